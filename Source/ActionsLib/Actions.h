@@ -52,6 +52,8 @@ template <typename ElemType>
 void DoCrossValidate(const ConfigParameters& config);
 template <typename ElemType>
 void DoWriteOutput(const ConfigParameters& config);
+template <typename ElemType>
+void DoQuantize(const ConfigParameters& config);
 
 // misc (OtherActions.cpp)
 template <typename ElemType>
@@ -163,6 +163,49 @@ template void DoEvalBN<float>(const ConfigParameters& config);
 template void DoEval<double>(const ConfigParameters& config);
 template void DoEval<float>(const ConfigParameters& config);
 
+// ===========================================================================
+// DoQuantize() - implements CNTK "quantize" command
+// ===========================================================================
+
+// Post-training int8 quantization: calibrates the input ranges of the Times and Convolution nodes on the reader's data,
+// stores their weights as int8 and saves the model to 'outputModelPath'.
+template <typename ElemType>
+void DoQuantize(const ConfigParameters& config)
+{
+    ConfigParameters readerConfig(config(L"reader"));
+    readerConfig.Insert("traceLevel", config(L"traceLevel", "0"));
+    if (!readerConfig.ExistsCurrent(L"randomize"))
+    {
+        readerConfig.Insert("randomize", "None");
+    }
+    DataReader reader(readerConfig);
+
+    ConfigArray minibatchSize = config(L"minibatchSize", "40960");
+    intargvector mbSize = minibatchSize;
+    size_t epochSize = config(L"epochSize", "0");
+    if (epochSize == 0)
+    {
+        epochSize = requestDataSize;
+    }
+    size_t numMinibatches = config(L"calibrationMinibatches", (size_t)100);
+    wstring modelPath = config(L"modelPath");
+    wstring outputModelPath = config(L"outputModelPath", modelPath + L".int8");
+    int traceLevel = config(L"traceLevel", "0");
+
+    vector<wstring> evalNodeNamesVector;
+    let net = GetModelFromConfig<ConfigParameters, ElemType>(config, L"evalNodeNames", evalNodeNamesVector);
+    net->SetTraceLevel(traceLevel);
+
+    SimpleEvaluator<ElemType> eval(net, nullptr, false, 100, 0, traceLevel);
+    auto inputRanges = eval.CalibrateInt8(&reader, evalNodeNamesVector, mbSize[0], numMinibatches, epochSize);
+    size_t numQuantized = net->QuantizeInt8(inputRanges);
+    fprintf(stderr, "Quantized %d of %d nodes to int8, saving model to %ls.\n", (int)numQuantized, (int)inputRanges.size(), outputModelPath.c_str());
+    net->Save(outputModelPath);
+}
+
+template void DoQuantize<double>(const ConfigParameters& config);
+template void DoQuantize<float>(const ConfigParameters& config);
+
 // ===========================================================================
 // DoCrossValidate() - implements CNTK "cv" command
 // ===========================================================================
@@ -153,6 +153,9 @@ ComputationNetworkPtr GetModelFromConfig(const ConfigRecordType& config, const w
     DEVICEID_TYPE deviceId = DeviceFromConfig(config);
 
     ConfigArray outputNodeNames = config(outputNodeNamesConfig.c_str(), ConfigArray(""));
+    bool fuseElementwiseOperations = config(L"fuseElementwiseOperations", false);
+    bool channelBlockedLayout = config(L"channelBlockedLayout", false);
+    bool foldBatchNormalization = config(L"foldBatchNormalization", false);
 
     ComputationNetworkPtr net;
 
@@ -163,10 +166,14 @@ ComputationNetworkPtr GetModelFromConfig(const ConfigRecordType& config, const w
     {
         // We have several ways to create a network.
         net = createNetworkFn(deviceId);
-        if (outputNodeNames.size() > 0)
+        if (outputNodeNames.size() > 0 || fuseElementwiseOperations || channelBlockedLayout || foldBatchNormalization)
         {
             net->InvalidateCompiledNetwork();
-            PatchOutputNodes(net, outputNodeNames, outputNodeNamesVector);
+            net->SetElementwiseFusion(fuseElementwiseOperations);
+            net->SetChannelBlockedLayout(channelBlockedLayout);
+            net->SetBatchNormalizationFolding(foldBatchNormalization);
+            if (outputNodeNames.size() > 0)
+                PatchOutputNodes(net, outputNodeNames, outputNodeNamesVector);
             net->CompileNetwork();
             // BUGBUG: This will generate double Validation output in the log
         }
@@ -179,6 +186,10 @@ ComputationNetworkPtr GetModelFromConfig(const ConfigRecordType& config, const w
         // By not compiling the network before patching, we avoid double log output for validation.
         net = make_shared<ComputationNetwork>(deviceId);
         net->SetTraceLevel(config(L"traceLevel", 0));
+        net->SetMemoryMappedParameters(config(L"memoryMappedModel", false));
+        net->SetElementwiseFusion(fuseElementwiseOperations);
+        net->SetChannelBlockedLayout(channelBlockedLayout);
+        net->SetBatchNormalizationFolding(foldBatchNormalization);
         net->Read<ElemType>(modelPath);
         if (outputNodeNames.size() > 0)
             PatchOutputNodes(net, outputNodeNames, outputNodeNamesVector);
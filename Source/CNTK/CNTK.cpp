@@ -25,6 +25,8 @@
 #include "CPUMatrix.h" // used for SetNumThreads()
 #include "GPUMatrix.h" // used for SyncGuard::EnableSync()
 #include "CommonMatrix.h"
+#include "ConvolutionEngine.h" // used for SetConvolutionAutotuning() and SetDirectAndWinogradConvolution()
+#include "CPUKernels.h" // used for SetCPUInstructionSet()
 #include "SGD.h"
 #include "MPIWrapper.h"
 #include "Config.h"
@@ -278,6 +280,10 @@ void DoCommands(const ConfigParameters& config, const shared_ptr<MPIWrapper>& mp
                 {
                     DoEvalBN<ElemType>(commandParams);
                 }
+                else if (thisAction == "quantize")
+                {
+                    DoQuantize<ElemType>(commandParams);
+                }
                 else if (thisAction == "adapt")
                 {
                     DoAdapt<ElemType>(commandParams);
@@ -522,6 +528,19 @@ int wmainWithBS(int argc, wchar_t* argv[]) // called from wmain which is a wrapp
     if (config(L"forceDeterministicAlgorithms", false))
         Globals::ForceDeterministicAlgorithms();
 
+    if (config(L"autotuneConvolution", false))
+    {
+        wstring tuningCacheFile = config(L"convolutionTuningCache", L"");
+        SetConvolutionAutotuning(true, tuningCacheFile);
+    }
+
+    if (config(L"directAndWinogradConvolution", false))
+        SetDirectAndWinogradConvolution(true);
+
+    wstring cpuInstructionSet = config(L"cpuInstructionSet", L"");
+    if (!cpuInstructionSet.empty())
+        SetCPUInstructionSet(CPUInstructionSetFromName(cpuInstructionSet));
+
 #ifndef CPUONLY
     auto valpp = config.Find(L"deviceId");
     if (valpp)
@@ -560,6 +579,7 @@ int wmainWithBS(int argc, wchar_t* argv[]) // called from wmain which is a wrapp
     }  
 
     g_shareNodeValueMatrices = config(L"shareNodeValueMatrices", false);
+    MatrixPool::SetMemorySharingByDefault(config(L"memorySharing", true));
 
     TracingGPUMemoryAllocator::SetTraceLevel(config(L"traceGPUMemoryAllocations", 0));
 
@@ -679,6 +699,19 @@ int wmainOldCNTKConfig(int argc, wchar_t* argv[])
     if (config(L"forceDeterministicAlgorithms", false))
         Globals::ForceDeterministicAlgorithms();
 
+    if (config(L"autotuneConvolution", false))
+    {
+        wstring tuningCacheFile = config(L"convolutionTuningCache", L"");
+        SetConvolutionAutotuning(true, tuningCacheFile);
+    }
+
+    if (config(L"directAndWinogradConvolution", false))
+        SetDirectAndWinogradConvolution(true);
+
+    wstring cpuInstructionSet = config(L"cpuInstructionSet", L"");
+    if (!cpuInstructionSet.empty())
+        SetCPUInstructionSet(CPUInstructionSetFromName(cpuInstructionSet));
+
     // get the command param set they want
     wstring logpath = config(L"stderr", L"");
 
@@ -700,6 +733,7 @@ int wmainOldCNTKConfig(int argc, wchar_t* argv[])
     } 
 
     g_shareNodeValueMatrices = config(L"shareNodeValueMatrices", false);
+    MatrixPool::SetMemorySharingByDefault(config(L"memorySharing", true));
 
     TracingGPUMemoryAllocator::SetTraceLevel(config(L"traceGPUMemoryAllocations", 0));
 
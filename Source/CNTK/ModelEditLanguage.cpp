@@ -606,6 +606,49 @@ void MELScript<ElemType>::CallFunction(const std::string& p_name, const ConfigPa
             fprintf(stderr, "Revise node %ls using parameter file %s\n", pNodes->NodeName().c_str(), paramPath.c_str());
         }
     }
+    else if (EqualInsensitive(name, "SetParameterStorage"))
+    {
+        typedef LearnableParameter<ElemType> LearnableParameterNode;
+        if (params.size() != 2)
+            RuntimeError("Invalid number of parameters: Valid parameters are: SetParameterStorage(nodeName, full|float16|bfloat16)");
+        std::string nodeName = params[0];
+        ReducedPrecisionFormat format = ReducedPrecisionFormatFromName(msra::strfun::utf16(params[1]));
+
+        NetNdl<ElemType>* netNdl;
+        vector<ComputationNodeBasePtr> nodes = FindSymbols(nodeName, netNdl);
+
+        for (auto& pNodes : nodes)
+        {
+            shared_ptr<LearnableParameterNode> pParamNode = std::dynamic_pointer_cast<LearnableParameterNode>(pNodes);
+            if (!pParamNode)
+            {
+                fprintf(stderr, "WARNING: you want to change the storage of node (%ls), but it is not a learnable parameter (it is a %ls node). Skipping this node\n",
+                        pNodes->NodeName().c_str(), pNodes->OperationName().c_str());
+                continue;
+            }
+            pParamNode->SetReducedPrecisionStorage(format);
+            fprintf(stderr, "Storing node %ls in %s precision\n", pNodes->NodeName().c_str(), ReducedPrecisionFormatName(format));
+        }
+    }
+    else if (EqualInsensitive(name, "FoldBatchNormalization"))
+    {
+        size_t numFixedParams = 1, numOptionalParams = 0;
+        if (params.size() > numFixedParams + numOptionalParams || params.size() < numFixedParams)
+            RuntimeError("Invalid number of parameters. Valid parameters: FoldBatchNormalization(modelName)");
+
+        std::string modelName = params[0];
+        auto found = m_mapNameToNetNdl.find(modelName);
+        if (found == m_mapNameToNetNdl.end())
+            RuntimeError("Model %s does not exist. Cannot fold batch normalization in non-existant model.", modelName.c_str());
+
+        // folding needs the validated network, in particular the running statistics in their current format
+        NetNdl<ElemType>* netNdl = &found->second;
+        ProcessNDLScript(netNdl, ndlPassAll, true);
+        if (!netNdl->cn->IsCompiled())
+            netNdl->cn->CompileNetwork();
+        size_t numFolded = netNdl->cn->FoldBatchNormalization();
+        fprintf(stderr, "Folded %d BatchNormalization nodes of model %s.\n", (int)numFolded, modelName.c_str());
+    }
     else
     {
         RuntimeError("Unknown Editor function %s", name.c_str());
@@ -332,7 +332,7 @@ public:
     // The layout and shape of the data in inputs vector must match the schema returned by GetInputLayouts.
     // Output must be preallocated and sized to avoid memory allocation / deallocation across DLL
     // boundaries.
-    // This method is not reentrant, as the forward pass keeps internal state.
+    // This method is not reentrant, as the forward pass keeps internal state. Use CreateSession() to evaluate concurrently.
     // inputs - vector of input buffers, one for every input as given by GetInputLayouts()
     // outputs - vector of output buffers. Must be sized to fit output schema.
     //
@@ -355,6 +355,30 @@ public:
     // resetRNN - flags whether to reset memory cells of RNN. 
     //
     virtual void ForwardPass(const ValueRefs<ElemType>& inputs, ValueRefs<ElemType>& output, bool resetRNN) = 0;
+
+    //
+    // ForwardPassBatched - thread-safe ForwardPass() for serving many concurrent callers with small requests.
+    // Each request is a single sample or a single sequence (of any length) per input. Requests from different
+    // threads are queued and merged into one minibatch, in which every request is a separate sequence, then one
+    // forward pass is run and the outputs are scattered back to the callers. A minibatch is evaluated once it
+    // holds 'maxBatchSize' requests (default 32), or when the oldest request has waited 'maxBatchWaitMs'
+    // milliseconds (default 5). Both are set in the configuration passed to CreateNetwork().
+    // Sequences always start with reset RNN state. Must be called after StartForwardEvaluation(), and must not be
+    // mixed with concurrent ForwardPass() calls on the same object.
+    // inputs - one input buffer per input, as for ForwardPass()
+    // outputs - one output buffer per output, sized to fit the outputs of this request
+    //
+    virtual void ForwardPassBatched(const Values<ElemType>& inputs, Values<ElemType>& output) = 0;
+
+    //
+    // CreateSession - create a lightweight evaluator for the same model, which shares the model parameters with
+    // this one instead of loading them again. A session has its own activation buffers and minibatch layouts,
+    // so that different sessions can call ForwardPass() concurrently from different threads. If
+    // StartForwardEvaluation() was already called, the session is started for the same outputs.
+    // Sessions keep the shared parameters alive and are released by Destroy(), independently of this object.
+    // This method may be called concurrently, but not concurrently with ForwardPass() on this object.
+    //
+    virtual IEvaluateModelExtended<ElemType>* CreateSession() = 0;
 };
 
 template <typename ElemType>
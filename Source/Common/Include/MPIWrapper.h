@@ -72,6 +72,11 @@ class MPIWrapper : public std::enable_shared_from_this<MPIWrapper>
     // MPI communicator that reflects the current subset selection
     MPI_Comm m_currentComm;
 
+    // sub-communicators of m_currentComm for hierarchical reductions, see SplitByHost()
+    MPI_Comm m_intraHostComm; // the ranks on the same host as this one
+    MPI_Comm m_interHostComm; // the first rank of each host, MPI_COMM_NULL on the others
+    size_t m_numHosts;
+
     static MPIWrapperPtr s_mpi;
 
     // MPI_Init() with delay-loading the msmpi.dll (possibly causing a failure if missing; we want to catch that)
@@ -121,7 +126,7 @@ class MPIWrapper : public std::enable_shared_from_this<MPIWrapper>
 
 public:
     MPIWrapper()
-        : m_currentComm(MPI_COMM_WORLD)
+        : m_currentComm(MPI_COMM_WORLD), m_intraHostComm(MPI_COMM_NULL), m_interHostComm(MPI_COMM_NULL), m_numHosts(0)
     {
         static bool initialized = false;
         if (initialized)
@@ -392,6 +397,72 @@ public:
     {
         MPI_Barrier(m_currentComm) || MpiFail("waitall: MPI_Barrier");
     }
+
+    // -----------------------------------------------------------------------
+    // hierarchical reductions: within each host first, then across hosts
+    // -----------------------------------------------------------------------
+
+    // Groups the ranks in use by the host they run on (the ranks that can share memory), and connects the first rank
+    // of each host, its leader, with the leaders of the other hosts. With ranksPerHost > 0 consecutive ranks are
+    // grouped instead, which simulates several hosts on one. Must be called by all ranks; replaces an earlier split.
+    void SplitByHost(size_t ranksPerHost = 0)
+    {
+        UndoSplitByHost();
+        if (Communicator() == MPI_COMM_NULL)
+            return;
+
+        int rank;
+        MPI_Comm_rank(Communicator(), &rank) || MpiFail("splitbyhost: MPI_Comm_rank");
+        if (ranksPerHost > 0)
+            MPI_Comm_split(Communicator(), rank / (int) ranksPerHost, rank, &m_intraHostComm) || MpiFail("splitbyhost: MPI_Comm_split");
+        else
+            MPI_Comm_split_type(Communicator(), MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &m_intraHostComm) || MpiFail("splitbyhost: MPI_Comm_split_type");
+
+        int intraHostRank;
+        MPI_Comm_rank(m_intraHostComm, &intraHostRank) || MpiFail("splitbyhost: MPI_Comm_rank");
+        MPI_Comm_split(Communicator(), (intraHostRank == 0) ? 0 : MPI_UNDEFINED, rank, &m_interHostComm) || MpiFail("splitbyhost: MPI_Comm_split");
+
+        int numHosts = (intraHostRank == 0) ? 1 : 0;
+        MPI_Allreduce(MPI_IN_PLACE, &numHosts, 1, MPI_INT, MPI_SUM, Communicator()) || MpiFail("splitbyhost: MPI_Allreduce");
+        m_numHosts = numHosts;
+
+        int numRanksOnHost;
+        MPI_Comm_size(m_intraHostComm, &numRanksOnHost) || MpiFail("splitbyhost: MPI_Comm_size");
+        fprintf(stderr, "splitbyhost: %d ranks on %d hosts; we (%d) share our host with %d ranks%s\n",
+                (int) NumNodesInUse(), (int) m_numHosts, (int) CurrentNodeRank(), numRanksOnHost - 1, IsHostLeader() ? " and lead it" : "");
+        fflush(stderr);
+    }
+
+    // Releases the communicators of SplitByHost(). Must be called by all ranks.
+    void UndoSplitByHost()
+    {
+        if (m_intraHostComm != MPI_COMM_NULL)
+            MPI_Comm_free(&m_intraHostComm) || MpiFail("splitbyhost: MPI_Comm_free");
+        if (m_interHostComm != MPI_COMM_NULL)
+            MPI_Comm_free(&m_interHostComm) || MpiFail("splitbyhost: MPI_Comm_free");
+        m_numHosts = 0;
+    }
+
+    bool IsSplitByHost() const
+    {
+        return m_intraHostComm != MPI_COMM_NULL;
+    }
+    MPI_Comm IntraHostCommunicator() const
+    {
+        return m_intraHostComm;
+    }
+    MPI_Comm InterHostCommunicator() const
+    {
+        return m_interHostComm;
+    }
+    size_t NumHosts() const
+    {
+        return m_numHosts;
+    }
+    bool IsHostLeader() const
+    {
+        return m_interHostComm != MPI_COMM_NULL;
+    } // the rank that communicates for its host
 };
 
 }}}
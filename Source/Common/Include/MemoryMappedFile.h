@@ -0,0 +1,49 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// MemoryMappedFile.h -- read-only memory mapping of a whole file
+//
+
+#pragma once
+
+#include "Basics.h"
+#include <string>
+#include <stdint.h>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// MemoryMappedFile -- maps a file read-only into the address space of the process.
+// The pages are backed by the file itself, so all processes on a host that map the same file
+// share its pages through the OS page cache. The mapping is released when this object is destroyed,
+// so users of GetData() must keep it alive (typically through a shared_ptr).
+class MemoryMappedFile
+{
+public:
+    MemoryMappedFile(const std::wstring& fileName);
+    ~MemoryMappedFile();
+
+    const char* GetData() const { return m_data; }
+    uint64_t Size() const { return m_size; }
+
+    // pointer to the bytes at 'offset' in the file, if the range [offset, offset + size) is inside the file
+    const char* TryGetData(uint64_t offset, uint64_t size) const
+    {
+        return (offset <= m_size && size <= m_size - offset) ? m_data + offset : nullptr;
+    }
+
+private:
+    DISABLE_COPY_AND_MOVE(MemoryMappedFile);
+
+    std::wstring m_fileName;
+    const char* m_data;
+    uint64_t m_size;
+#ifdef _WIN32
+    void* m_fileHandle;
+    void* m_mappingHandle;
+#else
+    int m_fileDescriptor;
+#endif
+};
+
+}}}
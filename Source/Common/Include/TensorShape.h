@@ -794,17 +794,25 @@ private:
 // Nodes that do semantic interpretation of width, height, channel information must know which index they are in.
 // Eventually this can go away once we switch completely to cudnn layout.
 // The cudnn layout is actually our layout in order W,H,C.
+// CHWc is the cudnn layout with the channels in blocks of ImageChannelBlockSize, interleaved per pixel:
+// [W x H x C] is stored as [c x W x H x C/c], c = ImageChannelBlockSize. It lets CPU kernels process a block of channels
+// with unit-stride SIMD access. It is not selectable in configs; ComputationNetwork picks it for image layers on the CPU
+// (see ComputationNetwork::SetChannelBlockedLayout()), which keep the tensor shapes of the cudnn layout.
 enum ImageLayoutKind
 {
     HWC, // legacy; default for NDL
-    CHW  // cudnn; default for BrainScript
+    CHW, // cudnn; default for BrainScript
+    CHWc // channel-blocked cudnn; CPU only
 };
+static const size_t ImageChannelBlockSize = 8;
 static inline std::string ToString(ImageLayoutKind imageLayoutKind)
 {
     if (imageLayoutKind == ImageLayoutKind::CHW)
         return "CHW";
     else if (imageLayoutKind == ImageLayoutKind::HWC)
         return "HWC";
+    else if (imageLayoutKind == ImageLayoutKind::CHWc)
+        return "CHWc";
     else
         LogicError("ImageLayout: Invalid ImageLayoutKind");
 }
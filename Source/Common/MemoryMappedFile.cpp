@@ -0,0 +1,93 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// MemoryMappedFile.cpp -- read-only memory mapping of a whole file
+//
+
+#define _CRT_SECURE_NO_WARNINGS // "secure" CRT not available on all platforms  --add this at the top of all CPP files that give "function or variable may be unsafe" warnings
+
+#include "MemoryMappedFile.h"
+#ifdef _WIN32
+#define NOMINMAX
+#include "Windows.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+MemoryMappedFile::MemoryMappedFile(const std::wstring& fileName)
+    : m_fileName(fileName), m_data(nullptr), m_size(0)
+{
+#ifdef _WIN32
+    m_mappingHandle = nullptr;
+    m_fileHandle = CreateFileW(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (m_fileHandle == INVALID_HANDLE_VALUE)
+        RuntimeError("MemoryMappedFile: Unable to open file %ls, error %x", fileName.c_str(), (unsigned int)GetLastError());
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(m_fileHandle, &size))
+    {
+        CloseHandle(m_fileHandle);
+        RuntimeError("MemoryMappedFile: Unable to retrieve the size of file %ls, error %x", fileName.c_str(), (unsigned int)GetLastError());
+    }
+    m_size = size.QuadPart;
+    if (m_size == 0)
+        return;
+
+    m_mappingHandle = CreateFileMapping(m_fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (m_mappingHandle != NULL)
+        m_data = (const char*)MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    if (m_data == nullptr)
+    {
+        if (m_mappingHandle != NULL)
+            CloseHandle(m_mappingHandle);
+        CloseHandle(m_fileHandle);
+        RuntimeError("MemoryMappedFile: Could not memory map file %ls, error %x", fileName.c_str(), (unsigned int)GetLastError());
+    }
+#else
+    m_fileDescriptor = open(msra::strfun::utf8(fileName).c_str(), O_RDONLY);
+    if (m_fileDescriptor == -1)
+        RuntimeError("MemoryMappedFile: Unable to open file %ls", fileName.c_str());
+
+    struct stat sb;
+    if (fstat(m_fileDescriptor, &sb) == -1)
+    {
+        close(m_fileDescriptor);
+        RuntimeError("MemoryMappedFile: Unable to retrieve the size of file %ls", fileName.c_str());
+    }
+    m_size = sb.st_size;
+    if (m_size == 0)
+        return;
+
+    // MAP_SHARED: the pages are the page cache of the file, never private copies
+    void* data = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, m_fileDescriptor, 0);
+    if (data == MAP_FAILED)
+    {
+        close(m_fileDescriptor);
+        RuntimeError("MemoryMappedFile: Could not memory map file %ls", fileName.c_str());
+    }
+    m_data = (const char*)data;
+#endif
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+#ifdef _WIN32
+    if (m_data)
+        UnmapViewOfFile(m_data);
+    if (m_mappingHandle)
+        CloseHandle(m_mappingHandle);
+    CloseHandle(m_fileHandle);
+#else
+    if (m_data)
+        munmap((void*)m_data, m_size);
+    close(m_fileDescriptor);
+#endif
+}
+
+}}}
@@ -36,13 +36,13 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 // -----------------------------------------------------------------------
 
 template <>
-vector<shared_ptr<Matrix<float>>>& MatrixPool::GetReleasedMatrices<float>()
+MatrixPool::ReleasedMatrices<float>& MatrixPool::GetReleasedMatrices<float>()
 {
     return m_releasedFloatMatrices;
 }
 
 template <>
-vector<shared_ptr<Matrix<double>>>& MatrixPool::GetReleasedMatrices<double>()
+MatrixPool::ReleasedMatrices<double>& MatrixPool::GetReleasedMatrices<double>()
 {
     return m_releasedDoubleMatrices;
 }
@@ -198,7 +198,7 @@ void ComputationNetwork::SaveToFileImpl(const wstring& fileName, const FileOptio
 // This is also used for reloading a model without recreating it, e.g. during training.
 // TODO: Why not just reload it? Because SGD::Train() holds pointers to the parameters directly? That should be fixed.
 template <class ElemType> // ElemType is the default for models prior to CNTK_MODEL_VERSION_7; after that, it is serialized, and ElemType is ignored
-void ComputationNetwork::ReadPersistableParameters(File& fstream, bool create)
+void ComputationNetwork::ReadPersistableParameters(File& fstream, bool create, const shared_ptr<MemoryMappedFile>& mappedFile)
 {
     fstream.GetMarker(FileMarker::fileMarkerBeginSection, L"BCN");
 
@@ -238,6 +238,12 @@ void ComputationNetwork::ReadPersistableParameters(File& fstream, bool create)
         else
             RuntimeError("Read: Unexpected precision tag '%ls'", precision.c_str());
 
+        if (mappedFile)
+        {
+            auto mappableNode = dynamic_pointer_cast<IMemoryMappable>(node);
+            if (mappableNode)
+                mappableNode->SetMemoryMappedFile(mappedFile);
+        }
         node->Load(fstream, modelVersion);
 
         if (create) // loaded from scratch
@@ -268,7 +274,12 @@ void ComputationNetwork::Read(const wstring& fileName)
 
     File fstream(fileName, FileOptions::fileOptionsBinary | FileOptions::fileOptionsRead);
 
-    ReadPersistableParameters<ElemType>(fstream, true);
+    // parameter values can only be used in place by the CPU
+    shared_ptr<MemoryMappedFile> mappedFile;
+    if (m_memoryMappedParameters && m_deviceId == CPUDEVICE)
+        mappedFile = make_shared<MemoryMappedFile>(fileName);
+
+    ReadPersistableParameters<ElemType>(fstream, true, mappedFile);
 
     size_t numNodes = m_nameToNodeMap.size();
 
@@ -638,6 +649,42 @@ void ComputationNetwork::SetSeqParam(ComputationNetworkPtr net,
     }
 }
 
+// enable/disable the 16-bit quantized CPU forward pass of Times and TransposeTimes operations whose weight is a parameter
+template <class ElemType>
+/*static*/ void ComputationNetwork::SetQuantizedInference(ComputationNetworkPtr net, const ComputationNodeBasePtr& rootNode, bool enable)
+{
+    if (enable && net->GetDeviceId() != CPUDEVICE)
+    {
+        fprintf(stderr, "WARNING: Quantized inference is only supported on the CPU, ignoring.\n");
+        return;
+    }
+
+    list<ComputationNodeBasePtr> timesNodes = net->GetNodesWithType(OperationNameOf(TimesNode), rootNode);
+    list<ComputationNodeBasePtr> transposeTimesNodes = net->GetNodesWithType(OperationNameOf(TransposeTimesNode), rootNode);
+    size_t numQuantized = 0;
+    for (auto& nodeIter : timesNodes)
+    {
+        auto node = dynamic_pointer_cast<TimesNodeBase<ElemType, false>>(nodeIter);
+        if (!node)
+            continue;
+        bool quantize = enable && nodeIter->GetInputs()[0]->OperationName() == OperationNameOf(LearnableParameter);
+        node->SetQuantizedInference(quantize);
+        numQuantized += quantize;
+    }
+    for (auto& nodeIter : transposeTimesNodes)
+    {
+        auto node = dynamic_pointer_cast<TimesNodeBase<ElemType, true>>(nodeIter);
+        if (!node)
+            continue;
+        bool quantize = enable && nodeIter->GetInputs()[0]->OperationName() == OperationNameOf(LearnableParameter);
+        node->SetQuantizedInference(quantize);
+        numQuantized += quantize;
+    }
+
+    if (enable)
+        fprintf(stderr, "Enabled quantized inference for %d out of %d Times operations.\n", (int)numQuantized, (int)(timesNodes.size() + transposeTimesNodes.size()));
+}
+
 // -----------------------------------------------------------------------
 // unit test
 // -----------------------------------------------------------------------
@@ -1488,23 +1535,25 @@ void ComputationNetwork::SaveToDbnFile(ComputationNetworkPtr net, const std::wst
 
 template void ComputationNetwork::InitLearnableParametersWithBilinearFill<float>(const ComputationNodeBasePtr& node, size_t kernelWidth, size_t kernelHeight);
 template void ComputationNetwork::Read<float>(const wstring& fileName);
-template void ComputationNetwork::ReadPersistableParameters<float>(File& fstream, bool create);
+template void ComputationNetwork::ReadPersistableParameters<float>(File& fstream, bool create, const shared_ptr<MemoryMappedFile>& mappedFile);
 template void ComputationNetwork::PerformSVDecomposition<float>(const map<wstring, float>& SVDConfig, size_t alignedsize);
 template /*static*/ void ComputationNetwork::SetDropoutRate<float>(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, const double dropoutRate, double& prevDropoutRate, size_t randSeedBase);
 template /*static*/ void ComputationNetwork::SetBatchNormalizationTimeConstants<float>(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, const double normalizationTimeConstant, double& prevNormalizationTimeConstant, double blendTimeConstant, double& prevBlendTimeConstant);
 template void ComputationNetwork::SetSeqParam<float>(ComputationNetworkPtr net, const ComputationNodeBasePtr criterionNode, const double& hsmoothingWeight, const double& frameDropThresh, const bool& doreferencealign,
                                                      const double& amf, const double& lmf, const double& wp, const double& bMMIfactor, const bool& sMBR);
 template void ComputationNetwork::SaveToDbnFile<float>(ComputationNetworkPtr net, const std::wstring& fileName) const;
+template /*static*/ void ComputationNetwork::SetQuantizedInference<float>(ComputationNetworkPtr net, const ComputationNodeBasePtr& rootNode, bool enable);
 
 template void ComputationNetwork::InitLearnableParametersWithBilinearFill<double>(const ComputationNodeBasePtr& node, size_t kernelWidth, size_t kernelHeight);
 template void ComputationNetwork::Read<double>(const wstring& fileName);
-template void ComputationNetwork::ReadPersistableParameters<double>(File& fstream, bool create);
+template void ComputationNetwork::ReadPersistableParameters<double>(File& fstream, bool create, const shared_ptr<MemoryMappedFile>& mappedFile);
 template void ComputationNetwork::PerformSVDecomposition<double>(const map<wstring, float>& SVDConfig, size_t alignedsize);
 template /*static*/ void ComputationNetwork::SetDropoutRate<double>(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, const double dropoutRate, double& prevDropoutRate, size_t randSeedBase);
 template /*static*/ void ComputationNetwork::SetBatchNormalizationTimeConstants<double>(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, const double normalizationTimeConstant, double& prevNormalizationTimeConstant, double blendTimeConstant, double& prevBlendTimeConstant);
 template void ComputationNetwork::SetSeqParam<double>(ComputationNetworkPtr net, const ComputationNodeBasePtr criterionNode, const double& hsmoothingWeight, const double& frameDropThresh, const bool& doreferencealign,
                                                       const double& amf, const double& lmf, const double& wp, const double& bMMIfactor, const bool& sMBR);
 template void ComputationNetwork::SaveToDbnFile<double>(ComputationNetworkPtr net, const std::wstring& fileName) const;
+template /*static*/ void ComputationNetwork::SetQuantizedInference<double>(ComputationNetworkPtr net, const ComputationNodeBasePtr& rootNode, bool enable);
 
 // register ComputationNetwork with the ScriptableObject system
 ScriptableObjects::ConfigurableRuntimeTypeRegister::Add<ComputationNetwork> registerComputationNetwork(L"ComputationNetwork");
@@ -52,6 +52,10 @@ public:
         m_randomSeedOffset(0),
         m_isCompiled(false),
         m_areMatricesAllocated(false),
+        m_memoryMappedParameters(false),
+        m_elementwiseFusion(false),
+        m_batchNormalizationFolding(false),
+        m_channelBlockedLayout(false),
         m_pMBLayoutOfNetwork(make_shared<MBLayout>(1, 0, L"*")),
         m_environment(make_shared<ComputationEnvironment>())
     {
@@ -90,7 +94,7 @@ public:
     // -----------------------------------------------------------------------
 
     template <class ElemType>
-    void ReadPersistableParameters(File& fstream, bool create);
+    void ReadPersistableParameters(File& fstream, bool create, const shared_ptr<MemoryMappedFile>& mappedFile = nullptr);
     // reload node content only, e.g. used by SGD::Train() when going back to an older model that had better training objective
     template <class ElemType>
     void RereadPersistableParameters(const std::wstring& fileName)
@@ -118,6 +122,12 @@ public:
     }
 
     void Save(const std::wstring& fileName, const FileOptions fileFormat = FileOptions::fileOptionsBinary) const;
+
+    // If enabled, Read() memory-maps the model file, and parameters on the CPU use their values in place instead of
+    // reading a copy. All processes on a host that load the same model then share these pages through the OS page cache.
+    // The parameters are read-only in this mode, so it is only meant for evaluation.
+    void SetMemoryMappedParameters(bool enable) { m_memoryMappedParameters = enable; }
+    bool IsMemoryMappedParameters() const { return m_memoryMappedParameters; }
     void SaveEdited(const std::wstring& fileName, const FileOptions fileFormat = FileOptions::fileOptionsBinary);
 
 private:
@@ -175,8 +185,28 @@ public:
 
     void CompileNetwork(); // call this after creation, Load(), and any modification
 
+    // If enabled, CompileNetwork() replaces chains of element-wise operations on the CPU by FusedElementwiseNodes,
+    // which compute the whole chain in a single pass over memory without storing the intermediate values.
+    void SetElementwiseFusion(bool enable) { m_elementwiseFusion = enable; }
+    bool IsElementwiseFusion() const { return m_elementwiseFusion; }
+
+    // If enabled, CompileNetwork() folds batch normalizations into the weights and biases of the preceding convolutions
+    // or matrix products (see FoldBatchNormalization()). For inference only.
+    void SetBatchNormalizationFolding(bool enable) { m_batchNormalizationFolding = enable; }
+    bool IsBatchNormalizationFolding() const { return m_batchNormalizationFolding; }
+
+    // If enabled, CompileNetwork() lets connected convolutions, poolings and batch normalizations on the CPU compute on the
+    // channel-blocked image layout, reordering their values from and to the cudnn layout only at the region boundaries.
+    // For inference only.
+    void SetChannelBlockedLayout(bool enable) { m_channelBlockedLayout = enable; }
+    bool IsChannelBlockedLayout() const { return m_channelBlockedLayout; }
+
+    bool IsCompiled() const { return m_isCompiled; }
+
 private:
     void ValidateNetwork();
+    size_t FuseElementwiseOperations();
+    size_t UseChannelBlockedLayout();
     size_t ValidateNodes(list<ComputationNodeBasePtr> nodes, bool isFirstPass, bool isFinalValidationPass);
     bool ValidateNode(ComputationNodeBasePtr node, bool isFinalValidationPass) const;
     void MarkValueNonSharableNodes();
@@ -187,7 +217,6 @@ private:
     void CollectInputAndLearnableParameters(const ComputationNodeBasePtr& rootNode);
     void CollectInputAndLearnableParametersRec(const ComputationNodeBasePtr& node, set<ComputationNodeBasePtr>& visited, list<ComputationNodeBasePtr>& inputs, list<ComputationNodeBasePtr>& learnableParameters);
     void ResetMBLayouts();
-    bool IsCompiled() const { return m_isCompiled; }
     bool AreMatricesAllocated() const { return m_areMatricesAllocated; }
     void VerifyIsCompiled(const char* where) const;
 public:
@@ -374,6 +403,7 @@ public:
     ComputationNodeBasePtr CopyNode(const ComputationNetwork& fromNet, const std::wstring fromName, std::wstring toName, const CopyNodeFlags flags);
     void CopySubTree(const ComputationNetwork& fromNet, const std::wstring fromName, std::wstring toNamePrefix, const CopyNodeFlags flags);
     void CopyInputs(const std::wstring fromName, std::wstring toName);
+    ComputationNetworkPtr CloneWithSharedParameters() const;
     void RenameNode(const std::wstring& nodeNameOrig, const std::wstring& nodeNameNew);
     void RenameNode(ComputationNodeBasePtr node, const std::wstring& newNodeName);
     void DeleteNode(const std::wstring& nodeName);
@@ -384,6 +414,9 @@ public:
     void AddFeatureNode(ComputationNodeBasePtr featureNode);
     //ComputationNodeBasePtr RemoveFeatureNode(ComputationNodeBasePtr featureNode);
     void SetLearnableNodesBelowLearningRateMultiplier(const float learningRateMultiplier, const ComputationNodeBasePtr& rootNode = nullptr);
+    size_t FoldBatchNormalization();
+    std::vector<ComputationNodeBasePtr> GetInt8QuantizableNodes(const std::vector<ComputationNodeBasePtr>& rootNodes) const;
+    size_t QuantizeInt8(const std::map<ComputationNodeBasePtr, double>& inputRanges);
 
     // -----------------------------------------------------------------------
     // node access
@@ -465,6 +498,8 @@ public:
                             const double& bMMIfactor = 0.0f,
                             const bool& sMBR = false);
     static void SetMaxTempMemSizeForCNN(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, const size_t maxTempMemSizeInSamples);
+    template <class ElemType>
+    static void SetQuantizedInference(ComputationNetworkPtr net, const ComputationNodeBasePtr& rootNode, bool enable);
 
     // -----------------------------------------------------------------------
     // node-group access
@@ -1114,6 +1149,10 @@ private:
     // cache for evaluation ordering:
     bool m_isCompiled; // CompileNetwork has been called
     bool m_areMatricesAllocated; // AllocateAllMatrices has been called
+    bool m_memoryMappedParameters; // Read() uses parameter values in place from the memory-mapped model file
+    bool m_elementwiseFusion;      // CompileNetwork() fuses chains of element-wise operations
+    bool m_batchNormalizationFolding; // CompileNetwork() folds batch normalizations into convolutions and matrix products
+    bool m_channelBlockedLayout;   // CompileNetwork() lets image regions compute on the channel-blocked layout
 
     // cached network iterations
     std::map<const ComputationNodeBasePtr, std::list<ComputationNodeBasePtr>> m_evalOrders; // [out node] flat depth-first traversal starting from out node
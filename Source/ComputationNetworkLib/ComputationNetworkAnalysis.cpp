@@ -9,8 +9,11 @@
 #include "ComputationNode.h"
 #include "ComputationNetwork.h"
 #include "RecurrentNodes.h"
+#include "SpecialPurposeNodes.h"
+#include "ConvolutionalNodes.h"
 #include <string>
 #include <set>
+#include <algorithm>
 
 using namespace std;
 
@@ -475,4 +478,300 @@ static int DetermineLoopDirection(const std::vector<ComputationNodeBasePtr>& nes
     return steppingDirection;
 }
 
+// -----------------------------------------------------------------------
+// element-wise operator fusion
+// -----------------------------------------------------------------------
+
+// A node can be folded into the fused node that replaces 'root' if it computes a single element-wise
+// operation on operands of the dimensions of 'root', so that each element of the result only
+// depends on the elements of the operands at the same position. Inputs without MBLayout are
+// broadcast along the minibatch when 'root' has one.
+static bool IsFusibleElementwiseInput(const ComputationNodeBasePtr& input, const ComputationNodeBasePtr& root)
+{
+    // trailing singleton dimensions are padded, e.g. a [4] input fits a [4 x 1] result
+    const auto& inputShape = input->GetSampleLayout();
+    const auto& rootShape = root->GetSampleLayout();
+    if (inputShape.GetRank() > rootShape.GetRank())
+        return false;
+    for (size_t k = 0; k < rootShape.GetRank(); k++)
+        if (inputShape.GetDimPadded(k) != rootShape[k])
+            return false;
+    return input->GetMBLayout() == root->GetMBLayout() || (root->HasMBLayout() && !input->HasMBLayout());
+}
+
+template <class ElemType>
+static bool IsFusibleElementwiseNode(const ComputationNodeBasePtr& node, const ComputationNodeBasePtr& root)
+{
+    if (!node->Is<IFusibleElementwiseNode>() || !node->Is<ComputationNode<ElemType>>() || node->IsPartOfLoop() ||
+        !IsFusibleElementwiseInput(node, root) || node->GetMBLayout() != root->GetMBLayout())
+        return false;
+    for (const auto& input : node->GetInputs())
+        if (!IsFusibleElementwiseInput(input, root))
+            return false;
+    return true;
+}
+
+// collect the chain of element-wise nodes that ends in 'root', and that can be computed in a single pass
+// Intermediate nodes must have no other consumers and must not be outputs, criteria etc.
+template <class ElemType>
+static std::vector<ComputationNodeBasePtr> CollectFusibleElementwiseChain(const ComputationNodeBasePtr& root,
+                                                                          const std::map<ComputationNodeBasePtr, size_t>& numConsumers,
+                                                                          const std::set<ComputationNodeBasePtr>& groupNodes)
+{
+    std::vector<ComputationNodeBasePtr> chain;
+    if (!IsFusibleElementwiseNode<ElemType>(root, root))
+        return chain;
+    chain.push_back(root);
+    for (size_t k = 0; k < chain.size(); k++)
+    {
+        for (const auto& input : chain[k]->GetInputs())
+        {
+            if (chain.size() >= FusedElementwiseNode<ElemType>::MaxNumSteps)
+                break;
+            auto consumers = numConsumers.find(input);
+            if (consumers == numConsumers.end() || consumers->second != 1 || groupNodes.find(input) != groupNodes.end() ||
+                std::find(chain.begin(), chain.end(), input) != chain.end() || !IsFusibleElementwiseNode<ElemType>(input, root))
+                continue;
+            chain.push_back(input);
+        }
+    }
+    return chain;
+}
+
+// create the node that computes 'chain' (sorted in evaluation order, ending in the root) from 'inputs'
+template <class ElemType>
+static ComputationNodeBasePtr CreateFusedElementwiseNode(const std::vector<ComputationNodeBasePtr>& chain, std::vector<ComputationNodeBasePtr>& inputs)
+{
+    // the inputs are the operands that are computed outside of the chain
+    for (const auto& node : chain)
+        for (const auto& operand : node->GetInputs())
+            if (std::find(chain.begin(), chain.end(), operand) == chain.end() && std::find(inputs.begin(), inputs.end(), operand) == inputs.end())
+                inputs.push_back(operand);
+
+    // operands refer to an input, or to the result of an earlier step
+    std::vector<FusedElementwiseStep> steps;
+    for (const auto& node : chain)
+    {
+        FusedElementwiseStep step = node->As<IFusibleElementwiseNode>()->GetFusedElementwiseStep();
+        for (size_t k = 0; k < step.m_numOperands; k++)
+        {
+            const auto& operand = node->GetInputs()[step.m_operands[k]];
+            auto iter = std::find(chain.begin(), chain.end(), operand);
+            if (iter != chain.end())
+                step.m_operands[k] = inputs.size() + (iter - chain.begin());
+            else
+                step.m_operands[k] = std::find(inputs.begin(), inputs.end(), operand) - inputs.begin();
+        }
+        steps.push_back(step);
+    }
+    const auto& root = chain.back();
+    return New<FusedElementwiseNode<ElemType>>(root->GetDeviceId(), root->NodeName(), steps);
+}
+
+// FuseElementwiseOperations() -- replace chains of element-wise nodes by FusedElementwiseNodes
+// Each chain is evaluated in a single pass over the data, without materializing the intermediate results.
+// This is called from CompileNetwork() on a validated network, which must be compiled again after this
+// if anything was replaced. The intermediate nodes are removed from the network, while the fused node
+// takes over the name of the last node of the chain. Only done for networks on the CPU.
+// Returns the number of nodes that were removed.
+size_t ComputationNetwork::FuseElementwiseOperations()
+{
+    if (m_deviceId != CPUDEVICE)
+        return 0;
+
+    std::map<ComputationNodeBasePtr, size_t> numConsumers;
+    for (const auto& iter : m_nameToNodeMap)
+        for (const auto& input : iter.second->GetInputs())
+            numConsumers[input]++;
+    std::set<ComputationNodeBasePtr> groupNodes;
+    for (auto group : GetAllNodeGroups())
+        groupNodes.insert(group->begin(), group->end());
+    for (const auto& namedCriterion : m_namedCriterionNodes)
+        groupNodes.insert(namedCriterion.second.begin(), namedCriterion.second.end());
+
+    const auto& evalOrder = GetEvalOrder(nullptr);
+    std::vector<ComputationNodeBasePtr> nodes(evalOrder.begin(), evalOrder.end());
+    std::map<ComputationNodeBasePtr, size_t> evalPosition;
+    for (size_t i = 0; i < nodes.size(); i++)
+        evalPosition[nodes[i]] = i;
+
+    // visit the nodes from the top, so that each chain is as long as possible
+    std::set<ComputationNodeBasePtr> fusedNodes;
+    std::vector<std::pair<std::vector<ComputationNodeBasePtr>, ComputationNodeBasePtr>> replacements; // [](chain, fused node)
+    for (size_t i = nodes.size(); i-- > 0;)
+    {
+        const auto& root = nodes[i];
+        if (fusedNodes.find(root) != fusedNodes.end())
+            continue;
+        bool isFloat = root->Is<ComputationNode<float>>();
+        auto chain = isFloat ? CollectFusibleElementwiseChain<float>(root, numConsumers, groupNodes)
+                             : CollectFusibleElementwiseChain<double>(root, numConsumers, groupNodes);
+        if (chain.size() < 2)
+            continue;
+        sort(chain.begin(), chain.end(), [&evalPosition](const ComputationNodeBasePtr& a, const ComputationNodeBasePtr& b)
+        {
+            return evalPosition[a] < evalPosition[b];
+        });
+        std::vector<ComputationNodeBasePtr> inputs;
+        auto fusedNode = isFloat ? CreateFusedElementwiseNode<float>(chain, inputs) : CreateFusedElementwiseNode<double>(chain, inputs);
+        fusedNode->AttachInputs(inputs);
+        fusedNodes.insert(chain.begin(), chain.end());
+        replacements.push_back(make_pair(chain, fusedNode));
+    }
+
+    // replace the chains, now that all of them have been determined from the original network
+    size_t numRemovedNodes = 0;
+    for (auto& replacement : replacements)
+    {
+        const auto& chain = replacement.first;
+        const auto& root = chain.back();
+        const auto& fusedNode = replacement.second;
+        if (TraceLevel() > 0)
+            fprintf(stderr, "FuseElementwiseOperations: Fusing %d element-wise operations into %ls %ls operation.\n",
+                    (int) chain.size(), fusedNode->NodeName().c_str(), fusedNode->OperationName().c_str());
+        for (const auto& node : chain)
+        {
+            RemoveNodeFromNet(node);
+            node->DetachInputs();
+        }
+        AddNodeToNet(fusedNode);
+        ChangeNodeInputs(root, fusedNode);
+        for (auto group : GetAllNodeGroups())
+            replace(group->begin(), group->end(), root, fusedNode);
+        for (auto& namedCriterion : m_namedCriterionNodes)
+            replace(namedCriterion.second.begin(), namedCriterion.second.end(), root, fusedNode);
+        numRemovedNodes += chain.size() - 1;
+    }
+    if (numRemovedNodes > 0)
+        InvalidateCompiledNetwork();
+    return numRemovedNodes;
+}
+
+// -----------------------------------------------------------------------
+// channel-blocked layout
+// -----------------------------------------------------------------------
+
+static ComputationNodeBasePtr FindRegionRoot(std::map<ComputationNodeBasePtr, ComputationNodeBasePtr>& parents, ComputationNodeBasePtr node)
+{
+    while (parents[node] != node)
+        node = parents[node] = parents[parents[node]];
+    return node;
+}
+
+// whether 'node' can pass the blocked layout through, i.e. is element-wise on inputs of its own shape
+static bool IsChannelBlockedLayoutAgnostic(const ComputationNodeBasePtr& node, const std::set<ComputationNodeBasePtr>& blockedNodes)
+{
+    if (!node->Is<IFusibleElementwiseNode>() && node->OperationName() != L"FusedElementwise")
+        return false;
+    for (const auto& input : node->GetInputs())
+        if (blockedNodes.find(input) == blockedNodes.end() || input->GetSampleLayout() != node->GetSampleLayout() || input->GetMBLayout() != node->GetMBLayout())
+            return false;
+    return true;
+}
+
+template <class ElemType>
+static ComputationNodeBasePtr CreateReorderChannelBlocksNode(const ComputationNodeBasePtr& input, bool toChannelBlocks)
+{
+    auto node = New<ReorderChannelBlocksNode<ElemType>>(input->GetDeviceId(), input->NodeName() + (toChannelBlocks ? L".toChannelBlocks" : L".fromChannelBlocks"), toChannelBlocks);
+    node->AttachInputs({ input });
+    return node;
+}
+
+// UseChannelBlockedLayout() -- let regions of convolutions, poolings and batch normalizations compute on ImageLayoutKind::CHWc
+// The blocked layout keeps a block of channels of a pixel in one vector, so that the CPU engines can use all lanes.
+// A region consists of nodes that implement IChannelBlockedLayoutNode and element-wise nodes between them. Its inputs
+// are reordered into the blocked layout and its outputs back into the cudnn layout by ReorderChannelBlocksNodes, once
+// per value. Regions with a single image node are left alone, as the reordering would cost more than it saves. Outputs,
+// criteria and nodes in loops are not touched. This is for inference only; the blocked engines do not implement backprop.
+// Like FuseElementwiseOperations(), this is called from CompileNetwork() on a validated network, which must be compiled
+// again if anything changed. Returns the number of nodes that now compute on the blocked layout.
+size_t ComputationNetwork::UseChannelBlockedLayout()
+{
+    if (m_deviceId != CPUDEVICE)
+        return 0;
+    for (const auto& iter : m_nameToNodeMap)
+        if (iter.second->OperationName() == L"ReorderChannelBlocks") // already done
+            return 0;
+
+    std::set<ComputationNodeBasePtr> groupNodes;
+    for (auto group : GetAllNodeGroups())
+        groupNodes.insert(group->begin(), group->end());
+    for (const auto& namedCriterion : m_namedCriterionNodes)
+        groupNodes.insert(namedCriterion.second.begin(), namedCriterion.second.end());
+
+    // determine the nodes that can compute on the blocked layout, and group them into connected regions
+    std::set<ComputationNodeBasePtr> blockedNodes;
+    std::map<ComputationNodeBasePtr, size_t> imageInputIndex; // [anchor node] -> index of the input that is an image
+    std::map<ComputationNodeBasePtr, ComputationNodeBasePtr> parents;
+    for (const auto& node : GetEvalOrder(nullptr))
+    {
+        if (node->IsPartOfLoop() || groupNodes.find(node) != groupNodes.end())
+            continue;
+        size_t index;
+        if (node->Is<IChannelBlockedLayoutNode>() && node->As<IChannelBlockedLayoutNode>()->CanUseChannelBlockedLayout(index))
+            imageInputIndex[node] = index;
+        else if (!IsChannelBlockedLayoutAgnostic(node, blockedNodes))
+            continue;
+        blockedNodes.insert(node);
+        parents[node] = node;
+        for (size_t i = 0; i < node->GetNumInputs(); i++)
+        {
+            const auto& input = node->GetInputs()[i];
+            auto anchor = imageInputIndex.find(node);
+            if (blockedNodes.find(input) != blockedNodes.end() && (anchor == imageInputIndex.end() || anchor->second == i))
+                parents[FindRegionRoot(parents, input)] = FindRegionRoot(parents, node);
+        }
+    }
+    std::map<ComputationNodeBasePtr, size_t> numAnchors;
+    for (const auto& anchor : imageInputIndex)
+        numAnchors[FindRegionRoot(parents, anchor.first)]++;
+    for (auto iter = blockedNodes.begin(); iter != blockedNodes.end();)
+    {
+        if (numAnchors[FindRegionRoot(parents, *iter)] < 2)
+        {
+            imageInputIndex.erase(*iter);
+            iter = blockedNodes.erase(iter);
+        }
+        else
+            iter++;
+    }
+    if (blockedNodes.empty())
+        return 0;
+
+    // insert the reorderings wherever a value crosses the region boundary, sharing them among all consumers of a value
+    std::map<std::pair<ComputationNodeBasePtr, bool>, ComputationNodeBasePtr> reorderNodes; // [(input, toChannelBlocks)] -> reorder node
+    std::vector<ComputationNodeBasePtr> allNodes;
+    for (const auto& iter : m_nameToNodeMap)
+        allNodes.push_back(iter.second);
+    for (const auto& node : allNodes)
+    {
+        bool isBlocked = blockedNodes.find(node) != blockedNodes.end();
+        auto anchor = imageInputIndex.find(node);
+        for (size_t i = 0; i < node->GetNumInputs(); i++)
+        {
+            const auto input = node->GetInputs()[i];
+            bool needsBlocked = isBlocked && (anchor == imageInputIndex.end() || anchor->second == i);
+            if (needsBlocked == (blockedNodes.find(input) != blockedNodes.end()))
+                continue;
+            auto& reorderNode = reorderNodes[make_pair(input, needsBlocked)];
+            if (!reorderNode)
+            {
+                reorderNode = node->Is<ComputationNode<float>>() ? CreateReorderChannelBlocksNode<float>(input, needsBlocked)
+                                                                 : CreateReorderChannelBlocksNode<double>(input, needsBlocked);
+                AddNodeToNet(reorderNode);
+            }
+            node->SetInput(i, reorderNode);
+        }
+    }
+    for (const auto& node : blockedNodes)
+        if (node->Is<IChannelBlockedLayoutNode>())
+            node->As<IChannelBlockedLayoutNode>()->SetChannelBlockedLayout(true);
+
+    if (TraceLevel() > 0)
+        fprintf(stderr, "UseChannelBlockedLayout: %d nodes compute on the channel-blocked layout, with %d reorderings at region boundaries.\n",
+                (int) blockedNodes.size(), (int) reorderNodes.size());
+    InvalidateCompiledNetwork();
+    return blockedNodes.size();
+}
+
 }}}
@@ -9,10 +9,13 @@
 #include "ComputationNode.h"
 #include "ComputationNetwork.h"
 #include "InputAndParamNodes.h"
+#include "LinearAlgebraNodes.h"
+#include "ConvolutionalNodes.h"
 #include "TrainingNodes.h"
 #include <string>
 #include <vector>
 #include <list>
+#include <functional>
 
 using namespace std;
 
@@ -103,6 +106,46 @@ void ComputationNetwork::CopyInputs(const std::wstring fromName, std::wstring to
     CopyNode(*this, fromName, toName, CopyNodeFlags::copyNodeInputLinks);
 }
 
+// create a compiled copy of this network in which all nodes are duplicated, except that the values of
+// the learnable parameters are shared with this network instead of copied
+// The copy has its own node values, MBLayouts, and matrix pool, so that copies can be evaluated concurrently from
+// different threads, while the model parameters exist only once in memory. The parameters must not be modified
+// while copies are in use (e.g. no training).
+ComputationNetworkPtr ComputationNetwork::CloneWithSharedParameters() const
+{
+    auto net = make_shared<ComputationNetwork>(GetDeviceId());
+    net->SetTraceLevel(TraceLevel());
+
+    // duplicate all nodes
+    for (const auto& iter : m_nameToNodeMap)
+    {
+        const auto& node = iter.second;
+        auto flags = CopyNodeFlags(CopyNodeFlags::copyNodeValue | CopyNodeFlags::copyNodeParametersShared);
+        if (node->Is<IFreezable>())
+            flags = CopyNodeFlags(flags | CopyNodeFlags::copyNodeValueShared);
+        net->AddNodeToNet(node->Duplicate(node->NodeName(), flags));
+    }
+
+    // connect the duplicates like the originals
+    for (const auto& iter : m_nameToNodeMap)
+    {
+        const auto& node = iter.second;
+        auto newNode = net->GetNodeFromName(node->NodeName());
+        for (size_t i = 0; i < node->GetNumInputs(); i++)
+            newNode->SetInput(i, net->GetNodeFromName(node->GetInputs()[i]->NodeName()));
+    }
+
+    // same node groups
+    for (const auto& node : FeatureNodes())        net->AddToNodeGroup(L"feature",    net->GetNodeFromName(node->NodeName()));
+    for (const auto& node : LabelNodes())          net->AddToNodeGroup(L"label",      net->GetNodeFromName(node->NodeName()));
+    for (const auto& node : FinalCriterionNodes()) net->AddToNodeGroup(L"criterion",  net->GetNodeFromName(node->NodeName()));
+    for (const auto& node : EvaluationNodes())     net->AddToNodeGroup(L"evaluation", net->GetNodeFromName(node->NodeName()));
+    for (const auto& node : OutputNodes())         net->AddToNodeGroup(L"output",     net->GetNodeFromName(node->NodeName()));
+
+    net->CompileNetwork();
+    return net;
+}
+
 // RenameNode - Rename a node to another name
 // nodeNameOrig - original node name
 // nodeNameNew - new node name
@@ -367,4 +410,272 @@ void ComputationNetwork::SetLearnableNodesBelowLearningRateMultiplier(const floa
     }
 }
 
+// -----------------------------------------------------------------------
+// batch-normalization folding
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+static std::vector<ElemType> GetParameterValues(const ComputationNodeBasePtr& node)
+{
+    const auto& value = node->As<ComputationNode<ElemType>>()->Value();
+    std::vector<ElemType> values(value.GetNumElements());
+    ElemType* data = values.data();
+    size_t size = values.size();
+    value.CopyToArray(data, size);
+    return values;
+}
+
+// replaces the value matrix rather than writing into it, as it may be a read-only view of a memory-mapped model file
+template <class ElemType>
+static void SetParameterValues(const ComputationNodeBasePtr& node, std::vector<ElemType>& values)
+{
+    auto& value = node->As<ComputationNode<ElemType>>()->Value();
+    value = Matrix<ElemType>(value.GetNumRows(), value.GetNumCols(), values.data(), value.GetDeviceId());
+}
+
+// fold the BatchNormalizationNode 'node' into the weights and bias of the ConvolutionNode or TimesNode that computes its input
+// Returns the PlusNode that computes the same as 'node' afterwards: the existing bias addition, or a new one whose bias parameter
+// is returned in 'newBias'. Returns nullptr if 'node' cannot be folded. Intermediate values and parameters must have no other
+// consumers, as they change.
+template <class ElemType>
+static ComputationNodeBasePtr FoldBatchNormalizationNode(const ComputationNodeBasePtr& node, const std::map<ComputationNodeBasePtr, size_t>& numConsumers,
+                                                         const std::set<ComputationNodeBasePtr>& groupNodes, ComputationNodeBasePtr& newBias)
+{
+    auto bn = node->As<BatchNormalizationNode<ElemType>>();
+    if (node->IsPartOfLoop())
+        return nullptr;
+    for (size_t i = 1; i < node->GetNumInputs(); i++)
+        if (node->Input(i)->OperationName() != OperationNameOf(LearnableParameter))
+            return nullptr;
+    auto isExclusive = [&](const ComputationNodeBasePtr& input)
+    {
+        auto consumers = numConsumers.find(input);
+        return consumers != numConsumers.end() && consumers->second == 1 && groupNodes.find(input) == groupNodes.end();
+    };
+
+    // BN(Plus(linear(W, x), b)), or BN(linear(W, x))
+    ComputationNodeBasePtr plus, bias;
+    ComputationNodeBasePtr linear = node->Input(0);
+    if (linear->OperationName() == OperationNameOf(PlusNode))
+    {
+        plus = linear;
+        size_t biasIndex = plus->Input(1)->OperationName() == OperationNameOf(LearnableParameter) ? 1 : 0;
+        bias = plus->Input(biasIndex);
+        linear = plus->Input(1 - biasIndex);
+        if (!isExclusive(plus) || bias->OperationName() != OperationNameOf(LearnableParameter) || !isExclusive(bias))
+            return nullptr;
+    }
+    if (!isExclusive(linear) || linear->IsPartOfLoop() || linear->GetNumInputs() != 2)
+        return nullptr;
+    const auto& weights = linear->Input(0);
+    if (weights->OperationName() != OperationNameOf(LearnableParameter) || !isExclusive(weights))
+        return nullptr;
+
+    // BN parameter j applies to output element e with j = e / mapSize; for spatial normalization, channels are the last dimension
+    const auto& outShape = node->GetSampleLayout();
+    size_t outDim = outShape.GetNumElements();
+    size_t numParams = node->Input(1)->GetSampleLayout().GetNumElements();
+    if (numParams == 0 || outDim % numParams != 0 || linear->GetSampleLayout().GetNumElements() != outDim)
+        return nullptr;
+    size_t mapSize = outDim / numParams;
+    if (mapSize > 1 && outShape[outShape.GetRank() - 1] != numParams)
+        return nullptr;
+    size_t numWeights = weights->GetSampleLayout().GetNumElements();
+    std::function<size_t(size_t)> weightParamIndex;
+    if (linear->OperationName() == OperationNameOf(ConvolutionNode))
+    {
+        // the kernels of the output channels are stored one after another
+        auto conv = linear->As<ConvolutionNode<ElemType>>();
+        if (conv->Transpose() || conv->ImageLayout() != ImageLayoutKind::CHW || outShape[outShape.GetRank() - 1] != numParams)
+            return nullptr;
+        size_t kernelSize = numWeights / numParams;
+        weightParamIndex = [kernelSize](size_t e) { return e / kernelSize; };
+    }
+    else if (linear->OperationName() == OperationNameOf(TimesNode))
+    {
+        // the weights are a column-major [outDim x inDim] matrix
+        if (numWeights % outDim != 0)
+            return nullptr;
+        weightParamIndex = [outDim, mapSize](size_t e) { return (e % outDim) / mapSize; };
+    }
+    else
+        return nullptr;
+
+    // the bias must be per element, or per channel in the last dimension
+    SmallVector<size_t> paramDims = outShape.GetDims();
+    for (size_t k = 0; k + 1 < paramDims.size(); k++)
+        paramDims[k] = mapSize == 1 ? paramDims[k] : 1;
+    TensorShape paramShape(paramDims);
+    size_t biasMapSize = 1;
+    if (bias)
+    {
+        const auto& biasShape = bias->GetSampleLayout();
+        if (biasShape.GetNumElements() == outDim && mapSize > 1)
+            biasMapSize = mapSize;
+        else if (biasShape.GetNumElements() != numParams || (mapSize > 1 && biasShape != paramShape))
+            return nullptr;
+    }
+
+    // y = scale * (z - mean) / sqrt(var + eps) + beta = s * z + t, where z = W x + b
+    auto scale = GetParameterValues<ElemType>(node->Input(1));
+    auto beta = GetParameterValues<ElemType>(node->Input(2));
+    auto mean = GetParameterValues<ElemType>(node->Input(3));
+    auto variance = GetParameterValues<ElemType>(node->Input(4));
+    double epsilon = bn->UseCNTKEngine() ? bn->Epsilon() : max(bn->Epsilon(), 1e-5); // cuDNN raises epsilon to its minimum
+    std::vector<ElemType> s(numParams), t(numParams);
+    for (size_t j = 0; j < numParams; j++)
+    {
+        s[j] = (ElemType)(scale[j] / sqrt(variance[j] + epsilon));
+        t[j] = beta[j] - s[j] * mean[j];
+    }
+
+    auto w = GetParameterValues<ElemType>(weights);
+    for (size_t e = 0; e < w.size(); e++)
+        w[e] *= s[weightParamIndex(e)];
+    SetParameterValues(weights, w);
+    if (bias)
+    {
+        auto b = GetParameterValues<ElemType>(bias);
+        for (size_t e = 0; e < b.size(); e++)
+            b[e] = s[e / biasMapSize] * b[e] + t[e / biasMapSize];
+        SetParameterValues(bias, b);
+        return plus;
+    }
+    auto biasParameter = New<LearnableParameter<ElemType>>(node->GetDeviceId(), node->NodeName() + L".foldedBias", paramShape);
+    SetParameterValues(biasParameter, t);
+    newBias = biasParameter;
+    auto newPlus = New<PlusNode<ElemType>>(node->GetDeviceId(), node->NodeName());
+    newPlus->AttachInputs({ linear, newBias });
+    return newPlus;
+}
+
+// FoldBatchNormalization() -- fold BatchNormalizationNodes into the preceding convolutions and matrix products for inference
+// A normalization with frozen running statistics is an affine map per channel, which is absorbed by scaling the weights and
+// adjusting (or adding) the bias of the ConvolutionNode or TimesNode (+ PlusNode) that computes its input. The node that then
+// computes the result takes over the name of the BatchNormalizationNode, so that outputs keep their names. The network must be
+// validated, and no longer normalizes with minibatch statistics in training afterwards. Returns the number of folded nodes.
+size_t ComputationNetwork::FoldBatchNormalization()
+{
+    std::map<ComputationNodeBasePtr, size_t> numConsumers;
+    for (const auto& iter : m_nameToNodeMap)
+        for (const auto& input : iter.second->GetInputs())
+            numConsumers[input]++;
+    std::set<ComputationNodeBasePtr> groupNodes;
+    for (auto group : GetAllNodeGroups())
+        groupNodes.insert(group->begin(), group->end());
+    for (const auto& namedCriterion : m_namedCriterionNodes)
+        groupNodes.insert(namedCriterion.second.begin(), namedCriterion.second.end());
+
+    std::vector<ComputationNodeBasePtr> bnNodes;
+    for (const auto& iter : m_nameToNodeMap)
+        if (iter.second->OperationName() == OperationNameOf(BatchNormalizationNode))
+            bnNodes.push_back(iter.second);
+
+    size_t numFolded = 0;
+    for (const auto& bn : bnNodes)
+    {
+        ComputationNodeBasePtr newBias;
+        auto plus = bn->Is<ComputationNode<float>>() ? FoldBatchNormalizationNode<float>(bn, numConsumers, groupNodes, newBias)
+                                                     : FoldBatchNormalizationNode<double>(bn, numConsumers, groupNodes, newBias);
+        if (!plus)
+            continue;
+        if (TraceLevel() > 0)
+            fprintf(stderr, "FoldBatchNormalization: Folding %ls %ls operation into %ls %ls operation.\n",
+                    bn->NodeName().c_str(), bn->OperationName().c_str(),
+                    plus->Input(0)->NodeName().c_str(), plus->Input(0)->OperationName().c_str());
+
+        // the bias addition takes the place and the name of the normalization
+        std::vector<ComputationNodeBasePtr> bnInputs = bn->GetInputs();
+        RemoveNodeFromNet(bn);
+        if (newBias)
+            AddNodeToNet(newBias);
+        else
+        {
+            RemoveNodeFromNet(plus);
+            plus->SetNodeName(bn->NodeName());
+        }
+        AddNodeToNet(plus);
+        ChangeNodeInputs(bn, plus);
+        for (auto group : GetAllNodeGroups())
+            replace(group->begin(), group->end(), bn, plus);
+        for (auto& namedCriterion : m_namedCriterionNodes)
+            replace(namedCriterion.second.begin(), namedCriterion.second.end(), bn, plus);
+        bn->DetachInputs();
+
+        // drop the normalization parameters unless something else uses them
+        for (size_t i = 1; i < bnInputs.size(); i++)
+        {
+            const auto& param = bnInputs[i];
+            if (--numConsumers[param] == 0 && groupNodes.find(param) == groupNodes.end() && NodeNameExists(param->NodeName()))
+                RemoveNodeFromNet(param);
+        }
+        numFolded++;
+    }
+    if (numFolded > 0)
+        InvalidateCompiledNetwork();
+    return numFolded;
+}
+
+// GetInt8QuantizableNodes() -- nodes below 'rootNodes' whose forward pass QuantizeInt8() can quantize to int8
+// These are the IInt8QuantizableNodes whose weight is a LearnableParameter that no other node uses, since QuantizeInt8()
+// rounds the weight itself. The network must be compiled.
+std::vector<ComputationNodeBasePtr> ComputationNetwork::GetInt8QuantizableNodes(const std::vector<ComputationNodeBasePtr>& rootNodes) const
+{
+    std::map<ComputationNodeBasePtr, size_t> numConsumers;
+    for (const auto& iter : m_nameToNodeMap)
+        for (const auto& input : iter.second->GetInputs())
+            numConsumers[input]++;
+
+    std::vector<ComputationNodeBasePtr> nodes;
+    std::set<ComputationNodeBasePtr> visited;
+    for (const auto& rootNode : rootNodes)
+    {
+        for (const auto& node : GetAllNodesForRoot(rootNode))
+        {
+            size_t numChannels, channelStride;
+            if (!node->Is<IInt8QuantizableNode>() || !visited.insert(node).second ||
+                !node->As<IInt8QuantizableNode>()->CanQuantizeInt8(numChannels, channelStride))
+                continue;
+            const auto& weight = node->Input(0);
+            if (weight->OperationName() == OperationNameOf(LearnableParameter) && numConsumers[weight] == 1)
+                nodes.push_back(node);
+        }
+    }
+    return nodes;
+}
+
+// QuantizeInt8() -- post-training int8 quantization for inference on the CPU
+// Each node in 'inputRanges' (see GetInt8QuantizableNodes()) gets the calibrated absolute range of its input, and its
+// weight is rounded to int8 with one range per output channel and saved that way. In inference mode, these nodes then
+// compute their products by an 8-bit integer GEMM. Nodes with a range of 0 (e.g. never calibrated) are skipped.
+// Returns the number of quantized nodes.
+size_t ComputationNetwork::QuantizeInt8(const std::map<ComputationNodeBasePtr, double>& inputRanges)
+{
+    size_t numQuantized = 0;
+    for (const auto& iter : inputRanges)
+    {
+        const auto& node = iter.first;
+        size_t numChannels, channelStride;
+        if (!node->Is<IInt8QuantizableNode>() || !node->As<IInt8QuantizableNode>()->CanQuantizeInt8(numChannels, channelStride))
+            InvalidArgument("QuantizeInt8: %ls %ls operation cannot be quantized.", node->NodeName().c_str(), node->OperationName().c_str());
+        if (iter.second <= 0)
+            continue;
+
+        const auto& weight = node->Input(0);
+        if (weight->Is<LearnableParameter<float>>())
+            weight->As<LearnableParameter<float>>()->SetInt8Storage(numChannels, channelStride);
+        else if (weight->Is<LearnableParameter<double>>())
+            weight->As<LearnableParameter<double>>()->SetInt8Storage(numChannels, channelStride);
+        else
+            InvalidArgument("QuantizeInt8: The weight of %ls %ls operation is no parameter.", node->NodeName().c_str(), node->OperationName().c_str());
+        node->As<IInt8QuantizableNode>()->SetInt8InputRange(iter.second);
+
+        if (TraceLevel() > 0)
+            fprintf(stderr, "QuantizeInt8: Quantizing %ls %ls operation with %d weight channels and input range %g.\n",
+                    node->NodeName().c_str(), node->OperationName().c_str(), (int)numChannels, iter.second);
+        numQuantized++;
+    }
+    return numQuantized;
+}
+
 }}}
@@ -522,7 +522,24 @@ void ComputationNetwork::CompileNetwork()
     ValidateNetwork();
 
     // STEP: Optimize the network.
-    // :)
+    if (m_batchNormalizationFolding && FoldBatchNormalization() > 0)
+    {
+        // the normalizations were replaced by bias additions, which may be fused below
+        CompileNetwork();
+        return;
+    }
+    if (m_elementwiseFusion && FuseElementwiseOperations() > 0)
+    {
+        // nodes were replaced, so all of the above must be redone; this finds nothing more to fuse
+        CompileNetwork();
+        return;
+    }
+    if (m_channelBlockedLayout && UseChannelBlockedLayout() > 0)
+    {
+        // reorderings were inserted and engines must be recreated; this is not repeated once they exist
+        CompileNetwork();
+        return;
+    }
 
     // STEP: Some final details.
     ResetEvalTimeStamps(); // invalidate all m_value fields. Really belongs into StartEvaluateMinibatchLoop()
@@ -1082,9 +1099,15 @@ void ComputationNetwork::AllocateAllMatrices(const std::vector<ComputationNodeBa
 
     m_areMatricesAllocated = true;
 
-    // print the memory sharing structure
+    // print the memory sharing plan and structure
     if (TraceLevel() > 0)
-    PrintMemorySharingStructure(GetAllNodes());
+    {
+        fprintf(stderr, "\nMemory sharing %s: %d requests are served by %d matrices, planned size is %.1f KB per sample (%.1f KB without sharing).\n",
+                m_matrixPool.IsMemorySharingEnabled() ? "enabled" : "disabled",
+                (int)m_matrixPool.GetNumberOfRequests(), (int)m_matrixPool.GetNumberOfMatrices(),
+                m_matrixPool.GetPlannedSizeInBytes() / 1024.0, m_matrixPool.GetRequestedSizeInBytes() / 1024.0);
+        PrintMemorySharingStructure(GetAllNodes());
+    }
 }
 
 void ComputationNetwork::ReleaseMatricesAfterEvalForChildren(ComputationNodeBasePtr n, std::unordered_map<ComputationNodeBasePtr, int>& parentCount)
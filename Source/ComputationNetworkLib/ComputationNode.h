@@ -12,6 +12,7 @@
 #include "TensorShape.h"
 #include "MatrixPool.h"
 #include "ComputationEnvironment.h"
+#include "MemoryMappedFile.h"
 
 #include <unordered_set>
 #include <map>
@@ -43,7 +44,11 @@
 #define CNTK_MODEL_VERSION_12 12 // Times() m_inputRank to support parameter-rank inference
 #define CNTK_MODEL_VERSION_13 13 // batch norm: switch running inverse std deviation -> variance, MB count -> samplesSeen; CuDNN v5
 #define CNTK_MODEL_VERSION_14 14 // axis parameter in OptimizedRNNStackNode
-#define CURRENT_CNTK_MODEL_VERSION CNTK_MODEL_VERSION_14
+#define CNTK_MODEL_VERSION_15 15 // page-aligned LearnableParameter values in binary files, for memory-mapped loading
+#define CNTK_MODEL_VERSION_16 16 // int8 LearnableParameter values, calibrated int8 input ranges of Times and Convolution
+#define CNTK_MODEL_VERSION_17 17 // float16 and bfloat16 LearnableParameter values
+#define CNTK_MODEL_VERSION_18 18 // channel-blocked layout of Convolution, Pooling and BatchNormalization
+#define CURRENT_CNTK_MODEL_VERSION CNTK_MODEL_VERSION_18
 
 extern bool g_shareNodeValueMatrices;
 
@@ -56,10 +61,12 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 
 enum CopyNodeFlags // flags to be passed to the CopyTo() function
 {
-    copyNodeValue          = 1, // copy everything except for the input links
-    copyNodeInputLinks     = 2, // copy over input links
-    copyNodeAll            = 3, // copy everything
-    copyNodeAcrossNetworks = 4  // allow a cross network child copy
+    copyNodeValue            = 1, // copy everything except for the input links
+    copyNodeInputLinks       = 2, // copy over input links
+    copyNodeAll              = 3, // copy everything
+    copyNodeAcrossNetworks   = 4, // allow a cross network child copy
+    copyNodeValueShared      = 8, // together with copyNodeValue: share the value matrix object instead of copying it (read-only use only)
+    copyNodeParametersShared = 16 // the copy will consume the same learnable parameter values as the original, so what is derived from them can be shared
 };
 
 #pragma region base computation class
@@ -968,14 +975,16 @@ public:
         if (flags & CopyNodeFlags::copyNodeValue)
         {
             auto node = DownCast(nodeP);
-            if (m_value)
+            if (m_value && (flags & CopyNodeFlags::copyNodeValueShared))
+                node->m_value = m_value; // both nodes now refer to the same matrix
+            else if (m_value)
             {
                 node->CreateValueMatrixIfNull();
                 node->m_value->SetValue(*m_value);
             }
             else
                 node->m_value = nullptr;
-            if (m_gradient)
+            if (m_gradient && !(flags & CopyNodeFlags::copyNodeValueShared))
             {
                 node->CreateGradientMatrixIfNull();
                 node->m_gradient->SetValue(*m_gradient);
@@ -1561,11 +1570,13 @@ protected:
             matrixPtr = make_shared<Matrix<ElemType>>(m_deviceId);
     }
 
+    // The expected size given to the pool is that of the node's output sample, which is also the right guess for
+    // the gradient and for most node-internal temporaries.
     void RequestMatrixFromPool(shared_ptr<Matrix<ElemType>>& matrixPtr, MatrixPool& matrixPool)
     {
         if (matrixPtr == nullptr)
         {
-            matrixPtr = matrixPool.Request<ElemType>(m_deviceId);
+            matrixPtr = matrixPool.Request<ElemType>(m_deviceId, GetSampleLayout().GetNumElements());
         }
     }
 
@@ -1939,6 +1950,68 @@ struct IRecurrentNode { virtual int GetRecurrenceSteppingDirection() const = 0;
 
 struct IFreezable { virtual void FreezeParameters() { } };
 
+// =======================================================================
+// IMemoryMappable -- nodes that can load their value in place from a memory-mapped model file
+// The value then refers to read-only memory, so this is only meant for evaluation.
+// =======================================================================
+
+struct IMemoryMappable { virtual void SetMemoryMappedFile(const shared_ptr<MemoryMappedFile>& mappedFile) = 0; };
+
+// =======================================================================
+// IFusibleElementwiseNode -- element-wise nodes that ComputationNetwork::FuseElementwiseOperations()
+// can fold, together with their element-wise inputs, into a single FusedElementwiseNode
+// =======================================================================
+
+// how the gradient of a unary element-wise operation is computed
+enum GradientOperationType
+{
+    noGradient,
+    unaryGradient,
+    binaryWithInputGradient,
+    binaryWithOutputGradient
+};
+
+// one element-wise operation of a fused expression
+// Binary steps are opSum, opDifference, or opElementwiseProduct (Plus, Minus, ElementTimes).
+// Unary steps carry the same opcodes as UnaryElementWiseWithOpCodeNodeBase.
+struct FusedElementwiseStep
+{
+    ElementWiseOperator m_op;             // the forward operation
+    ElementWiseOperator m_backwardOp;     // unary steps: operation that computes the input gradient
+    GradientOperationType m_gradientType; // unary steps: what m_backwardOp is applied to
+    size_t m_numOperands;                 // 1 or 2
+    size_t m_operands[2];                 // index of the fused node's input, or number of inputs + index of an earlier step
+};
+
+struct IFusibleElementwiseNode { virtual FusedElementwiseStep GetFusedElementwiseStep() const = 0; };
+
+// =======================================================================
+// IChannelBlockedLayoutNode -- image nodes that can compute on the channel-blocked layout ImageLayoutKind::CHWc,
+// into which ComputationNetwork::UseChannelBlockedLayout() converts their image input once per region
+// =======================================================================
+
+struct IChannelBlockedLayoutNode
+{
+    // whether the node can switch its image input (returned in 'imageInputIndex') and its output to the blocked layout; valid after validation
+    virtual bool CanUseChannelBlockedLayout(size_t& imageInputIndex) const = 0;
+    virtual void SetChannelBlockedLayout(bool enable) = 0;
+};
+
+// =======================================================================
+// IInt8QuantizableNode -- nodes that can compute their product of a weight parameter with an input
+// by an 8-bit integer GEMM, see ComputationNetwork::QuantizeInt8()
+// =======================================================================
+
+struct IInt8QuantizableNode
+{
+    // whether the forward pass can be quantized; if so, the weight is Input(0) and the quantized operand Input(1), and the weight's
+    // output channels are returned as for ChannelwiseInt8Quantizer; valid after validation
+    virtual bool CanQuantizeInt8(size_t& numChannels, size_t& channelStride) const = 0;
+    // calibrated absolute range of Input(1); 0 disables quantization. Quantized products are used only when inferring on the CPU.
+    virtual void SetInt8InputRange(double inputRange) = 0;
+    virtual double GetInt8InputRange() const = 0;
+};
+
 // =======================================================================
 // PreComputedNodeBase -- interface implemented by ComputationNodes that precompute
 // TODO: We can use this interface in more places.
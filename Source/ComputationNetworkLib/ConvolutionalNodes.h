@@ -53,7 +53,7 @@ class ConvolutionNodeBase : public ComputationNode<ElemType>
 
 public:
     ConvolutionNodeBase(DEVICEID_TYPE deviceId, const wstring& name)
-        : Base(deviceId, name), m_poolKind(PoolKind::None), m_transpose(false), m_maxTempMemSizeInSamples(0)
+        : Base(deviceId, name), m_poolKind(PoolKind::None), m_transpose(false), m_maxTempMemSizeInSamples(0), m_channelBlocked(false)
     {
     }
     ConvolutionNodeBase(DEVICEID_TYPE deviceId, const wstring& name, const TensorShape& kernelShape, const TensorShape& mapCount, const TensorShape& strideShape,
@@ -61,7 +61,7 @@ public:
                         PoolKind poolKind, bool transpose, ImageLayoutKind imageLayout, size_t maxTempMemSizeInSamples)
                         : Base(deviceId, name), m_kernelShape(kernelShape), m_mapCount(mapCount), m_stride(strideShape), m_sharing(sharing),
                         m_autoPad(autoPadding), m_lowerPad(lowerPad), m_upperPad(upperPad), m_poolKind(poolKind), m_transpose(transpose),
-                        m_imageLayout(imageLayout), m_maxTempMemSizeInSamples(maxTempMemSizeInSamples)
+                        m_imageLayout(imageLayout), m_maxTempMemSizeInSamples(maxTempMemSizeInSamples), m_channelBlocked(false)
     {
     }
 
@@ -81,6 +81,7 @@ public:
         fstream << (int32_t)m_imageLayout;
         fstream << m_maxTempMemSizeInSamples;
         fstream << m_transpose;
+        fstream << m_channelBlocked;
     }
 
     void Load(File& fstream, size_t modelVersion) override
@@ -109,6 +110,8 @@ public:
         {
             fstream >> m_transpose;
         }
+        if (modelVersion >= CNTK_MODEL_VERSION_18)
+            fstream >> m_channelBlocked;
     }
 
     void CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const override
@@ -128,6 +131,7 @@ public:
             node->m_transpose = m_transpose;
             node->m_imageLayout = m_imageLayout;
             node->m_maxTempMemSizeInSamples = m_maxTempMemSizeInSamples;
+            node->m_channelBlocked = m_channelBlocked;
         }
     }
 
@@ -147,9 +151,30 @@ public:
     TensorShape LowerPad() const { return m_lowerPad; }
     TensorShape UpperPad() const { return m_upperPad; }
     bool Transpose() const { return m_transpose; }
+    ImageLayoutKind ImageLayout() const { return m_imageLayout; }
     size_t MaxTempMemSizeInSamples() const { return m_maxTempMemSizeInSamples; }
     PoolKind PoolingKind() const { return m_poolKind; }
 
+protected:
+    // The channel-blocked layout is set by ComputationNetwork::UseChannelBlockedLayout(), together with the ReorderChannelBlocksNodes
+    // that it inserts, and is saved and copied with them.
+    void EnableChannelBlockedLayout(bool enable)
+    {
+        if (enable != m_channelBlocked)
+            m_convEng = nullptr; // recreated by the next validation
+        m_channelBlocked = enable;
+    }
+
+    // whether the engine can compute on the channel-blocked layout, which applies to non-transposed convolutions and poolings in cudnn layout
+    bool SupportsChannelBlockedLayout() const
+    {
+        return m_convEng != nullptr && !m_transpose && m_imageLayout == ImageLayoutKind::CHW &&
+               ConvolutionEngine<ElemType>::IsChannelBlockedLayoutSupported(*m_convEng->Geometry(), m_deviceId, m_poolKind);
+    }
+
+    // image layout that the engine uses
+    ImageLayoutKind EngineImageLayout() const { return m_channelBlocked ? ImageLayoutKind::CHWc : m_imageLayout; }
+
 private:
     // bottomlessly expand shape to filterRank, then expand to inputRank using defaults or given 'from' values
     template<class V, typename T>
@@ -199,6 +224,7 @@ protected:
     
     size_t m_maxTempMemSizeInSamples;
     shared_ptr<Matrix<ElemType>> m_tempMatrix;
+    bool m_channelBlocked; // input and output are in the channel-blocked layout ImageLayoutKind::CHWc
 
     std::unique_ptr<ConvolutionEngine<ElemType>> m_convEng;
 };
@@ -219,7 +245,11 @@ protected:                                  \
     using Base::m_maxTempMemSizeInSamples;  \
     using Base::m_tempMatrix;               \
     using Base::m_convEng;                  \
+    using Base::m_channelBlocked;           \
     using Base::InferReductionDims;         \
+    using Base::EngineImageLayout;          \
+    using Base::EnableChannelBlockedLayout; \
+    using Base::SupportsChannelBlockedLayout; \
 public:
 
 // -----------------------------------------------------------------------
@@ -227,20 +257,20 @@ public:
 // -----------------------------------------------------------------------
 
 template <class ElemType>
-class ConvolutionNode : public ConvolutionNodeBase<ElemType>, public NumInputs<2>
+class ConvolutionNode : public ConvolutionNodeBase<ElemType>, public NumInputs<2>, public IChannelBlockedLayoutNode, public IInt8QuantizableNode
 {
     typedef ConvolutionNodeBase<ElemType> Base; UsingConvolutionNodeBaseMembers;
     static const std::wstring TypeName() { return L"Convolution"; }
 public:
     ConvolutionNode(DEVICEID_TYPE deviceId, const wstring& name)
-        : Base(deviceId, name)
+        : Base(deviceId, name), m_int8InputRange(0)
     {
     }
     ConvolutionNode(DEVICEID_TYPE deviceId, const wstring& name, const TensorShape& kernelShape, const TensorShape& mapCount, const TensorShape& strideShape,
                     const std::vector<bool>& sharing, const std::vector<bool>& autoPadding, const TensorShape& lowerPad, const TensorShape& upperPad,
                     bool transpose, ImageLayoutKind imageLayout, size_t maxTempMemSizeInSamples)
                     : Base(deviceId, name, kernelShape, mapCount, strideShape, sharing, autoPadding, lowerPad, upperPad, PoolKind::None, transpose, imageLayout, maxTempMemSizeInSamples),
-                    m_convolution2D(false)
+                    m_convolution2D(false), m_int8InputRange(0)
     {
     }
     ConvolutionNode(DEVICEID_TYPE deviceId, const wstring& name, const size_t kernelWidth, const size_t kernelHeight, const size_t outputChannels,
@@ -266,6 +296,7 @@ public:
     {
         Base::Save(fstream);
         fstream << m_convolution2D;
+        fstream << m_int8InputRange;
     }
 
     void Load(File& fstream, size_t modelVersion) override
@@ -302,6 +333,10 @@ public:
         {
             fstream >> m_convolution2D;
         }
+        double int8InputRange = 0;
+        if (modelVersion >= CNTK_MODEL_VERSION_16)
+            fstream >> int8InputRange;
+        SetInt8InputRange(int8InputRange);
     }
 
     void CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const override
@@ -311,15 +346,65 @@ public:
         {
             auto node = dynamic_pointer_cast<ConvolutionNode<ElemType>>(nodeP);
             node->m_convolution2D = m_convolution2D;
+            // a copy that convolves with the same kernel value shares its quantized copy, see TimesNodeBase::CopyTo()
+            node->SetInt8InputRange(m_int8InputRange, (flags & CopyNodeFlags::copyNodeParametersShared) ? m_int8Multiplier : nullptr);
         }
     }
 
+    bool CanUseChannelBlockedLayout(size_t& imageInputIndex) const override
+    {
+        imageInputIndex = 1;
+        return SupportsChannelBlockedLayout() && m_int8InputRange == 0; // int8 quantized convolutions compute on the cudnn layout
+    }
+
+    // The kernel of each output channel is contiguous in the weights, see GemmConvolutionEngine.
+    bool CanQuantizeInt8(size_t& numChannels, size_t& channelStride) const override
+    {
+        if (m_transpose || m_imageLayout != ImageLayoutKind::CHW || m_channelBlocked || !m_convEng ||
+            std::find(m_sharing.begin(), m_sharing.end(), false) != m_sharing.end())
+            return false;
+        numChannels = m_convEng->Geometry()->KernelCount();
+        channelStride = m_kernelShape.GetNumElements();
+        return true;
+    }
+
+    void SetInt8InputRange(double inputRange) override
+    {
+        SetInt8InputRange(inputRange, nullptr);
+    }
+
+    // sharedWeight - see TimesNodeBase::SetInt8InputRange()
+    void SetInt8InputRange(double inputRange, const shared_ptr<Int8QuantizedMultiplier<ElemType>>& sharedWeight)
+    {
+        m_int8InputRange = inputRange;
+        if (inputRange > 0)
+            m_int8Multiplier = make_shared<Int8QuantizedMultiplier<ElemType>>(inputRange, sharedWeight ? sharedWeight->GetCache() : nullptr);
+        else
+            m_int8Multiplier.reset();
+    }
+
+    double GetInt8InputRange() const override { return m_int8InputRange; }
+
+    void SetChannelBlockedLayout(bool enable) override { EnableChannelBlockedLayout(enable); }
+
     void ForwardProp(const FrameRange& fr) override
     {
         Matrix<ElemType> sliceOutputValue = ValueFor(fr);
         const Matrix<ElemType>& input0 = InputRef(0).ValueAsMatrix();
         Matrix<ElemType> sliceInput1Value = InputRef(1).ValueFor(fr);
-        if (!m_transpose)
+        if (m_int8Multiplier && Environment().IsInferring() && m_deviceId == CPUDEVICE && !m_transpose && !m_channelBlocked)
+        {
+            if (!m_int8ConvEng) // the GEMM engine is the one that computes its products with the int8 multiplier
+            {
+                const auto& g = *m_convEng->Geometry();
+                auto geometry = std::make_shared<ConvolveGeometry>(g.InputShape(), g.KernelShape(), g.MapCount(), g.Stride(),
+                                                                   g.Sharing(), g.AutoPad(), g.LowerPad(), g.UpperPad());
+                m_int8ConvEng = ConvolutionEngine<ElemType>::Create(geometry, m_deviceId, ImageLayoutKind::CHW, m_maxTempMemSizeInSamples,
+                                                                    PoolKind::None, ConvolutionEngineKind::Gemm, NodeName());
+            }
+            m_int8ConvEng->ForwardQuantized(sliceInput1Value, input0, sliceOutputValue, *m_tempMatrix, *m_int8Multiplier);
+        }
+        else if (!m_transpose)
             m_convEng->Forward(sliceInput1Value, input0, sliceOutputValue, *m_tempMatrix);
         else
         {
@@ -451,7 +536,7 @@ public:
                 auto geometry = std::make_shared<ConvolveGeometry>(!m_transpose ? inputShape : outputShape,
                                                                    m_kernelShape, m_mapCount, m_stride, 
                                                                    m_sharing, m_autoPad, m_lowerPad, m_upperPad);
-                m_convEng = ConvolutionEngine<ElemType>::Create(geometry, m_deviceId, m_imageLayout,
+                m_convEng = ConvolutionEngine<ElemType>::Create(geometry, m_deviceId, EngineImageLayout(),
                                                                 m_maxTempMemSizeInSamples, m_poolKind,
                                                                 ConvolutionEngineKind::All, NodeName(), Globals::ShouldForceDeterministicAlgorithms());
             }
@@ -488,6 +573,10 @@ public:
 protected:
     // Flag that indicates whether the node is created using 2D-syntax.
     bool m_convolution2D;
+
+    double m_int8InputRange; // calibrated range of the input features, 0 if not quantized to int8
+    shared_ptr<Int8QuantizedMultiplier<ElemType>> m_int8Multiplier;
+    std::unique_ptr<ConvolutionEngine<ElemType>> m_int8ConvEng; // created on first use
 };
 
 // -----------------------------------------------------------------------
@@ -668,7 +757,7 @@ protected:
 // -----------------------------------------------------------------------
 
 template <class ElemType>
-class PoolingNode : public ConvolutionNodeBase<ElemType>, public NumInputs<1>
+class PoolingNode : public ConvolutionNodeBase<ElemType>, public NumInputs<1>, public IChannelBlockedLayoutNode
 {
     typedef ConvolutionNodeBase<ElemType> Base; UsingConvolutionNodeBaseMembers;
     static const std::wstring TypeName() { return L"Pooling"; }
@@ -716,6 +805,14 @@ public:
         return m_poolKind == PoolKind::Max;
     }
 
+    bool CanUseChannelBlockedLayout(size_t& imageInputIndex) const override
+    {
+        imageInputIndex = 0;
+        return SupportsChannelBlockedLayout();
+    }
+
+    void SetChannelBlockedLayout(bool enable) override { EnableChannelBlockedLayout(enable); }
+
 public:
     void Validate(bool isFinalValidationPass) override
     {
@@ -744,7 +841,7 @@ public:
             {
                 auto geometry = std::make_shared<ConvolveGeometry>(inputShape, m_kernelShape, m_mapCount, m_stride,
                                                                    m_sharing, m_autoPad, m_lowerPad, m_upperPad);
-                m_convEng = ConvolutionEngine<ElemType>::Create(geometry, m_deviceId, m_imageLayout,
+                m_convEng = ConvolutionEngine<ElemType>::Create(geometry, m_deviceId, EngineImageLayout(),
                                                                 m_maxTempMemSizeInSamples, m_poolKind,
                                                                 ConvolutionEngineKind::All, NodeName());
             }
@@ -854,6 +951,83 @@ public:
     }
 };
 
+// -----------------------------------------------------------------------
+// ReorderChannelBlocksNode (input)
+// Converts an image in cudnn (CHW) layout into the channel-blocked layout ImageLayoutKind::CHWc or back.
+// Both layouts have the same tensor shape; only the order of the elements differs. These nodes are not
+// created by users but inserted by ComputationNetwork::UseChannelBlockedLayout() at the boundaries of
+// regions that compute on the blocked layout.
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+class ReorderChannelBlocksNode : public ComputationNode<ElemType>, public NumInputs<1>
+{
+    typedef ComputationNode<ElemType> Base; UsingComputationNodeMembersBoilerplate;
+    static const std::wstring TypeName() { return L"ReorderChannelBlocks"; }
+
+public:
+    ReorderChannelBlocksNode(DEVICEID_TYPE deviceId, const wstring& name, bool toChannelBlocks = true)
+        : Base(deviceId, name), m_toChannelBlocks(toChannelBlocks)
+    {
+    }
+    ReorderChannelBlocksNode(const ScriptableObjects::IConfigRecordPtr configp)
+        : ReorderChannelBlocksNode(configp->Get(L"deviceId"), L"<placeholder>")
+    {
+        InvalidArgument("ReorderChannelBlocks: This node is created for the channel-blocked layout of a network and cannot be specified directly.");
+    }
+
+    void Save(File& fstream) const override
+    {
+        Base::Save(fstream);
+        fstream << m_toChannelBlocks;
+    }
+
+    void Load(File& fstream, size_t modelVersion) override
+    {
+        Base::Load(fstream, modelVersion);
+        fstream >> m_toChannelBlocks;
+    }
+
+    void CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const override
+    {
+        Base::CopyTo(nodeP, newName, flags);
+        if (flags & CopyNodeFlags::copyNodeValue)
+        {
+            auto node = dynamic_pointer_cast<ReorderChannelBlocksNode<ElemType>>(nodeP);
+            node->m_toChannelBlocks = m_toChannelBlocks;
+        }
+    }
+
+    void ForwardProp(const FrameRange& fr) override
+    {
+        Matrix<ElemType> sliceOutputValue = ValueFor(fr);
+        ConvolutionEngine<ElemType>::ReorderChannelBlocks(InputRef(0).ValueFor(fr), sliceOutputValue, GetSampleLayout(), m_toChannelBlocks);
+    }
+
+    void BackpropTo(const size_t /*inputIndex*/, const FrameRange& fr) override
+    {
+        Matrix<ElemType> sliceInput0Grad = InputRef(0).GradientFor(fr);
+        ConvolutionEngine<ElemType>::ReorderChannelBlocks(GradientFor(fr), sliceInput0Grad, GetSampleLayout(), !m_toChannelBlocks, /*accumulate=*/true);
+    }
+
+    bool OutputUsedInComputingInputNodesGradients() const override { return false; }
+    bool InputUsedInComputingInputNodesGradients(size_t /*childIndex*/) const override { return false; }
+
+    void Validate(bool isFinalValidationPass) override
+    {
+        ValidateUnaryMap(isFinalValidationPass);
+        const auto& shape = GetSampleLayout();
+        if (isFinalValidationPass && (m_deviceId != CPUDEVICE || shape.GetRank() != 3 || shape[2] % ImageChannelBlockSize != 0))
+            InvalidArgument("%ls %ls operation: Input [%s] cannot be stored in the channel-blocked layout, which requires a [W x H x C] image on CPU with C a multiple of %d.",
+                            NodeName().c_str(), OperationName().c_str(), string(shape).c_str(), (int)ImageChannelBlockSize);
+    }
+
+    bool ToChannelBlocks() const { return m_toChannelBlocks; }
+
+private:
+    bool m_toChannelBlocks; // true: CHW -> CHWc; false: CHWc -> CHW
+};
+
 // -----------------------------------------------------------------------
 // Legacy PoolingNodeBase (input)
 // -----------------------------------------------------------------------
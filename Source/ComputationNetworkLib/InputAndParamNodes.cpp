@@ -7,6 +7,7 @@
 #include "InputAndParamNodes.h"
 #include "File.h"        // for LoadMatrixFromTextFile()
 #include "TensorShape.h" // for SmallVector<>
+#include "Quantizers.h"  // for ChannelwiseInt8Quantizer
 
 #include <string>
 
@@ -412,7 +413,14 @@ void LearnableParameter<ElemType>::Save(File& fstream) const /*override*/
     Base::Save(fstream);
     fstream << m_learningRateMultiplier;
     m_sampleLayout.Save(fstream);
-    fstream << Value();
+    if (fstream.IsTextBased())
+        fstream << Value();
+    else if (HasInt8Storage())
+        SaveInt8Value(fstream);
+    else if (m_reducedPrecisionStorage != ReducedPrecisionFormat::none)
+        SaveReducedPrecisionValue(fstream);
+    else
+        SaveAlignedValue(fstream);
 }
 
 template <class ElemType>
@@ -445,13 +453,217 @@ void LearnableParameter<ElemType>::Load(File& fstream, size_t modelVersion) /*ov
         }
     }
 
-    LoadValue(fstream);
+    m_int8Channels = 0;
+    m_reducedPrecisionStorage = ReducedPrecisionFormat::none;
+    if (modelVersion >= CNTK_MODEL_VERSION_16 && !fstream.IsTextBased() && fstream.TryGetMarker(FileMarker::fileMarkerBeginSection, L"BInt8Value"))
+        LoadInt8Value(fstream);
+    else if (modelVersion >= CNTK_MODEL_VERSION_17 && !fstream.IsTextBased() && fstream.TryGetMarker(FileMarker::fileMarkerBeginSection, L"BReducedPrecisionValue"))
+        LoadReducedPrecisionValue(fstream);
+    else if (modelVersion >= CNTK_MODEL_VERSION_15 && !fstream.IsTextBased())
+        LoadAlignedValue(fstream);
+    else
+        LoadValue(fstream);
     SetDims(sampleLayout, false); // note: call this after LoadValue() since LoadValue() overwrites m_sampleLayout
     VerifyDataSize(Value());      // sanity check
 
     m_initString.clear(); // deferred initialization not possible after loading
 }
 
+// Values of at least a page are stored page-aligned in the file, smaller ones aligned to the element size.
+// This allows LoadAlignedValue() to use them in place if the file is memory-mapped, in which case all
+// processes that load the same model share the pages of the values through the OS page cache.
+static const size_t valueAlignmentInBytes = 4096;
+
+template <class ElemType>
+void LearnableParameter<ElemType>::SaveAlignedValue(File& fstream) const
+{
+    const Matrix<ElemType>& value = Value();
+    const size_t numElements = value.GetNumElements();
+    const size_t numBytes = numElements * sizeof(ElemType);
+
+    unique_ptr<ElemType[]> cpuCopy;
+    if (value.GetDeviceId() != CPUDEVICE || value.GetMatrixType() != DENSE)
+        cpuCopy.reset(value.CopyToArray());
+    const ElemType* data = cpuCopy ? cpuCopy.get() : value.Data();
+
+    fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BAlignedValue");
+    fstream << sizeof(ElemType) << value.GetNumRows() << value.GetNumCols();
+
+    const size_t alignment = numBytes >= valueAlignmentInBytes ? valueAlignmentInBytes : sizeof(ElemType);
+    const uint64_t dataStart = fstream.GetPosition() + sizeof(size_t);
+    const size_t padding = (alignment - dataStart % alignment) % alignment;
+    fstream << padding;
+    vector<char> zeros(padding, 0);
+    fwriteOrDie(zeros.data(), 1, padding, fstream);
+    fwriteOrDie(data, sizeof(ElemType), numElements, fstream);
+
+    fstream.PutMarker(FileMarker::fileMarkerEndSection, L"EAlignedValue");
+}
+
+template <class ElemType>
+void LearnableParameter<ElemType>::LoadAlignedValue(File& fstream)
+{
+    fstream.GetMarker(FileMarker::fileMarkerBeginSection, L"BAlignedValue");
+    size_t elementSize, numRows, numCols, padding;
+    fstream >> elementSize >> numRows >> numCols >> padding;
+    if (elementSize != sizeof(ElemType))
+        RuntimeError("LearnableParameter: %ls has %d-byte elements in the model file, expected %d.", NodeName().c_str(), (int)elementSize, (int)sizeof(ElemType));
+
+    const size_t numElements = numRows * numCols;
+    const uint64_t dataStart = fstream.GetPosition() + padding;
+    const uint64_t dataEnd = dataStart + numElements * sizeof(ElemType);
+
+    CreateMatrixIfNull(m_value);
+    const char* mappedData = (m_mappedFile && m_deviceId == CPUDEVICE) ? m_mappedFile->TryGetData(dataStart, dataEnd - dataStart) : nullptr;
+    if (mappedData && numElements > 0 && (uintptr_t)mappedData % sizeof(ElemType) == 0)
+    {
+        // use the values in place: the matrix neither owns nor may modify them
+        Value().SetValue(numRows, numCols, CPUDEVICE, (ElemType*)mappedData, matrixFlagDontOwnBuffer);
+    }
+    else
+    {
+        fstream.SetPosition(dataStart);
+        vector<ElemType> values(numElements);
+        freadOrDie(values.data(), sizeof(ElemType), numElements, fstream);
+        Value().SetValue(numRows, numCols, m_deviceId, values.data());
+    }
+    fstream.SetPosition(dataEnd);
+    fstream.GetMarker(FileMarker::fileMarkerEndSection, L"EAlignedValue");
+
+    SetDims(TensorShape(numRows, numCols), false);
+}
+
+template <class ElemType>
+void LearnableParameter<ElemType>::SetInt8Storage(size_t numChannels, size_t channelStride)
+{
+    Matrix<ElemType>& value = Value();
+    if (numChannels == 0 || channelStride == 0 || value.GetNumElements() % (numChannels * channelStride) != 0)
+        InvalidArgument("SetInt8Storage: %ls has %d elements, which cannot be split into %d channels with stride %d.",
+                        NodeName().c_str(), (int)value.GetNumElements(), (int)numChannels, (int)channelStride);
+
+    const size_t numElements = value.GetNumElements();
+    unique_ptr<ElemType[]> values(value.CopyToArray());
+    vector<int8_t> quantized(numElements);
+    ChannelwiseInt8Quantizer<ElemType> quantizer(numChannels, channelStride);
+    ArrayRef<ElemType> raw(values.get(), numElements);
+    ArrayRef<int8_t> out(quantized.data(), numElements);
+    quantizer.Quantize(raw, out);
+    quantizer.Dequantize(out, raw);
+
+    // a memory-mapped value is read-only, so the rounded value always goes into a new matrix
+    Matrix<ElemType> rounded(value.GetNumRows(), value.GetNumCols(), values.get(), m_deviceId);
+    value = move(rounded);
+    m_int8Channels = numChannels;
+    m_int8ChannelStride = channelStride;
+    m_reducedPrecisionStorage = ReducedPrecisionFormat::none;
+}
+
+// Layout: channels, stride, rows, cols, element size and one ElemType range per channel, followed by the int8 values.
+// The ranges are recomputed from the rounded value, which yields the ones it was rounded with.
+template <class ElemType>
+void LearnableParameter<ElemType>::SaveInt8Value(File& fstream) const
+{
+    const Matrix<ElemType>& value = Value();
+    const size_t numElements = value.GetNumElements();
+    unique_ptr<ElemType[]> values(value.CopyToArray());
+    vector<int8_t> quantized(numElements);
+    ChannelwiseInt8Quantizer<ElemType> quantizer(m_int8Channels, m_int8ChannelStride);
+    ArrayRef<ElemType> raw(values.get(), numElements);
+    ArrayRef<int8_t> out(quantized.data(), numElements);
+    quantizer.Quantize(raw, out);
+
+    fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BInt8Value");
+    fstream << m_int8Channels << m_int8ChannelStride << value.GetNumRows() << value.GetNumCols() << sizeof(ElemType);
+    fwriteOrDie(quantizer.GetInverseQuantizeFactors().data(), sizeof(ElemType), m_int8Channels, fstream);
+    fwriteOrDie(quantized.data(), sizeof(int8_t), numElements, fstream);
+    fstream.PutMarker(FileMarker::fileMarkerEndSection, L"EInt8Value");
+}
+
+template <class ElemType>
+void LearnableParameter<ElemType>::LoadInt8Value(File& fstream)
+{
+    size_t numChannels, channelStride, numRows, numCols, elementSize;
+    fstream >> numChannels >> channelStride >> numRows >> numCols >> elementSize;
+    if (elementSize != sizeof(ElemType))
+        RuntimeError("LearnableParameter: %ls has %d-byte ranges in the model file, expected %d.", NodeName().c_str(), (int)elementSize, (int)sizeof(ElemType));
+
+    const size_t numElements = numRows * numCols;
+    vector<ElemType> factors(numChannels);
+    freadOrDie(factors.data(), sizeof(ElemType), numChannels, fstream);
+    vector<int8_t> quantized(numElements);
+    freadOrDie(quantized.data(), sizeof(int8_t), numElements, fstream);
+    fstream.GetMarker(FileMarker::fileMarkerEndSection, L"EInt8Value");
+
+    vector<ElemType> values(numElements);
+    ChannelwiseInt8Quantizer<ElemType> quantizer(numChannels, channelStride);
+    quantizer.SetInverseQuantizeFactors(factors);
+    ArrayRef<int8_t> in(quantized.data(), numElements);
+    ArrayRef<ElemType> out(values.data(), numElements);
+    quantizer.Dequantize(in, out);
+
+    CreateMatrixIfNull(m_value);
+    Value().SetValue(numRows, numCols, m_deviceId, values.data());
+    SetDims(TensorShape(numRows, numCols), false);
+    m_int8Channels = numChannels;
+    m_int8ChannelStride = channelStride;
+}
+
+template <class ElemType>
+void LearnableParameter<ElemType>::SetReducedPrecisionStorage(ReducedPrecisionFormat format)
+{
+    if (format != ReducedPrecisionFormat::none)
+    {
+        Matrix<ElemType>& value = Value();
+        unique_ptr<ElemType[]> values(value.CopyToArray());
+        RoundToReducedPrecision(format, values.get(), value.GetNumElements());
+
+        // a memory-mapped value is read-only, so the rounded value always goes into a new matrix
+        Matrix<ElemType> rounded(value.GetNumRows(), value.GetNumCols(), values.get(), m_deviceId);
+        value = move(rounded);
+        m_int8Channels = 0;
+    }
+    m_reducedPrecisionStorage = format;
+}
+
+// Layout: format, rows, cols, followed by the 16-bit values.
+template <class ElemType>
+void LearnableParameter<ElemType>::SaveReducedPrecisionValue(File& fstream) const
+{
+    const Matrix<ElemType>& value = Value();
+    const size_t numElements = value.GetNumElements();
+    unique_ptr<ElemType[]> values(value.CopyToArray());
+    vector<uint16_t> reduced(numElements);
+    ConvertToReducedPrecision(m_reducedPrecisionStorage, values.get(), reduced.data(), numElements);
+
+    fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BReducedPrecisionValue");
+    fstream << (int)m_reducedPrecisionStorage << value.GetNumRows() << value.GetNumCols();
+    fwriteOrDie(reduced.data(), sizeof(uint16_t), numElements, fstream);
+    fstream.PutMarker(FileMarker::fileMarkerEndSection, L"EReducedPrecisionValue");
+}
+
+template <class ElemType>
+void LearnableParameter<ElemType>::LoadReducedPrecisionValue(File& fstream)
+{
+    int format;
+    size_t numRows, numCols;
+    fstream >> format >> numRows >> numCols;
+    if (format != (int)ReducedPrecisionFormat::float16 && format != (int)ReducedPrecisionFormat::bfloat16)
+        RuntimeError("LearnableParameter: %ls has an unknown storage format %d in the model file.", NodeName().c_str(), format);
+
+    const size_t numElements = numRows * numCols;
+    vector<uint16_t> reduced(numElements);
+    freadOrDie(reduced.data(), sizeof(uint16_t), numElements, fstream);
+    fstream.GetMarker(FileMarker::fileMarkerEndSection, L"EReducedPrecisionValue");
+
+    vector<ElemType> values(numElements);
+    ConvertFromReducedPrecision((ReducedPrecisionFormat)format, reduced.data(), values.data(), numElements);
+
+    CreateMatrixIfNull(m_value);
+    Value().SetValue(numRows, numCols, m_deviceId, values.data());
+    SetDims(TensorShape(numRows, numCols), false);
+    m_reducedPrecisionStorage = (ReducedPrecisionFormat)format;
+}
+
 template <class ElemType>
 /*virtual*/ void LearnableParameter<ElemType>::CopyTo(ComputationNodeBasePtr nodeP, const wstring& newName, const CopyNodeFlags flags) const /*override*/
 {
@@ -466,6 +678,11 @@ template <class ElemType>
         node->m_initOutputRank = m_initOutputRank;
         node->m_initOnCPUOnly  = m_initOnCPUOnly;
         node->m_initValue      = m_initValue;
+        node->m_int8Channels      = m_int8Channels;
+        node->m_int8ChannelStride = m_int8ChannelStride;
+        node->m_reducedPrecisionStorage = m_reducedPrecisionStorage;
+        if (flags & CopyNodeFlags::copyNodeValueShared)
+            node->m_mappedFile = m_mappedFile; // a shared value may live in the mapped file
     }
 }
 
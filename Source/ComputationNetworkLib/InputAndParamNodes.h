@@ -9,6 +9,7 @@
 #include "ScriptableObjects.h"
 #include "TensorShape.h"
 #include "Matrix.h"
+#include "ReducedPrecision.h"
 
 #include <string>
 
@@ -30,7 +31,7 @@ static const wchar_t* BilinearInitializerTypeName =         L"bilinear";
 // -----------------------------------------------------------------------
 
 template <class ElemType>
-class LearnableParameter : public ComputationNode<ElemType>, public NumInputs<0>, public IFreezable
+class LearnableParameter : public ComputationNode<ElemType>, public NumInputs<0>, public IFreezable, public IMemoryMappable
 {
     typedef ComputationNode<ElemType> Base; UsingComputationNodeMembersBoilerplate;
     static const std::wstring TypeName() { return L"LearnableParameter"; }
@@ -46,6 +47,9 @@ public:
         MarkValueNonSharable();
         m_initString = L"fromValue"; // default init is with 0; typically overwritten
         m_initValue = 0;
+        m_int8Channels = 0;
+        m_int8ChannelStride = 0;
+        m_reducedPrecisionStorage = ReducedPrecisionFormat::none;
     }
     LearnableParameter(DEVICEID_TYPE deviceId, const wstring& name, const TensorShape& shape) :
         LearnableParameter(deviceId, name)
@@ -141,7 +145,42 @@ public:
     // called from CloneFunction(..., parameters="constant")
     virtual void FreezeParameters() override; // from IFreezable
 
+    // called before Load() when the model file is memory-mapped
+    virtual void SetMemoryMappedFile(const shared_ptr<MemoryMappedFile>& mappedFile) override { m_mappedFile = mappedFile; } // from IMemoryMappable
+
+    // Rounds the value to 8-bit integers with one range per channel, see ChannelwiseInt8Quantizer; binary model files
+    // then store the int8 values and ranges. The value stays in ElemType for computation, and consumers that quantize
+    // it again per channel reproduce the stored int8 values exactly.
+    void SetInt8Storage(size_t numChannels, size_t channelStride);
+    bool HasInt8Storage() const { return m_int8Channels > 0; }
+
+    // Rounds the value to a 16-bit floating-point format, see ReducedPrecision.h; binary model files then store the
+    // 16-bit values. The value stays in ElemType for computation; TimesNode multiplies with a 16-bit copy when inferring on the CPU.
+    // ReducedPrecisionFormat::none returns to full-precision storage. Replaces int8 storage and vice versa.
+    void SetReducedPrecisionStorage(ReducedPrecisionFormat format);
+    ReducedPrecisionFormat GetReducedPrecisionStorage() const { return m_reducedPrecisionStorage; }
+
 private:
+    // binary model files store the values such that they can be used in place from a memory-mapped file
+    void SaveAlignedValue(File& fstream) const;
+    void LoadAlignedValue(File& fstream);
+
+    // or as 8-bit integers with their ranges, if SetInt8Storage() was called
+    void SaveInt8Value(File& fstream) const;
+    void LoadInt8Value(File& fstream); // after the begin marker
+
+    size_t m_int8Channels; // 0 for full-precision storage
+    size_t m_int8ChannelStride;
+
+    // or in a 16-bit format, if SetReducedPrecisionStorage() was called
+    void SaveReducedPrecisionValue(File& fstream) const;
+    void LoadReducedPrecisionValue(File& fstream); // after the begin marker
+
+    ReducedPrecisionFormat m_reducedPrecisionStorage;
+
+    // if set, the value refers to this mapping instead of owning a copy
+    shared_ptr<MemoryMappedFile> m_mappedFile;
+
     // init parameters for deferred initialization (which happens in Validate())
     std::wstring m_initString; // if non-empty then deferred initialization is needed. Gets cleared upon completion of deferred init.
     unsigned long m_randomSeed;
@@ -272,6 +311,16 @@ protected:
 public:
     virtual const std::wstring GetRequestedDynamicAxis() const { return m_dynamicAxisNodeName; }
 
+    virtual void CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const override
+    {
+        Base::CopyTo(nodeP, newName, flags);
+        if (flags & CopyNodeFlags::copyNodeValue)
+        {
+            auto node = dynamic_pointer_cast<InputValueBase<ElemType>>(nodeP);
+            node->m_dynamicAxisNodeName = m_dynamicAxisNodeName;
+        }
+    }
+
     virtual void Save(File& fstream) const override
     {
         Base::Save(fstream);
@@ -6,8 +6,10 @@
 
 #include "Basics.h"
 #include "ComputationNode.h"
+#include "InputAndParamNodes.h"
 #include "Matrix.h"
 #include "TensorView.h"
+#include "QuantizedMultiplier.h"
 
 #include <unordered_set>
 #include <map>
@@ -27,7 +29,7 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 // -----------------------------------------------------------------------
 
 template <class ElemType>
-class PlusNode : public BinaryElementWiseNode<ElemType>
+class PlusNode : public BinaryElementWiseNode<ElemType>, public IFusibleElementwiseNode
 {
     typedef BinaryElementWiseNode<ElemType> Base; UsingBinaryElementwiseNodeBaseMembers;
     static const std::wstring TypeName() { return L"Plus"; }
@@ -60,6 +62,11 @@ public:
 
         inputGradient.AddCopyOf(gradient);
     }
+
+    virtual FusedElementwiseStep /*IFusibleElementwiseNode::*/ GetFusedElementwiseStep() const override
+    {
+        return FusedElementwiseStep{ opSum, opNone, noGradient, 2, { 0, 1 } };
+    }
 };
 
 template class PlusNode<float>;
@@ -128,7 +135,7 @@ template class LogPlusNode<double>;
 // -----------------------------------------------------------------------
 
 template <class ElemType>
-class MinusNode : public BinaryElementWiseNode<ElemType>
+class MinusNode : public BinaryElementWiseNode<ElemType>, public IFusibleElementwiseNode
 {
     typedef BinaryElementWiseNode<ElemType> Base; UsingBinaryElementwiseNodeBaseMembers;
     static const std::wstring TypeName() { return L"Minus"; }
@@ -162,6 +169,11 @@ public:
         ElemType sign = inputIndex == 0 ? 1.0f : -1.0f;
         inputGradient.AddCopyOf(gradient, sign);
     }
+
+    virtual FusedElementwiseStep /*IFusibleElementwiseNode::*/ GetFusedElementwiseStep() const override
+    {
+        return FusedElementwiseStep{ opDifference, opNone, noGradient, 2, { 0, 1 } };
+    }
 };
 
 template class MinusNode<float>;
@@ -174,7 +186,7 @@ template class MinusNode<double>;
 // -----------------------------------------------------------------------
 
 template <class ElemType>
-class ElementTimesNode : public BinaryElementWiseNode<ElemType>
+class ElementTimesNode : public BinaryElementWiseNode<ElemType>, public IFusibleElementwiseNode
 {
     typedef BinaryElementWiseNode<ElemType> Base;
     UsingBinaryElementwiseNodeBaseMembers;
@@ -216,6 +228,11 @@ public:
     }
 
     virtual bool InputUsedInComputingInputNodesGradients(size_t /*childIndex*/) const override { return true; }
+
+    virtual FusedElementwiseStep /*IFusibleElementwiseNode::*/ GetFusedElementwiseStep() const override
+    {
+        return FusedElementwiseStep{ opElementwiseProduct, opNone, noGradient, 2, { 0, 1 } };
+    }
 };
 
 template class ElementTimesNode<float>;
@@ -233,13 +250,14 @@ template class ElementTimesNode<double>;
 // -----------------------------------------------------------------------
 
 template <class ElemType, bool m_transpose>
-class TimesNodeBase : public ComputationNode<ElemType>, public NumInputs<2>
+class TimesNodeBase : public ComputationNode<ElemType>, public NumInputs<2>, public IInt8QuantizableNode
 {
     typedef ComputationNode<ElemType> Base; UsingComputationNodeMembers; using Base::OperationName;                                                                                                                           \
 
 public:
     TimesNodeBase(DEVICEID_TYPE deviceId, const wstring& name, size_t outputRank = 1, int inferInputRankToMap = -1)
-        : Base(deviceId, name), m_outputRank(outputRank), m_inferInputRankToMap(inferInputRankToMap)
+        : Base(deviceId, name), m_outputRank(outputRank), m_inferInputRankToMap(inferInputRankToMap), m_int8InputRange(0),
+          m_reducedPrecisionWeight(make_shared<typename ReducedPrecisionMultiplier<ElemType>::Cache>())
     {
     }
 
@@ -251,6 +269,16 @@ public:
             auto node = dynamic_pointer_cast<TimesNodeBase<ElemType, m_transpose>>(nodeP);
             node->m_outputRank          = m_outputRank;
             node->m_inferInputRankToMap = m_inferInputRankToMap;
+            // Each copy needs its own multipliers, as a multiplier is not thread-safe. A copy that multiplies by the same
+            // weight value shares the quantized weight, so that it is prepared and kept only once.
+            bool shareWeight = (flags & CopyNodeFlags::copyNodeParametersShared) != 0;
+            if (m_quantizedMultiplier && shareWeight)
+                node->m_quantizedMultiplier = make_shared<QuantizedMultiplier<ElemType>>(2, m_quantizedMultiplier->GetCache());
+            else
+                node->SetQuantizedInference(m_quantizedMultiplier != nullptr);
+            node->SetInt8InputRange(m_int8InputRange, shareWeight ? m_int8Multiplier : nullptr);
+            if (shareWeight)
+                node->m_reducedPrecisionWeight = m_reducedPrecisionWeight;
         }
     }
 
@@ -259,6 +287,7 @@ public:
         Base::Save(fstream);
         fstream << m_outputRank;
         fstream << m_inferInputRankToMap;
+        fstream << m_int8InputRange;
     }
 
     virtual void Load(File& fstream, size_t modelVersion) override
@@ -272,6 +301,10 @@ public:
             fstream >> m_inferInputRankToMap;
         else
             m_inferInputRankToMap = -1;
+        double int8InputRange = 0;
+        if (modelVersion >= CNTK_MODEL_VERSION_16)
+            fstream >> int8InputRange;
+        SetInt8InputRange(int8InputRange);
     }
 
 private:
@@ -312,7 +345,14 @@ public:
         auto input0 = OneSampleTensorFor(0,  /*gradient=*/false, fr.AllowBroadcast());
         auto input1 = OneSampleTensorFor(1,  /*gradient=*/false, fr.AllowBroadcast());
         auto output = OneSampleTensorFor(-1, /*gradient=*/false, fr);
-        output.AssignMatrixProductOf(false/*transC*/, input0, m_transpose/*transA*/, input1, false/*transB*/);
+        if (m_int8Multiplier && Environment().IsInferring())
+            output.AssignQuantizedMatrixProductOf(input0, m_transpose/*transA*/, input1, *m_int8Multiplier);
+        else if (m_quantizedMultiplier && Environment().IsInferring())
+            output.AssignQuantizedMatrixProductOf(input0, m_transpose/*transA*/, input1, *m_quantizedMultiplier);
+        else if (auto reducedPrecisionMultiplier = GetReducedPrecisionMultiplier())
+            output.AssignReducedPrecisionMatrixProductOf(input0, m_transpose/*transA*/, input1, *reducedPrecisionMultiplier);
+        else
+            output.AssignMatrixProductOf(false/*transC*/, input0, m_transpose/*transA*/, input1, false/*transB*/);
     }
 
     virtual void /*ComputationNode::*/ BackpropTo(const size_t inputIndex, const FrameRange& fr) override
@@ -497,9 +537,81 @@ public:
 
     size_t OutputRank() const { return m_outputRank; }
 
+    // Enables/disables the 16-bit quantized forward pass used in inference mode on the CPU.
+    // The left operand must be constant (a parameter), since its quantized copy is cached.
+    void SetQuantizedInference(bool enable)
+    {
+        if (!enable)
+            m_quantizedMultiplier.reset();
+        else if (!m_quantizedMultiplier)
+            m_quantizedMultiplier = make_shared<QuantizedMultiplier<ElemType>>();
+    }
+
+    // The output channels are the rows of op(A): the leading outputRank dimensions of A, or its columns when transposing.
+    virtual bool CanQuantizeInt8(size_t& numChannels, size_t& channelStride) const override // from IInt8QuantizableNode
+    {
+        if (Input(0)->HasMBLayout() || Input(0)->GetSampleLayout().GetNumElements() == 0)
+            return false;
+        const auto& dimsA = Input(0)->GetSampleLayout().GetDims();
+        bool transpose = m_transpose;
+        if (transpose)
+        {
+            channelStride = dimsA[0];
+            numChannels = Input(0)->GetSampleLayout().GetNumElements() / channelStride;
+        }
+        else
+        {
+            channelStride = 1;
+            numChannels = 1;
+            for (size_t k = 0; k < m_outputRank; k++)
+                numChannels *= dimsA[k];
+        }
+        return true;
+    }
+
+    virtual void SetInt8InputRange(double inputRange) override
+    {
+        SetInt8InputRange(inputRange, nullptr);
+    }
+
+    // sharedWeight - if not null, the multiplier of a node with the same weight value, whose quantized weight is reused
+    void SetInt8InputRange(double inputRange, const shared_ptr<Int8QuantizedMultiplier<ElemType>>& sharedWeight)
+    {
+        m_int8InputRange = inputRange;
+        if (inputRange > 0)
+            m_int8Multiplier = make_shared<Int8QuantizedMultiplier<ElemType>>(inputRange, sharedWeight ? sharedWeight->GetCache() : nullptr);
+        else
+            m_int8Multiplier.reset();
+    }
+
+    virtual double GetInt8InputRange() const override { return m_int8InputRange; }
+
 private:
+    // The multiplier for a weight stored in 16 bits (see LearnableParameter::SetReducedPrecisionStorage()) when inferring on the CPU, else null.
+    // Its packed copy of the weight, which copies with the same weight value share, is dropped whenever the weight may change, i.e. outside of inference.
+    ReducedPrecisionMultiplier<ElemType>* GetReducedPrecisionMultiplier()
+    {
+        auto weight = dynamic_cast<LearnableParameter<ElemType>*>(Input(0).get());
+        ReducedPrecisionFormat format = weight ? weight->GetReducedPrecisionStorage() : ReducedPrecisionFormat::none;
+        if (format == ReducedPrecisionFormat::none || !Environment().IsInferring() || m_deviceId != CPUDEVICE)
+        {
+            if (format != ReducedPrecisionFormat::none)
+                m_reducedPrecisionWeight->Reset();
+            m_reducedPrecisionMultiplier.reset();
+            return nullptr;
+        }
+        if (!m_reducedPrecisionMultiplier || m_reducedPrecisionMultiplier->Format() != format)
+            m_reducedPrecisionMultiplier = make_shared<ReducedPrecisionMultiplier<ElemType>>(format, m_reducedPrecisionWeight);
+        return m_reducedPrecisionMultiplier.get();
+    }
+
     size_t m_outputRank;
     int m_inferInputRankToMap;  // -1 (not specified) or says how to expand shape of W, to keep this many mapping dims
+    shared_ptr<QuantizedMultiplier<ElemType>> m_quantizedMultiplier; // if set, the forward pass in inference mode uses int16 GEMM
+    double m_int8InputRange;                                          // calibrated range of the right operand, 0 if not quantized to int8
+    shared_ptr<Int8QuantizedMultiplier<ElemType>> m_int8Multiplier;   // if set, the forward pass in inference mode uses int8 GEMM
+    shared_ptr<ReducedPrecisionMultiplier<ElemType>> m_reducedPrecisionMultiplier; // see GetReducedPrecisionMultiplier()
+    shared_ptr<typename ReducedPrecisionMultiplier<ElemType>::Cache> m_reducedPrecisionWeight; // its packed weight, shared with copies
 };
 
 // -----------------------------------------------------------------------
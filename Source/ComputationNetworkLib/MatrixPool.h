@@ -8,53 +8,94 @@
 #include <string>
 #include <stdexcept>
 #include <vector>
+#include <map>
+#include <unordered_map>
 #include <algorithm>
 #include <stdlib.h>
 
 #include "Basics.h"
 #include "Matrix.h"
-#include "ComputationNode.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
 // MatrixPool -- class to support memory sharing
 // Despite the gather general name of this class, it is specifically designed to support the memory sharing of ComputationNodes.
-// Note: see #define SUPRESS_MEMSHARING below as for how to temporarily disable memory sharing altogether, for debugging
+//
+// ComputationNetwork::AllocateAllMatrices() simulates the forward and backward passes and requests/releases the
+// matrices in execution order, so the pool sees the full lifetime of each matrix before any memory is allocated.
+// Each request carries the expected matrix size (in elements per sample, known from the validated sample layout).
+// The pool plans the sharing by best fit: released matrices are kept ordered by their planned size, and a request
+// takes the smallest one that is large enough, or otherwise the largest one (which then has to grow the least).
+// This keeps small activations from claiming (and growing) buffers that large ones could have reused.
+// The planned size of a matrix is the largest size requested for it, their sum is the planned peak memory, which is
+// reported against the memory needed without any sharing.
+//
+// Memory sharing can be switched off for debugging by SetMemorySharing(false) (formerly #define SUPRESS_MEMSHARING),
+// or for all pools created afterwards through the process-wide default (config option 'memorySharing').
 class MatrixPool
 {
-    vector<shared_ptr<Matrix<float>>>  m_releasedFloatMatrices;
-    vector<shared_ptr<Matrix<double>>> m_releasedDoubleMatrices;
+    template <class ElemType>
+    using ReleasedMatrices = multimap<size_t, shared_ptr<Matrix<ElemType>>>; // [planned size in bytes] -> matrix
+
+    ReleasedMatrices<float>  m_releasedFloatMatrices;
+    ReleasedMatrices<double> m_releasedDoubleMatrices;
 
     template <class ElemType>
-    vector<shared_ptr<Matrix<ElemType>>>& GetReleasedMatrices();
+    ReleasedMatrices<ElemType>& GetReleasedMatrices();
+
+    // planned size in bytes of each matrix handed out by this pool
+    unordered_map<const MatrixBase*, size_t> m_plannedSizes;
+
+    bool m_memorySharing;
+    size_t m_numRequests;
+    size_t m_plannedSizeInBytes;  // sum of the planned sizes of all matrices of this pool
+    size_t m_requestedSizeInBytes; // sum of the sizes of all requests, i.e. the memory needed without sharing
+
+    static bool& MemorySharingByDefault()
+    {
+        static bool memorySharing = true;
+        return memorySharing;
+    }
 
 public:
+    MatrixPool()
+        : m_memorySharing(MemorySharingByDefault()), m_numRequests(0), m_plannedSizeInBytes(0), m_requestedSizeInBytes(0)
+    {
+    }
+
+    // default for pools created from now on
+    static void SetMemorySharingByDefault(bool enable) { MemorySharingByDefault() = enable; }
+
+    void SetMemorySharing(bool enable) { m_memorySharing = enable; }
+    bool IsMemorySharingEnabled() const { return m_memorySharing; }
+
     // release here means the matrix can be put back and shared by others
     template <class ElemType>
     void Release(shared_ptr<Matrix<ElemType>> freeMatrix)
     {
         if (freeMatrix == nullptr || freeMatrix->GetMatrixType() == SPARSE)
             LogicError("MatrixPool::Release: freeMatrix should not be null or sparse.");
-//#define SUPRESS_MEMSHARING // #define this to disable memory sharing through this structure
-        // TODO: Make this a runtime option.
-#ifndef SUPRESS_MEMSHARING
-        vector<shared_ptr<Matrix<ElemType>>>& releasedMatrices = GetReleasedMatrices<ElemType>();
+        if (!m_memorySharing)
+            return;
+
+        ReleasedMatrices<ElemType>& releasedMatrices = GetReleasedMatrices<ElemType>();
 #ifdef _DEBUG
-        for (int i = 0; i < releasedMatrices.size(); i++)
+        for (const auto& item : releasedMatrices)
         {
-            if (releasedMatrices[i] == freeMatrix)
+            if (item.second == freeMatrix)
                 RuntimeError("MatrixPool::Release: freeMatrix is already in the released pool.");
         }
-
-#endif
-        releasedMatrices.push_back(freeMatrix);
 #endif
+        auto plannedSize = m_plannedSizes.find(freeMatrix.get());
+        releasedMatrices.insert(make_pair(plannedSize != m_plannedSizes.end() ? plannedSize->second : 0, freeMatrix));
     }
 
+    // numElements - expected number of elements (per sample) of the matrix, 0 if not known
     template <class ElemType>
-    shared_ptr<Matrix<ElemType>> Request(DEVICEID_TYPE deviceId)
+    shared_ptr<Matrix<ElemType>> Request(DEVICEID_TYPE deviceId, size_t numElements = 0)
     {
-        vector<shared_ptr<Matrix<ElemType>>>& releasedMatrices = GetReleasedMatrices<ElemType>();
+        ReleasedMatrices<ElemType>& releasedMatrices = GetReleasedMatrices<ElemType>();
+        const size_t sizeInBytes = numElements * sizeof(ElemType);
         shared_ptr<Matrix<ElemType>> matrixPtr;
         if (releasedMatrices.empty())
         {
@@ -62,15 +103,34 @@ public:
         }
         else
         {
-            matrixPtr = releasedMatrices.back();
-            releasedMatrices.pop_back();
+            // best fit: the smallest released matrix that is large enough, otherwise the largest one
+            auto bestFit = releasedMatrices.lower_bound(sizeInBytes);
+            if (bestFit == releasedMatrices.end())
+                --bestFit;
+            matrixPtr = bestFit->second;
+            releasedMatrices.erase(bestFit);
         }
 
         if (!matrixPtr) // this can't really happen
             LogicError("MatrixPool::Request: failed to get a valid matrix.");
 
+        size_t& plannedSize = m_plannedSizes[matrixPtr.get()];
+        if (plannedSize < sizeInBytes)
+        {
+            m_plannedSizeInBytes += sizeInBytes - plannedSize;
+            plannedSize = sizeInBytes;
+        }
+        m_requestedSizeInBytes += sizeInBytes;
+        m_numRequests++;
+
         return matrixPtr;
     }
+
+    // statistics of the memory sharing plan, sizes are per sample
+    size_t GetNumberOfRequests() const { return m_numRequests; }
+    size_t GetNumberOfMatrices() const { return m_plannedSizes.size(); }
+    size_t GetPlannedSizeInBytes() const { return m_plannedSizeInBytes; }
+    size_t GetRequestedSizeInBytes() const { return m_requestedSizeInBytes; }
 };
 
 }}}
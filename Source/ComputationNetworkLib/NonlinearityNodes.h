@@ -27,16 +27,8 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 // only inputs (but not // function values) are used.
 // -----------------------------------------------------------------------
 
-enum GradientOperationType 
-{
-    noGradient,
-    unaryGradient,
-    binaryWithInputGradient,
-    binaryWithOutputGradient
-};
-
 template <class ElemType, ElementWiseOperator opForward, ElementWiseOperator opBackward, GradientOperationType opType>
-class UnaryElementWiseWithOpCodeNodeBase : public ComputationNode<ElemType>, public NumInputs<1>
+class UnaryElementWiseWithOpCodeNodeBase : public ComputationNode<ElemType>, public NumInputs<1>, public IFusibleElementwiseNode
 {
     typedef ComputationNode<ElemType> Base;
     UsingComputationNodeMembers;
@@ -97,6 +89,11 @@ public:
     {
         return opType == binaryWithInputGradient;
     }
+
+    virtual FusedElementwiseStep /*IFusibleElementwiseNode::*/ GetFusedElementwiseStep() const override
+    {
+        return FusedElementwiseStep{ opForward, opBackward, opType, 1, { 0, 0 } };
+    }
 };
 
 #define UnaryElementWiseWithOpCodeNodeBaseMembers UsingComputationNodeMembersBoilerplate;
@@ -155,6 +155,10 @@ void OptimizedRNNStackNode<ElemType>::BackpropTo(const size_t inputIndex, const
 {
     MBLayoutPtr mb = this->GetMBLayout();
 
+    // the CPU implementation is inference only
+    if (m_transposedOutput->GetDeviceId() == CPUDEVICE)
+        RuntimeError("OptimizedRNNStackNode: Training is only supported on the GPU, the CPU implementation supports evaluation only.");
+
     // ensure BackwardData is the first method called, as required by CuDnn API
     if (!m_BackwardDataCalledYet)
     {
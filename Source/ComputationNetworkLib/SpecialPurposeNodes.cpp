@@ -6,6 +6,7 @@
 #include "Basics.h"
 #include "ComputationNode.h"
 #include "SpecialPurposeNodes.h"
+#include "TensorOps.h"
 
 #include <string>
 #include <vector>
@@ -145,4 +146,400 @@ template <class ElemType>
 template class TraceNode<float>;
 template class TraceNode<double>;
 
+// -----------------------------------------------------------------------
+// FusedElementwise (input0, input1, ...)
+//
+// Chain of element-wise operations, created by ComputationNetwork::FuseElementwiseOperations().
+// -----------------------------------------------------------------------
+
+// below this number of elements, the fused loops run on the calling thread only
+static const size_t c_minParallelFusedElements = 16384;
+// the gradient of a broadcast input is summed over blocks of this many columns
+static const size_t c_fusedGradientColumnBlockSize = 64;
+
+// apply an element-wise operation to scalars, using the same functions as the CPU tensor ops
+template <class ElemType>
+static inline ElemType ApplyFusedUnaryOp(ElementWiseOperator op, ElemType a)
+{
+#define CaseFusedUnaryOp(oper) case ElementWiseOperator::op##oper: return Op##oper(a)
+    switch (op)
+    {
+        ForAllUnaryOps(CaseFusedUnaryOp);
+    default:
+        LogicError("FusedElementwise: Unary operation %d is not supported.", (int) op);
+    }
+#undef CaseFusedUnaryOp
+}
+
+template <class ElemType>
+static inline ElemType ApplyFusedBinaryOp(ElementWiseOperator op, ElemType a, ElemType b)
+{
+#define CaseFusedBinaryOp(oper) case ElementWiseOperator::op##oper: return Op##oper(a, b)
+    switch (op)
+    {
+        ForAllBinaryOps(CaseFusedBinaryOp);
+    default:
+        LogicError("FusedElementwise: Binary operation %d is not supported.", (int) op);
+    }
+#undef CaseFusedBinaryOp
+}
+
+template <class ElemType>
+FusedElementwiseNode<ElemType>::FusedElementwiseNode(const ScriptableObjects::IConfigRecordPtr configp) :
+    FusedElementwiseNode(configp->Get(L"deviceId"), L"<placeholder>")
+{
+    InvalidArgument("FusedElementwise: This node is created by the element-wise fusion of a network and cannot be specified directly.");
+}
+
+template <class ElemType>
+/*virtual*/ void FusedElementwiseNode<ElemType>::CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const /*override*/
+{
+    Base::CopyTo(nodeP, newName, flags);
+    auto node = dynamic_pointer_cast<FusedElementwiseNode<ElemType>>(nodeP);
+    node->m_steps = m_steps;
+}
+
+template <class ElemType>
+/*virtual*/ void FusedElementwiseNode<ElemType>::Save(File& fstream) const /*override*/
+{
+    Base::Save(fstream);
+    fstream << m_steps.size();
+    for (const auto& step : m_steps)
+        fstream << (int) step.m_op << (int) step.m_backwardOp << (int) step.m_gradientType << step.m_numOperands << step.m_operands[0] << step.m_operands[1];
+}
+
+template <class ElemType>
+/*virtual*/ void FusedElementwiseNode<ElemType>::Load(File& fstream, size_t modelVersion) /*override*/
+{
+    Base::Load(fstream, modelVersion);
+    size_t numSteps;
+    fstream >> numSteps;
+    m_steps.resize(numSteps);
+    for (auto& step : m_steps)
+    {
+        int op, backwardOp, gradientType;
+        fstream >> op >> backwardOp >> gradientType >> step.m_numOperands >> step.m_operands[0] >> step.m_operands[1];
+        step.m_op = (ElementWiseOperator) op;
+        step.m_backwardOp = (ElementWiseOperator) backwardOp;
+        step.m_gradientType = (GradientOperationType) gradientType;
+    }
+}
+
+template <class ElemType>
+/*virtual*/ void FusedElementwiseNode<ElemType>::Validate(bool isFinalValidationPass) /*override*/
+{
+    // each step may only use the inputs and the steps before it
+    const size_t numInputs = GetNumInputs();
+    bool isValid = numInputs > 0 && !m_steps.empty() && m_steps.size() <= MaxNumSteps && numInputs + m_steps.size() <= MaxNumValues;
+    for (size_t s = 0; isValid && s < m_steps.size(); s++)
+    {
+        isValid = m_steps[s].m_numOperands == 1 || m_steps[s].m_numOperands == 2;
+        for (size_t k = 0; isValid && k < m_steps[s].m_numOperands; k++)
+            isValid = m_steps[s].m_operands[k] < numInputs + s;
+    }
+    if (!isValid)
+        LogicError("%ls: Invalid chain of element-wise operations.", NodeDescription().c_str());
+
+    ValidateNaryZip(isFinalValidationPass, /*allowBroadcast=*/ true, numInputs);
+}
+
+// The fused loops require dense CPU matrices for the entire minibatch. Each input must either have
+// the dimensions of the result, or be a single column without MBLayout that is broadcast to all columns.
+template <class ElemType>
+bool FusedElementwiseNode<ElemType>::CanUseFusedLoop(const FrameRange& fr, size_t gradientInputIndex) const
+{
+    if (!fr.IsAllFrames() || Value().GetDeviceId() != CPUDEVICE || Value().GetMatrixType() != DENSE)
+        return false;
+    if (gradientInputIndex != SIZE_MAX && (Gradient().GetMatrixType() != DENSE || InputRef(gradientInputIndex).Gradient().GetMatrixType() != DENSE))
+        return false;
+    for (size_t i = 0; i < GetNumInputs(); i++)
+    {
+        const auto& inputValue = InputRef(i).Value();
+        if (inputValue.GetDeviceId() != CPUDEVICE || inputValue.GetMatrixType() != DENSE)
+            return false;
+        if (IsBroadcastInput(i) ? inputValue.GetNumElements() != Value().GetNumRows()
+                                : Input(i)->GetMBLayout() != GetMBLayout() || inputValue.GetNumElements() != Value().GetNumElements())
+            return false;
+    }
+    return true;
+}
+
+// values[] holds the values of the inputs at one element; this computes those of the steps after them
+template <class ElemType>
+inline void FusedElementwiseNode<ElemType>::EvaluateSteps(ElemType* values, size_t numInputs) const
+{
+    for (size_t s = 0; s < m_steps.size(); s++)
+    {
+        const auto& step = m_steps[s];
+        if (step.m_numOperands == 1)
+            values[numInputs + s] = ApplyFusedUnaryOp(step.m_op, values[step.m_operands[0]]);
+        else
+            values[numInputs + s] = ApplyFusedBinaryOp(step.m_op, values[step.m_operands[0]], values[step.m_operands[1]]);
+    }
+}
+
+// propagate the gradient of the last step at one element back through all steps
+// gradients[] must be zero except for the last step. Only the steps that depend on the input
+// whose gradient is computed are visited (see DependsOnInput()).
+template <class ElemType>
+inline void FusedElementwiseNode<ElemType>::BackpropSteps(const ElemType* values, ElemType* gradients, const char* dependsOnInput, size_t numInputs) const
+{
+    for (size_t s = m_steps.size(); s-- > 0;)
+    {
+        const size_t result = numInputs + s;
+        if (!dependsOnInput[result])
+            continue;
+        const auto& step = m_steps[s];
+        const ElemType gradient = gradients[result];
+        const size_t a = step.m_operands[0];
+        if (step.m_numOperands == 1) // same as UnaryElementWiseWithOpCodeNodeBase::BackpropTo()
+        {
+            if (step.m_gradientType == unaryGradient)
+                gradients[a] += ApplyFusedUnaryOp(step.m_backwardOp, gradient);
+            else if (step.m_gradientType == binaryWithInputGradient)
+                gradients[a] += ApplyFusedBinaryOp(step.m_backwardOp, gradient, values[a]);
+            else if (step.m_gradientType == binaryWithOutputGradient)
+                gradients[a] += ApplyFusedBinaryOp(step.m_backwardOp, gradient, values[result]);
+            continue;
+        }
+        const size_t b = step.m_operands[1];
+        if (step.m_op == ElementWiseOperator::opElementwiseProduct)
+        {
+            if (dependsOnInput[a])
+                gradients[a] += gradient * values[b];
+            if (dependsOnInput[b])
+                gradients[b] += gradient * values[a];
+        }
+        else
+        {
+            if (dependsOnInput[a])
+                gradients[a] += gradient;
+            if (dependsOnInput[b])
+                gradients[b] += step.m_op == ElementWiseOperator::opDifference ? -gradient : gradient;
+        }
+    }
+}
+
+// flags for the inputs and steps whose values depend on input 'inputIndex'
+template <class ElemType>
+std::vector<char> FusedElementwiseNode<ElemType>::DependsOnInput(size_t inputIndex) const
+{
+    const size_t numInputs = GetNumInputs();
+    std::vector<char> dependsOnInput(numInputs + m_steps.size(), 0);
+    dependsOnInput[inputIndex] = 1;
+    for (size_t s = 0; s < m_steps.size(); s++)
+        for (size_t k = 0; k < m_steps[s].m_numOperands; k++)
+            dependsOnInput[numInputs + s] |= dependsOnInput[m_steps[s].m_operands[k]];
+    return dependsOnInput;
+}
+
+template <class ElemType>
+/*virtual*/ void FusedElementwiseNode<ElemType>::ForwardProp(const FrameRange& fr) /*override*/
+{
+    if (!CanUseFusedLoop(fr, SIZE_MAX))
+        return ForwardPropWithTensorOps(fr);
+
+    const size_t numInputs = GetNumInputs();
+    const size_t numRows = Value().GetNumRows();
+    const size_t numCols = Value().GetNumCols();
+    const ElemType* inputs[MaxNumValues];
+    bool isBroadcast[MaxNumValues];
+    for (size_t i = 0; i < numInputs; i++)
+    {
+        inputs[i] = InputRef(i).Value().Data();
+        isBroadcast[i] = IsBroadcastInput(i);
+    }
+    ElemType* result = Value().Data();
+    const size_t resultIndex = numInputs + m_steps.size() - 1;
+
+#pragma omp parallel for if (numRows * numCols >= c_minParallelFusedElements)
+    for (long j = 0; j < (long) numCols; j++)
+    {
+        ElemType values[MaxNumValues];
+        for (size_t r = 0; r < numRows; r++)
+        {
+            for (size_t i = 0; i < numInputs; i++)
+                values[i] = inputs[i][isBroadcast[i] ? r : j * numRows + r];
+            EvaluateSteps(values, numInputs);
+            result[j * numRows + r] = values[resultIndex];
+        }
+    }
+}
+
+template <class ElemType>
+/*virtual*/ void FusedElementwiseNode<ElemType>::BackpropTo(const size_t inputIndex, const FrameRange& fr) /*override*/
+{
+    if (!CanUseFusedLoop(fr, inputIndex))
+        return BackpropToWithTensorOps(inputIndex, fr);
+
+    const size_t numInputs = GetNumInputs();
+    const size_t numValues = numInputs + m_steps.size();
+    const size_t numRows = Value().GetNumRows();
+    const size_t numCols = Value().GetNumCols();
+    const ElemType* inputs[MaxNumValues];
+    bool isBroadcast[MaxNumValues];
+    for (size_t i = 0; i < numInputs; i++)
+    {
+        inputs[i] = InputRef(i).Value().Data();
+        isBroadcast[i] = IsBroadcastInput(i);
+    }
+    const ElemType* gradient = Gradient().Data();
+    ElemType* inputGradient = InputRef(inputIndex).Gradient().Data();
+    const auto dependsOnInput = DependsOnInput(inputIndex);
+
+    // gradient of the result at element (r, j) with respect to the input at that element
+    auto elementGradient = [&](size_t r, size_t j) -> ElemType
+    {
+        ElemType values[MaxNumValues];
+        ElemType gradients[MaxNumValues] = { 0 };
+        for (size_t i = 0; i < numInputs; i++)
+            values[i] = inputs[i][isBroadcast[i] ? r : j * numRows + r];
+        EvaluateSteps(values, numInputs);
+        gradients[numValues - 1] = gradient[j * numRows + r];
+        BackpropSteps(values, gradients, dependsOnInput.data(), numInputs);
+        return gradients[inputIndex];
+    };
+
+    if (!isBroadcast[inputIndex])
+    {
+#pragma omp parallel for if (numRows * numCols >= c_minParallelFusedElements)
+        for (long j = 0; j < (long) numCols; j++)
+            for (size_t r = 0; r < numRows; r++)
+                inputGradient[j * numRows + r] += elementGradient(r, j);
+        return;
+    }
+
+    // The input is broadcast to all columns, so its gradient is the sum over the columns, except for gaps.
+    // Columns are summed in blocks of fixed size, so that the result does not depend on the number of threads.
+    std::vector<char> isGap(numCols, 0);
+    const auto& pMBLayout = GetMBLayout();
+    if (pMBLayout->HasGaps())
+    {
+        const size_t numParallelSequences = pMBLayout->GetNumParallelSequences();
+        for (size_t t = 0; t < pMBLayout->GetNumTimeSteps(); t++)
+            for (size_t s = 0; s < numParallelSequences; s++)
+                isGap[t * numParallelSequences + s] = pMBLayout->IsGap(FrameRange(nullptr, t).Sequence(s));
+    }
+    const size_t numBlocks = (numCols + c_fusedGradientColumnBlockSize - 1) / c_fusedGradientColumnBlockSize;
+    std::vector<ElemType> blockGradients(numBlocks * numRows, 0);
+#pragma omp parallel for if (numRows * numCols >= c_minParallelFusedElements)
+    for (long block = 0; block < (long) numBlocks; block++)
+    {
+        ElemType* blockGradient = blockGradients.data() + block * numRows;
+        for (size_t j = block * c_fusedGradientColumnBlockSize; j < min(numCols, (block + 1) * c_fusedGradientColumnBlockSize); j++)
+            if (!isGap[j])
+                for (size_t r = 0; r < numRows; r++)
+                    blockGradient[r] += elementGradient(r, j);
+    }
+    for (size_t block = 0; block < numBlocks; block++)
+        for (size_t r = 0; r < numRows; r++)
+            inputGradient[r] += blockGradients[block * numRows + r];
+}
+
+// tensor of the value or gradient of step 's', allocated like the value of this node
+template <class ElemType>
+TensorView<ElemType> FusedElementwiseNode<ElemType>::StepTensorFor(std::vector<shared_ptr<Matrix<ElemType>>>& matrices, size_t s, size_t rank, const FrameRange& fr)
+{
+    if (matrices.size() < m_steps.size())
+        matrices.resize(m_steps.size());
+    CreateMatrixIfNull(matrices[s]);
+    matrices[s]->Resize(Value());
+    return DataTensorFor(matrices[s], rank, fr);
+}
+
+template <class ElemType>
+static void ForwardPropStepWithTensorOps(TensorView<ElemType>& result, const FusedElementwiseStep& step, const std::vector<TensorView<ElemType>>& values)
+{
+    if (step.m_numOperands == 1)
+        result.DoUnaryOpOf(0, values[step.m_operands[0]], 1, step.m_op, ElementWiseOperator::opSum);
+    else
+        result.DoBinaryOpOf(0, values[step.m_operands[0]], values[step.m_operands[1]], 1, step.m_op, ElementWiseOperator::opSum);
+}
+
+// compute the steps one after another with the tensor ops of the original nodes
+template <class ElemType>
+void FusedElementwiseNode<ElemType>::ForwardPropWithTensorOps(const FrameRange& fr)
+{
+    size_t rank = DetermineElementwiseTensorRank();
+    std::vector<TensorView<ElemType>> values;
+    for (size_t i = 0; i < GetNumInputs(); i++)
+        values.push_back(InputRef(i).ValueTensorFor(rank, fr.AllowBroadcast()));
+    for (size_t s = 0; s < m_steps.size(); s++)
+    {
+        auto result = s + 1 < m_steps.size() ? StepTensorFor(m_stepValues, s, rank, fr) : ValueTensorFor(rank, fr);
+        ForwardPropStepWithTensorOps(result, m_steps[s], values);
+        values.push_back(result);
+    }
+}
+
+template <class ElemType>
+void FusedElementwiseNode<ElemType>::BackpropToWithTensorOps(const size_t inputIndex, const FrameRange& fr)
+{
+    size_t rank = DetermineElementwiseTensorRank();
+    const size_t numInputs = GetNumInputs();
+    const auto dependsOnInput = DependsOnInput(inputIndex);
+
+    // if reduction then mask the gaps, like the original nodes
+    if (Input(inputIndex)->ReducesInTimeWrt(shared_from_this()))
+    {
+        MaskMissingGradientColumnsToZero(fr);
+        for (size_t i = 0; i < numInputs; i++)
+            if (i != inputIndex && Input(inputIndex)->ReducesInTimeWrt(Input(i)))
+                Input(i)->MaskMissingValueColumnsToZero(fr);
+    }
+
+    // recompute the values of all steps, as the intermediate values are not kept
+    std::vector<TensorView<ElemType>> values;
+    for (size_t i = 0; i < numInputs; i++)
+        values.push_back(InputRef(i).ValueTensorFor(rank, fr.AllowBroadcast()));
+    for (size_t s = 0; s < m_steps.size(); s++)
+    {
+        auto result = StepTensorFor(m_stepValues, s, rank, fr);
+        ForwardPropStepWithTensorOps(result, m_steps[s], values);
+        values.push_back(result);
+    }
+
+    std::vector<TensorView<ElemType>> stepGradients;
+    for (size_t s = 0; s + 1 < m_steps.size(); s++)
+    {
+        stepGradients.push_back(StepTensorFor(m_stepGradients, s, rank, fr));
+        m_stepGradients[s]->SetValue(0);
+    }
+    stepGradients.push_back(GradientTensorFor(rank, fr));
+    auto inputGradient = InputRef(inputIndex).GradientTensorFor(rank, fr.AllowBroadcast());
+
+    for (size_t s = m_steps.size(); s-- > 0;)
+    {
+        const auto& step = m_steps[s];
+        if (!dependsOnInput[numInputs + s])
+            continue;
+        const auto& gradient = stepGradients[s];
+        for (size_t k = 0; k < step.m_numOperands; k++)
+        {
+            const size_t operand = step.m_operands[k];
+            if (!dependsOnInput[operand])
+                continue;
+            auto operandGradient = operand < numInputs ? inputGradient : stepGradients[operand - numInputs];
+            if (step.m_numOperands == 1) // same as UnaryElementWiseWithOpCodeNodeBase::BackpropTo()
+            {
+                if (step.m_gradientType == unaryGradient)
+                    operandGradient.DoUnaryOpOf(1, gradient, 1, step.m_backwardOp, ElementWiseOperator::opSum);
+                else if (step.m_gradientType == binaryWithInputGradient)
+                    operandGradient.DoBinaryOpOf(1, gradient, values[operand], 1, step.m_backwardOp, ElementWiseOperator::opSum);
+                else if (step.m_gradientType == binaryWithOutputGradient)
+                    operandGradient.DoBinaryOpOf(1, gradient, values[numInputs + s], 1, step.m_backwardOp, ElementWiseOperator::opSum);
+            }
+            else if (step.m_op == ElementWiseOperator::opElementwiseProduct)
+                operandGradient.DoBinaryOpOf(1, gradient, values[step.m_operands[1 - k]], 1, ElementWiseOperator::opElementwiseProduct, ElementWiseOperator::opSum);
+            else if (step.m_op == ElementWiseOperator::opDifference && k == 1)
+                operandGradient.DoUnaryOpOf(1, gradient, 1, ElementWiseOperator::opNegate, ElementWiseOperator::opSum);
+            else
+                operandGradient.DoUnaryOpOf(1, gradient, 1, ElementWiseOperator::opCopy, ElementWiseOperator::opSum);
+        }
+    }
+}
+
+template class FusedElementwiseNode<float>;
+template class FusedElementwiseNode<double>;
+
 }}}
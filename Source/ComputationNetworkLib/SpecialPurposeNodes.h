@@ -64,6 +64,66 @@ private:
     std::vector<std::string> m_labelMapping;
 };
 
+// -----------------------------------------------------------------------
+// FusedElementwiseNode (input0, input1, ...) -- a chain of element-wise operations computed in a single pass
+// This node is not specified by users. ComputationNetwork::FuseElementwiseOperations() creates it from
+// element-wise nodes (IFusibleElementwiseNode) whose values are only used by the next one of the chain,
+// e.g. Plus -> Sigmoid -> ElementTimes in an LSTM cell. The chain is stored as a list of steps, in
+// evaluation order; the last step is the value of this node.
+// On the CPU, all steps are computed for one element before moving to the next, and the intermediate
+// values are never stored. Their gradients are computed the same way, recomputing the intermediate values
+// from the inputs. Each input must have the dimensions of the result, or have no MBLayout and be
+// broadcast to all of its columns. In all other cases (GPU, sparse inputs, individual time steps) the
+// steps are computed one after another with the same tensor operations as the original nodes.
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+class FusedElementwiseNode : public ComputationNode<ElemType>
+{
+    typedef ComputationNode<ElemType> Base; UsingComputationNodeMembersBoilerplate;
+    static const std::wstring TypeName() { return L"FusedElementwise"; }
+
+public:
+    // The values of the inputs and steps at one element are kept in fixed-size arrays.
+    static const size_t MaxNumSteps = 16;
+    static const size_t MaxNumValues = 2 * MaxNumSteps + 1; // steps have at most 2 operands
+
+    FusedElementwiseNode(DEVICEID_TYPE deviceId, const wstring& name, const std::vector<FusedElementwiseStep>& steps = std::vector<FusedElementwiseStep>())
+        : Base(deviceId, name), m_steps(steps)
+    {
+    }
+
+    FusedElementwiseNode(const ScriptableObjects::IConfigRecordPtr configp);
+    virtual void CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const override;
+    virtual void Save(File& fstream) const override;
+    virtual void Load(File& fstream, size_t modelVersion) override;
+    virtual void /*ComputationNode::*/ ForwardProp(const FrameRange& fr) override;
+    virtual void /*ComputationNode::*/ BackpropTo(const size_t inputIndex, const FrameRange& fr) override;
+    virtual void /*ComputationNodeBase::*/ Validate(bool isFinalValidationPass) override;
+
+    // the gradient recomputes the intermediate values from the inputs
+    virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
+    virtual bool InputUsedInComputingInputNodesGradients(size_t /*childIndex*/) const override { return true; }
+
+    const std::vector<FusedElementwiseStep>& GetSteps() const { return m_steps; }
+
+private:
+    bool CanUseFusedLoop(const FrameRange& fr, size_t gradientInputIndex) const;
+    bool IsBroadcastInput(size_t inputIndex) const { return HasMBLayout() && !Input(inputIndex)->HasMBLayout(); }
+    void EvaluateSteps(ElemType* values, size_t numInputs) const;
+    void BackpropSteps(const ElemType* values, ElemType* gradients, const char* dependsOnInput, size_t numInputs) const;
+    std::vector<char> DependsOnInput(size_t inputIndex) const;
+    TensorView<ElemType> StepTensorFor(std::vector<shared_ptr<Matrix<ElemType>>>& matrices, size_t s, size_t rank, const FrameRange& fr);
+    void ForwardPropWithTensorOps(const FrameRange& fr);
+    void BackpropToWithTensorOps(const size_t inputIndex, const FrameRange& fr);
+
+private:
+    std::vector<FusedElementwiseStep> m_steps;
+    // values and gradients of all but the last step, only used by the tensor-op fallback
+    std::vector<shared_ptr<Matrix<ElemType>>> m_stepValues;
+    std::vector<shared_ptr<Matrix<ElemType>>> m_stepGradients;
+};
+
 #ifdef COMING_SOON
 
 // -----------------------------------------------------------------------
@@ -1597,7 +1597,7 @@ template class DropoutNode<double>;
 // * imageLayout is the image layout. Only cudnn is supported at present.
 // -----------------------------------------------------------------------
 template <class ElemType>
-class BatchNormalizationNode : public ComputationNodeNonLooping<ElemType>, public NumInputs<5>, public IFreezable
+class BatchNormalizationNode : public ComputationNodeNonLooping<ElemType>, public NumInputs<5>, public IFreezable, public IChannelBlockedLayoutNode
 {
     typedef ComputationNodeNonLooping<ElemType> Base; UsingComputationNodeMembersBoilerplate;
     static const std::wstring TypeName() { return L"BatchNormalization"; }
@@ -1606,14 +1606,14 @@ public:
     BatchNormalizationNode(DEVICEID_TYPE deviceId, const wstring& name) :
         Base(deviceId, name), m_spatial(false), m_normTimeConst(0), m_blendTimeConst(0), m_epsilon(0), m_useCntkEngine(true),
         m_samplesSeen(0), m_imageLayoutKind(ImageLayoutKind::CHW), m_postBatchNormalization(false), m_swapNormTimeConst(0),
-        m_swapBlendTimeConst(0), m_convertRunningVariancePending(false)
+        m_swapBlendTimeConst(0), m_convertRunningVariancePending(false), m_channelBlocked(false)
     {
     }
     BatchNormalizationNode(DEVICEID_TYPE deviceId, const wstring& name, bool spatial, double normalizationTimeConstant, double blendTimeConstant,
                            double epsilon, bool useCntkEngine, ImageLayoutKind imageLayoutKind) :
         Base(deviceId, name), m_spatial(spatial), m_normTimeConst(normalizationTimeConstant), m_blendTimeConst(blendTimeConstant),
         m_epsilon(epsilon), m_useCntkEngine(useCntkEngine), m_imageLayoutKind(imageLayoutKind), m_samplesSeen(0), m_postBatchNormalization(false),
-        m_swapNormTimeConst(0), m_swapBlendTimeConst(0), m_convertRunningVariancePending(false)
+        m_swapNormTimeConst(0), m_swapBlendTimeConst(0), m_convertRunningVariancePending(false), m_channelBlocked(false)
     {
     }
     BatchNormalizationNode(const ScriptableObjects::IConfigRecordPtr configp) :
@@ -1639,6 +1639,7 @@ public:
         fstream << m_samplesSeen;
         fstream << m_epsilon;
         fstream << m_useCntkEngine;
+        fstream << m_channelBlocked;
     }
 
     void Load(File& fstream, size_t modelVersion) override
@@ -1658,6 +1659,8 @@ public:
                 fstream >> mbCount; // converted below
             fstream >> m_epsilon;
             fstream >> m_useCntkEngine;
+            if (modelVersion >= CNTK_MODEL_VERSION_18)
+                fstream >> m_channelBlocked;
         }
         else
         {
@@ -1732,6 +1735,7 @@ public:
             node->m_samplesSeen = m_samplesSeen;
             node->m_epsilon = m_epsilon;
             node->m_useCntkEngine = m_useCntkEngine;
+            node->m_channelBlocked = m_channelBlocked;
         }
     }
 
@@ -1989,7 +1993,7 @@ public:
             if (m_bnEng == nullptr)
             {
                 auto shape = GetSampleLayout();
-                m_bnEng = BatchNormEngine<ElemType>::Create(m_deviceId, shape, m_spatial, m_imageLayoutKind,
+                m_bnEng = BatchNormEngine<ElemType>::Create(m_deviceId, shape, m_spatial, m_channelBlocked ? ImageLayoutKind::CHWc : m_imageLayoutKind,
                                                             m_useCntkEngine ? BatchNormEngineKind::Cntk : BatchNormEngineKind::CuDnn);
             }
         }
@@ -2037,8 +2041,25 @@ public:
         m_blendTimeConst = std::numeric_limits<double>::infinity();
     }
 
+    // spatial normalization of a cudnn-layout image can be computed on the channel-blocked layout (for inference only)
+    bool CanUseChannelBlockedLayout(size_t& imageInputIndex) const override // from IChannelBlockedLayoutNode
+    {
+        imageInputIndex = 0;
+        return m_spatial && m_imageLayoutKind == CHW && BatchNormEngine<ElemType>::IsChannelBlockedLayoutSupported(m_deviceId, GetSampleLayout(), m_spatial);
+    }
+
+    void SetChannelBlockedLayout(bool enable) override
+    {
+        if (enable != m_channelBlocked)
+            m_bnEng = nullptr; // recreated by the next validation
+        m_channelBlocked = enable;
+    }
+
     double NormalizationTimeConstant() const { return m_normTimeConst; }
     double BlendTimeConstant() const { return m_blendTimeConst; }
+    // number of samples that the running statistics were estimated from; inference requires it to be nonzero
+    size_t SamplesSeen() const { return m_samplesSeen; }
+    void SetSamplesSeen(size_t samplesSeen) { m_samplesSeen = samplesSeen; } // for running statistics that were estimated elsewhere
     bool Spatial() const { return m_spatial; }
     double Epsilon() const { return m_epsilon; }
     bool UseCNTKEngine() const { return m_useCntkEngine; }
@@ -2128,6 +2149,9 @@ private:
     double m_swapNormTimeConst;
     double m_swapBlendTimeConst;
     bool m_convertRunningVariancePending;
+
+    // Input and output are in the channel-blocked layout ImageLayoutKind::CHWc. Not saved.
+    bool m_channelBlocked;
 };
 
 template class BatchNormalizationNode<float>;
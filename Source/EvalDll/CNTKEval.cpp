@@ -45,6 +45,7 @@ void CNTKEvalBase<ElemType>::Init(const std::string& config)
     size_t nThreads = m_config("numCPUThreads", "1");
     CPUMatrix<ElemType>::SetNumThreads(nThreads);
     g_shareNodeValueMatrices = m_config(L"shareNodeValueMatrices", false);
+    MatrixPool::SetMemorySharingByDefault(m_config(L"memorySharing", true));
 }
 
 
@@ -63,6 +64,10 @@ void CNTKEvalBase<ElemType>::CreateNetwork(const std::string& networkDescription
     {
         LogicError("Unable to construct network from description");
     }
+
+    // Opt-in: evaluate products with constant weights through the 16-bit integer GEMM.
+    if (config(L"quantizedInference", false))
+        ComputationNetwork::SetQuantizedInference<ElemType>(this->m_net, nullptr, true);
 }
 
 
@@ -240,6 +245,20 @@ template class CNTKEval<float>;
 // Extended interface
 // ----------------------------------------------------------------------------
 
+template <typename ElemType>
+void CNTKEvalExtended<ElemType>::CreateNetwork(const std::string& networkDescription)
+{
+    CNTKEvalBase<ElemType>::CreateNetwork(networkDescription);
+
+    // settings for ForwardPassBatched()
+    ConfigParameters config;
+    config.Parse(networkDescription);
+    m_maxBatchSize = config(L"maxBatchSize", (size_t)32);
+    if (m_maxBatchSize == 0)
+        InvalidArgument("maxBatchSize must be at least 1.");
+    m_maxBatchWait = std::chrono::microseconds((long long)(1000 * config(L"maxBatchWaitMs", 5.0)));
+}
+
 template<typename ElemType>
 VariableLayout CNTKEvalExtended<ElemType>::ToVariableLayout(const ComputationNodeBasePtr n) 
 {
@@ -308,6 +327,46 @@ VariableSchema CNTKEvalExtended<ElemType>::GetInputSchema() const
     return inputLayouts;
 }
 
+// GetNumSamples - validate an input buffer against the input node it is meant for, and return its number of samples (columns)
+template<typename ElemType>
+template<template<typename> class ValueContainer>
+/*static*/ size_t CNTKEvalExtended<ElemType>::GetNumSamples(const ComputationNodeBasePtr& inputNode, const ValueBuffer<ElemType, ValueContainer>& buffer)
+{
+    auto matrix = dynamic_pointer_cast<Matrix<ElemType>>(inputNode->ValuePtr());
+    auto type = matrix->GetMatrixType();
+    size_t numRows = inputNode->GetSampleLayout().GetNumElements();
+
+    if (buffer.m_buffer.data() == nullptr)
+        RuntimeError("Input %ls: Buffer is not allocated.", inputNode->GetName().c_str());
+    if (type == MatrixType::DENSE)
+    {
+        if (buffer.m_buffer.size() % numRows != 0)
+            RuntimeError("Input %ls: Expected input data to be a multiple of %" PRIu64 ", but it is %" PRIu64 ".", 
+                         inputNode->GetName().c_str(), numRows, buffer.m_buffer.size());
+        if (buffer.m_buffer.size() == 0)
+            RuntimeError("Input %ls: Expected at least one element.", inputNode->GetName().c_str());
+    }
+    else if (type == MatrixType::SPARSE)
+    {
+        if (buffer.m_colIndices.data() == nullptr)
+            RuntimeError("Input %ls: Due to sparse input format, expected colIndices array, but was nullptr.", inputNode->GetName().c_str());
+        if (buffer.m_indices.data() == nullptr)
+            RuntimeError("Input %ls: Due to sparse input format, expected Indices array, but was nullptr.", inputNode->GetName().c_str());
+        if (buffer.m_colIndices.size() < 2)
+            RuntimeError("Input %ls: Expected at least one element (2 entries in colIndices array).", inputNode->GetName().c_str());
+        if (buffer.m_colIndices[0] != 0)
+            RuntimeError("Input %ls: First element of column indices must be 0", inputNode->GetName().c_str());
+        if (buffer.m_colIndices[buffer.m_colIndices.size() - 1] != buffer.m_indices.size())
+            RuntimeError("Input %ls: Last element of column indices must be equal to the size of indices (%ld), but was %d", 
+                         inputNode->GetName().c_str(), buffer.m_indices.size(), 
+                         buffer.m_colIndices[buffer.m_colIndices.size() - 1]);
+    }
+
+    size_t numCols = type == MatrixType::DENSE ? buffer.m_buffer.size() / numRows : buffer.m_colIndices.size() - 1;
+    assert(numCols >= 1);
+    return numCols;
+}
+
 template<typename ElemType>
 template<template<typename> class ValueContainer>
 void CNTKEvalExtended<ElemType>::ForwardPassT(const std::vector<ValueBuffer<ElemType, ValueContainer> >& inputs, std::vector<ValueBuffer<ElemType, ValueContainer> >& outputs, bool resetRNN)
@@ -330,35 +389,8 @@ void CNTKEvalExtended<ElemType>::ForwardPassT(const std::vector<ValueBuffer<Elem
         auto matrix = dynamic_pointer_cast<Matrix<ElemType>>(inputNode->ValuePtr());
         auto type = matrix->GetMatrixType();
         size_t numRows = inputNode->GetSampleLayout().GetNumElements();
+        size_t numCols = GetNumSamples(inputNode, buffer);
 
-        if (buffer.m_buffer.data() == nullptr)
-            RuntimeError("Input %ls: Buffer is not allocated.", m_inputNodes[i]->GetName().c_str());
-        if (type == MatrixType::DENSE)
-        {
-            if (buffer.m_buffer.size() % numRows != 0)
-                RuntimeError("Input %ls: Expected input data to be a multiple of %" PRIu64 ", but it is %" PRIu64 ".", 
-                             m_inputNodes[i]->GetName().c_str(), numRows, buffer.m_buffer.size());
-            if (buffer.m_buffer.size() == 0)
-                RuntimeError("Input %ls: Expected at least one element.", m_inputNodes[i]->GetName().c_str());
-        }
-        else if (type == MatrixType::SPARSE)
-        {
-            if (buffer.m_colIndices.data() == nullptr)
-                RuntimeError("Input %ls: Due to sparse input format, expected colIndices array, but was nullptr.", m_inputNodes[i]->GetName().c_str());
-            if (buffer.m_indices.data() == nullptr)
-                RuntimeError("Input %ls: Due to sparse input format, expected Indices array, but was nullptr.", m_inputNodes[i]->GetName().c_str());
-            if (buffer.m_colIndices.size() < 2)
-                RuntimeError("Input %ls: Expected at least one element (2 entries in colIndices array).", m_inputNodes[i]->GetName().c_str());
-            if (buffer.m_colIndices[0] != 0)
-                RuntimeError("Input %ls: First element of column indices must be 0", m_inputNodes[i]->GetName().c_str());
-            if (buffer.m_colIndices[buffer.m_colIndices.size() - 1] != buffer.m_indices.size())
-                RuntimeError("Input %ls: Last element of column indices must be equal to the size of indices (%ld), but was %d", 
-                             m_inputNodes[i]->GetName().c_str(), buffer.m_indices.size(), 
-                             buffer.m_colIndices[buffer.m_colIndices.size() - 1]);
-        }
-
-        int numCols = type == MatrixType::DENSE ? buffer.m_buffer.size() / numRows : buffer.m_colIndices.size() - 1;
-        assert(numCols >= 1);
         inputNode->GetMBLayout()->Init(1, numCols);
         
         // INT_MIN is used to specify the lower bound of look-back step of recurrent nodes
@@ -435,6 +467,242 @@ void CNTKEvalExtended<ElemType>::ForwardPass(const ValueRefs<ElemType>& inputs,
     ForwardPassT(inputs, outputs, resetRNN);
 }
 
+// ForwardPassBatched - queue a request and evaluate it together with the requests of other threads
+// There is no batching thread. The first caller that finds no batch in progress collects the next batch: it waits
+// until the batch is full or the oldest request has waited long enough, evaluates it, and wakes up its callers.
+template<typename ElemType>
+void CNTKEvalExtended<ElemType>::ForwardPassBatched(const Values<ElemType>& inputs, Values<ElemType>& outputs)
+{
+    if (!m_started)
+        RuntimeError("ForwardPassBatched() called before StartForwardEvaluation()");
+
+    BatchRequest request{ &inputs, &outputs, std::chrono::steady_clock::now(), false, nullptr };
+    std::unique_lock<std::mutex> lock(m_batchMutex);
+    m_pendingRequests.push_back(&request);
+    m_batchCondition.notify_all(); // a batch being collected may now be full
+    while (!request.m_done)
+    {
+        if (m_batchRunning)
+        {
+            m_batchCondition.wait(lock);
+            continue;
+        }
+
+        // collect the next batch
+        m_batchRunning = true;
+        auto deadline = m_pendingRequests.front()->m_arrivalTime + m_maxBatchWait;
+        while (m_pendingRequests.size() < m_maxBatchSize && m_batchCondition.wait_until(lock, deadline) == std::cv_status::no_timeout)
+            ;
+        size_t batchSize = min(m_pendingRequests.size(), m_maxBatchSize);
+        std::vector<BatchRequest*> batch(m_pendingRequests.begin(), m_pendingRequests.begin() + batchSize);
+        m_pendingRequests.erase(m_pendingRequests.begin(), m_pendingRequests.begin() + batchSize);
+
+        // evaluate it without holding the lock, so that further requests can be queued meanwhile
+        lock.unlock();
+        try
+        {
+            ForwardPassBatch(batch);
+        }
+        catch (...)
+        {
+            for (auto r : batch)
+                if (!r->m_exception)
+                    r->m_exception = std::current_exception();
+        }
+        lock.lock();
+
+        for (auto r : batch)
+            r->m_done = true;
+        m_batchRunning = false;
+        m_batchCondition.notify_all();
+    }
+    lock.unlock();
+
+    if (request.m_exception)
+        std::rethrow_exception(request.m_exception);
+}
+
+// ForwardPassBatch - evaluate a batch of requests in one forward pass
+// Each request becomes one sequence, with the request's index in the batch as its sequence id; variable-length
+// sequences are packed into the parallel sequences of the MBLayout. Requests with invalid inputs or outputs fail
+// individually, without affecting the others.
+template<typename ElemType>
+void CNTKEvalExtended<ElemType>::ForwardPassBatch(const std::vector<BatchRequest*>& batch)
+{
+    const size_t numInputs = m_inputNodes.size();
+
+    // validate the requests and determine their numbers of samples
+    std::vector<BatchRequest*> requests;
+    std::vector<std::vector<size_t>> numSamples; // [request][input]
+    for (auto request : batch)
+    {
+        try
+        {
+            const auto& inputs = *request->m_inputs;
+            if (inputs.size() != numInputs)
+                RuntimeError("Expected %d inputs, but got %d.", (int)numInputs, (int)inputs.size());
+            if (request->m_outputs->size() != m_outputNodes.size())
+                RuntimeError("Expected %d outputs, but got %d.", (int)m_outputNodes.size(), (int)request->m_outputs->size());
+
+            std::vector<size_t> requestNumSamples(numInputs);
+            for (size_t i = 0; i < numInputs; i++)
+            {
+                requestNumSamples[i] = GetNumSamples(m_inputNodes[i], inputs[i]);
+                for (size_t j = 0; j < i; j++)
+                    if (m_inputNodes[j]->GetMBLayout() == m_inputNodes[i]->GetMBLayout() && requestNumSamples[j] != requestNumSamples[i])
+                        RuntimeError("Inputs %ls and %ls have the same dynamic axis, but %d and %d samples.",
+                                     m_inputNodes[j]->GetName().c_str(), m_inputNodes[i]->GetName().c_str(), (int)requestNumSamples[j], (int)requestNumSamples[i]);
+            }
+            requests.push_back(request);
+            numSamples.push_back(requestNumSamples);
+        }
+        catch (...)
+        {
+            request->m_exception = std::current_exception();
+        }
+    }
+    if (requests.empty())
+        return;
+
+    // pack the samples of all requests into the input matrices
+    std::map<MBLayoutPtr, std::vector<std::pair<size_t, size_t>>> placements; // [MBLayout][request] -> (parallel sequence, begin time)
+    for (size_t i = 0; i < numInputs; i++)
+    {
+        auto& inputNode = m_inputNodes[i];
+        auto pMBLayout = inputNode->GetMBLayout();
+        auto& placement = placements[pMBLayout];
+        if (placement.empty()) // first input with this MBLayout
+        {
+            std::vector<MBLayout::SequenceInfo> sequences(requests.size());
+            for (size_t r = 0; r < requests.size(); r++)
+            {
+                sequences[r].seqId = r;
+                sequences[r].s = 0;
+                sequences[r].tBegin = 0;
+                sequences[r].tEnd = numSamples[r][i];
+            }
+            pMBLayout->InitAsPackedSequences(sequences, placement, std::vector<size_t>());
+        }
+
+        const size_t numParallelSequences = pMBLayout->GetNumParallelSequences();
+        const size_t numCols = numParallelSequences * pMBLayout->GetNumTimeSteps();
+        const size_t numRows = inputNode->GetSampleLayout().GetNumElements();
+        auto matrix = dynamic_pointer_cast<Matrix<ElemType>>(inputNode->ValuePtr());
+        if (matrix->GetMatrixType() == MatrixType::DENSE)
+        {
+            std::vector<ElemType> data(numRows * numCols, 0); // gaps are zero
+            for (size_t r = 0; r < requests.size(); r++)
+            {
+                const auto& buffer = (*requests[r]->m_inputs)[i].m_buffer;
+                for (size_t t = 0; t < numSamples[r][i]; t++)
+                {
+                    size_t col = (placement[r].second + t) * numParallelSequences + placement[r].first;
+                    std::copy(buffer.begin() + t * numRows, buffer.begin() + (t + 1) * numRows, data.begin() + col * numRows);
+                }
+            }
+            matrix->SetValue(numRows, numCols, matrix->GetDeviceId(), data.data(), matrixFlagNormal);
+        }
+        else
+        {
+            std::vector<std::pair<size_t, size_t>> sources(numCols, make_pair(SIZE_MAX, (size_t)0)); // [column] -> (request, sample), none for gaps
+            for (size_t r = 0; r < requests.size(); r++)
+                for (size_t t = 0; t < numSamples[r][i]; t++)
+                    sources[(placement[r].second + t) * numParallelSequences + placement[r].first] = make_pair(r, t);
+
+            std::vector<int> colIndices(1, 0), indices;
+            std::vector<ElemType> values;
+            for (const auto& source : sources)
+            {
+                if (source.first != SIZE_MAX)
+                {
+                    const auto& buffer = (*requests[source.first]->m_inputs)[i];
+                    for (int k = buffer.m_colIndices[source.second]; k < buffer.m_colIndices[source.second + 1]; k++)
+                    {
+                        indices.push_back(buffer.m_indices[k]);
+                        values.push_back(buffer.m_buffer[k]);
+                    }
+                }
+                colIndices.push_back((int)indices.size());
+            }
+            matrix->SetMatrixFromCSCFormat(colIndices.data(), indices.data(), values.data(), values.size(), numRows, numCols);
+        }
+    }
+
+    ComputationNetwork::BumpEvalTimeStamp(m_inputNodes);
+
+    // evaluate, and hand each request the columns of its own sequence
+    for (size_t o = 0; o < m_outputNodes.size(); o++)
+    {
+        auto node = m_outputNodes[o];
+        this->m_net->ForwardProp(node);
+        shared_ptr<Matrix<ElemType>> outputMatrix = dynamic_pointer_cast<Matrix<ElemType>>(node->ValuePtr());
+        const size_t numRows = outputMatrix->GetNumRows();
+        size_t numElements = outputMatrix->GetNumElements();
+        std::vector<ElemType> data(numElements);
+        ElemType* dataPtr = data.data();
+        outputMatrix->CopyToArray(dataPtr, numElements);
+
+        auto pMBLayout = node->GetMBLayout();
+        for (size_t r = 0; r < requests.size(); r++)
+        {
+            if (requests[r]->m_exception)
+                continue;
+            try
+            {
+                std::vector<size_t> cols; // columns of this request's sequence
+                if (!pMBLayout) // not minibatch data: the same for all requests
+                {
+                    for (size_t j = 0; j < outputMatrix->GetNumCols(); j++)
+                        cols.push_back(j);
+                }
+                else
+                {
+                    const auto& seq = pMBLayout->FindSequence(r);
+                    for (ptrdiff_t t = max(seq.tBegin, (ptrdiff_t)0); t < (ptrdiff_t)min(seq.tEnd, pMBLayout->GetNumTimeSteps()); t++)
+                        cols.push_back(t * pMBLayout->GetNumParallelSequences() + seq.s);
+                }
+
+                auto& vec = (*requests[r]->m_outputs)[o].m_buffer;
+                if (vec.capacity() < numRows * cols.size())
+                    RuntimeError("Not enough space in output buffer for output '%ls'.", node->GetName().c_str());
+                vec.resize(numRows * cols.size());
+                for (size_t j = 0; j < cols.size(); j++)
+                    std::copy(data.begin() + cols[j] * numRows, data.begin() + (cols[j] + 1) * numRows, vec.begin() + j * numRows);
+            }
+            catch (...)
+            {
+                requests[r]->m_exception = std::current_exception();
+            }
+        }
+    }
+}
+
+template <typename ElemType>
+IEvaluateModelExtended<ElemType>* CNTKEvalExtended<ElemType>::CreateSession()
+{
+    if (this->m_net == nullptr)
+        RuntimeError("CreateSession() called before CreateNetwork()");
+
+    auto session = new CNTKEvalExtended<ElemType>();
+    session->m_config = this->m_config;
+    session->m_maxBatchSize = m_maxBatchSize;
+    session->m_maxBatchWait = m_maxBatchWait;
+    {
+        // the session gets its own nodes, but refers to the parameter matrices of our network
+        std::lock_guard<std::mutex> lock(m_sessionMutex);
+        session->m_net = this->m_net->CloneWithSharedParameters();
+    }
+
+    if (m_started)
+    {
+        std::vector<wstring> outputNodeNames;
+        for (const auto& node : m_outputNodes)
+            outputNodeNames.push_back(node->GetName());
+        session->StartForwardEvaluation(outputNodeNames);
+    }
+    return session;
+}
+
 template <typename ElemType>
 void CNTKEvalExtended<ElemType>::Destroy()
 {
@@ -13,6 +13,11 @@
 #include <string>
 #include <map>
 #include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <exception>
 
 #include "Eval.h"
 #include "EvalReader.h"
@@ -91,7 +96,7 @@ class CNTKEvalExtended : public CNTKEvalBase<ElemType>, public IEvaluateModelExt
 {
 public:
     CNTKEvalExtended() : CNTKEvalBase<ElemType>(), 
-        m_started(false){}
+        m_started(false), m_maxBatchSize(32), m_maxBatchWait(std::chrono::milliseconds(5)), m_batchRunning(false) {}
 
     virtual VariableSchema GetOutputSchema() const override;
 
@@ -107,12 +112,13 @@ public:
 
     virtual void ForwardPass(const ValueRefs<ElemType>& inputs, ValueRefs<ElemType>& output, bool resetRNN) override;
 
+    virtual void ForwardPassBatched(const Values<ElemType>& inputs, Values<ElemType>& output) override;
+
+    virtual IEvaluateModelExtended<ElemType>* CreateSession() override;
+
     virtual void Destroy() override;
 
-    virtual void CreateNetwork(const std::string& networkDescription) override
-    {
-        CNTKEvalBase<ElemType>::CreateNetwork(networkDescription);
-    }
+    virtual void CreateNetwork(const std::string& networkDescription) override;
 
     virtual void Init(const std::string& config) override
     {
@@ -126,10 +132,32 @@ private:
     std::vector<ComputationNodeBasePtr> m_inputNodes;
     StreamMinibatchInputs m_inputMatrices;
     bool m_started;
+    std::mutex m_sessionMutex; // serializes CreateSession()
 
     template<template<typename> class ValueContainer> 
     void ForwardPassT(const std::vector < ValueBuffer<ElemType, ValueContainer> >& inputs,
                       std::vector < ValueBuffer<ElemType, ValueContainer> >& outputs, bool resetRNN);
 
+    template<template<typename> class ValueContainer>
+    static size_t GetNumSamples(const ComputationNodeBasePtr& inputNode, const ValueBuffer<ElemType, ValueContainer>& buffer);
+
+    // a request queued by ForwardPassBatched()
+    struct BatchRequest
+    {
+        const Values<ElemType>* m_inputs;
+        Values<ElemType>* m_outputs;
+        std::chrono::steady_clock::time_point m_arrivalTime;
+        bool m_done;
+        std::exception_ptr m_exception;
+    };
+    void ForwardPassBatch(const std::vector<BatchRequest*>& batch);
+
+    size_t m_maxBatchSize;
+    std::chrono::microseconds m_maxBatchWait;
+    std::mutex m_batchMutex;                       // protects the members below
+    std::condition_variable m_batchCondition;      // signals new requests and completed batches
+    std::deque<BatchRequest*> m_pendingRequests;
+    bool m_batchRunning;                           // a thread is collecting or evaluating a batch
+
 };
 } } }
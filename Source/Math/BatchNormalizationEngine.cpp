@@ -96,24 +96,77 @@ protected:
     {
         if (m_spatial && m_imageLayout == ImageLayoutKind::HWC)
             InvalidArgument("CNTK batch normalization supports only cudnn(CHW) layout.");
+        if (m_imageLayout == ImageLayoutKind::CHWc && !Base::IsChannelBlockedLayoutSupported(m_deviceId, m_inOutT, m_spatial))
+            InvalidArgument("CNTK batch normalization supports the CHWc layout only for spatial normalization of [W x H x C] images with C a multiple of %d on CPU device.",
+                            (int)ImageChannelBlockSize);
     }
 
     void ForwardCore(const Mat& in, const Mat& scale, const Mat& bias, bool inferenceOnly, double expAvgFactor, double blendFactor, Mat& runMean, Mat& runVariance,
                      Mat& out, double epsilon, Mat& savedMean, Mat& savedInvStdDev) override
     {
-        in.BatchNormalizationForward(scale, bias, inferenceOnly, expAvgFactor, blendFactor, runMean, runVariance, out, epsilon, savedMean, savedInvStdDev);
+        if (m_imageLayout == ImageLayoutKind::CHWc)
+            ForwardChannelBlocked(in, scale, bias, inferenceOnly, expAvgFactor, blendFactor, runMean, runVariance, out, epsilon, savedMean, savedInvStdDev);
+        else
+            in.BatchNormalizationForward(scale, bias, inferenceOnly, expAvgFactor, blendFactor, runMean, runVariance, out, epsilon, savedMean, savedInvStdDev);
     }
 
     void BackwardCore(const Mat& in, const Mat& srcGrad, Mat& grad, const Mat& scale, double blendFactor, const Mat& savedMean, const Mat& savedInvStdDev,
                       Mat& scaleGrad, Mat& biasGrad) override
     {
+        if (m_imageLayout == ImageLayoutKind::CHWc)
+            LogicError("CNTK batch normalization supports the CHWc layout only for inference.");
         srcGrad.BatchNormalizationBackward(in, grad, scale, blendFactor, savedMean, savedInvStdDev, scaleGrad, biasGrad);
     }
+
+    // Inference in the channel-blocked layout ImageLayoutKind::CHWc, where the channels of a block are contiguous for each pixel.
+    // Computes the same as CPUMatrix::BatchNormalizationForward(), folded into a scale and a shift per channel.
+    void ForwardChannelBlocked(const Mat& in, const Mat& scale, const Mat& bias, bool inferenceOnly, double expAvgFactor, double blendFactor, const Mat& runMean, const Mat& runVariance,
+                               Mat& out, double epsilon, Mat& savedMean, Mat& savedInvStdDev)
+    {
+        if (!inferenceOnly || expAvgFactor != 0 || blendFactor != 1)
+            RuntimeError("Batch normalization training on CPU is not yet implemented.");
+        savedMean.Resize(0, 0);
+        savedInvStdDev.Resize(0, 0);
+
+        const size_t blockSize = ImageChannelBlockSize;
+        const size_t numChannels = m_inOutT[2];
+        const size_t mapSize = m_inOutT[0] * m_inOutT[1];
+        std::vector<ElemType> channelScale(numChannels);
+        std::vector<ElemType> channelShift(numChannels);
+        for (size_t c = 0; c < numChannels; c++)
+        {
+            ElemType stdDev = sqrt(runVariance.Data()[c] + (ElemType)epsilon);
+            channelScale[c] = scale.Data()[c] / stdDev;
+            channelShift[c] = bias.Data()[c] - channelScale[c] * runMean.Data()[c];
+        }
+
+        const ElemType* pin = in.Data();
+        ElemType* pout = out.Data();
+        const size_t numBlocks = numChannels / blockSize;
+#pragma omp parallel for
+        for (long task = 0; task < (long)(in.GetNumCols() * numBlocks); task++)
+        {
+            const size_t c0 = (task % numBlocks) * blockSize;
+            const ElemType* blockIn = pin + task * mapSize * blockSize;
+            ElemType* blockOut = pout + task * mapSize * blockSize;
+            for (size_t i = 0; i < mapSize; i++)
+            {
+                for (size_t c = 0; c < blockSize; c++)
+                    blockOut[i * blockSize + c] = channelScale[c0 + c] * blockIn[i * blockSize + c] + channelShift[c0 + c];
+            }
+        }
+    }
 };
 
 template class CntkBatchNormEngine<float>;
 template class CntkBatchNormEngine<double>;
 
+template <class ElemType>
+bool BatchNormEngine<ElemType>::IsChannelBlockedLayoutSupported(DEVICEID_TYPE deviceId, const TensorShape& inOutT, bool spatial)
+{
+    return deviceId < 0 && spatial && inOutT.GetRank() == 3 && inOutT[2] % ImageChannelBlockSize == 0;
+}
+
 template <typename T> bool HasFlag(T src, T testFlag)
 {
     return ((int)src & (int)testFlag) != 0;
@@ -124,8 +177,8 @@ std::unique_ptr<BatchNormEngine<ElemType>> BatchNormEngine<ElemType>::Create(DEV
                                                                              bool spatial, ImageLayoutKind imageLayout,
                                                                              BatchNormEngineKind enabledEngines)
 {
-    // Use CNTK as default batch norm engine.
-    if (HasFlag(enabledEngines, BatchNormEngineKind::Cntk))
+    // Use CNTK as default batch norm engine. Only CNTK supports the channel-blocked layout.
+    if (HasFlag(enabledEngines, BatchNormEngineKind::Cntk) || imageLayout == ImageLayoutKind::CHWc)
     {
         if (GetMathLibTraceLevel() > 0)
             fprintf(stderr, "Using CNTK batch normalization engine.\n");
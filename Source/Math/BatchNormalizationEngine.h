@@ -44,6 +44,9 @@ public:
                                                              bool spatial, ImageLayoutKind imageLayout,
                                                              BatchNormEngineKind enabledEngines = BatchNormEngineKind::All);
 
+    // Whether Create() with ImageLayoutKind::CHWc returns an engine that supports this normalization.
+    static bool IsChannelBlockedLayoutSupported(DEVICEID_TYPE deviceId, const TensorShape& inOutT, bool spatial);
+
     DISABLE_COPY_AND_MOVE(BatchNormEngine);
 
 protected:
@@ -296,7 +296,7 @@ FORCEINLINE void BlockHandlerAVX::HandleBlock8x4(int currBlock, int startRow, in
 FORCEINLINE void BlockHandlerAVX::HandleBlock8x1(int currBlock, int startRow, int k, int n, short* newA, short* B, 
         int /*blockCnt*/, __m128i* resultStorage)
 {
-    int aOffset = RowToColOffsetRewrittenA(startRow, currBlock, 8, 4, k);
+    int aOffset = RowToColOffsetRewrittenA(startRow, currBlock, 8, 1, k);
     short* currA = &newA[aOffset];
     LOAD_8x1;
     for (int c = 0; c < n; ++c)
@@ -466,7 +466,7 @@ FORCEINLINE void BlockHandlerAVX::HandleBlock64x4(int currBlock, int startRow, i
 FORCEINLINE void BlockHandlerAVX::HandleBlock64x1(int currBlock, int startRow, int k, int n, short* newA, short* B, 
         int /*blockCnt*/, __m256i* resultStorage)
 {
-    int aOffset = RowToColOffsetRewrittenA(startRow, currBlock, 64, 4, k);
+    int aOffset = RowToColOffsetRewrittenA(startRow, currBlock, 64, 1, k);
     short* currA = &newA[aOffset];
     LOADAVX_64x1;
     //#pragma omp parallel for
@@ -501,7 +501,8 @@ FORCEINLINE void BlockHandlerAVX::HandleBlock128x4(int currBlock, int startRow,
     int aOffset = RowToColOffsetRewrittenA(startRow, currBlock, 128, 4, k);
     int aOffset2 = RowToColOffsetRewrittenA(startRow, currBlock + 1, 128, 4, k);
     short* currA = &newA[aOffset];
-    short* currA2 = &newA[aOffset2];
+    // the second block is only loaded from when there is one
+    short* currA2 = blockCnt > 1 ? &newA[aOffset2] : currA;
     LOADAVX_128x4;
     LOADAVX2_128x4;
     //#pragma omp parallel for
@@ -552,10 +553,11 @@ FORCEINLINE void BlockHandlerAVX::HandleBlock128x4(int currBlock, int startRow,
 FORCEINLINE void BlockHandlerAVX::HandleBlock128x1(int currBlock, int startRow, int k, int n, short* newA, short* B,  
         int blockCnt, __m256i* resultStorage, VectorT* /*subtractMe*/)
 {
-    int aOffset = RowToColOffsetRewrittenA(startRow, currBlock, 128, 4, k);
-    int aOffset2 = RowToColOffsetRewrittenA(startRow, currBlock + 1, 128, 4, k);
+    int aOffset = RowToColOffsetRewrittenA(startRow, currBlock, 128, 1, k);
+    int aOffset2 = RowToColOffsetRewrittenA(startRow, currBlock + 1, 128, 1, k);
     short* currA = &newA[aOffset];
-    short* currA2 = &newA[aOffset2];
+    // the second block is only loaded from when there is one
+    short* currA2 = blockCnt > 1 ? &newA[aOffset2] : currA;
     LOADAVX_128x1;
     LOADAVX2_128x1;
     //#pragma omp parallel for
@@ -578,7 +580,7 @@ FORCEINLINE void BlockHandlerAVX::HandleBlock128x1(int currBlock, int startRow,
         {
             kernelavx128x1(
                     r0b0a2, r0b0b2, r0b0c2, r0b0d2, r0b0e2, r0b0f2, r0b0g2, r0b0h2,
-                    currB2, &accum1);
+                    currB2, &accum2);
         }
 
         resultStorage[RowColToOffset(0, c, n)] = _mm256_add_epi32( resultStorage[RowColToOffset(0, c, n)], _mm256_add_epi32(accum1,  accum2));
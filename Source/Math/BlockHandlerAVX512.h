@@ -0,0 +1,163 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full licence information.
+//
+#pragma once
+#include "BlockMultiplierPlatform.h"
+#include <immintrin.h>
+#include <emmintrin.h>
+#include <smmintrin.h>
+#include <cassert>
+#include <cstdint>
+#include "BlockMultiplierMatrixUtil.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// Handles block multiplications of 16-bit (BlockHandlerAVX512) or 8-bit (BlockHandlerAVX512Int8) integer matrices
+// using AVX-512 F and BW instructions (512-bit data path). Thirty-two values at a time are loaded as int16 lanes,
+// int8 values being sign-extended (vpmovsxbw), and multiplied and pairwise added into 32-bit partial sums (vpmaddwd).
+// Blocks of 16 fill half a register, blocks of 8 use the 128-bit data path, as BlockMultiplier keeps their partial sums in __m128i.
+// Only include this from translation units compiled for AVX-512 (see CPUKernels.h).
+template <typename ScalarT>
+class BlockHandlerAVX512T
+{
+public:
+    typedef __m512i VectorT;
+    typedef ScalarT ScalarAT;
+    typedef ScalarT ScalarBT;
+    typedef int32_t ScalarCT;
+
+    FORCEINLINE static void HandleBlock8x4(int currBlock, int startRow, int k, int n, ScalarT* newA, ScalarT* B, int blockCnt, __m128i* resultStorage)
+    {
+        HandleBlocks8<4>(currBlock, startRow, k, n, newA, B, blockCnt, resultStorage);
+    }
+    FORCEINLINE static void HandleBlock16x4(int currBlock, int startRow, int k, int n, ScalarT* newA, ScalarT* B, int blockCnt, __m512i* resultStorage)
+    {
+        HandleBlocks<16, 4>(currBlock, startRow, k, n, newA, B, blockCnt, resultStorage);
+    }
+    FORCEINLINE static void HandleBlock32x4(int currBlock, int startRow, int k, int n, ScalarT* newA, ScalarT* B, int blockCnt, __m512i* resultStorage)
+    {
+        HandleBlocks<32, 4>(currBlock, startRow, k, n, newA, B, blockCnt, resultStorage);
+    }
+    FORCEINLINE static void HandleBlock64x4(int currBlock, int startRow, int k, int n, ScalarT* newA, ScalarT* B, int blockCnt, __m512i* resultStorage)
+    {
+        HandleBlocks<64, 4>(currBlock, startRow, k, n, newA, B, blockCnt, resultStorage);
+    }
+    FORCEINLINE static void HandleBlock128x4(int currBlock, int startRow, int k, int n, ScalarT* newA, ScalarT* B, int blockCnt, __m512i* resultStorage,
+                                             VectorT* /*subtractMe*/)
+    {
+        HandleBlocks<128, 4>(currBlock, startRow, k, n, newA, B, blockCnt, resultStorage);
+    }
+    FORCEINLINE static void HandleBlock8x1(int currBlock, int startRow, int k, int n, ScalarT* newA, ScalarT* B, int blockCnt, __m128i* resultStorage)
+    {
+        HandleBlocks8<1>(currBlock, startRow, k, n, newA, B, blockCnt, resultStorage);
+    }
+    FORCEINLINE static void HandleBlock16x1(int currBlock, int startRow, int k, int n, ScalarT* newA, ScalarT* B, int blockCnt, __m512i* resultStorage)
+    {
+        HandleBlocks<16, 1>(currBlock, startRow, k, n, newA, B, blockCnt, resultStorage);
+    }
+    FORCEINLINE static void HandleBlock32x1(int currBlock, int startRow, int k, int n, ScalarT* newA, ScalarT* B, int blockCnt, __m512i* resultStorage)
+    {
+        HandleBlocks<32, 1>(currBlock, startRow, k, n, newA, B, blockCnt, resultStorage);
+    }
+    FORCEINLINE static void HandleBlock64x1(int currBlock, int startRow, int k, int n, ScalarT* newA, ScalarT* B, int blockCnt, __m512i* resultStorage)
+    {
+        HandleBlocks<64, 1>(currBlock, startRow, k, n, newA, B, blockCnt, resultStorage);
+    }
+    FORCEINLINE static void HandleBlock128x1(int currBlock, int startRow, int k, int n, ScalarT* newA, ScalarT* B, int blockCnt, __m512i* resultStorage,
+                                             VectorT* /*subtractMe*/)
+    {
+        HandleBlocks<128, 1>(currBlock, startRow, k, n, newA, B, blockCnt, resultStorage);
+    }
+
+    static VectorT* PrepareExtraB(const ScalarBT* prepareMe, int k, int n)
+    {
+        prepareMe; k; n; //warning re. unreferenced params
+        return nullptr;
+    }
+    static void FreePreparedB(VectorT* freeMe) { freeMe; assert(nullptr == freeMe); }
+
+private:
+    // Same block order as the one written by BlockMultiplier::RewriteAInBlockOrder() and RewriteBInBlockOrder().
+    static int RowToColOffsetRewrittenA(int row, int kOffset, int blockSize, int rowsPerBlock, int origCols)
+    {
+        int rowIdx = row / rowsPerBlock;
+        int offsetFromBlockBeginning = row % rowsPerBlock;
+        int colIdx = kOffset * rowsPerBlock * blockSize + (offsetFromBlockBeginning * blockSize);
+        return (rowIdx * (origCols / blockSize) * rowsPerBlock * blockSize) + colIdx;
+    }
+
+    static int RowToColOffsetRewrittenB(int col, int kOffset, int blockSize, int origCols)
+    {
+        return (origCols * blockSize * kOffset) + (col * blockSize);
+    }
+
+    // 32 consecutive values as int16 lanes
+    FORCEINLINE static __m512i Load32(const int16_t* p) { return _mm512_loadu_si512(p); }
+    FORCEINLINE static __m512i Load32(const int8_t* p) { return _mm512_cvtepi8_epi16(_mm256_loadu_si256((const __m256i*)p)); }
+    // 16 consecutive values as the lower int16 lanes, the upper ones are zero
+    FORCEINLINE static __m512i Load16(const int16_t* p) { return _mm512_maskz_loadu_epi16(0xffff, p); }
+    FORCEINLINE static __m512i Load16(const int8_t* p) { return _mm512_maskz_cvtepi8_epi16(0xffff, _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)p))); }
+    // 8 consecutive values as int16 lanes of a 128-bit register
+    FORCEINLINE static __m128i Load8(const int16_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+    FORCEINLINE static __m128i Load8(const int8_t* p) { return _mm_cvtepi8_epi16(_mm_loadl_epi64((const __m128i*)p)); }
+
+    FORCEINLINE static __m512i Load(const ScalarT* p, int blockSize) { return blockSize == 16 ? Load16(p) : Load32(p); }
+
+    // Accumulates the dot products of 'rows' rows of A with all n columns of B over blocks currBlock .. currBlock + blockCnt - 1,
+    // see BlockHandlerSSEInt8::HandleBlocks().
+    template <int blockSize, int rows>
+    FORCEINLINE static void HandleBlocks(int currBlock, int startRow, int k, int n, ScalarT* newA, ScalarT* B, int blockCnt, __m512i* resultStorage)
+    {
+        const int lanes = blockSize < 32 ? 1 : blockSize / 32;
+        __m512i loadedA[rows * lanes];
+        for (int block = currBlock; block < currBlock + blockCnt; ++block)
+        {
+            const ScalarT* currA = &newA[RowToColOffsetRewrittenA(startRow, block, blockSize, rows, k)];
+            for (int r = 0; r < rows; ++r)
+                for (int l = 0; l < lanes; ++l)
+                    loadedA[r * lanes + l] = Load(currA + r * blockSize + 32 * l, blockSize);
+
+            for (int c = 0; c < n; ++c)
+            {
+                const ScalarT* currB = &B[RowToColOffsetRewrittenB(c, block, blockSize, n)];
+                __m512i accum[rows];
+                for (int r = 0; r < rows; ++r)
+                    accum[r] = _mm512_setzero_si512();
+                for (int l = 0; l < lanes; ++l)
+                {
+                    __m512i loadedB = Load(currB + 32 * l, blockSize);
+                    for (int r = 0; r < rows; ++r)
+                        accum[r] = _mm512_add_epi32(accum[r], _mm512_madd_epi16(loadedA[r * lanes + l], loadedB));
+                }
+                for (int r = 0; r < rows; ++r)
+                    resultStorage[RowColToOffset(r, c, n)] = _mm512_add_epi32(resultStorage[RowColToOffset(r, c, n)], accum[r]);
+            }
+        }
+    }
+
+    // blocks of 8 on the 128-bit data path
+    template <int rows>
+    FORCEINLINE static void HandleBlocks8(int currBlock, int startRow, int k, int n, ScalarT* newA, ScalarT* B, int blockCnt, __m128i* resultStorage)
+    {
+        for (int block = currBlock; block < currBlock + blockCnt; ++block)
+        {
+            __m128i loadedA[rows];
+            const ScalarT* currA = &newA[RowToColOffsetRewrittenA(startRow, block, 8, rows, k)];
+            for (int r = 0; r < rows; ++r)
+                loadedA[r] = Load8(currA + 8 * r);
+
+            for (int c = 0; c < n; ++c)
+            {
+                __m128i loadedB = Load8(&B[RowToColOffsetRewrittenB(c, block, 8, n)]);
+                for (int r = 0; r < rows; ++r)
+                    resultStorage[RowColToOffset(r, c, n)] = _mm_add_epi32(resultStorage[RowColToOffset(r, c, n)], _mm_madd_epi16(loadedA[r], loadedB));
+            }
+        }
+    }
+};
+
+typedef BlockHandlerAVX512T<int16_t> BlockHandlerAVX512;
+typedef BlockHandlerAVX512T<int8_t> BlockHandlerAVX512Int8;
+
+}}}
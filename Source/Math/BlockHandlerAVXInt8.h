@@ -0,0 +1,152 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full licence information.
+//
+#pragma once
+#include "BlockMultiplierPlatform.h"
+#include <immintrin.h>
+#include <emmintrin.h>
+#include <smmintrin.h>
+#include <cassert>
+#include <cstdint>
+#include "BlockMultiplierMatrixUtil.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// Handles block multiplications of 8-bit integer matrices using AVX2 instructions (256-bit data path).
+// Same scheme as BlockHandlerSSEInt8 with twice the width: sixteen int8 values at a time are sign-extended
+// to 16 bits (vpmovsxbw) and multiplied and pairwise added into 32-bit partial sums (vpmaddwd).
+// Blocks of 8 use the 128-bit data path, as BlockMultiplier keeps their partial sums in __m128i.
+// Only include this from translation units compiled for AVX2 (see CPUKernels.h).
+class BlockHandlerAVXInt8
+{
+public:
+    typedef __m256i VectorT;
+    typedef int8_t ScalarAT;
+    typedef int8_t ScalarBT;
+    typedef int32_t ScalarCT;
+
+    FORCEINLINE static void HandleBlock8x4(int currBlock, int startRow, int k, int n, int8_t* newA, int8_t* B, int blockCnt, __m128i* resultStorage)
+    {
+        HandleBlocks8<4>(currBlock, startRow, k, n, newA, B, blockCnt, resultStorage);
+    }
+    FORCEINLINE static void HandleBlock16x4(int currBlock, int startRow, int k, int n, int8_t* newA, int8_t* B, int blockCnt, __m256i* resultStorage)
+    {
+        HandleBlocks<16, 4>(currBlock, startRow, k, n, newA, B, blockCnt, resultStorage);
+    }
+    FORCEINLINE static void HandleBlock32x4(int currBlock, int startRow, int k, int n, int8_t* newA, int8_t* B, int blockCnt, __m256i* resultStorage)
+    {
+        HandleBlocks<32, 4>(currBlock, startRow, k, n, newA, B, blockCnt, resultStorage);
+    }
+    FORCEINLINE static void HandleBlock64x4(int currBlock, int startRow, int k, int n, int8_t* newA, int8_t* B, int blockCnt, __m256i* resultStorage)
+    {
+        HandleBlocks<64, 4>(currBlock, startRow, k, n, newA, B, blockCnt, resultStorage);
+    }
+    FORCEINLINE static void HandleBlock128x4(int currBlock, int startRow, int k, int n, int8_t* newA, int8_t* B, int blockCnt, __m256i* resultStorage,
+                                             VectorT* /*subtractMe*/)
+    {
+        HandleBlocks<128, 4>(currBlock, startRow, k, n, newA, B, blockCnt, resultStorage);
+    }
+    FORCEINLINE static void HandleBlock8x1(int currBlock, int startRow, int k, int n, int8_t* newA, int8_t* B, int blockCnt, __m128i* resultStorage)
+    {
+        HandleBlocks8<1>(currBlock, startRow, k, n, newA, B, blockCnt, resultStorage);
+    }
+    FORCEINLINE static void HandleBlock16x1(int currBlock, int startRow, int k, int n, int8_t* newA, int8_t* B, int blockCnt, __m256i* resultStorage)
+    {
+        HandleBlocks<16, 1>(currBlock, startRow, k, n, newA, B, blockCnt, resultStorage);
+    }
+    FORCEINLINE static void HandleBlock32x1(int currBlock, int startRow, int k, int n, int8_t* newA, int8_t* B, int blockCnt, __m256i* resultStorage)
+    {
+        HandleBlocks<32, 1>(currBlock, startRow, k, n, newA, B, blockCnt, resultStorage);
+    }
+    FORCEINLINE static void HandleBlock64x1(int currBlock, int startRow, int k, int n, int8_t* newA, int8_t* B, int blockCnt, __m256i* resultStorage)
+    {
+        HandleBlocks<64, 1>(currBlock, startRow, k, n, newA, B, blockCnt, resultStorage);
+    }
+    FORCEINLINE static void HandleBlock128x1(int currBlock, int startRow, int k, int n, int8_t* newA, int8_t* B, int blockCnt, __m256i* resultStorage,
+                                             VectorT* /*subtractMe*/)
+    {
+        HandleBlocks<128, 1>(currBlock, startRow, k, n, newA, B, blockCnt, resultStorage);
+    }
+
+    static VectorT* PrepareExtraB(const ScalarBT* prepareMe, int k, int n)
+    {
+        prepareMe; k; n; //warning re. unreferenced params
+        return nullptr;
+    }
+    static void FreePreparedB(VectorT* freeMe) { freeMe; assert(nullptr == freeMe); }
+
+private:
+    // Same block order as the one written by BlockMultiplier::RewriteAInBlockOrder() and RewriteBInBlockOrder().
+    static int RowToColOffsetRewrittenA(int row, int kOffset, int blockSize, int rowsPerBlock, int origCols)
+    {
+        int rowIdx = row / rowsPerBlock;
+        int offsetFromBlockBeginning = row % rowsPerBlock;
+        int colIdx = kOffset * rowsPerBlock * blockSize + (offsetFromBlockBeginning * blockSize);
+        return (rowIdx * (origCols / blockSize) * rowsPerBlock * blockSize) + colIdx;
+    }
+
+    static int RowToColOffsetRewrittenB(int col, int kOffset, int blockSize, int origCols)
+    {
+        return (origCols * blockSize * kOffset) + (col * blockSize);
+    }
+
+    // Sign-extends sixteen consecutive int8 values into sixteen int16 lanes.
+    FORCEINLINE static __m256i LoadWidened(const int8_t* p)
+    {
+        return _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)p));
+    }
+
+    // Accumulates the dot products of 'rows' rows of A with all n columns of B over blocks currBlock .. currBlock + blockCnt - 1,
+    // see BlockHandlerSSEInt8::HandleBlocks().
+    template <int blockSize, int rows>
+    FORCEINLINE static void HandleBlocks(int currBlock, int startRow, int k, int n, int8_t* newA, int8_t* B, int blockCnt, __m256i* resultStorage)
+    {
+        const int lanes = blockSize / 16;
+        __m256i widenedA[rows * lanes];
+        for (int block = currBlock; block < currBlock + blockCnt; ++block)
+        {
+            const int8_t* currA = &newA[RowToColOffsetRewrittenA(startRow, block, blockSize, rows, k)];
+            for (int i = 0; i < rows * lanes; ++i)
+                widenedA[i] = LoadWidened(currA + 16 * i);
+
+            for (int c = 0; c < n; ++c)
+            {
+                const int8_t* currB = &B[RowToColOffsetRewrittenB(c, block, blockSize, n)];
+                __m256i accum[rows];
+                for (int r = 0; r < rows; ++r)
+                    accum[r] = _mm256_setzero_si256();
+                for (int l = 0; l < lanes; ++l)
+                {
+                    __m256i widenedB = LoadWidened(currB + 16 * l);
+                    for (int r = 0; r < rows; ++r)
+                        accum[r] = _mm256_add_epi32(accum[r], _mm256_madd_epi16(widenedA[r * lanes + l], widenedB));
+                }
+                for (int r = 0; r < rows; ++r)
+                    resultStorage[RowColToOffset(r, c, n)] = _mm256_add_epi32(resultStorage[RowColToOffset(r, c, n)], accum[r]);
+            }
+        }
+    }
+
+    // blocks of 8 on the 128-bit data path
+    template <int rows>
+    FORCEINLINE static void HandleBlocks8(int currBlock, int startRow, int k, int n, int8_t* newA, int8_t* B, int blockCnt, __m128i* resultStorage)
+    {
+        for (int block = currBlock; block < currBlock + blockCnt; ++block)
+        {
+            __m128i widenedA[rows];
+            const int8_t* currA = &newA[RowToColOffsetRewrittenA(startRow, block, 8, rows, k)];
+            for (int r = 0; r < rows; ++r)
+                widenedA[r] = _mm_cvtepi8_epi16(_mm_loadl_epi64((const __m128i*)(currA + 8 * r)));
+
+            for (int c = 0; c < n; ++c)
+            {
+                __m128i widenedB = _mm_cvtepi8_epi16(_mm_loadl_epi64((const __m128i*)&B[RowToColOffsetRewrittenB(c, block, 8, n)]));
+                for (int r = 0; r < rows; ++r)
+                    resultStorage[RowColToOffset(r, c, n)] = _mm_add_epi32(resultStorage[RowColToOffset(r, c, n)], _mm_madd_epi16(widenedA[r], widenedB));
+            }
+        }
+    }
+};
+
+}}}
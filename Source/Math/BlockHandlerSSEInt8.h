@@ -0,0 +1,131 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full licence information.
+//
+#pragma once
+#include "BlockMultiplierPlatform.h"
+#include <emmintrin.h>
+#include <smmintrin.h>
+#include <cassert>
+#include <cstdint>
+#include "BlockMultiplierMatrixUtil.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// Handles block multiplications of 8-bit integer matrices using SSE4.1 instructions (128-bit data path).
+// Plugs into BlockMultiplier like BlockHandlerSSE, but A and B hold int8 values: eight of them are sign-extended
+// to 16 bits at a time (pmovsxbw) and multiplied and pairwise added into 32-bit partial sums (pmaddwd).
+// Each product of two int8 values is at most 2^14, so the 32-bit partial sums are exact for k below 2^17.
+// The blocks of A are widened once and then reused for all columns of B.
+class BlockHandlerSSEInt8
+{
+public:
+    typedef __m128i VectorT;
+    typedef int8_t ScalarAT;
+    typedef int8_t ScalarBT;
+    typedef int32_t ScalarCT;
+
+    FORCEINLINE static void HandleBlock8x4(int currBlock, int startRow, int k, int n, int8_t* newA, int8_t* B, int blockCnt, __m128i* resultStorage)
+    {
+        HandleBlocks<8, 4>(currBlock, startRow, k, n, newA, B, blockCnt, resultStorage);
+    }
+    FORCEINLINE static void HandleBlock16x4(int currBlock, int startRow, int k, int n, int8_t* newA, int8_t* B, int blockCnt, __m128i* resultStorage)
+    {
+        HandleBlocks<16, 4>(currBlock, startRow, k, n, newA, B, blockCnt, resultStorage);
+    }
+    FORCEINLINE static void HandleBlock32x4(int currBlock, int startRow, int k, int n, int8_t* newA, int8_t* B, int blockCnt, __m128i* resultStorage)
+    {
+        HandleBlocks<32, 4>(currBlock, startRow, k, n, newA, B, blockCnt, resultStorage);
+    }
+    FORCEINLINE static void HandleBlock64x4(int currBlock, int startRow, int k, int n, int8_t* newA, int8_t* B, int blockCnt, __m128i* resultStorage)
+    {
+        HandleBlocks<64, 4>(currBlock, startRow, k, n, newA, B, blockCnt, resultStorage);
+    }
+    FORCEINLINE static void HandleBlock128x4(int currBlock, int startRow, int k, int n, int8_t* newA, int8_t* B, int blockCnt, __m128i* resultStorage,
+                                             VectorT* /*subtractMe*/)
+    {
+        HandleBlocks<128, 4>(currBlock, startRow, k, n, newA, B, blockCnt, resultStorage);
+    }
+    FORCEINLINE static void HandleBlock8x1(int currBlock, int startRow, int k, int n, int8_t* newA, int8_t* B, int blockCnt, __m128i* resultStorage)
+    {
+        HandleBlocks<8, 1>(currBlock, startRow, k, n, newA, B, blockCnt, resultStorage);
+    }
+    FORCEINLINE static void HandleBlock16x1(int currBlock, int startRow, int k, int n, int8_t* newA, int8_t* B, int blockCnt, __m128i* resultStorage)
+    {
+        HandleBlocks<16, 1>(currBlock, startRow, k, n, newA, B, blockCnt, resultStorage);
+    }
+    FORCEINLINE static void HandleBlock32x1(int currBlock, int startRow, int k, int n, int8_t* newA, int8_t* B, int blockCnt, __m128i* resultStorage)
+    {
+        HandleBlocks<32, 1>(currBlock, startRow, k, n, newA, B, blockCnt, resultStorage);
+    }
+    FORCEINLINE static void HandleBlock64x1(int currBlock, int startRow, int k, int n, int8_t* newA, int8_t* B, int blockCnt, __m128i* resultStorage)
+    {
+        HandleBlocks<64, 1>(currBlock, startRow, k, n, newA, B, blockCnt, resultStorage);
+    }
+    FORCEINLINE static void HandleBlock128x1(int currBlock, int startRow, int k, int n, int8_t* newA, int8_t* B, int blockCnt, __m128i* resultStorage,
+                                             VectorT* /*subtractMe*/)
+    {
+        HandleBlocks<128, 1>(currBlock, startRow, k, n, newA, B, blockCnt, resultStorage);
+    }
+
+    static VectorT* PrepareExtraB(const ScalarBT* prepareMe, int k, int n)
+    {
+        prepareMe; k; n; //warning re. unreferenced params
+        return nullptr;
+    }
+    static void FreePreparedB(VectorT* freeMe) { freeMe; assert(nullptr == freeMe); }
+
+private:
+    // Same block order as the one written by BlockMultiplier::RewriteAInBlockOrder() and RewriteBInBlockOrder().
+    static int RowToColOffsetRewrittenA(int row, int kOffset, int blockSize, int rowsPerBlock, int origCols)
+    {
+        int rowIdx = row / rowsPerBlock;
+        int offsetFromBlockBeginning = row % rowsPerBlock;
+        int colIdx = kOffset * rowsPerBlock * blockSize + (offsetFromBlockBeginning * blockSize);
+        return (rowIdx * (origCols / blockSize) * rowsPerBlock * blockSize) + colIdx;
+    }
+
+    static int RowToColOffsetRewrittenB(int col, int kOffset, int blockSize, int origCols)
+    {
+        return (origCols * blockSize * kOffset) + (col * blockSize);
+    }
+
+    // Sign-extends eight consecutive int8 values into eight int16 lanes.
+    FORCEINLINE static __m128i LoadWidened(const int8_t* p)
+    {
+        return _mm_cvtepi8_epi16(_mm_loadl_epi64((const __m128i*)p));
+    }
+
+    // Accumulates the dot products of 'rows' rows of A with all n columns of B over blocks currBlock .. currBlock + blockCnt - 1.
+    // resultStorage[RowColToOffset(r, c, n)] holds four partial sums of row startRow + r and column c.
+    template <int blockSize, int rows>
+    FORCEINLINE static void HandleBlocks(int currBlock, int startRow, int k, int n, int8_t* newA, int8_t* B, int blockCnt, __m128i* resultStorage)
+    {
+        const int lanes = blockSize / 8;
+        __m128i widenedA[rows * lanes];
+        for (int block = currBlock; block < currBlock + blockCnt; ++block)
+        {
+            const int8_t* currA = &newA[RowToColOffsetRewrittenA(startRow, block, blockSize, rows, k)];
+            for (int i = 0; i < rows * lanes; ++i)
+                widenedA[i] = LoadWidened(currA + 8 * i);
+
+            for (int c = 0; c < n; ++c)
+            {
+                const int8_t* currB = &B[RowToColOffsetRewrittenB(c, block, blockSize, n)];
+                __m128i accum[rows];
+                for (int r = 0; r < rows; ++r)
+                    accum[r] = _mm_setzero_si128();
+                for (int l = 0; l < lanes; ++l)
+                {
+                    __m128i widenedB = LoadWidened(currB + 8 * l);
+                    for (int r = 0; r < rows; ++r)
+                        accum[r] = _mm_add_epi32(accum[r], _mm_madd_epi16(widenedA[r * lanes + l], widenedB));
+                }
+                for (int r = 0; r < rows; ++r)
+                    resultStorage[RowColToOffset(r, c, n)] = _mm_add_epi32(resultStorage[RowColToOffset(r, c, n)], accum[r]);
+            }
+        }
+    }
+};
+
+}}}
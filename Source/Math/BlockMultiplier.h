@@ -20,8 +20,13 @@
 #include <vector>
 #include "BlockMultiplierMatrixUtil.h"
 #include "BlockHandlerSSE.h"
+#include "BlockHandlerSSEInt8.h"
 #ifdef SUPPORT_AVX2
 #include "BlockHandlerAVX.h"
+#include "BlockHandlerAVXInt8.h"
+#endif
+#ifdef SUPPORT_AVX512
+#include "BlockHandlerAVX512.h"
 #endif
 //#define STDTHREAD
 #define OPENMPTHREAD
@@ -73,9 +78,11 @@ template<typename BlockHandlerT>struct HandlerArgs
 // multiplication. Blocks of A and B (the LHS and RHS of the multiplication)
 // are then handed off to a class implementing the BlockHandlerT interface.
 // Implementations are provided for multiplying 16-bit integer matrices using
-// the SSE and AVX2 instruction sets. To compile for AVX2, you need to add the /arch:AVX2
-// flag to the compiler. Note that the AVX2 code only runs on Haswell or better processors,
-// will throw illegal instruction on other machines.
+// the SSE, AVX2 and AVX-512 instruction sets, and 8-bit integer matrices (BlockHandlerSSEInt8,
+// BlockHandlerAVXInt8, BlockHandlerAVX512Int8). The AVX2 and AVX-512 handlers are only available
+// with SUPPORT_AVX2 and SUPPORT_AVX512, in translation units compiled for these instruction sets;
+// they throw illegal instruction on older processors. Use IBlockGemm from CPUKernels.h to pick
+// the handlers for the processor at runtime.
 // To use the code, first call PrepareB, which rewrites B in block order and returns
 // a pointer to the rewritten block (don't forget to call FreePreparedB on it when you're done
 // multiplying by that matrix). Then you can call MultiplyMatrices().
@@ -182,7 +189,7 @@ template<typename BlockHandlerT> class BlockMultiplier
         static void BlockHandler128x4Thread(HandlerArgs<BlockHandlerT> ha)
         {
             // Accumulate full row results locally b/f writing to C
-            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * ha.rowsPerBlock * ha.n, 16);
+            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * ha.rowsPerBlock * ha.n, sizeof(VectorT));
             memset(resultStorage, 0, sizeof(VectorT) * ha.rowsPerBlock * ha.n);
             const int blocksAtOnce = 2;
 
@@ -221,7 +228,7 @@ template<typename BlockHandlerT> class BlockMultiplier
 
         static void BlockHandler64x4Thread(HandlerArgs<BlockHandlerT> ha)
         {
-            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * 4 * ha.n, 16);
+            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * 4 * ha.n, sizeof(VectorT));
             memset(resultStorage, 0, sizeof(VectorT) * 4 * ha.n);
             int32_t* transC = ha.transC;
 
@@ -254,7 +261,7 @@ template<typename BlockHandlerT> class BlockMultiplier
 
         static void BlockHandler32x4Thread(HandlerArgs<BlockHandlerT> ha)
         {
-            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * 4 * ha.n, 16);
+            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * 4 * ha.n, sizeof(VectorT));
             memset(resultStorage, 0, sizeof(VectorT) * 4 * ha.n);
             int32_t* transC = ha.transC;
 
@@ -287,7 +294,7 @@ template<typename BlockHandlerT> class BlockMultiplier
 
         static void BlockHandler16x4Thread(HandlerArgs<BlockHandlerT> ha)
         {
-            VectorT* resultStorage = (VectorT*) ALIGNED_ALLOC(sizeof(VectorT) * 4 * ha.n, 16);
+            VectorT* resultStorage = (VectorT*) ALIGNED_ALLOC(sizeof(VectorT) * 4 * ha.n, sizeof(VectorT));
             memset(resultStorage, 0, sizeof(VectorT) * 4 * ha.n);
             int32_t* transC = ha.transC;
             for (int currBlock = 0; currBlock < ha.blocks; ++currBlock)
@@ -355,7 +362,7 @@ template<typename BlockHandlerT> class BlockMultiplier
 
         static void BlockHandler128x1Thread(HandlerArgs<BlockHandlerT> ha)
         {
-            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * ha.rowsPerBlock * ha.n, 64);
+            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * ha.rowsPerBlock * ha.n, sizeof(VectorT));
             memset(resultStorage, 0, sizeof(VectorT) * ha.rowsPerBlock * ha.n);
             const int blocksAtOnce = 2;
             int32_t* transC = ha.transC;
@@ -379,7 +386,7 @@ template<typename BlockHandlerT> class BlockMultiplier
 
         static void BlockHandler64x1Thread(HandlerArgs<BlockHandlerT> ha)
         {
-            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * ha.rowsPerBlock * ha.n, 16);
+            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * ha.rowsPerBlock * ha.n, sizeof(VectorT));
             memset(resultStorage, 0, sizeof(VectorT) * ha.rowsPerBlock * ha.n);
             int32_t* transC = ha.transC;
 
@@ -403,7 +410,7 @@ template<typename BlockHandlerT> class BlockMultiplier
 
         static void BlockHandler32x1Thread(HandlerArgs<BlockHandlerT> ha)
         {
-            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * ha.rowsPerBlock * ha.n, 16);
+            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * ha.rowsPerBlock * ha.n, sizeof(VectorT));
             memset(resultStorage, 0, sizeof(VectorT) * ha.rowsPerBlock * ha.n);
             int32_t* transC = ha.transC;
 
@@ -427,7 +434,7 @@ template<typename BlockHandlerT> class BlockMultiplier
 
         static void BlockHandler16x1Thread(HandlerArgs<BlockHandlerT> ha)
         {
-            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * ha.rowsPerBlock * ha.n, 16);
+            VectorT* resultStorage = (VectorT*)ALIGNED_ALLOC(sizeof(VectorT) * ha.rowsPerBlock * ha.n, sizeof(VectorT));
             memset(resultStorage, 0, sizeof(VectorT) * ha.rowsPerBlock  * ha.n);
             int32_t* transC = ha.transC;
 
@@ -545,10 +552,20 @@ template<typename BlockHandlerT> class BlockMultiplier
         }
 #endif
 
+#ifdef SUPPORT_AVX512
+        //Same as above, for AVX-512 registers
+        FORCEINLINE static int32_t my_hadd(__m512i hAddMe)
+        {
+            __m128i low = my_adds_epi32(_mm512_extracti32x4_epi32(hAddMe, 0), _mm512_extracti32x4_epi32(hAddMe, 1));
+            __m128i high = my_adds_epi32(_mm512_extracti32x4_epi32(hAddMe, 2), _mm512_extracti32x4_epi32(hAddMe, 3));
+            return my_hadd(my_adds_epi32(low, high));
+        }
+#endif
+
 
         int m_numThreads;
 
-        BlockMultiplier(int numThreads = 1) 
+        BlockMultiplier(int numThreads = 1) : m_pBlockHandlerBInfo(nullptr)
         {
             SetNumThreads(numThreads);
         }
@@ -560,7 +577,9 @@ template<typename BlockHandlerT> class BlockMultiplier
             m_pPool.reset(new StdThreadPool<HandlerArgs<BlockHandlerT>>(threads));
 #else
 #ifdef OPENMPTHREAD
-            m_oldNumThreads = omp_get_num_threads();
+            // omp_get_num_threads() is always 1 outside of a parallel region, so remember
+            // the setting that applies to the next parallel region instead.
+            m_oldNumThreads = omp_get_max_threads();
             omp_set_num_threads(threads);
 #endif
 #endif
@@ -939,12 +958,14 @@ template<typename BlockHandlerT> void BlockMultiplier<BlockHandlerT>::MultiplyMa
 #endif
                     for (int startRow = 0; startRow < m; startRow += 4)
                     {
-                        ha.startRow = startRow;
+                        // Each iteration needs its own copy, 'ha' is shared between the threads.
+                        HandlerArgs<BlockHandlerT> haRow = ha;
+                        haRow.startRow = startRow;
 #ifdef STDTHREAD
-                        m_pPool->QueueAndWake(ha, currBlockInfo.fourFn);
+                        m_pPool->QueueAndWake(haRow, currBlockInfo.fourFn);
 #else
 #ifdef OPENMPTHREAD
-                        currBlockInfo.fourFn(ha);
+                        currBlockInfo.fourFn(haRow);
 #endif
 #endif
                     }
@@ -961,12 +982,13 @@ template<typename BlockHandlerT> void BlockMultiplier<BlockHandlerT>::MultiplyMa
 #endif
                     for (int startRow = 0; startRow < m; ++startRow)
                     {
-                        ha.startRow = startRow;
+                        HandlerArgs<BlockHandlerT> haRow = ha;
+                        haRow.startRow = startRow;
 #ifdef STDTHREAD
-                        m_pPool->QueueAndWake(ha, currBlockInfo.oneFn);
+                        m_pPool->QueueAndWake(haRow, currBlockInfo.oneFn);
 #else
 #ifdef OPENMPTHREAD
-                        currBlockInfo.oneFn(ha);
+                        currBlockInfo.oneFn(haRow);
 #endif
 #endif
                     }
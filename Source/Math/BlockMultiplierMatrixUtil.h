@@ -14,6 +14,9 @@
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
+    // The helpers that run during multiplications are static: they are compiled into translation units for
+    // different instruction sets (see CPUKernels.h), and the linker must not pick a copy that uses a newer one.
+
     template<typename ScalarT> void DumpMatrix(ScalarT* pDumpMe, int rows, int cols, std::ostream* pStream, int rowMax = std::numeric_limits<int>::max(),
                                                int colMax = std::numeric_limits<int>::max())
     {
@@ -28,7 +31,7 @@ namespace Microsoft { namespace MSR { namespace CNTK {
     }
 
     // Turn a row+col into an absolute offset
-    FORCEINLINE int RowColToOffset(int idxRow, int idxCol, int numCols)
+    static FORCEINLINE int RowColToOffset(int idxRow, int idxCol, int numCols)
     {
         return idxRow * numCols + idxCol;
     }
@@ -64,7 +67,7 @@ namespace Microsoft { namespace MSR { namespace CNTK {
     };
 
 
-    template<class ScalarT> void Transpose(ScalarT* transposeMe, ScalarT* transposed, int origRows, int origCols)
+    template<class ScalarT> static void Transpose(ScalarT* transposeMe, ScalarT* transposed, int origRows, int origCols)
     {
 #pragma omp parallel for
         for (int r = 0; r < origRows; ++r)
@@ -78,7 +81,7 @@ namespace Microsoft { namespace MSR { namespace CNTK {
         }
     }
 
-    template<typename ScalarT> ScalarT* CreateAlignedMatrix(int m, int n, ScalarT initVal, int alignment = 64)
+    template<typename ScalarT> static ScalarT* CreateAlignedMatrix(int m, int n, ScalarT initVal, int alignment = 64)
     {
         ScalarT* ret = (ScalarT*)ALIGNED_ALLOC(sizeof(ScalarT) * (m * n), alignment);
 
@@ -98,7 +101,7 @@ namespace Microsoft { namespace MSR { namespace CNTK {
         return ret;
     }
 
-    template<typename ScalarT> void FreeAlignedMatrix(ScalarT* destroyMe)
+    template<typename ScalarT> static void FreeAlignedMatrix(ScalarT* destroyMe)
     {
         ALIGNED_FREE(destroyMe);
     }
@@ -0,0 +1,123 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// CPUKernels.cpp -- detection of the instruction set of the processor and selection of the CPU kernels compiled for it
+//
+
+#include "stdafx.h"
+#include "Basics.h"
+#include "CPUKernels.h"
+#include <atomic>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+static void CpuId(unsigned int leaf, unsigned int subleaf, unsigned int regs[4])
+{
+#ifdef _MSC_VER
+    __cpuidex((int*)regs, (int)leaf, (int)subleaf);
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// XCR0, the register state the operating system saves on context switches
+static unsigned long long GetEnabledRegisterState()
+{
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    unsigned int eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+
+static CPUInstructionSet DetectCPUInstructionSet()
+{
+    unsigned int regs[4]; // eax, ebx, ecx, edx
+    CpuId(0, 0, regs);
+    const unsigned int maxLeaf = regs[0];
+    CpuId(1, 0, regs);
+    const bool hasOSXSave = (regs[2] & (1u << 27)) != 0;
+    const bool hasAVX = (regs[2] & (1u << 28)) != 0;
+    if (maxLeaf < 7 || !hasOSXSave || !hasAVX)
+        return CPUInstructionSet::SSE41;
+
+    // The instructions are only usable if the operating system saves the wider registers.
+    const unsigned long long xcr0 = GetEnabledRegisterState();
+    const bool hasYmmState = (xcr0 & 0x06) == 0x06;    // XMM and YMM
+    const bool hasZmmState = (xcr0 & 0xe6) == 0xe6;    // XMM, YMM, opmask and both halves of ZMM
+    CpuId(7, 0, regs);
+    const bool hasAVX2 = (regs[1] & (1u << 5)) != 0;
+    const bool hasAVX512 = (regs[1] & (1u << 16)) != 0 && (regs[1] & (1u << 30)) != 0; // F and BW
+
+    if (hasAVX512 && hasAVX2 && hasZmmState)
+        return CPUInstructionSet::AVX512;
+    if (hasAVX2 && hasYmmState)
+        return CPUInstructionSet::AVX2;
+    return CPUInstructionSet::SSE41;
+}
+
+CPUInstructionSet GetSupportedCPUInstructionSet()
+{
+    static const CPUInstructionSet supported = DetectCPUInstructionSet();
+    return supported;
+}
+
+static std::atomic<int>& SelectedCPUInstructionSet()
+{
+    static std::atomic<int> selected((int)GetSupportedCPUInstructionSet());
+    return selected;
+}
+
+CPUInstructionSet GetCPUInstructionSet()
+{
+    return (CPUInstructionSet)SelectedCPUInstructionSet().load();
+}
+
+CPUInstructionSet SetCPUInstructionSet(CPUInstructionSet instructionSet)
+{
+    auto selected = std::min(instructionSet, GetSupportedCPUInstructionSet());
+    SelectedCPUInstructionSet() = (int)selected;
+    return selected;
+}
+
+const char* CPUInstructionSetName(CPUInstructionSet instructionSet)
+{
+    switch (instructionSet)
+    {
+    case CPUInstructionSet::SSE41:  return "sse4.1";
+    case CPUInstructionSet::AVX2:   return "avx2";
+    case CPUInstructionSet::AVX512: return "avx512";
+    default: LogicError("CPUInstructionSetName: Unknown instruction set %d.", (int)instructionSet);
+    }
+}
+
+CPUInstructionSet CPUInstructionSetFromName(const std::wstring& name)
+{
+    for (auto instructionSet : { CPUInstructionSet::SSE41, CPUInstructionSet::AVX2, CPUInstructionSet::AVX512 })
+    {
+        std::string candidate = CPUInstructionSetName(instructionSet);
+        if (EqualCI(name, std::wstring(candidate.begin(), candidate.end())))
+            return instructionSet;
+    }
+    InvalidArgument("'%ls' is not a CPU instruction set, use sse4.1, avx2 or avx512.", name.c_str());
+}
+
+const CPUKernels& GetCPUKernels()
+{
+    switch (GetCPUInstructionSet())
+    {
+    case CPUInstructionSet::AVX512: return GetCPUKernelsAVX512();
+    case CPUInstructionSet::AVX2:   return GetCPUKernelsAVX2();
+    default:                        return GetCPUKernelsSSE();
+    }
+}
+
+}}}
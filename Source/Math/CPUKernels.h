@@ -0,0 +1,94 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include "CommonMatrix.h" // for ElementWiseOperator and MATH_API
+#include <cstdint>
+#include <string>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// -----------------------------------------------------------------------
+// Runtime selection of CPU kernels by instruction set.
+//
+// The kernels below are compiled once per instruction set, each in its own translation unit with the
+// matching compiler flags (CPUKernelsSSE.cpp, CPUKernelsAVX2.cpp, CPUKernelsAVX512.cpp). The instruction
+// set is determined once with CPUID, so a single binary runs on processors that only have SSE4.1 and
+// uses AVX2 or AVX-512 where the processor and the operating system support them.
+// -----------------------------------------------------------------------
+
+enum class CPUInstructionSet
+{
+    SSE41  = 0, // the baseline every build requires
+    AVX2   = 1,
+    AVX512 = 2  // AVX-512 F and BW
+};
+
+// The most capable instruction set supported by this processor and enabled by the operating system.
+MATH_API CPUInstructionSet GetSupportedCPUInstructionSet();
+
+// The instruction set the kernels are selected for: the supported one, unless lowered by SetCPUInstructionSet().
+MATH_API CPUInstructionSet GetCPUInstructionSet();
+
+// Restricts the kernels to 'instructionSet' (e.g. to compare results across instruction sets).
+// Requests beyond the supported instruction set are lowered to it. Returns the instruction set now in use.
+MATH_API CPUInstructionSet SetCPUInstructionSet(CPUInstructionSet instructionSet);
+
+MATH_API const char* CPUInstructionSetName(CPUInstructionSet instructionSet);
+// Accepts the names returned by CPUInstructionSetName(), case-insensitive.
+MATH_API CPUInstructionSet CPUInstructionSetFromName(const std::wstring& name);
+
+// BlockMultiplier behind a virtual interface, so that handlers compiled for different instruction sets can be chosen at runtime.
+// Matrices are row-major as in BlockMultiplier. Not thread-safe.
+template <typename ScalarT>
+class IBlockGemm
+{
+public:
+    virtual ~IBlockGemm() {}
+
+    // Rewrites the [k x n] matrix B in block order. The result is released with FreePreparedB().
+    virtual ScalarT* PrepareB(ScalarT* oldB, int k, int n) = 0;
+    virtual void FreePreparedB(ScalarT* preparedB) = 0;
+
+    // C [m x n] += A [m x k] * B, where B was returned by PrepareB(). C must start at zero.
+    virtual void MultiplyMatrices(ScalarT* A, int m, int k, ScalarT* B, int n, int32_t* C) = 0;
+};
+
+// Element-wise TensorOp loops over contiguous memory without reduction, c[i] = beta * c[i] + alpha * op(a[i] [, b[i]]).
+// Return false for operations they do not implement.
+template <class ElemType>
+struct CPUElementwiseKernels
+{
+    bool (*UnaryOp)(ElementWiseOperator op, ElemType beta, const ElemType* a, ElemType alpha, ElemType* c, size_t n);
+    bool (*BinaryOp)(ElementWiseOperator op, ElemType beta, const ElemType* a, const ElemType* b, ElemType alpha, ElemType* c, size_t n);
+};
+
+struct CPUKernels
+{
+    CPUInstructionSet instructionSet;
+    IBlockGemm<int16_t>* (*CreateInt16BlockGemm)(int numThreads);
+    IBlockGemm<int8_t>* (*CreateInt8BlockGemm)(int numThreads);
+    CPUElementwiseKernels<float> floatKernels;
+    CPUElementwiseKernels<double> doubleKernels;
+
+    template <class ElemType>
+    const CPUElementwiseKernels<ElemType>& Elementwise() const;
+};
+
+template <>
+inline const CPUElementwiseKernels<float>& CPUKernels::Elementwise<float>() const { return floatKernels; }
+template <>
+inline const CPUElementwiseKernels<double>& CPUKernels::Elementwise<double>() const { return doubleKernels; }
+
+// The kernels for GetCPUInstructionSet().
+const CPUKernels& GetCPUKernels();
+
+// defined in the translation unit of the respective instruction set
+const CPUKernels& GetCPUKernelsSSE();
+const CPUKernels& GetCPUKernelsAVX2();
+const CPUKernels& GetCPUKernelsAVX512();
+
+}}}
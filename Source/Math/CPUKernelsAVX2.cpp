@@ -0,0 +1,20 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// CPUKernelsAVX2.cpp -- the CPU kernels for AVX2, compiled with -mavx2 or /arch:AVX2, see CPUKernels.h
+//
+
+#include "stdafx.h"
+#define SUPPORT_AVX2
+#include "CPUKernelsImpl.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+const CPUKernels& GetCPUKernelsAVX2()
+{
+    static const CPUKernels kernels = MakeCPUKernels<BlockHandlerAVX, BlockHandlerAVXInt8>(CPUInstructionSet::AVX2);
+    return kernels;
+}
+
+}}}
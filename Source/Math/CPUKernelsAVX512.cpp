@@ -0,0 +1,31 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// CPUKernelsAVX512.cpp -- the CPU kernels for AVX-512 F and BW, compiled with -mavx512f -mavx512bw, see CPUKernels.h
+//
+
+#include "stdafx.h"
+#if defined(_MSC_VER) && _MSC_VER < 1910 // AVX-512 intrinsics require Visual Studio 2017
+#include "CPUKernels.h"
+#else
+#define SUPPORT_AVX512
+#include "CPUKernelsImpl.h"
+#endif
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+#if defined(_MSC_VER) && _MSC_VER < 1910
+const CPUKernels& GetCPUKernelsAVX512()
+{
+    return GetCPUKernelsAVX2();
+}
+#else
+const CPUKernels& GetCPUKernelsAVX512()
+{
+    static const CPUKernels kernels = MakeCPUKernels<BlockHandlerAVX512, BlockHandlerAVX512Int8>(CPUInstructionSet::AVX512);
+    return kernels;
+}
+#endif
+
+}}}
@@ -0,0 +1,133 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// CPUKernelsImpl.h -- the kernels declared in CPUKernels.h, included by the translation unit of each instruction set,
+// which defines SUPPORT_AVX2 or SUPPORT_AVX512 as applicable and is compiled with the matching compiler flags.
+// Everything here either has internal linkage or depends on the block handler, so that the linker cannot
+// substitute code compiled for a newer instruction set into the translation unit of an older one.
+//
+
+#pragma once
+
+#include "CPUKernels.h"
+#include "BlockMultiplier.h"
+#include "TensorOps.h"
+#include <omp.h>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// IBlockGemm on top of BlockMultiplier<BlockHandlerT>
+template <class BlockHandlerT>
+class BlockMultiplierGemm : public IBlockGemm<typename BlockHandlerT::ScalarAT>
+{
+    typedef typename BlockHandlerT::ScalarAT ScalarT;
+
+public:
+    BlockMultiplierGemm(int numThreads)
+        : m_multiplier(numThreads)
+    {
+    }
+
+    static IBlockGemm<ScalarT>* Create(int numThreads)
+    {
+        return new BlockMultiplierGemm<BlockHandlerT>(numThreads);
+    }
+
+    ScalarT* PrepareB(ScalarT* oldB, int k, int n) override
+    {
+        return m_multiplier.PrepareB(oldB, k, n);
+    }
+
+    void FreePreparedB(ScalarT* preparedB) override
+    {
+        BlockMultiplier<BlockHandlerT>::FreeMatrix(preparedB);
+    }
+
+    void MultiplyMatrices(ScalarT* A, int m, int k, ScalarT* B, int n, int32_t* C) override
+    {
+        m_multiplier.MultiplyMatrices(A, m, k, B, n, C);
+    }
+
+private:
+    BlockMultiplier<BlockHandlerT> m_multiplier;
+};
+
+// same threshold as for TensorOp in CPUMatrix.cpp
+static const size_t c_minParallelElementwiseWork = 16384;
+
+// c[i] = beta * c[i] + alpha * opfn(i), in the order of evaluation of TensorOp in CPUMatrix.cpp, so that the
+// results are the same. beta and alpha are special-cased to allow the compiler to short-circuit them.
+template <class ElemType, typename OPFN>
+static inline void ElementwiseLoop(ElemType beta, ElemType alpha, ElemType* c, size_t n, const OPFN& opfn)
+{
+    const long size = (long)n;
+    if (beta != 0)
+    {
+#pragma omp parallel for if (n >= c_minParallelElementwiseWork)
+        for (long i = 0; i < size; i++)
+            c[i] = opfn(i) * alpha + beta * c[i];
+    }
+    else if (alpha != 1)
+    {
+#pragma omp parallel for if (n >= c_minParallelElementwiseWork)
+        for (long i = 0; i < size; i++)
+            c[i] = opfn(i) * alpha;
+    }
+    else
+    {
+#pragma omp parallel for if (n >= c_minParallelElementwiseWork)
+        for (long i = 0; i < size; i++)
+            c[i] = opfn(i);
+    }
+}
+
+template <class ElemType>
+static bool ElementwiseUnaryOp(ElementWiseOperator op, ElemType beta, const ElemType* a, ElemType alpha, ElemType* c, size_t n)
+{
+#define CaseElementwiseUnaryOp(oper)                                                         \
+    case ElementWiseOperator::op##oper:                                                      \
+        ElementwiseLoop(beta, alpha, c, n, [a](long i) { return Op##oper(a[i]); });          \
+        return true
+
+    switch (op)
+    {
+        ForAllUnaryOps(CaseElementwiseUnaryOp);
+    default:
+        return false;
+    }
+#undef CaseElementwiseUnaryOp
+}
+
+template <class ElemType>
+static bool ElementwiseBinaryOp(ElementWiseOperator op, ElemType beta, const ElemType* a, const ElemType* b, ElemType alpha, ElemType* c, size_t n)
+{
+#define CaseElementwiseBinaryOp(oper)                                                        \
+    case ElementWiseOperator::op##oper:                                                      \
+        ElementwiseLoop(beta, alpha, c, n, [a, b](long i) { return Op##oper(a[i], b[i]); }); \
+        return true
+
+    switch (op)
+    {
+        ForAllBinaryOps(CaseElementwiseBinaryOp);
+    default:
+        return false;
+    }
+#undef CaseElementwiseBinaryOp
+}
+
+template <class Int16BlockHandlerT, class Int8BlockHandlerT>
+static CPUKernels MakeCPUKernels(CPUInstructionSet instructionSet)
+{
+    CPUKernels kernels;
+    kernels.instructionSet = instructionSet;
+    kernels.CreateInt16BlockGemm = &BlockMultiplierGemm<Int16BlockHandlerT>::Create;
+    kernels.CreateInt8BlockGemm = &BlockMultiplierGemm<Int8BlockHandlerT>::Create;
+    kernels.floatKernels.UnaryOp = &ElementwiseUnaryOp<float>;
+    kernels.floatKernels.BinaryOp = &ElementwiseBinaryOp<float>;
+    kernels.doubleKernels.UnaryOp = &ElementwiseUnaryOp<double>;
+    kernels.doubleKernels.BinaryOp = &ElementwiseBinaryOp<double>;
+    return kernels;
+}
+
+}}}
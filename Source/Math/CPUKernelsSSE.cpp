@@ -0,0 +1,19 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// CPUKernelsSSE.cpp -- the CPU kernels for the SSE4.1 baseline, see CPUKernels.h
+//
+
+#include "stdafx.h"
+#include "CPUKernelsImpl.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+const CPUKernels& GetCPUKernelsSSE()
+{
+    static const CPUKernels kernels = MakeCPUKernels<BlockHandlerSSE, BlockHandlerSSEInt8>(CPUInstructionSet::SSE41);
+    return kernels;
+}
+
+}}}
@@ -11,6 +11,7 @@
 
 #include "CPUMatrix.h"
 #include "TensorOps.h"
+#include "CPUKernels.h"
 #include <assert.h>
 #include <stdexcept>
 #include <omp.h>
@@ -1440,10 +1441,14 @@ size_t CPUMatrix<ElemType>::CopyToArray(ElemType*& arrayCopyTo, size_t& currentA
 }
 
 template <typename ElemType>
-void CPUMatrix<ElemType>::CopySection(size_t /*numRows*/, size_t /*numCols*/, ElemType* /*dst*/, size_t /*colStride*/) const
+void CPUMatrix<ElemType>::CopySection(size_t numRows, size_t numCols, ElemType* dst, size_t colStride) const
 {
-    // REVIEW alexeyk: currently not used by CPU, but implement when possible.
-    RuntimeError("Not implemented.");
+    // same as GPUMatrix: the top left numRows x numCols of the matrix, column j at dst + j * colStride
+    if (numRows > GetNumRows() || numCols > GetNumCols())
+        InvalidArgument("CopySection: The section exceeds the matrix.");
+
+    for (size_t j = 0; j < numCols; j++)
+        memcpy(dst + j * colStride, Data() + LocateColumn(j), numRows * sizeof(ElemType));
 }
 
 template <class ElemType>
@@ -6087,6 +6092,10 @@ void CPUMatrix<ElemType>::SetCompatibleMode()
 // function to compute the value for a given output location (perform reduction if needed)
 // -----------------------------------------------------------------------
 
+// Below this number of elementary operations a tensor op (or a loop of it) runs on the calling thread only,
+// as the overhead of entering an OpenMP parallel region exceeds the gain.
+static const size_t c_minParallelTensorOpWork = 16384;
+
 // perform loop over reduction index m
 // This function is declared inside a wrapper struct to allow partial specialization (m = -1).
 template <class ElemType, typename OPFN, typename ReductionOp, size_t N, int m>
@@ -6095,13 +6104,24 @@ struct TensorOpReduction
     // reduction case (non-reduction case is specialized)
     static inline ElemType Loop(array<ElemType*, N> pointers, const OPFN& opfn, const ReductionOp& reductionOp,
                                 const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, N>& reducingStrides)
+    {
+        // Actually it would be nicer to return double but we keep ElementType so that test don't return different numbers than previous implementation.
+        return static_cast<ElemType>(Range(pointers, 0, reducingOpDims[(size_t) m], opfn, reductionOp, reducingOpDims, reducingStrides));
+    }
+
+    // reduction over the index range [begin, end) of dimension m
+    static inline double Range(array<ElemType*, N> pointers, size_t begin, size_t end, const OPFN& opfn, const ReductionOp& reductionOp,
+                               const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, N>& reducingStrides)
     {
         array<ptrdiff_t, N - 1> strides;   // N-1 because last one is the result pointer, which is unused in reduction
         for (size_t i = 0; i < N - 1; i++) // N = a small constant, this will be unrolled
+        {
             strides[i] = reducingStrides[i][(size_t) m];
+            pointers[i] += (ptrdiff_t) begin * strides[i];
+        }
 
         double aggregate = TensorOpReduction<ElemType, OPFN, ReductionOp, N, m - 1>::Loop(pointers, opfn, reductionOp, reducingOpDims, reducingStrides);
-        for (size_t dim = reducingOpDims[(size_t)m] - 1; dim-- > 0;)
+        for (size_t dim = end - begin - 1; dim-- > 0;)
         {
             // advance the pointers
             for (size_t i = 0; i < N - 1; i++)
@@ -6110,8 +6130,71 @@ struct TensorOpReduction
             // need to descend into one loop deeper
             aggregate = reductionOp(aggregate, TensorOpReduction<ElemType, OPFN, ReductionOp, N, m - 1>::Loop(pointers, opfn, reductionOp, reducingOpDims, reducingStrides));
         }
-        // Actually it would be nicer to return double but we keep ElementType so that test don't return different numbers than previous implementation.
-        return static_cast<double>(aggregate);
+        return aggregate;
+    }
+};
+
+// perform loop over the innermost reduction index
+// This is the specialized version for m = 0. Long reductions are accumulated into four independent aggregates,
+// which breaks the dependency of each step on the previous one so that the steps can be pipelined.
+// All reduction ops are associative, so only the rounding may differ from a strictly sequential loop.
+template <class ElemType, typename OPFN, typename ReductionOp, size_t N>
+struct TensorOpReduction<ElemType, OPFN, ReductionOp, N, 0>
+{
+    static inline ElemType Loop(array<ElemType*, N> pointers, const OPFN& opfn, const ReductionOp& reductionOp,
+                                const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, N>& reducingStrides)
+    {
+        return static_cast<ElemType>(Range(pointers, 0, reducingOpDims[0], opfn, reductionOp, reducingOpDims, reducingStrides));
+    }
+
+    static inline double Range(array<ElemType*, N> pointers, size_t begin, size_t end, const OPFN& opfn, const ReductionOp& reductionOp,
+                               const SmallVector<size_t>&, const array<SmallVector<ptrdiff_t>, N>& reducingStrides)
+    {
+        array<ptrdiff_t, N - 1> strides;
+        for (size_t i = 0; i < N - 1; i++)
+        {
+            strides[i] = reducingStrides[i][0];
+            pointers[i] += (ptrdiff_t) begin * strides[i];
+        }
+
+        size_t count = end - begin;
+        size_t j = 0;
+        double aggregate;
+        if (count >= 8)
+        {
+            double aggregates[4];
+            for (; j < 4; j++)
+            {
+                aggregates[j] = opfn(pointers);
+                for (size_t i = 0; i < N - 1; i++)
+                    pointers[i] += strides[i];
+            }
+            for (; j + 4 <= count; j += 4)
+            {
+                for (size_t a = 0; a < 4; a++) // this will be unrolled
+                {
+                    aggregates[a] = reductionOp(aggregates[a], opfn(pointers));
+                    for (size_t i = 0; i < N - 1; i++)
+                        pointers[i] += strides[i];
+                }
+            }
+            aggregate = reductionOp(reductionOp(aggregates[0], aggregates[1]), reductionOp(aggregates[2], aggregates[3]));
+        }
+        else
+        {
+            aggregate = opfn(pointers);
+            for (size_t i = 0; i < N - 1; i++)
+                pointers[i] += strides[i];
+            j = 1;
+        }
+
+        for (; j < count; j++)
+        {
+            aggregate = reductionOp(aggregate, opfn(pointers));
+            for (size_t i = 0; i < N - 1; i++)
+                pointers[i] += strides[i];
+        }
+        return aggregate;
     }
 };
 
@@ -6127,6 +6210,44 @@ struct TensorOpReduction<ElemType, OPFN, ReductionOp, N, -1>
     }
 };
 
+// Reduction for a single output element. If the reduction is large and no parallel region is active yet
+// (i.e. there are too few output elements to parallelize over), the outermost reduction dimension is split
+// into chunks that are reduced concurrently; the partial results are then combined pairwise in a fixed order.
+template <class ElemType, typename OPFN, typename ReductionOp, size_t N, int m>
+static inline ElemType TensorOpSplitReduction(const array<ElemType*, N>& pointers, const OPFN& opfn, const ReductionOp& reductionOp,
+                                              const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, N>& reducingStrides,
+                                              std::true_type /*has reduction*/)
+{
+    size_t work = 1;
+    for (size_t i = 0; i < reducingOpDims.size(); i++)
+        work *= reducingOpDims[i];
+    const size_t dim = reducingOpDims[(size_t) m];
+    if (work < 2 * c_minParallelTensorOpWork || dim < 2 || omp_in_parallel())
+        return TensorOpReduction<ElemType, OPFN, ReductionOp, N, m>::Loop(pointers, opfn, reductionOp, reducingOpDims, reducingStrides);
+
+    const int numChunks = (int) min(min((size_t) omp_get_max_threads(), dim), work / c_minParallelTensorOpWork);
+    if (numChunks < 2)
+        return TensorOpReduction<ElemType, OPFN, ReductionOp, N, m>::Loop(pointers, opfn, reductionOp, reducingOpDims, reducingStrides);
+
+    vector<double> partials(numChunks);
+#pragma omp parallel for
+    for (int c = 0; c < numChunks; c++)
+        partials[c] = TensorOpReduction<ElemType, OPFN, ReductionOp, N, m>::Range(pointers, dim * c / numChunks, dim * (c + 1) / numChunks, opfn, reductionOp, reducingOpDims, reducingStrides);
+
+    for (int step = 1; step < numChunks; step *= 2)
+        for (int c = 0; c + step < numChunks; c += 2 * step)
+            partials[c] = reductionOp(partials[c], partials[c + step]);
+    return static_cast<ElemType>(partials[0]);
+}
+
+template <class ElemType, typename OPFN, typename ReductionOp, size_t N, int m>
+static inline ElemType TensorOpSplitReduction(const array<ElemType*, N>& pointers, const OPFN& opfn, const ReductionOp& reductionOp,
+                                              const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, N>& reducingStrides,
+                                              std::false_type /*has reduction*/)
+{
+    return TensorOpReduction<ElemType, OPFN, ReductionOp, N, m>::Loop(pointers, opfn, reductionOp, reducingOpDims, reducingStrides);
+}
+
 // -----------------------------------------------------------------------
 // perform loop over regular index k for N-nary operations (N counting the output)
 // -----------------------------------------------------------------------
@@ -6169,20 +6290,19 @@ struct TensorOpIteration<ElemType, OPFN, ReductionOp, 3, true /*vectorizable*/,
         size_t K = regularOpDims[0];
         // special-case beta and alpha to allow the compiler to short-circuit it
         if (beta != 0)
-#pragma omp parallel for
+#pragma omp parallel for if (K >= c_minParallelTensorOpWork)
             for (int k = 0; k < (int) K; k++)
                 TensorOpIteration<ElemType, OPFN, ReductionOp, 3, true /*vectorizable*/, -1 /*no reduction*/, -1 /*scalar*/>::Loop(beta, array<ElemType*, 3>{pa + k, pb + k, pc + k}, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
         else if (alpha != 1)
-#pragma omp parallel for
+#pragma omp parallel for if (K >= c_minParallelTensorOpWork)
             for (int k = 0; k < (int) K; k++)
                 TensorOpIteration<ElemType, OPFN, ReductionOp, 3, true /*vectorizable*/, -1 /*no reduction*/, -1 /*scalar*/>::Loop(0, array<ElemType*, 3>{pa + k, pb + k, pc + k}, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
         else
-#pragma omp parallel for
+#pragma omp parallel for if (K >= c_minParallelTensorOpWork)
             for (int k = 0; k < (int) K; k++)
                 TensorOpIteration<ElemType, OPFN, ReductionOp, 3, true /*vectorizable*/, -1 /*no reduction*/, -1 /*scalar*/>::Loop(0, array<ElemType*, 3>{pa + k, pb + k, pc + k}, 1, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
         // TODO: According to Amit, the VS compiler is not able to vectorize into lambdas. Solution: change the lambda to take an N, or to implement the loop inside (with 1 element by default).
         // TODO: The signedness of k (required for omp) causes an extra sign-extend.
-        // TODO: OMP adds LOTS of overhead. Do we need a guard, a min size when to use it?
     }
 };
 // and unary
@@ -6198,15 +6318,15 @@ struct TensorOpIteration<ElemType, OPFN, ReductionOp, 2, true /*vectorizable*/,
         size_t K = regularOpDims[0];
         // special-case beta and alpha to allow the compiler to short-circuit it
         if (beta != 0)
-#pragma omp parallel for
+#pragma omp parallel for if (K >= c_minParallelTensorOpWork)
             for (int k = 0; k < (int) K; k++)
                 TensorOpIteration<ElemType, OPFN, ReductionOp, 2, true /*vectorizable*/, -1 /*no reduction*/, -1 /*scalar*/>::Loop(beta, array<ElemType*, 2>{pa + k, pb + k}, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
         else if (alpha != 1)
-#pragma omp parallel for
+#pragma omp parallel for if (K >= c_minParallelTensorOpWork)
             for (int k = 0; k < (int) K; k++)
                 TensorOpIteration<ElemType, OPFN, ReductionOp, 2, true /*vectorizable*/, -1 /*no reduction*/, -1 /*scalar*/>::Loop(0, array<ElemType*, 2>{pa + k, pb + k}, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
         else
-#pragma omp parallel for
+#pragma omp parallel for if (K >= c_minParallelTensorOpWork)
             for (int k = 0; k < (int) K; k++)
                 TensorOpIteration<ElemType, OPFN, ReductionOp, 2, true /*vectorizable*/, -1 /*no reduction*/, -1 /*scalar*/>::Loop(0, array<ElemType*, 2>{pa + k, pb + k}, 1, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
     }
@@ -6220,7 +6340,7 @@ struct TensorOpIteration<ElemType, OPFN, ReductionOp, N, vectorizable, m, -1>
                             const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, N>& reducingStrides)
     {
         // we are at element level for the result: perform the op (there may still be reduction)
-        ElemType val = TensorOpReduction<ElemType, OPFN, ReductionOp, N, m>::Loop(pointers, opfn, reductionOp, reducingOpDims, reducingStrides);
+        ElemType val = TensorOpSplitReduction<ElemType, OPFN, ReductionOp, N, m>(pointers, opfn, reductionOp, reducingOpDims, reducingStrides, std::integral_constant<bool, (m >= 0)>());
         // scale
         val *= alpha;
         // combine with previous value in target matrix, then write it out
@@ -6237,6 +6357,39 @@ struct TensorOpIteration<ElemType, OPFN, ReductionOp, N, vectorizable, m, -1>
 // map runtime parameters N to template parameters
 // -----------------------------------------------------------------------
 
+// true, if a reduction is large enough to compute its output elements in parallel, with enough
+// output elements along the outermost regular dimension k to keep all threads busy
+static bool ShouldParallelizeTensorOpOuterLoop(int k, const SmallVector<size_t>& regularOpDims, const SmallVector<size_t>& reducingOpDims)
+{
+    if (k < 0 || regularOpDims[(size_t) k] < (size_t) omp_get_max_threads() || omp_in_parallel())
+        return false;
+
+    size_t work = 1;
+    for (size_t i = 0; i < regularOpDims.size(); i++)
+        work *= regularOpDims[i];
+    for (size_t i = 0; i < reducingOpDims.size(); i++)
+        work *= reducingOpDims[i];
+    return work >= c_minParallelTensorOpWork;
+}
+
+// perform the loop over the outermost regular index k with reduction index m in parallel,
+// each thread computing complete output elements, so the result is identical to the serial loop
+template <class ElemType, typename OPFN, typename ReductionOp, size_t N, int m, int k>
+static void TensorOpParallelOuterLoop(ElemType beta, const array<ElemType*, N>& pointers, ElemType alpha, const OPFN& opfn, const ReductionOp& reductionOp,
+                                      const SmallVector<size_t>& regularOpDims, const array<SmallVector<ptrdiff_t>, N>& regularStrides,
+                                      const SmallVector<size_t>& reducingOpDims, const array<SmallVector<ptrdiff_t>, N>& reducingStrides)
+{
+    const int K = (int) regularOpDims[(size_t) k];
+#pragma omp parallel for
+    for (int dim = 0; dim < K; dim++)
+    {
+        array<ElemType*, N> outerPointers = pointers;
+        for (size_t i = 0; i < N; i++)
+            outerPointers[i] += dim * regularStrides[i][(size_t) k];
+        TensorOpIteration<ElemType, OPFN, ReductionOp, N, false /*vectorizable*/, m, (k > 0 ? k - 1 : -1)>::Loop(beta, outerPointers, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
+    }
+}
+
 // tensor operation with k+1 dimensions (-1 means scalar)
 template <class ElemType, typename OPFN, typename ReductionOp, size_t N, int k>
 static void TensorOpWithRegularLoop(ElemType beta, const array<ElemType*, N>& pointers, ElemType alpha, const OPFN& opfn, ReductionOp reductionOp,
@@ -6247,8 +6400,12 @@ static void TensorOpWithRegularLoop(ElemType beta, const array<ElemType*, N>& po
     switch (dims)
     {
     case 2:
+        if (ShouldParallelizeTensorOpOuterLoop(k, regularOpDims, reducingOpDims))
+            return TensorOpParallelOuterLoop<ElemType, OPFN, ReductionOp, N, 1, k>(beta, pointers, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
         return TensorOpIteration<ElemType, OPFN, ReductionOp, N, false /*vectorizable*/, 1, k>::Loop(beta, pointers, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
     case 1:
+        if (ShouldParallelizeTensorOpOuterLoop(k, regularOpDims, reducingOpDims))
+            return TensorOpParallelOuterLoop<ElemType, OPFN, ReductionOp, N, 0, k>(beta, pointers, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
         return TensorOpIteration<ElemType, OPFN, ReductionOp, N, false /*vectorizable*/, 0, k>::Loop(beta, pointers, alpha, opfn, reductionOp, regularOpDims, regularStrides, reducingOpDims, reducingStrides);
     case 0:
     {
@@ -6354,6 +6511,11 @@ void CPUMatrix<ElemType>::TensorOp(ElemType beta, const CPUMatrix<ElemType>& a,
                               },                                                       \
                               reductionOp, offsets, regularOpDims, regularStrides, reducingOpDims, reducingStrides)
 
+    // contiguous without reduction: use the loops compiled for the instruction set of this processor
+    if (reducingOpDims.size() == 0 && regularOpDims.size() == 1 && regularStrides[0][0] == 1 && regularStrides[1][0] == 1 &&
+        GetCPUKernels().Elementwise<ElemType>().UnaryOp(op, beta, a.Data() + offsets[0], alpha, Data() + offsets[1], regularOpDims[0]))
+        return;
+
     array<ElemType*, 2> pointers = {a.Data(), Data()};
     switch (op)
     {
@@ -6382,6 +6544,10 @@ void CPUMatrix<ElemType>::TensorOp(ElemType beta, const CPUMatrix<ElemType>& a,
                               },                                                       \
                               reductionOp, offsets, regularOpDims, regularStrides, reducingOpDims, reducingStrides)
 
+    if (reducingOpDims.size() == 0 && regularOpDims.size() == 1 && regularStrides[0][0] == 1 && regularStrides[1][0] == 1 && regularStrides[2][0] == 1 &&
+        GetCPUKernels().Elementwise<ElemType>().BinaryOp(op, beta, a.Data() + offsets[0], b.Data() + offsets[1], alpha, Data() + offsets[2], regularOpDims[0]))
+        return;
+
     array<ElemType*, 3> pointers = {a.Data(), b.Data(), Data()};
     switch (op)
     {
@@ -0,0 +1,225 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#include "CPURNN.h"
+#include <math.h>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+enum class CPURNNCellKind
+{
+    LSTM,
+    GRU,
+    ReLU,
+    Tanh
+};
+
+static CPURNNCellKind GetCellKind(const RnnAttributes& rnnAttributes)
+{
+    if      (rnnAttributes.m_recurrentOp == wstring(L"lstm"))    return CPURNNCellKind::LSTM;
+    else if (rnnAttributes.m_recurrentOp == wstring(L"gru"))     return CPURNNCellKind::GRU;
+    else if (rnnAttributes.m_recurrentOp == wstring(L"rnnReLU")) return CPURNNCellKind::ReLU;
+    else if (rnnAttributes.m_recurrentOp == wstring(L"rnnTanh")) return CPURNNCellKind::Tanh;
+    else InvalidArgument("Unknown cell type '%ls'. Supported values are 'lstm', 'gru', 'rnnReLU', 'rnnTanh'.", rnnAttributes.m_recurrentOp.c_str());
+}
+
+static size_t GetNumGates(CPURNNCellKind kind)
+{
+    return kind == CPURNNCellKind::LSTM ? 4 : kind == CPURNNCellKind::GRU ? 3 : 1;
+}
+
+template <class ElemType>
+static inline ElemType Sigmoid(ElemType x)
+{
+    return 1 / (1 + exp(-x));
+}
+
+// Computes the new state of one sequence from the input projection z = W x (without bias) and the recurrent
+// projection u = R h (nullptr if there is no previous state, i.e. h = 0 and c = 0).
+template <class ElemType>
+static void ComputeCell(CPURNNCellKind kind, size_t hidden, const ElemType* z, const ElemType* u, const ElemType* bW, const ElemType* bR,
+                        const ElemType* cPrev, const ElemType* hPrev, ElemType* h, ElemType* c)
+{
+    switch (kind)
+    {
+    case CPURNNCellKind::LSTM:
+        for (size_t k = 0; k < hidden; k++)
+        {
+            ElemType a[4];
+            for (size_t g = 0; g < 4; g++)
+            {
+                size_t i = g * hidden + k;
+                a[g] = z[i] + bW[i] + bR[i] + (u ? u[i] : 0);
+            }
+            ElemType ct = Sigmoid(a[0]) * tanh(a[2]) + (cPrev ? Sigmoid(a[1]) * cPrev[k] : 0);
+            c[k] = ct;
+            h[k] = Sigmoid(a[3]) * tanh(ct);
+        }
+        break;
+    case CPURNNCellKind::GRU:
+        for (size_t k = 0; k < hidden; k++)
+        {
+            size_t ir = k, iu = hidden + k, ic = 2 * hidden + k;
+            ElemType r  = Sigmoid(z[ir] + bW[ir] + bR[ir] + (u ? u[ir] : 0));
+            ElemType ut = Sigmoid(z[iu] + bW[iu] + bR[iu] + (u ? u[iu] : 0));
+            ElemType ct = tanh(z[ic] + bW[ic] + r * (bR[ic] + (u ? u[ic] : 0)));
+            h[k] = (1 - ut) * ct + (hPrev ? ut * hPrev[k] : 0);
+        }
+        break;
+    case CPURNNCellKind::ReLU:
+        for (size_t k = 0; k < hidden; k++)
+        {
+            ElemType a = z[k] + bW[k] + bR[k] + (u ? u[k] : 0);
+            h[k] = a > 0 ? a : 0;
+        }
+        break;
+    case CPURNNCellKind::Tanh:
+        for (size_t k = 0; k < hidden; k++)
+            h[k] = tanh(z[k] + bW[k] + bR[k] + (u ? u[k] : 0));
+        break;
+    }
+}
+
+template <class ElemType>
+/*static*/ void CPURNN<ElemType>::Forward(const Matrix<ElemType>& weightsW, const Matrix<ElemType>& inputX, Matrix<ElemType>& outputY,
+                                          size_t xDim, size_t yDim, const vector<size_t>& numSequencesForFrame,
+                                          const RnnAttributes& rnnAttributes, Matrix<ElemType>& workspace)
+{
+    const CPURNNCellKind kind = GetCellKind(rnnAttributes);
+    const size_t numGates = GetNumGates(kind);
+    const size_t hidden = rnnAttributes.m_hiddenSize;
+    const size_t numLayers = rnnAttributes.m_numLayers;
+    const size_t numDirections = rnnAttributes.m_bidirectional ? 2 : 1;
+    const size_t gateDim = numGates * hidden;
+
+    if (yDim != numDirections * hidden)
+        InvalidArgument("CPURNN: Output dimension %d does not match the hidden size %d for %d direction(s).", (int)yDim, (int)hidden, (int)numDirections);
+
+    // frame offsets in the packed data
+    const size_t numFrames = numSequencesForFrame.size();
+    vector<size_t> frameOffsets(numFrames + 1, 0);
+    for (size_t t = 0; t < numFrames; t++)
+    {
+        if (t > 0 && numSequencesForFrame[t] > numSequencesForFrame[t - 1])
+            LogicError("CPURNN: The sequences must be packed by decreasing length.");
+        frameOffsets[t + 1] = frameOffsets[t] + numSequencesForFrame[t];
+    }
+    const size_t numCols = frameOffsets[numFrames];
+    const size_t maxSequences = numFrames > 0 ? numSequencesForFrame[0] : 0;
+
+    if (inputX.GetNumElements() != xDim * numCols)
+        InvalidArgument("CPURNN: Input has %d elements, expected %d x %d.", (int)inputX.GetNumElements(), (int)xDim, (int)numCols);
+    if (outputY.GetNumElements() != yDim * numCols)
+        outputY.Resize(yDim, numCols);
+    if (numCols == 0)
+        return;
+
+    // offsets of the parameters of each layer and direction
+    const size_t numPseudoLayers = numLayers * numDirections;
+    vector<size_t> weightOffsets(numPseudoLayers), biasOffsets(numPseudoLayers);
+    size_t numParameters = 0;
+    for (size_t l = 0; l < numLayers; l++)
+    {
+        size_t inputDim = l == 0 ? xDim : yDim;
+        for (size_t d = 0; d < numDirections; d++)
+        {
+            weightOffsets[l * numDirections + d] = numParameters;
+            numParameters += gateDim * (inputDim + hidden);
+        }
+    }
+    for (size_t i = 0; i < numPseudoLayers; i++)
+    {
+        biasOffsets[i] = numParameters;
+        numParameters += 2 * gateDim;
+    }
+    if (weightsW.GetNumElements() != numParameters)
+        InvalidArgument("CPURNN: Parameter matrix has %d elements, expected %d.", (int)weightsW.GetNumElements(), (int)numParameters);
+
+    // carve the scratch buffers out of the workspace
+    size_t sizeZ = gateDim * numCols;
+    size_t sizeU = gateDim * maxSequences;
+    size_t sizeC = hidden * numCols;
+    size_t sizeH = numDirections > 1 ? hidden * numCols : 0; // the state of one direction, if it can't be written to the output directly
+    size_t sizeLayerOutput = numLayers > 1 ? yDim * numCols : 0;
+    workspace.Resize(1, sizeZ + sizeU + sizeC + sizeH + 2 * sizeLayerOutput);
+    size_t workspaceOffset = 0;
+    auto carve = [&](size_t rows, size_t cols)
+    {
+        Matrix<ElemType> slice = workspace.ColumnSlice(workspaceOffset, std::max(rows * cols, (size_t)1)).Reshaped(rows, cols);
+        workspaceOffset += rows * cols;
+        return slice;
+    };
+    Matrix<ElemType> Z = carve(gateDim, numCols);
+    Matrix<ElemType> U = carve(gateDim, maxSequences);
+    Matrix<ElemType> C = carve(hidden, numCols);
+    Matrix<ElemType> H = numDirections > 1 ? carve(hidden, numCols) : Matrix<ElemType>(outputY.GetDeviceId());
+    Matrix<ElemType> layerOutputs[2] = { numLayers > 1 ? carve(yDim, numCols) : Matrix<ElemType>(outputY.GetDeviceId()),
+                                         numLayers > 1 ? carve(yDim, numCols) : Matrix<ElemType>(outputY.GetDeviceId()) };
+
+    Matrix<ElemType> Y = outputY.Reshaped(yDim, numCols);
+    // all offsets into the parameters are multiples of 'hidden'
+    Matrix<ElemType> parameters = weightsW.Reshaped(hidden, numParameters / hidden);
+    const ElemType* weights = weightsW.Data();
+    for (size_t l = 0; l < numLayers; l++)
+    {
+        const size_t inputDim = l == 0 ? xDim : yDim;
+        Matrix<ElemType> X = l == 0 ? inputX.Reshaped(xDim, numCols) : layerOutputs[(l - 1) % 2].ColumnSlice(0, numCols);
+        Matrix<ElemType> layerOutput = l == numLayers - 1 ? Y.ColumnSlice(0, numCols) : layerOutputs[l % 2].ColumnSlice(0, numCols);
+
+        for (size_t d = 0; d < numDirections; d++)
+        {
+            const size_t pseudoLayer = l * numDirections + d;
+            const size_t weightColumn = weightOffsets[pseudoLayer] / hidden;
+            Matrix<ElemType> W = parameters.ColumnSlice(weightColumn, gateDim * inputDim / hidden).Reshaped(inputDim, gateDim);
+            Matrix<ElemType> R = parameters.ColumnSlice(weightColumn + gateDim * inputDim / hidden, gateDim).Reshaped(hidden, gateDim);
+            const ElemType* bW = weights + biasOffsets[pseudoLayer];
+            const ElemType* bR = bW + gateDim;
+
+            // input projection of all frames at once
+            Matrix<ElemType>::MultiplyAndWeightedAdd(1, W, true, X, false, 0, Z);
+
+            Matrix<ElemType>& state = numDirections > 1 ? H : layerOutput;
+            ElemType* z = Z.Data();
+            ElemType* u = U.Data();
+            ElemType* c = C.Data();
+            ElemType* h = state.Data();
+            for (size_t step = 0; step < numFrames; step++)
+            {
+                // the backward direction runs from the end of each sequence to its start
+                const size_t t = d == 0 ? step : numFrames - 1 - step;
+                const size_t numSequences = numSequencesForFrame[t];
+                const bool hasPrevFrame = d == 0 ? t > 0 : t + 1 < numFrames;
+                const size_t prevFrame = d == 0 ? t - 1 : t + 1;
+                const size_t numWithPrev = hasPrevFrame ? std::min(numSequences, numSequencesForFrame[prevFrame]) : 0;
+
+                if (numWithPrev > 0)
+                {
+                    Matrix<ElemType> uFrame = U.ColumnSlice(0, numWithPrev);
+                    Matrix<ElemType>::MultiplyAndWeightedAdd(1, R, true, state.ColumnSlice(frameOffsets[prevFrame], numWithPrev), false, 0, uFrame);
+                }
+
+                const size_t col = frameOffsets[t];
+                const size_t prevCol = hasPrevFrame ? frameOffsets[prevFrame] : 0;
+#pragma omp parallel for
+                for (long j = 0; j < (long)numSequences; j++)
+                {
+                    bool hasPrev = (size_t)j < numWithPrev;
+                    ComputeCell(kind, hidden, z + (col + j) * gateDim, hasPrev ? u + j * gateDim : nullptr, bW, bR,
+                                hasPrev ? c + (prevCol + j) * hidden : nullptr, hasPrev ? h + (prevCol + j) * hidden : nullptr,
+                                h + (col + j) * hidden, c + (col + j) * hidden);
+                }
+            }
+
+            if (numDirections > 1)
+                layerOutput.AssignToRowSliceValuesOf(H, d * hidden, hidden);
+        }
+    }
+}
+
+template class CPURNN<float>;
+template class CPURNN<double>;
+
+}}}
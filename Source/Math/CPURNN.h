@@ -0,0 +1,39 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include "Matrix.h"
+#include "RNNCommon.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// CPURNN implements the forward pass of OptimizedRNNStack on the CPU, so that models trained with
+// the cuDNN implementation can be evaluated on machines without a GPU.
+//
+// It consumes the same data and parameters as CuDnnRNNExecutor:
+//  - The input is packed by frames: the columns of frame t are the numSequencesForFrame[t] sequences that
+//    are still active at t, ordered by decreasing length. Hence the first n columns of frame t continue the
+//    first n columns of frame t-1.
+//  - The parameters use the cuDNN layout: for each layer (and for each direction within a layer) the input
+//    weights W of all gates followed by the recurrent weights R of all gates, after all layers the biases
+//    bW and bR of each layer and direction. Each gate matrix is [hidden x inputDim] row-major, i.e. the
+//    weights of a layer form a column-major [inputDim x numGates * hidden] matrix.
+//  - Gate order is i, f, c, o for LSTM and r, u, c for GRU.
+//
+// The input projections of all frames are computed by one GEMM per layer and direction, each frame then
+// needs one GEMM for the recurrent projection of all its sequences, followed by a fused computation of
+// the gate nonlinearities that is parallelized over the sequences.
+template <class ElemType>
+class MATH_API CPURNN
+{
+public:
+    // outputY - [yDim x N] where N is the sum of numSequencesForFrame, resized if needed
+    // workspace - scratch memory, resized as needed
+    static void Forward(const Matrix<ElemType>& weightsW, const Matrix<ElemType>& inputX, Matrix<ElemType>& outputY,
+                        size_t xDim, size_t yDim, const vector<size_t>& numSequencesForFrame,
+                        const RnnAttributes& rnnAttributes, Matrix<ElemType>& workspace);
+};
+
+}}}
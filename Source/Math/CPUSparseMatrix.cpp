@@ -933,8 +933,8 @@ void CPUSparseMatrix<ElemType>::MultiplyAndWeightedAdd(ElemType alpha, const CPU
         MultiplyDenseAndSparse<ElemType, false /* dense times sparse */, false /* transposeA */, false /*transposeB*/>::MultiplyAndWeightedAdd(alpha, a /*sparse*/, b /* dense */, beta, c /* matrix beeing updated */);
 }
 
-// c = alpha * lhs * rhs
-// dense * sparse -> sparse
+// c = alpha * op(lhs) * op(rhs)
+// dense * sparse -> sparse (block column format, one block per nonzero column of c)
 template <class ElemType>
 void CPUSparseMatrix<ElemType>::MultiplyAndAdd(ElemType alpha, const CPUMatrix<ElemType>& lhs, const bool transposeA,
                                                const CPUSparseMatrix<ElemType>& rhs, const bool transposeB, CPUSparseMatrix<ElemType>& c)
@@ -961,69 +961,98 @@ void CPUSparseMatrix<ElemType>::MultiplyAndAdd(ElemType alpha, const CPUMatrix<E
 
     c.Reset();
 
-    if (!transposeA && !transposeB)
-    {
+    if (rhs.GetFormat() != matrixFormatSparseCSC)
         NOT_IMPLEMENTED;
-    }
-    else if (!transposeA && transposeB)
-    {
-        if (rhs.GetFormat() != matrixFormatSparseCSC)
-            NOT_IMPLEMENTED;
-
-        // allocate enough memory
-        c.SetFormat(matrixFormatSparseBlockCol);
-        c.RequireSizeAndAllocate(m, n, m * min(n, rhs.NzCount()), true, false);
 
-        map<size_t, size_t> w2Id;
+    // The view of rhs: value and row index of the p-th nonzero element, and the range of nonzero elements of column j.
+    const ElemType* values = rhs.Buffer() + rhs.SecondaryIndexLocation()[0];
+    const CPUSPARSE_INDEX_TYPE* rowIndices = rhs.MajorIndexLocation();
+    const CPUSPARSE_INDEX_TYPE* colStarts = rhs.SecondaryIndexLocation();
+    const size_t nz = colStarts[rhs.GetNumCols()] - colStarts[0]; // (NzCount() does not account for the view offset)
+
+    // Column c(:, j) only receives contributions from the nonzero elements in column j of op(rhs), so c is
+    // built as one block per such column. The blocks are found first, together with a list of the nonzero
+    // elements contributing to each block (ordered as in rhs), then all blocks are accumulated in parallel.
+    vector<size_t> blockIds;                    // column of c of each block, ascending
+    vector<size_t> blockStarts;                 // range of the elements of each block in 'elements'
+    vector<size_t> elements(nz);                // index of a nonzero element of rhs
+    vector<size_t> innerIndices(nz);            // index into the inner dimension of the product of each nonzero element
+    if (transposeB)
+    {
+        // columns of c are rows of rhs: gather the unique row ids by sorting the nonzero elements by row
+        vector<pair<CPUSPARSE_INDEX_TYPE, size_t>> rowAndElement(nz);
         for (size_t j = 0; j < rhs.GetNumCols(); j++)
-        { // j ranges over batches
-            size_t start = rhs.SecondaryIndexLocation()[j];
-            size_t end = rhs.SecondaryIndexLocation()[j + 1];
-
-            for (size_t p = start; p < end; p++)
+        {
+            for (size_t p = colStarts[j] - colStarts[0]; p < colStarts[j + 1] - colStarts[0]; p++)
             {
-                size_t i = rhs.MajorIndexLocation()[p]; // i ranges over words
-                ElemType val = rhs.Buffer()[p];  // 1 for(i, j)
-
-                bool first = true;
-                if (w2Id.find(i) == w2Id.end())
-                {
-                    size_t id = w2Id.size();
-                    w2Id[i] = id;
-                    c.GetBlockIds()[c.GetBlockSize()] = i;
-                    c.SetBlockSize(c.GetBlockSize() + 1);
-                }
-                else
-                {
-                    first = false;
-                }
-                size_t pos = w2Id[i] * lhs.GetNumRows();
-                for (size_t h = 0; h < lhs.GetNumRows(); h++)
-                { // h range over hidden layer
-                    if (first == true)
-                    {
-                        c.Buffer()[pos] = alpha * lhs(h, j) * val;
-                    }
-                    else
-                    {
-                        c.Buffer()[pos] += alpha * lhs(h, j) * val;
-                    }
-                    pos++;
-                }
+                rowAndElement[p] = make_pair(rowIndices[p], p);
+                innerIndices[p] = j;
             }
         }
-        if (c.GetBlockSize() * m > c.GetSizeAllocated())
+        sort(rowAndElement.begin(), rowAndElement.end());
+
+        for (size_t p = 0; p < nz; p++)
         {
-            LogicError("Sparse matrix is unexpectedly out of range.");
+            if (p == 0 || rowAndElement[p].first != rowAndElement[p - 1].first)
+            {
+                blockIds.push_back(rowAndElement[p].first);
+                blockStarts.push_back(p);
+            }
+            elements[p] = rowAndElement[p].second;
         }
     }
-    else if (transposeA && !transposeB)
+    else
     {
-        NOT_IMPLEMENTED;
+        // columns of c are the nonempty columns of rhs
+        for (size_t j = 0; j < rhs.GetNumCols(); j++)
+        {
+            if (colStarts[j + 1] == colStarts[j])
+                continue;
+
+            blockIds.push_back(j);
+            blockStarts.push_back(colStarts[j] - colStarts[0]);
+        }
+        for (size_t p = 0; p < nz; p++)
+        {
+            elements[p] = p;
+            innerIndices[p] = rowIndices[p];
+        }
     }
-    else
+    blockStarts.push_back(nz);
+
+    c.SetFormat(matrixFormatSparseBlockCol);
+    c.RequireSizeAndAllocate(m, n, m * blockIds.size(), true, false);
+    c.SetBlockSize(blockIds.size());
+    if (!blockIds.empty())
+        memcpy(c.GetBlockIds(), blockIds.data(), sizeof(size_t) * blockIds.size());
+
+    // Column 'inner' of op(lhs) starts at lhsData + inner * lhsInnerStride, its elements are lhsRowStride apart.
+    const ElemType* lhsData = lhs.Data();
+    const size_t lhsInnerStride = transposeA ? 1 : lhs.GetNumRows();
+    const size_t lhsRowStride = transposeA ? lhs.GetNumRows() : 1;
+    ElemType* blockValues = c.Buffer();
+    const long numBlocks = (long) blockIds.size();
+
+#pragma omp parallel for
+    for (long b = 0; b < numBlocks; b++)
     {
-        NOT_IMPLEMENTED;
+        ElemType* block = blockValues + b * m;
+        memset(block, 0, sizeof(ElemType) * m);
+        for (size_t e = blockStarts[b]; e < blockStarts[b + 1]; e++)
+        {
+            size_t p = elements[e];
+            ElemType scale = alpha * values[p];
+            const ElemType* column = lhsData + innerIndices[p] * lhsInnerStride;
+            if (sizeof(ElemType) == sizeof(double))
+            {
+                cblas_daxpy((int) m, (double) scale, reinterpret_cast<const double*>(column), (int) lhsRowStride, reinterpret_cast<double*>(block), 1);
+            }
+            else
+            {
+#pragma warning(suppress : 4244)
+                cblas_saxpy((int) m, (float) scale, reinterpret_cast<const float*>(column), (int) lhsRowStride, reinterpret_cast<float*>(block), 1);
+            }
+        }
     }
 }
 
@@ -6,6 +6,10 @@
 #include "stdafx.h"
 #include "ConvolutionEngine.h"
 #include "CuDnnFactories.h"
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -29,6 +33,29 @@ void ConvolutionEngine<ElemType>::Forward(const Mat& in, const Mat& kernel, Mat&
     ForwardCore(in, kernel, out, workspace);
 }
 
+template <class ElemType>
+void ConvolutionEngine<ElemType>::ForwardQuantized(const Mat& in, const Mat& kernel, Mat& out, Mat& workspace, Int8QuantizedMultiplier<ElemType>& multiplier)
+{
+    const auto& g = *m_geometry;
+    assert(g.InputShape().GetNumElements() == in.GetNumRows());
+    assert(g.OutputShape().GetNumElements() == out.GetNumRows());
+    assert(in.GetNumCols() == out.GetNumCols());
+    assert(g.KernelShape().GetNumElements() * g.KernelCount() == kernel.GetNumElements());
+#ifdef NDEBUG
+    UNUSED(g);
+#endif
+
+    EnsureCompatible();
+    EnsureConvolutionInitialized();
+    ForwardQuantizedCore(in, kernel, out, workspace, multiplier);
+}
+
+template <class ElemType>
+void ConvolutionEngine<ElemType>::ForwardQuantizedCore(const Mat&, const Mat&, Mat&, Mat&, Int8QuantizedMultiplier<ElemType>&)
+{
+    LogicError("This convolution engine does not support quantized forward propagation.");
+}
+
 template <class ElemType>
 void ConvolutionEngine<ElemType>::BackwardData(const Mat& srcGrad, const Mat& kernel, Mat& grad, Mat& workspace)
 {
@@ -624,19 +651,7 @@ protected:
         for (size_t start = 0; start < batchSize; start += subBatchSize)
         {
             size_t curBatchSize = min(subBatchSize, batchSize - start);
-            auto inputSlice = in.ColumnSlice(start, curBatchSize);
-            auto unrolledInput = workspace.ColumnSlice(0, unrollCols);
-            if (curBatchSize != subBatchSize)
-            {
-                unrolledInput.Reshape(mapOutSize, subBatchSize * unrollCols);
-                unrolledInput = unrolledInput.ColumnSlice(0, curBatchSize * unrollCols);
-            }
-            // Need to reshape (soft transpose) as matrices are column-major.
-            unrolledInput.Reshape(unrollCols, mapOutSize * curBatchSize);
-
-            // Unroll inputs.
-            unrolledInput.SetValue(0);
-            inputSlice.UnrollConvolutionInput(unrollCols, mapOutSize, m_mpRowCol, *m_mpRowRun, *m_runs, unrolledInput);
+            auto unrolledInput = UnrollInputSlice(in, start, curBatchSize, subBatchSize, mapOutSize, unrollCols, workspace);
 
             // cudnn layout uses row-major kernel weight matrix.
             auto kern = kernel.ColumnSlice(0, kernel.GetNumCols());
@@ -666,6 +681,63 @@ protected:
             }
         }
     }
+
+    // Same as ForwardCore, but the GEMM is computed by the 8-bit integer multiplier as
+    //    [XYC x K]^T * [XYC x NW'H'] -> [K x NW'H'], where column j holds sample j % N at output position j / N.
+    // Viewed as [KN x W'H'], its transpose is exactly the [W'H'K x N] output.
+    void ForwardQuantizedCore(const Mat& in, const Mat& kernel, Mat& out, Mat& workspace, Int8QuantizedMultiplier<ElemType>& multiplier) override
+    {
+        size_t batchSize = in.GetNumCols();
+        size_t subBatchSize = m_maxTempMemSizeInSamples == 0 ? batchSize : min(batchSize, m_maxTempMemSizeInSamples);
+
+        size_t mapCount = m_geometry->GetMapCount(m_geometry->InputShape().GetRank() - 1);
+        size_t mapOutSize = m_geometry->OutputShape().GetNumElements() / mapCount;
+        size_t unrollCols = m_geometry->KernelShape().GetNumElements();
+        workspace.Resize(mapOutSize * subBatchSize, unrollCols + mapCount);
+
+        auto kern = kernel.ColumnSlice(0, kernel.GetNumCols());
+        kern.Reshape(unrollCols, kernel.GetNumElements() / unrollCols);
+
+        for (size_t start = 0; start < batchSize; start += subBatchSize)
+        {
+            size_t curBatchSize = min(subBatchSize, batchSize - start);
+            auto unrolledInput = UnrollInputSlice(in, start, curBatchSize, subBatchSize, mapOutSize, unrollCols, workspace);
+
+            auto outTempSlice = workspace.ColumnSlice(unrollCols, mapCount);
+            if (curBatchSize != subBatchSize)
+            {
+                outTempSlice.Reshape(mapOutSize, subBatchSize * mapCount);
+                outTempSlice = outTempSlice.ColumnSlice(0, curBatchSize * mapCount);
+            }
+            outTempSlice.Reshape(mapCount, mapOutSize * curBatchSize);
+            multiplier.Multiply(kern, true, unrolledInput, outTempSlice);
+
+            outTempSlice.Reshape(mapCount * curBatchSize, mapOutSize);
+            auto outSlice = out.ColumnSlice(start, curBatchSize);
+            outSlice.Reshape(mapOutSize, mapCount * curBatchSize);
+            outSlice.AssignTransposeOf(outTempSlice);
+        }
+    }
+
+    // Unrolls samples [start, start + curBatchSize) of 'in' into the first unrollCols columns of the workspace,
+    // viewed as [XYC x NW'H'], see ForwardCore().
+    Mat UnrollInputSlice(const Mat& in, size_t start, size_t curBatchSize, size_t subBatchSize, size_t mapOutSize, size_t unrollCols, Mat& workspace)
+    {
+        auto inputSlice = in.ColumnSlice(start, curBatchSize);
+        auto unrolledInput = workspace.ColumnSlice(0, unrollCols);
+        if (curBatchSize != subBatchSize)
+        {
+            unrolledInput.Reshape(mapOutSize, subBatchSize * unrollCols);
+            unrolledInput = unrolledInput.ColumnSlice(0, curBatchSize * unrollCols);
+        }
+        // Need to reshape (soft transpose) as matrices are column-major.
+        unrolledInput.Reshape(unrollCols, mapOutSize * curBatchSize);
+
+        // Unroll inputs.
+        unrolledInput.SetValue(0);
+        inputSlice.UnrollConvolutionInput(unrollCols, mapOutSize, m_mpRowCol, *m_mpRowRun, *m_runs, unrolledInput);
+        return unrolledInput;
+    }
     
     // The backward data method works by representing this operation as a "reverse" convolution
     // in case kernel's last dimension is equal to input dimension. Gradients matrix (grad) becomes
@@ -848,6 +920,1043 @@ public:
     }
 };
 
+//------------------------------------------------------------------
+// Dimensions of a plain 2D convolution, the configuration of almost all image models:
+// a [W x H x C] input, kernels of [X x Y x C] that span all input channels, full sharing,
+// and K output maps, i.e. a [W' x H' x K] output. The kernel of map k is column k of a [XYC x K] matrix.
+//------------------------------------------------------------------
+struct Convolution2DDims
+{
+    int inW, inH, inC;
+    int outW, outH, outC;
+    int kernelW, kernelH;
+    int strideW, strideH;
+    // input coordinates of the first kernel cell for output (0, 0); negative if the input is padded
+    int offsetW, offsetH;
+
+    // Returns false if the geometry is not a plain 2D convolution.
+    static bool TryGet(const ConvolveGeometry& g, Convolution2DDims& dims)
+    {
+        const auto& inT = g.InputShape();
+        const auto& kernT = g.KernelShape();
+        const auto& outT = g.OutputShape();
+        if (inT.GetRank() != 3 || kernT[2] != inT[2] || g.GetMapCount(0) != 1 || g.GetMapCount(1) != 1 ||
+            outT[2] != g.GetMapCount(2) || g.KernelCount() != outT[2] || g.MpRowCol().empty())
+            return false;
+        for (size_t i = 0; i < 3; i++)
+        {
+            if (!g.GetSharing(i))
+                return false;
+        }
+
+        SetFrom(g, dims);
+        return true;
+    }
+
+    static void SetFrom(const ConvolveGeometry& g, Convolution2DDims& dims)
+    {
+        const auto& inT = g.InputShape();
+        const auto& kernT = g.KernelShape();
+        const auto& outT = g.OutputShape();
+        dims.inW = (int)inT[0];
+        dims.inH = (int)inT[1];
+        dims.inC = (int)inT[2];
+        dims.outW = (int)outT[0];
+        dims.outH = (int)outT[1];
+        dims.outC = (int)outT[2];
+        dims.kernelW = (int)kernT[0];
+        dims.kernelH = (int)kernT[1];
+        dims.strideW = (int)g.GetStride(0);
+        dims.strideH = (int)g.GetStride(1);
+        // MpRowCol[0] is the input cell under the kernel center for output (0, 0).
+        int col = g.MpRowCol()[0];
+        dims.offsetW = col % dims.inW - (dims.kernelW - 1) / 2;
+        dims.offsetH = (col / dims.inW) % dims.inH - (dims.kernelH - 1) / 2;
+    }
+
+    // Same for a 2D pooling: a [W x H x C] input, windows of [X x Y x 1] and a [W' x H' x C] output.
+    static bool TryGetPooling(const ConvolveGeometry& g, Convolution2DDims& dims)
+    {
+        const auto& inT = g.InputShape();
+        const auto& kernT = g.KernelShape();
+        const auto& outT = g.OutputShape();
+        if (inT.GetRank() != 3 || kernT[2] != 1 || g.GetStride(2) != 1 || outT[2] != inT[2] || g.MpRowCol().empty())
+            return false;
+        for (size_t i = 0; i < 3; i++)
+        {
+            if (g.GetMapCount(i) != 1)
+                return false;
+        }
+        SetFrom(g, dims);
+        return true;
+    }
+
+    // Range [begin, end) of outputs along one dimension for which kernel cell 'k' falls into the input.
+    static void GetValidOutputRange(int k, int offset, int stride, int inSize, int outSize, int& begin, int& end)
+    {
+        int first = offset + k; // input coordinate for output 0
+        begin = first >= 0 ? 0 : (-first + stride - 1) / stride;
+        end = first < inSize ? min(outSize, (inSize - 1 - first) / stride + 1) : 0;
+    }
+};
+
+//------------------------------------------------------------------
+// Direct convolution engine implementation.
+// Computes plain 2D convolutions (see Convolution2DDims) on the CPU straight from the input,
+// so unlike the GEMM engine it needs no workspace for an unrolled input.
+// 1x1 convolutions with stride 1 are a matrix product per sample. Everything else loops over
+// the kernel cells, with the innermost loop along a row of the output, parallelized over output maps.
+// Other than for 1x1 convolutions, the backward passes are those of the GEMM engine.
+//------------------------------------------------------------------
+template <class ElemType>
+class DirectConvolutionEngine : public ReferenceConvolutionEngine<ElemType>
+{
+public:
+    using Base = ReferenceConvolutionEngine<ElemType>;
+    using typename Base::Mat;
+
+public:
+    DirectConvolutionEngine(ConvolveGeometryPtr geometry, DEVICEID_TYPE deviceId, ImageLayoutKind imageLayout, size_t maxTempMemSizeInSamples, PoolKind poolKind)
+        : Base(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind)
+    {
+        m_isPlain2D = Convolution2DDims::TryGet(*geometry, m_dims);
+    }
+
+protected:
+    using Base::IsGpu;
+
+    using Base::m_geometry;
+    using Base::m_deviceId;
+    using Base::m_imageLayout;
+    using Base::m_maxTempMemSizeInSamples;
+    using Base::m_poolKind;
+
+    // number of output maps that the forward pass computes together from the same input rows
+    static const int MapBlockSize = 4;
+
+    void EnsureCompatible() override
+    {
+        if (m_imageLayout != ImageLayoutKind::CHW)
+            LogicError("Direct convolution engine supports only CHW/cudnn layout.");
+        if (IsGpu(m_deviceId))
+            LogicError("Direct convolution engine supports only CPU device.");
+        if (!m_isPlain2D)
+            RuntimeError("Direct convolution engine supports only 2D convolutions with full sharing whose kernels span all input channels. Geometry: %s", ((string)*m_geometry).c_str());
+    }
+
+    bool IsMatrixProduct() const
+    {
+        const auto& d = m_dims;
+        return d.kernelW == 1 && d.kernelH == 1 && d.strideW == 1 && d.strideH == 1 && d.outW == d.inW && d.outH == d.inH;
+    }
+
+    void ForwardCore(const Mat& in, const Mat& kernel, Mat& out, Mat& /*workspace*/) override
+    {
+        const auto& d = m_dims;
+        size_t batchSize = in.GetNumCols();
+        if (IsMatrixProduct())
+        {
+            // per sample [WH x C] * [C x K] -> [WH x K]
+            auto kern = kernel.ColumnSlice(0, kernel.GetNumCols());
+            kern.Reshape(d.inC, d.outC);
+            for (size_t n = 0; n < batchSize; n++)
+            {
+                auto inSlice = in.ColumnSlice(n, 1);
+                inSlice.Reshape(d.inW * d.inH, d.inC);
+                auto outSlice = out.ColumnSlice(n, 1);
+                outSlice.Reshape(d.outW * d.outH, d.outC);
+                Mat::Multiply(inSlice, false, kern, false, outSlice);
+            }
+            return;
+        }
+
+        const ElemType* pin = in.Data();
+        const ElemType* pkern = kernel.Data();
+        ElemType* pout = out.Data();
+        const size_t inSize = (size_t)d.inW * d.inH * d.inC;
+        const size_t outMapSize = (size_t)d.outW * d.outH;
+        const size_t kernSize = (size_t)d.kernelW * d.kernelH * d.inC;
+        const int numMapBlocks = (d.outC + MapBlockSize - 1) / MapBlockSize;
+
+#pragma omp parallel for
+        for (long task = 0; task < (long)batchSize * numMapBlocks; task++)
+        {
+            const size_t n = task / numMapBlocks;
+            const int mapBegin = (int)(task % numMapBlocks) * MapBlockSize;
+            const int mapEnd = min(mapBegin + MapBlockSize, d.outC);
+            const ElemType* sampleIn = pin + n * inSize;
+            ElemType* sampleOut = pout + n * outMapSize * d.outC;
+            std::fill(sampleOut + mapBegin * outMapSize, sampleOut + mapEnd * outMapSize, (ElemType)0);
+
+            for (int c = 0; c < d.inC; c++)
+            {
+                for (int ky = 0; ky < d.kernelH; ky++)
+                {
+                    int oyBegin, oyEnd;
+                    Convolution2DDims::GetValidOutputRange(ky, d.offsetH, d.strideH, d.inH, d.outH, oyBegin, oyEnd);
+                    for (int kx = 0; kx < d.kernelW; kx++)
+                    {
+                        int oxBegin, oxEnd;
+                        Convolution2DDims::GetValidOutputRange(kx, d.offsetW, d.strideW, d.inW, d.outW, oxBegin, oxEnd);
+                        const size_t kernIndex = ((size_t)c * d.kernelH + ky) * d.kernelW + kx;
+                        for (int oy = oyBegin; oy < oyEnd; oy++)
+                        {
+                            const ElemType* inRow = sampleIn + ((size_t)c * d.inH + oy * d.strideH + d.offsetH + ky) * d.inW + d.offsetW + kx;
+                            for (int k = mapBegin; k < mapEnd; k++)
+                            {
+                                const ElemType w = pkern[k * kernSize + kernIndex];
+                                ElemType* outRow = sampleOut + k * outMapSize + (size_t)oy * d.outW;
+                                for (int ox = oxBegin; ox < oxEnd; ox++)
+                                    outRow[ox] += w * inRow[ox * d.strideW];
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void BackwardDataCore(const Mat& srcGrad, const Mat& kernel, Mat& grad, Mat& workspace) override
+    {
+        const auto& d = m_dims;
+        size_t batchSize = srcGrad.GetNumCols();
+        if (IsMatrixProduct())
+        {
+            auto kern = kernel.ColumnSlice(0, kernel.GetNumCols());
+            kern.Reshape(d.inC, d.outC);
+            for (size_t n = 0; n < batchSize; n++)
+            {
+                auto srcGradSlice = srcGrad.ColumnSlice(n, 1);
+                srcGradSlice.Reshape(d.outW * d.outH, d.outC);
+                auto gradSlice = grad.ColumnSlice(n, 1);
+                gradSlice.Reshape(d.inW * d.inH, d.inC);
+                Mat::MultiplyAndAdd(srcGradSlice, false, kern, true, gradSlice);
+            }
+            return;
+        }
+        GemmEngine().BackwardData(srcGrad, kernel, grad, workspace);
+    }
+
+    void BackwardKernelCore(const Mat& srcGrad, const Mat& in, Mat& kernelGrad, bool allowReuse, Mat& workspace) override
+    {
+        const auto& d = m_dims;
+        size_t batchSize = srcGrad.GetNumCols();
+        if (IsMatrixProduct())
+        {
+            auto kernGrad = kernelGrad.ColumnSlice(0, kernelGrad.GetNumCols());
+            kernGrad.Reshape(d.inC, d.outC);
+            for (size_t n = 0; n < batchSize; n++)
+            {
+                auto inSlice = in.ColumnSlice(n, 1);
+                inSlice.Reshape(d.inW * d.inH, d.inC);
+                auto srcGradSlice = srcGrad.ColumnSlice(n, 1);
+                srcGradSlice.Reshape(d.outW * d.outH, d.outC);
+                Mat::MultiplyAndAdd(inSlice, true, srcGradSlice, false, kernGrad);
+            }
+            return;
+        }
+        GemmEngine().BackwardKernel(srcGrad, in, kernelGrad, allowReuse, workspace);
+    }
+
+    // Outside of the matrix product case the backward passes are matrix products over unrolled values too,
+    // so they are left to a GEMM engine of the same geometry, created on first use (i.e. only when training).
+    GemmConvolutionEngine<ElemType>& GemmEngine()
+    {
+        if (!m_gemmEngine)
+            m_gemmEngine = std::make_unique<GemmConvolutionEngine<ElemType>>(m_geometry, m_deviceId, m_imageLayout, m_maxTempMemSizeInSamples, m_poolKind);
+        return *m_gemmEngine;
+    }
+
+public:
+    static bool IsSupported(DEVICEID_TYPE deviceId, ConvolveGeometryPtr geometry, PoolKind poolKind)
+    {
+        Convolution2DDims dims;
+        return deviceId < 0 && poolKind == PoolKind::None && Convolution2DDims::TryGet(*geometry, dims);
+    }
+
+    // Preferred over the GEMM engine where unrolling does not pay off, as each input value is used
+    // only once: 1x1 kernels, and strides that are at least as large as the kernel.
+    static bool IsPreferred(ConvolveGeometryPtr geometry)
+    {
+        Convolution2DDims dims;
+        return Convolution2DDims::TryGet(*geometry, dims) && dims.strideW >= dims.kernelW && dims.strideH >= dims.kernelH;
+    }
+
+protected:
+    Convolution2DDims m_dims;
+    bool m_isPlain2D;
+    std::unique_ptr<GemmConvolutionEngine<ElemType>> m_gemmEngine;
+};
+
+//------------------------------------------------------------------
+// Winograd convolution engine implementation.
+// Computes the forward pass of 3x3 convolutions with stride 1 with the Winograd algorithm F(2x2,3x3)
+// (Lavin and Gray, "Fast Algorithms for Convolutional Neural Networks"), which needs 16 instead of 36
+// multiplications per 2x2 output tile and input channel. Kernels are transformed on each call, into the
+// workspace ([16 x KC], much smaller than the unrolled input of the GEMM engine). The backward passes
+// are those of the GEMM engine (see DirectConvolutionEngine).
+//------------------------------------------------------------------
+template <class ElemType>
+class WinogradConvolutionEngine : public DirectConvolutionEngine<ElemType>
+{
+public:
+    using Base = DirectConvolutionEngine<ElemType>;
+    using typename Base::Mat;
+
+public:
+    WinogradConvolutionEngine(ConvolveGeometryPtr geometry, DEVICEID_TYPE deviceId, ImageLayoutKind imageLayout, size_t maxTempMemSizeInSamples, PoolKind poolKind)
+        : Base(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind)
+    {
+    }
+
+protected:
+    using Base::m_geometry;
+    using Base::m_dims;
+
+    // number of tiles along an output row that are transformed and multiplied together
+    static const int TileBlockSize = 8;
+
+    void EnsureCompatible() override
+    {
+        Base::EnsureCompatible();
+        if (!IsWinograd(m_dims))
+            RuntimeError("Winograd convolution engine supports only 3x3 kernels with stride 1. Geometry: %s", ((string)*m_geometry).c_str());
+    }
+
+    // U = G g G^T for a 3x3 kernel g (row-major)
+    static void TransformKernel(const ElemType* g, ElemType* u)
+    {
+        ElemType t[4][3];
+        for (int j = 0; j < 3; j++)
+        {
+            t[0][j] = g[j];
+            t[1][j] = (g[j] + g[3 + j] + g[6 + j]) / 2;
+            t[2][j] = (g[j] - g[3 + j] + g[6 + j]) / 2;
+            t[3][j] = g[6 + j];
+        }
+        for (int i = 0; i < 4; i++)
+        {
+            u[4 * i + 0] = t[i][0];
+            u[4 * i + 1] = (t[i][0] + t[i][1] + t[i][2]) / 2;
+            u[4 * i + 2] = (t[i][0] - t[i][1] + t[i][2]) / 2;
+            u[4 * i + 3] = t[i][2];
+        }
+    }
+
+    // V = B^T d B for a 4x4 input tile d (row-major)
+    static void TransformInput(const ElemType d[4][4], ElemType* v)
+    {
+        ElemType t[4][4];
+        for (int j = 0; j < 4; j++)
+        {
+            t[0][j] = d[0][j] - d[2][j];
+            t[1][j] = d[1][j] + d[2][j];
+            t[2][j] = d[2][j] - d[1][j];
+            t[3][j] = d[1][j] - d[3][j];
+        }
+        for (int i = 0; i < 4; i++)
+        {
+            v[4 * i + 0] = t[i][0] - t[i][2];
+            v[4 * i + 1] = t[i][1] + t[i][2];
+            v[4 * i + 2] = t[i][2] - t[i][1];
+            v[4 * i + 3] = t[i][1] - t[i][3];
+        }
+    }
+
+    // Y = A^T m A, the 2x2 output tile of a product m (row-major)
+    static void TransformOutput(const ElemType* m, ElemType y[2][2])
+    {
+        ElemType t[2][4];
+        for (int j = 0; j < 4; j++)
+        {
+            t[0][j] = m[j] + m[4 + j] + m[8 + j];
+            t[1][j] = m[4 + j] - m[8 + j] - m[12 + j];
+        }
+        for (int i = 0; i < 2; i++)
+        {
+            y[i][0] = t[i][0] + t[i][1] + t[i][2];
+            y[i][1] = t[i][1] - t[i][2] - t[i][3];
+        }
+    }
+
+    void ForwardCore(const Mat& in, const Mat& kernel, Mat& out, Mat& workspace) override
+    {
+        const auto& d = m_dims;
+        size_t batchSize = in.GetNumCols();
+        const size_t inMapSize = (size_t)d.inW * d.inH;
+        const size_t outMapSize = (size_t)d.outW * d.outH;
+        const int numInMaps = d.inC;
+        const int numOutMaps = d.outC;
+
+        // transformed kernels, [16 x C x K]
+        workspace.Resize(16, (size_t)numInMaps * numOutMaps);
+        ElemType* pu = workspace.Data();
+        const ElemType* pkern = kernel.Data();
+        for (size_t i = 0; i < (size_t)numInMaps * numOutMaps; i++)
+            TransformKernel(pkern + 9 * i, pu + 16 * i);
+
+        const ElemType* pin = in.Data();
+        ElemType* pout = out.Data();
+        const int tilesW = (d.outW + 1) / 2;
+        const int tilesH = (d.outH + 1) / 2;
+        const int numTileBlocks = (tilesW + TileBlockSize - 1) / TileBlockSize;
+
+#pragma omp parallel
+        {
+            std::vector<ElemType> v((size_t)numInMaps * TileBlockSize * 16);  // transformed input tiles, [16 x tile x C]
+            std::vector<ElemType> m((size_t)numOutMaps * TileBlockSize * 16); // their products with the kernels, [16 x tile x K]
+#pragma omp for
+            for (long task = 0; task < (long)batchSize * tilesH * numTileBlocks; task++)
+            {
+                const size_t n = task / (tilesH * numTileBlocks);
+                const int ty = (int)(task / numTileBlocks % tilesH);
+                const int txBegin = (int)(task % numTileBlocks) * TileBlockSize;
+                const int numTiles = min(TileBlockSize, tilesW - txBegin);
+                const int iyBegin = 2 * ty + d.offsetH;
+
+                for (int c = 0; c < numInMaps; c++)
+                {
+                    const ElemType* inMap = pin + (n * numInMaps + c) * inMapSize;
+                    for (int t = 0; t < numTiles; t++)
+                    {
+                        const int ixBegin = 2 * (txBegin + t) + d.offsetW;
+                        ElemType tile[4][4];
+                        for (int i = 0; i < 4; i++)
+                        {
+                            const int iy = iyBegin + i;
+                            for (int j = 0; j < 4; j++)
+                            {
+                                const int ix = ixBegin + j;
+                                tile[i][j] = iy >= 0 && iy < d.inH && ix >= 0 && ix < d.inW ? inMap[(size_t)iy * d.inW + ix] : 0;
+                            }
+                        }
+                        TransformInput(tile, &v[((size_t)c * TileBlockSize + t) * 16]);
+                    }
+                }
+
+                std::fill(m.begin(), m.end(), (ElemType)0);
+                for (int k = 0; k < numOutMaps; k++)
+                {
+                    for (int c = 0; c < numInMaps; c++)
+                    {
+                        const ElemType* u = pu + ((size_t)k * numInMaps + c) * 16;
+                        for (int t = 0; t < numTiles; t++)
+                        {
+                            const ElemType* vt = &v[((size_t)c * TileBlockSize + t) * 16];
+                            ElemType* mt = &m[((size_t)k * TileBlockSize + t) * 16];
+                            for (int e = 0; e < 16; e++)
+                                mt[e] += u[e] * vt[e];
+                        }
+                    }
+                }
+
+                for (int k = 0; k < numOutMaps; k++)
+                {
+                    ElemType* outMap = pout + (n * numOutMaps + k) * outMapSize;
+                    for (int t = 0; t < numTiles; t++)
+                    {
+                        ElemType y[2][2];
+                        TransformOutput(&m[((size_t)k * TileBlockSize + t) * 16], y);
+                        const int ox = 2 * (txBegin + t);
+                        for (int i = 0; i < 2 && 2 * ty + i < d.outH; i++)
+                        {
+                            for (int j = 0; j < 2 && ox + j < d.outW; j++)
+                                outMap[(size_t)(2 * ty + i) * d.outW + ox + j] = y[i][j];
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    static bool IsWinograd(const Convolution2DDims& dims)
+    {
+        return dims.kernelW == 3 && dims.kernelH == 3 && dims.strideW == 1 && dims.strideH == 1;
+    }
+
+public:
+    static bool IsSupported(DEVICEID_TYPE deviceId, ConvolveGeometryPtr geometry, PoolKind poolKind)
+    {
+        Convolution2DDims dims;
+        return Base::IsSupported(deviceId, geometry, poolKind) && Convolution2DDims::TryGet(*geometry, dims) && IsWinograd(dims);
+    }
+};
+
+//------------------------------------------------------------------
+// Channel-blocked convolution engine implementation.
+// Computes 2D convolutions (see Convolution2DDims) and max/average pooling on the CPU for inputs and outputs in the
+// channel-blocked layout ImageLayoutKind::CHWc. All innermost loops run over a block of ImageChannelBlockSize
+// channels of one pixel, which are contiguous in this layout. Convolution kernels are reordered into the workspace
+// on each call, so that the weights that connect a block of input channels to a block of output channels are contiguous too.
+// Only the forward passes are implemented: the layout is used by ComputationNetwork for inference only.
+//------------------------------------------------------------------
+template <class ElemType>
+class ChannelBlockedConvolutionEngine : public ConvolutionEngine<ElemType>
+{
+public:
+    using Base = ConvolutionEngine<ElemType>;
+    using typename Base::Mat;
+
+public:
+    ChannelBlockedConvolutionEngine(ConvolveGeometryPtr geometry, DEVICEID_TYPE deviceId, ImageLayoutKind imageLayout, size_t maxTempMemSizeInSamples, PoolKind poolKind)
+        : Base(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind)
+    {
+        m_isSupported = IsSupported(*geometry, deviceId, poolKind);
+        if (m_isSupported)
+        {
+            if (poolKind == PoolKind::None)
+                Convolution2DDims::TryGet(*geometry, m_dims);
+            else
+                Convolution2DDims::TryGetPooling(*geometry, m_dims);
+        }
+    }
+
+    static bool IsSupported(const ConvolveGeometry& geometry, DEVICEID_TYPE deviceId, PoolKind poolKind)
+    {
+        Convolution2DDims dims;
+        if (deviceId >= 0)
+            return false;
+        if (poolKind == PoolKind::None)
+            return Convolution2DDims::TryGet(geometry, dims) && dims.inC % BlockSize == 0 && dims.outC % BlockSize == 0;
+        return Convolution2DDims::TryGetPooling(geometry, dims) && dims.inC % BlockSize == 0;
+    }
+
+protected:
+    using Base::m_geometry;
+    using Base::m_deviceId;
+    using Base::m_imageLayout;
+    using Base::m_poolKind;
+
+    static const int BlockSize = (int)ImageChannelBlockSize;
+
+    void EnsureCompatible() override
+    {
+        if (m_imageLayout != ImageLayoutKind::CHWc)
+            LogicError("Channel-blocked convolution engine supports only CHWc layout.");
+        if (!m_isSupported)
+            RuntimeError("Channel-blocked convolution engine supports only 2D convolutions and poolings on CPU device whose channel counts are multiples of %d. Geometry: %s",
+                         BlockSize, ((string)*m_geometry).c_str());
+    }
+
+    void EnsureConvolutionInitialized() override
+    {
+    }
+
+    void ForwardCore(const Mat& in, const Mat& kernel, Mat& out, Mat& workspace) override
+    {
+        const auto& d = m_dims;
+        const int inBlocks = d.inC / BlockSize;
+        const int outBlocks = d.outC / BlockSize;
+        const size_t kernelSize = (size_t)d.kernelW * d.kernelH * d.inC;
+
+        // kernels as [BlockSize(out) x BlockSize(in) x kW x kH x C/BlockSize x K/BlockSize]
+        workspace.Resize(kernelSize * d.outC, 1);
+        const ElemType* pkern = kernel.Data();
+        ElemType* pw = workspace.Data();
+#pragma omp parallel for
+        for (long k = 0; k < (long)d.outC; k++)
+        {
+            for (int c = 0; c < d.inC; c++)
+            {
+                for (int ky = 0; ky < d.kernelH; ky++)
+                {
+                    for (int kx = 0; kx < d.kernelW; kx++)
+                    {
+                        size_t dst = (((((size_t)(k / BlockSize) * inBlocks + c / BlockSize) * d.kernelH + ky) * d.kernelW + kx) * BlockSize + c % BlockSize) * BlockSize + k % BlockSize;
+                        pw[dst] = pkern[k * kernelSize + ((size_t)c * d.kernelH + ky) * d.kernelW + kx];
+                    }
+                }
+            }
+        }
+
+        const ElemType* pin = in.Data();
+        ElemType* pout = out.Data();
+        const size_t inSize = (size_t)d.inW * d.inH * d.inC;
+        const size_t outSize = (size_t)d.outW * d.outH * d.outC;
+        const size_t batchSize = in.GetNumCols();
+#pragma omp parallel for
+        for (long task = 0; task < (long)(batchSize * outBlocks * d.outH); task++)
+        {
+            const size_t n = task / (outBlocks * d.outH);
+            const int kb = (int)(task / d.outH % outBlocks);
+            const int oy = (int)(task % d.outH);
+            ElemType* outRow = pout + n * outSize + ((size_t)kb * d.outH + oy) * d.outW * BlockSize;
+            std::fill(outRow, outRow + (size_t)d.outW * BlockSize, (ElemType)0);
+
+            for (int cb = 0; cb < inBlocks; cb++)
+            {
+                for (int ky = 0; ky < d.kernelH; ky++)
+                {
+                    const int iy = oy * d.strideH + d.offsetH + ky;
+                    if (iy < 0 || iy >= d.inH)
+                        continue;
+                    const ElemType* inRow = pin + n * inSize + ((size_t)cb * d.inH + iy) * d.inW * BlockSize;
+                    for (int kx = 0; kx < d.kernelW; kx++)
+                    {
+                        int oxBegin, oxEnd;
+                        Convolution2DDims::GetValidOutputRange(kx, d.offsetW, d.strideW, d.inW, d.outW, oxBegin, oxEnd);
+                        const ElemType* w = pw + ((((size_t)kb * inBlocks + cb) * d.kernelH + ky) * d.kernelW + kx) * BlockSize * BlockSize;
+                        for (int ox = oxBegin; ox < oxEnd; ox++)
+                        {
+                            const ElemType* inPixel = inRow + (size_t)(ox * d.strideW + d.offsetW + kx) * BlockSize;
+                            ElemType* outPixel = outRow + (size_t)ox * BlockSize;
+                            for (int ci = 0; ci < BlockSize; ci++)
+                            {
+                                const ElemType v = inPixel[ci];
+                                const ElemType* wci = w + ci * BlockSize;
+                                for (int co = 0; co < BlockSize; co++)
+                                    outPixel[co] += v * wci[co];
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void BackwardDataCore(const Mat&, const Mat&, Mat&, Mat&) override
+    {
+        LogicError("Channel-blocked convolution engine supports only inference.");
+    }
+
+    void BackwardKernelCore(const Mat&, const Mat&, Mat&, bool, Mat&) override
+    {
+        LogicError("Channel-blocked convolution engine supports only inference.");
+    }
+
+    void EnsurePoolingInitialized() override
+    {
+    }
+
+    void ForwardPoolingCore(const Mat& in, Mat& out) override
+    {
+        const auto& d = m_dims;
+        const int blocks = d.inC / BlockSize;
+        const ElemType* pin = in.Data();
+        ElemType* pout = out.Data();
+        const size_t inSize = (size_t)d.inW * d.inH * d.inC;
+        const size_t outSize = (size_t)d.outW * d.outH * d.outC;
+        const size_t batchSize = in.GetNumCols();
+        const bool isMax = m_poolKind == PoolKind::Max;
+#pragma omp parallel for
+        for (long task = 0; task < (long)(batchSize * blocks * d.outH); task++)
+        {
+            const size_t n = task / (blocks * d.outH);
+            const int cb = (int)(task / d.outH % blocks);
+            const int oy = (int)(task % d.outH);
+            const ElemType* inMap = pin + n * inSize + (size_t)cb * d.inH * d.inW * BlockSize;
+            ElemType* outRow = pout + n * outSize + ((size_t)cb * d.outH + oy) * d.outW * BlockSize;
+            const int iyBegin = max(0, oy * d.strideH + d.offsetH);
+            const int iyEnd = min(d.inH, oy * d.strideH + d.offsetH + d.kernelH);
+            for (int ox = 0; ox < d.outW; ox++)
+            {
+                const int ixBegin = max(0, ox * d.strideW + d.offsetW);
+                const int ixEnd = min(d.inW, ox * d.strideW + d.offsetW + d.kernelW);
+                ElemType res[BlockSize];
+                for (int c = 0; c < BlockSize; c++)
+                    res[c] = isMax ? -std::numeric_limits<ElemType>::infinity() : 0;
+                for (int iy = iyBegin; iy < iyEnd; iy++)
+                {
+                    for (int ix = ixBegin; ix < ixEnd; ix++)
+                    {
+                        const ElemType* inPixel = inMap + ((size_t)iy * d.inW + ix) * BlockSize;
+                        if (isMax)
+                        {
+                            for (int c = 0; c < BlockSize; c++)
+                                res[c] = std::max(res[c], inPixel[c]);
+                        }
+                        else
+                        {
+                            for (int c = 0; c < BlockSize; c++)
+                                res[c] += inPixel[c];
+                        }
+                    }
+                }
+                // As in the reference engine, averages do not include the padding.
+                const ElemType scale = isMax ? 1 : (ElemType)1 / ((iyEnd - iyBegin) * (ixEnd - ixBegin));
+                ElemType* outPixel = outRow + (size_t)ox * BlockSize;
+                for (int c = 0; c < BlockSize; c++)
+                    outPixel[c] = res[c] * scale;
+            }
+        }
+    }
+
+    void BackwardPoolingCore(const Mat&, const Mat&, const Mat&, Mat&) override
+    {
+        LogicError("Channel-blocked convolution engine supports only inference.");
+    }
+
+    void MaxUnpoolingCore(const Mat&, const Mat&, Mat&) override
+    {
+        LogicError("Channel-blocked convolution engine supports only inference.");
+    }
+
+private:
+    Convolution2DDims m_dims;
+    bool m_isSupported;
+};
+
+template <class ElemType>
+bool ConvolutionEngine<ElemType>::IsChannelBlockedLayoutSupported(const ConvolveGeometry& geometry, DEVICEID_TYPE deviceId, PoolKind poolKind)
+{
+    return ChannelBlockedConvolutionEngine<ElemType>::IsSupported(geometry, deviceId, poolKind);
+}
+
+template <class ElemType>
+void ConvolutionEngine<ElemType>::ReorderChannelBlocks(const Mat& in, Mat& out, const TensorShape& imageShape, bool toChannelBlocks, bool accumulate)
+{
+    if (in.GetDeviceId() >= 0 || out.GetDeviceId() >= 0)
+        LogicError("ReorderChannelBlocks: The channel-blocked layout is supported only on CPU device.");
+    if (imageShape.GetRank() != 3 || imageShape[2] % ImageChannelBlockSize != 0)
+        LogicError("ReorderChannelBlocks: Image shape %s is not [W x H x C] with C a multiple of %d.", string(imageShape).c_str(), (int)ImageChannelBlockSize);
+    assert(in.GetNumRows() == imageShape.GetNumElements() && out.GetNumRows() == in.GetNumRows() && out.GetNumCols() == in.GetNumCols());
+
+    const size_t mapSize = imageShape[0] * imageShape[1];
+    const size_t numBlocks = imageShape[2] / ImageChannelBlockSize;
+    const ElemType* pin = in.Data();
+    ElemType* pout = out.Data();
+#pragma omp parallel for
+    for (long task = 0; task < (long)(in.GetNumCols() * numBlocks); task++)
+    {
+        // the channel block [mapSize x ImageChannelBlockSize] of planes against its interleaved form [ImageChannelBlockSize x mapSize]
+        const size_t offset = task * mapSize * ImageChannelBlockSize;
+        for (size_t c = 0; c < ImageChannelBlockSize; c++)
+        {
+            for (size_t i = 0; i < mapSize; i++)
+            {
+                size_t plane = offset + c * mapSize + i;
+                size_t blocked = offset + i * ImageChannelBlockSize + c;
+                size_t src = toChannelBlocks ? plane : blocked;
+                size_t dst = toChannelBlocks ? blocked : plane;
+                pout[dst] = accumulate ? pout[dst] + pin[src] : pin[src];
+            }
+        }
+    }
+}
+
+static std::atomic<bool> s_directAndWinogradConvolution(false);
+
+void SetDirectAndWinogradConvolution(bool enable)
+{
+    s_directAndWinogradConvolution = enable;
+}
+
+bool IsDirectAndWinogradConvolutionEnabled()
+{
+    return s_directAndWinogradConvolution;
+}
+
+//------------------------------------------------------------------
+// Autotuning of CPU convolution engines.
+// Instead of following the fixed order of Create(), the autotuning engine times every compatible CPU engine
+// on the first minibatch (and again whenever the minibatch size grows, as the cuDNN engine does) and keeps the fastest.
+// Every candidate runs once untimed, so that allocations and cold caches do not count, and is then timed twice.
+// The GEMM engine is timed with several values of maxTempMemSizeInSamples, none above the configured one.
+// Decisions are kept per process and, if a cache file is set, appended to it as "<key> <engine kind> <maxTempMemSizeInSamples>"
+// lines, where the key is a hash of the geometry, minibatch size, device, layout, element type and enabled engines.
+// Later runs start with the tuned engine immediately.
+//------------------------------------------------------------------
+struct ConvolutionTuningDecision
+{
+    ConvolutionEngineKind kind;
+    size_t maxTempMemSizeInSamples;
+};
+
+class ConvolutionTuningCache
+{
+public:
+    static ConvolutionTuningCache& Instance()
+    {
+        static ConvolutionTuningCache cache;
+        return cache;
+    }
+
+    void Reset(bool enabled, const std::wstring& filePath)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_enabled = enabled;
+        m_filePath = enabled ? filePath : L"";
+        m_decisions.clear();
+        if (m_filePath.empty())
+            return;
+
+        FILE* f = nullptr;
+        if (_wfopen_s(&f, m_filePath.c_str(), L"r") != 0 || f == nullptr)
+            return; // nothing tuned yet
+        unsigned long long key, maxTempMem;
+        int kind;
+        while (fscanf(f, "%llx %d %llu", &key, &kind, &maxTempMem) == 3)
+            m_decisions[key] = ConvolutionTuningDecision{(ConvolutionEngineKind)kind, (size_t)maxTempMem};
+        fclose(f);
+    }
+
+    bool IsEnabled() const
+    {
+        return m_enabled;
+    }
+
+    bool TryGet(uint64_t key, ConvolutionTuningDecision& decision)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto found = m_decisions.find(key);
+        if (found == m_decisions.end())
+            return false;
+        decision = found->second;
+        return true;
+    }
+
+    void Put(uint64_t key, const ConvolutionTuningDecision& decision)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_decisions[key] = decision;
+        if (m_filePath.empty())
+            return;
+
+        // Lines are appended, so a file shared by several processes at worst records a decision twice.
+        FILE* f = nullptr;
+        if (_wfopen_s(&f, m_filePath.c_str(), L"a") != 0 || f == nullptr)
+        {
+            fprintf(stderr, "WARNING: Could not write the convolution tuning cache (%ls).\n", m_filePath.c_str());
+            return;
+        }
+        fprintf(f, "%016llx %d %llu\n", (unsigned long long)key, (int)decision.kind, (unsigned long long)decision.maxTempMemSizeInSamples);
+        fclose(f);
+    }
+
+private:
+    ConvolutionTuningCache()
+        : m_enabled(false)
+    {
+    }
+
+    std::mutex m_mutex;
+    std::atomic<bool> m_enabled;
+    std::wstring m_filePath;
+    std::map<uint64_t, ConvolutionTuningDecision> m_decisions;
+};
+
+void SetConvolutionAutotuning(bool enable, const std::wstring& cacheFilePath)
+{
+    ConvolutionTuningCache::Instance().Reset(enable, cacheFilePath);
+}
+
+bool IsConvolutionAutotuningEnabled()
+{
+    return ConvolutionTuningCache::Instance().IsEnabled();
+}
+
+template <class ElemType>
+class AutotuningConvolutionEngine : public ConvolutionEngine<ElemType>
+{
+public:
+    using Base = ConvolutionEngine<ElemType>;
+    using typename Base::Mat;
+
+public:
+    AutotuningConvolutionEngine(ConvolveGeometryPtr geometry, DEVICEID_TYPE deviceId, ImageLayoutKind imageLayout, size_t maxTempMemSizeInSamples, PoolKind poolKind,
+                                ConvolutionEngineKind enabledEngines, const std::wstring& logPrefix)
+        : Base(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind), m_enabledEngines(enabledEngines), m_logPrefix(logPrefix), m_maxTunedBatchSize(0)
+    {
+    }
+
+    static bool IsSupported(DEVICEID_TYPE deviceId, ImageLayoutKind imageLayout, PoolKind poolKind)
+    {
+        return deviceId < 0 && imageLayout == ImageLayoutKind::CHW && poolKind == PoolKind::None;
+    }
+
+protected:
+    using Base::m_geometry;
+    using Base::m_deviceId;
+    using Base::m_imageLayout;
+    using Base::m_maxTempMemSizeInSamples;
+    using Base::m_poolKind;
+
+    void EnsureCompatible() override
+    {
+        if (!IsSupported(m_deviceId, m_imageLayout, m_poolKind))
+            LogicError("Autotuning convolution engine supports only convolutions in CHW/cudnn layout on CPU device.");
+    }
+
+    void EnsureConvolutionInitialized() override
+    {
+    }
+
+    void ForwardCore(const Mat& in, const Mat& kernel, Mat& out, Mat& workspace) override
+    {
+        EnsureTuned(in.GetNumCols(), kernel, workspace);
+        m_engine->Forward(in, kernel, out, workspace);
+    }
+
+    void BackwardDataCore(const Mat& srcGrad, const Mat& kernel, Mat& grad, Mat& workspace) override
+    {
+        EnsureTuned(srcGrad.GetNumCols(), kernel, workspace);
+        m_engine->BackwardData(srcGrad, kernel, grad, workspace);
+    }
+
+    void BackwardKernelCore(const Mat& srcGrad, const Mat& in, Mat& kernelGrad, bool allowReuse, Mat& workspace) override
+    {
+        EnsureTuned(srcGrad.GetNumCols(), kernelGrad, workspace);
+        m_engine->BackwardKernel(srcGrad, in, kernelGrad, allowReuse, workspace);
+    }
+
+    void EnsurePoolingInitialized() override
+    {
+        LogicError("Autotuning convolution engine does not support pooling.");
+    }
+
+    void ForwardPoolingCore(const Mat&, Mat&) override
+    {
+        LogicError("Autotuning convolution engine does not support pooling.");
+    }
+
+    void BackwardPoolingCore(const Mat&, const Mat&, const Mat&, Mat&) override
+    {
+        LogicError("Autotuning convolution engine does not support pooling.");
+    }
+
+    void MaxUnpoolingCore(const Mat&, const Mat&, Mat&) override
+    {
+        LogicError("Autotuning convolution engine does not support pooling.");
+    }
+
+private:
+    bool IsEnabled(ConvolutionEngineKind kind) const
+    {
+        return ((int)m_enabledEngines & (int)kind) != 0;
+    }
+
+    // Compatible engine configurations for the given minibatch size, the Reference engine last as it is the slowest.
+    std::vector<ConvolutionTuningDecision> GetCandidates(size_t batchSize) const
+    {
+        std::vector<ConvolutionTuningDecision> res;
+        bool useDirectAndWinograd = IsDirectAndWinogradConvolutionEnabled() || !IsEnabled(ConvolutionEngineKind::Gemm);
+        if (useDirectAndWinograd && IsEnabled(ConvolutionEngineKind::Winograd) && WinogradConvolutionEngine<ElemType>::IsSupported(m_deviceId, m_geometry, m_poolKind))
+            res.push_back(ConvolutionTuningDecision{ConvolutionEngineKind::Winograd, m_maxTempMemSizeInSamples});
+        if (useDirectAndWinograd && IsEnabled(ConvolutionEngineKind::Direct) && DirectConvolutionEngine<ElemType>::IsSupported(m_deviceId, m_geometry, m_poolKind))
+            res.push_back(ConvolutionTuningDecision{ConvolutionEngineKind::Direct, m_maxTempMemSizeInSamples});
+        if (IsEnabled(ConvolutionEngineKind::Gemm) && GemmConvolutionEngine<ElemType>::IsSupported(m_deviceId, m_geometry))
+        {
+            // Sub-batches trade the size of the unrolled input for the efficiency of the GEMM.
+            size_t maxSubBatchSize = m_maxTempMemSizeInSamples == 0 ? batchSize : min(batchSize, m_maxTempMemSizeInSamples);
+            std::vector<size_t> subBatchSizes;
+            for (size_t size : {(size_t)1, (size_t)4, (size_t)16, (size_t)64, maxSubBatchSize})
+            {
+                size = min(size, maxSubBatchSize);
+                if (std::find(subBatchSizes.begin(), subBatchSizes.end(), size) == subBatchSizes.end())
+                    subBatchSizes.push_back(size);
+            }
+            for (size_t size : subBatchSizes)
+                res.push_back(ConvolutionTuningDecision{ConvolutionEngineKind::Gemm, size == batchSize && m_maxTempMemSizeInSamples == 0 ? 0 : size});
+        }
+        if (IsEnabled(ConvolutionEngineKind::Reference))
+            res.push_back(ConvolutionTuningDecision{ConvolutionEngineKind::Reference, m_maxTempMemSizeInSamples});
+        return res;
+    }
+
+    std::unique_ptr<Base> CreateEngine(const ConvolutionTuningDecision& decision) const
+    {
+        switch (decision.kind)
+        {
+        case ConvolutionEngineKind::Winograd:
+            return std::make_unique<WinogradConvolutionEngine<ElemType>>(m_geometry, m_deviceId, m_imageLayout, decision.maxTempMemSizeInSamples, m_poolKind);
+        case ConvolutionEngineKind::Direct:
+            return std::make_unique<DirectConvolutionEngine<ElemType>>(m_geometry, m_deviceId, m_imageLayout, decision.maxTempMemSizeInSamples, m_poolKind);
+        case ConvolutionEngineKind::Gemm:
+            return std::make_unique<GemmConvolutionEngine<ElemType>>(m_geometry, m_deviceId, m_imageLayout, decision.maxTempMemSizeInSamples, m_poolKind);
+        case ConvolutionEngineKind::Reference:
+            return std::make_unique<ReferenceConvolutionEngine<ElemType>>(m_geometry, m_deviceId, m_imageLayout, decision.maxTempMemSizeInSamples, m_poolKind);
+        default:
+            LogicError("Unexpected convolution engine kind %d.", (int)decision.kind);
+        }
+    }
+
+    uint64_t GetTuningKey(size_t batchSize) const
+    {
+        std::string key = (std::string)*m_geometry + ", Batch: " + std::to_string(batchSize) + ", Device: " + std::to_string(m_deviceId) +
+                          ", Layout: " + std::to_string((int)m_imageLayout) + ", ElemSize: " + std::to_string(sizeof(ElemType)) +
+                          ", Engines: " + std::to_string((int)m_enabledEngines) + ", DirectAndWinograd: " + std::to_string((int)IsDirectAndWinogradConvolutionEnabled()) +
+                          ", MaxTempMem: " + std::to_string(m_maxTempMemSizeInSamples);
+        // FNV-1a, so that keys are stable across builds and platforms
+        uint64_t hash = 14695981039346656037ull;
+        for (char c : key)
+            hash = (hash ^ (unsigned char)c) * 1099511628211ull;
+        return hash;
+    }
+
+    // Runs all three convolution passes on scratch buffers and returns the elapsed time in seconds.
+    // Stops early, returning a value above 'limit', once the candidate is slower than 'limit'.
+    static double TimeEngine(Base& engine, const Mat& kernel, Mat& in, Mat& out, Mat& grad, Mat& kernelGrad, Mat& workspace, double limit)
+    {
+        using Clock = std::chrono::steady_clock;
+        auto start = Clock::now();
+        auto elapsed = [&] { return std::chrono::duration<double>(Clock::now() - start).count(); };
+        engine.Forward(in, kernel, out, workspace);
+        if (elapsed() > limit)
+            return elapsed();
+        engine.BackwardData(out, kernel, grad, workspace);
+        if (elapsed() > limit)
+            return elapsed();
+        engine.BackwardKernel(out, in, kernelGrad, false, workspace);
+        return elapsed();
+    }
+
+    void EnsureTuned(size_t batchSize, const Mat& kernel, Mat& workspace)
+    {
+        // Same policy as the cuDNN auto-tuner: retune only when the minibatch grows.
+        if (m_engine != nullptr && batchSize <= m_maxTunedBatchSize)
+            return;
+
+        auto candidates = GetCandidates(batchSize);
+        if (candidates.empty())
+            RuntimeError("Autotuning found no enabled convolution engine that supports geometry: %s", ((std::string)*m_geometry).c_str());
+
+        uint64_t key = GetTuningKey(batchSize);
+        ConvolutionTuningDecision best;
+        bool isCached = ConvolutionTuningCache::Instance().TryGet(key, best) &&
+                        std::any_of(candidates.begin(), candidates.end(), [&](const ConvolutionTuningDecision& c) { return c.kind == best.kind; });
+        if (!isCached)
+        {
+            const auto& g = *m_geometry;
+            Mat in(g.InputShape().GetNumElements(), batchSize, m_deviceId);
+            Mat out(g.OutputShape().GetNumElements(), batchSize, m_deviceId);
+            Mat grad(g.InputShape().GetNumElements(), batchSize, m_deviceId);
+            Mat kernelGrad(kernel.GetNumRows(), kernel.GetNumCols(), m_deviceId);
+            in.SetValue(1);
+            grad.SetValue(0);
+            kernelGrad.SetValue(0);
+
+            double bestTime = std::numeric_limits<double>::max();
+            for (const auto& candidate : candidates)
+            {
+                auto engine = CreateEngine(candidate);
+                TimeEngine(*engine, kernel, in, out, grad, kernelGrad, workspace, bestTime); // warm-up
+                double time = TimeEngine(*engine, kernel, in, out, grad, kernelGrad, workspace, bestTime);
+                if (time < bestTime)
+                    time = min(time, TimeEngine(*engine, kernel, in, out, grad, kernelGrad, workspace, bestTime));
+                if (GetMathLibTraceLevel() > 0)
+                    fprintf(stderr, "%lsautotuning: engine %d, maxTempMemSizeInSamples %d: %.3f ms.\n", m_logPrefix.c_str(), (int)candidate.kind, (int)candidate.maxTempMemSizeInSamples, time * 1000);
+                if (time < bestTime)
+                {
+                    bestTime = time;
+                    best = candidate;
+                }
+            }
+            ConvolutionTuningCache::Instance().Put(key, best);
+        }
+
+        if (GetMathLibTraceLevel() > 0)
+            fprintf(stderr, "%lsautotuning %s engine %d (maxTempMemSizeInSamples %d) for minibatch size %d and geometry: %s.\n", m_logPrefix.c_str(),
+                    isCached ? "restored" : "selected", (int)best.kind, (int)best.maxTempMemSizeInSamples, (int)batchSize, ((std::string)*m_geometry).c_str());
+        m_engine = CreateEngine(best);
+        m_maxTunedBatchSize = batchSize;
+    }
+
+    ConvolutionEngineKind m_enabledEngines;
+    std::wstring m_logPrefix;
+    std::unique_ptr<Base> m_engine;
+    size_t m_maxTunedBatchSize;
+};
+
 template <class ElemType>
 std::unique_ptr<ConvolutionEngine<ElemType>> ConvolutionEngine<ElemType>::Create(ConvolveGeometryPtr geometry, DEVICEID_TYPE deviceId,
                                                                                  ImageLayoutKind imageLayout, size_t maxTempMemSizeInSamples, PoolKind poolKind,
@@ -861,6 +1970,14 @@ std::unique_ptr<ConvolutionEngine<ElemType>> ConvolutionEngine<ElemType>::Create
     // can be called from places like MEL with default parameters and never be used. 
     // The check will be done later in engine's EnsureCompatible call if the egnine is actually used.
     auto engStr = (std::string)(*geometry);
+    if (imageLayout == ImageLayoutKind::CHWc)
+    {
+        if (GetMathLibTraceLevel() > 0)
+            fprintf(stderr, "%lsusing channel-blocked convolution engine for geometry: %s.\n", logPrefix.c_str(), engStr.c_str());
+
+        return std::make_unique<ChannelBlockedConvolutionEngine<ElemType>>(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind);
+    }
+
     // Only legacy engine supports HWC layout.
     if (imageLayout == ImageLayoutKind::HWC)
     {
@@ -883,6 +2000,36 @@ std::unique_ptr<ConvolutionEngine<ElemType>> ConvolutionEngine<ElemType>::Create
         return CuDnnConvolutionEngineFactory<ElemType>::Create(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind, forceDeterministicAlgorithms);
     }
 
+    // With autotuning, the CPU engine is chosen by timing the compatible ones on the first minibatch,
+    // unless the caller asked for a single engine.
+    bool isSingleEngine = ((int)enabledEngines & ((int)enabledEngines - 1)) == 0;
+    if (IsConvolutionAutotuningEnabled() && !isSingleEngine && AutotuningConvolutionEngine<ElemType>::IsSupported(deviceId, imageLayout, poolKind))
+    {
+        if (GetMathLibTraceLevel() > 0)
+            fprintf(stderr, "%lsusing autotuning convolution engine for geometry: %s.\n", logPrefix.c_str(), engStr.c_str());
+
+        return std::make_unique<AutotuningConvolutionEngine<ElemType>>(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind, enabledEngines, logPrefix);
+    }
+
+    // On the CPU, prefer the engines that need no unrolled input where they apply, if they are enabled (see SetDirectAndWinogradConvolution()).
+    bool useDirectAndWinograd = IsDirectAndWinogradConvolutionEnabled() || !isEnabled(ConvolutionEngineKind::Gemm);
+    if (useDirectAndWinograd && isEnabled(ConvolutionEngineKind::Winograd) && WinogradConvolutionEngine<ElemType>::IsSupported(deviceId, geometry, poolKind))
+    {
+        if (GetMathLibTraceLevel() > 0)
+            fprintf(stderr, "%lsusing Winograd convolution engine for geometry: %s.\n", logPrefix.c_str(), engStr.c_str());
+
+        return std::make_unique<WinogradConvolutionEngine<ElemType>>(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind);
+    }
+
+    if (useDirectAndWinograd && isEnabled(ConvolutionEngineKind::Direct) && DirectConvolutionEngine<ElemType>::IsSupported(deviceId, geometry, poolKind) &&
+        (!isEnabled(ConvolutionEngineKind::Gemm) || DirectConvolutionEngine<ElemType>::IsPreferred(geometry)))
+    {
+        if (GetMathLibTraceLevel() > 0)
+            fprintf(stderr, "%lsusing direct convolution engine for geometry: %s.\n", logPrefix.c_str(), engStr.c_str());
+
+        return std::make_unique<DirectConvolutionEngine<ElemType>>(geometry, deviceId, imageLayout, maxTempMemSizeInSamples, poolKind);
+    }
+
     if (isEnabled(ConvolutionEngineKind::Gemm) && GemmConvolutionEngine<ElemType>::IsSupported(deviceId, geometry))
     {
         if (GetMathLibTraceLevel() > 0)
@@ -9,6 +9,7 @@
 #include "TensorShape.h" // for ImageLayoutKind
 #include "ConvolveGeometry.h"
 #include "StringUtil.h"
+#include "QuantizedMultiplier.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -22,8 +23,10 @@ enum class ConvolutionEngineKind
     CuDnn     = 1 << 1, // cuDNN, works only for 2D/3D convos with full sharing.
     Legacy    = 1 << 2, // Legacy, for backwards compatibility. REVIEW alexeyk: implement sparse version and remove Legacy altogether.
     Gemm      = 1 << 3, // Uses convolution unrolling+GEMM technique. Works only for convos with full sharing.
+    Direct    = 1 << 4, // Direct loops over the kernel without unrolling, CPU only. Works only for 2D convos with full sharing.
+    Winograd  = 1 << 5, // Winograd F(2x2,3x3) forward pass, CPU only. Works only for 2D convos with 3x3 kernels and stride 1.
 
-    All       = Reference | CuDnn | Legacy | Gemm
+    All       = Reference | CuDnn | Legacy | Gemm | Direct | Winograd
 };
 
 enum class PoolKind
@@ -47,6 +50,10 @@ public:
 
     void Forward(const Mat& in, const Mat& kernel, Mat& out, Mat& workspace);
 
+    // Forward() with the products computed by an 8-bit integer GEMM on a quantized copy of the kernel that the multiplier caches.
+    // Supported by the GEMM engine only, see Create() for how to request it.
+    void ForwardQuantized(const Mat& in, const Mat& kernel, Mat& out, Mat& workspace, Int8QuantizedMultiplier<ElemType>& multiplier);
+
     void BackwardData(const Mat& srcGrad, const Mat& kernel, Mat& grad, Mat& workspace);
 
     void BackwardKernel(const Mat& srcGrad, const Mat& in, Mat& kernelGrad, bool allowReuse, Mat& workspace);
@@ -64,6 +71,13 @@ public:
                                                                ConvolutionEngineKind enabledEngines = ConvolutionEngineKind::All,
                                                                std::wstring logPrefix = L"", bool forceDeterministicAlgorithms = false);
 
+    // Whether Create() with ImageLayoutKind::CHWc returns an engine that supports this convolution or pooling.
+    static bool IsChannelBlockedLayoutSupported(const ConvolveGeometry& geometry, DEVICEID_TYPE deviceId, PoolKind poolKind);
+
+    // Converts a minibatch of [W x H x C] images from the cudnn layout to the channel-blocked layout ImageLayoutKind::CHWc, or back.
+    // CPU only. 'out' must have the dimensions of 'in'. If 'accumulate' is true, the result is added to 'out'.
+    static void ReorderChannelBlocks(const Mat& in, Mat& out, const TensorShape& imageShape, bool toChannelBlocks, bool accumulate = false);
+
     DISABLE_COPY_AND_MOVE(ConvolutionEngine);
 
     // REVIEW alexeyk: This is not enough as there should be invalidation of auto-tuner state in cuDNN engine. Fine for now if it works.
@@ -85,6 +99,8 @@ protected:
 
     virtual void ForwardCore(const Mat& in, const Mat& kernel, Mat& out, Mat& workspace) = 0;
 
+    virtual void ForwardQuantizedCore(const Mat& in, const Mat& kernel, Mat& out, Mat& workspace, Int8QuantizedMultiplier<ElemType>& multiplier);
+
     virtual void BackwardDataCore(const Mat& srcGrad, const Mat& kernel, Mat& grad, Mat& workspace) = 0;
 
     virtual void BackwardKernelCore(const Mat& srcGrad, const Mat& in, Mat& kernelGrad, bool allowReuse, Mat& workspace) = 0;
@@ -107,6 +123,18 @@ protected:
 
 #pragma warning(pop)
 
+// Enables or disables autotuning of CPU convolution engines: Create() then returns an engine that times all compatible
+// engines on the first minibatch and uses the fastest. If cacheFilePath is not empty, the decisions are loaded from and
+// appended to that file, so that later runs skip the timing.
+MATH_API void SetConvolutionAutotuning(bool enable, const std::wstring& cacheFilePath = L"");
+MATH_API bool IsConvolutionAutotuningEnabled();
+
+// Lets Create() and the autotuning choose the direct and Winograd CPU engines where they apply, training included. They are
+// off by default since they round differently than the GEMM engine that existing models were trained with. Callers that
+// disable the GEMM engine get them regardless.
+MATH_API void SetDirectAndWinogradConvolution(bool enable);
+MATH_API bool IsDirectAndWinogradConvolutionEnabled();
+
 static inline PoolKind PoolKindFrom(const wstring& s)
 {
     if (s.empty() || AreEqualIgnoreCase(s, L"none"))
@@ -611,6 +611,9 @@ public:
     template <typename T>
     friend class QuantizedMatrix;
 
+    template <typename T>
+    friend class ReducedPrecisionMultiplier;
+
     template <typename T>
     friend class Matrix;
 };
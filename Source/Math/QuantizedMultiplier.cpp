@@ -0,0 +1,496 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#include "QuantizedMultiplier.h"
+#include "CPUSparseMatrix.h"
+#include "Quantizers.h"
+#include "CPUKernels.h"
+#include <climits>
+#include <omp.h>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+typedef int16_t QuantizedType;
+
+template <class ElemType>
+struct QuantizedMultiplier<ElemType>::PreparedOperand
+{
+    PreparedOperand(size_t extraBits)
+        : m_gemm(GetCPUKernels().CreateInt16BlockGemm(omp_get_max_threads())), m_preparedA(nullptr), m_extraBits(extraBits), m_inverseFactorA(0)
+    {
+    }
+
+    ~PreparedOperand()
+    {
+        if (m_preparedA)
+            m_gemm->FreePreparedB(m_preparedA);
+    }
+
+    // the block multiplier that prepared A and releases it
+    std::unique_ptr<IBlockGemm<QuantizedType>> m_gemm;
+
+    // op(A)^T as [inner x rows] row-major matrix, rewritten in block order by PrepareB().
+    // Note that a column-major op(A) is exactly the row-major op(A)^T the block multiplier expects.
+    QuantizedType* m_preparedA;
+    size_t m_extraBits; // headroom used for both operands
+    ElemType m_inverseFactorA;
+};
+
+template <class ElemType>
+struct QuantizedMultiplier<ElemType>::Impl
+{
+    Impl()
+        : m_gemm(GetCPUKernels().CreateInt16BlockGemm(omp_get_max_threads()))
+    {
+    }
+
+    // the block multiplier for the instruction set of this processor
+    std::unique_ptr<IBlockGemm<QuantizedType>> m_gemm;
+
+    // scratch buffers reused across calls
+    std::vector<QuantizedType> m_quantizedB;
+    std::vector<int32_t> m_result;
+};
+
+template <class ElemType>
+static ElemType AbsMax(const ElemType* data, size_t size)
+{
+    ElemType absMax = 0;
+    for (size_t i = 0; i < size; i++)
+        absMax = std::max(absMax, (ElemType)fabs(data[i]));
+    return absMax;
+}
+
+// Each product of two quantized values is below 2^(30 - 2 * extraBits), and 'inner' of them are summed up
+// in an int32 accumulator. Returns the headroom that guarantees the sum does not overflow.
+static size_t GetExtraBitsForInnerDimension(size_t inner, size_t minExtraBits)
+{
+    size_t log2Inner = 0;
+    while (((size_t)1 << log2Inner) < inner)
+        log2Inner++;
+    return std::max(minExtraBits, (log2Inner + 1) / 2);
+}
+
+template <class ElemType>
+QuantizedMultiplier<ElemType>::QuantizedMultiplier(size_t extraBits, const std::shared_ptr<Cache>& cache)
+    : m_cache(cache ? cache : std::make_shared<Cache>()), m_extraBits(extraBits)
+{
+}
+
+template <class ElemType>
+QuantizedMultiplier<ElemType>::~QuantizedMultiplier()
+{
+}
+
+template <class ElemType>
+void QuantizedMultiplier<ElemType>::Reset()
+{
+    m_cache->Reset();
+}
+
+template <class ElemType>
+bool QuantizedMultiplier<ElemType>::IsPrepared() const
+{
+    return m_cache->IsPrepared();
+}
+
+template <class ElemType>
+void QuantizedMultiplier<ElemType>::Multiply(const Matrix<ElemType>& A, bool transposeA, const Matrix<ElemType>& B, Matrix<ElemType>& C)
+{
+    const size_t rows  = transposeA ? A.GetNumCols() : A.GetNumRows();
+    const size_t inner = transposeA ? A.GetNumRows() : A.GetNumCols();
+    const size_t cols  = B.GetNumCols();
+
+    if (B.GetNumRows() != inner || C.GetNumRows() != rows || C.GetNumCols() != cols)
+        InvalidArgument("QuantizedMultiplier: Dimensions of op(A) [%d x %d], B [%d x %d] and C [%d x %d] do not match.",
+                        (int)rows, (int)inner, (int)B.GetNumRows(), (int)cols, (int)C.GetNumRows(), (int)C.GetNumCols());
+
+    bool isSupported = A.GetDeviceId() == CPUDEVICE && B.GetDeviceId() == CPUDEVICE && C.GetDeviceId() == CPUDEVICE &&
+                       A.GetMatrixType() == DENSE && B.GetMatrixType() == DENSE && C.GetMatrixType() == DENSE &&
+                       rows * inner <= INT_MAX && inner * cols <= INT_MAX && rows * cols <= INT_MAX;
+    if (!isSupported)
+    {
+        Matrix<ElemType>::MultiplyAndWeightedAdd(1, A, transposeA, B, false, 0, C);
+        return;
+    }
+
+    if (rows == 0 || cols == 0)
+        return;
+
+    // Quantize A once and keep it in block order.
+    auto preparedA = m_cache->Get(A.Data(), rows, inner, transposeA, m_extraBits, [&]()
+    {
+        std::shared_ptr<PreparedOperand> prepared = std::make_shared<PreparedOperand>(GetExtraBitsForInnerDimension(inner, m_extraBits));
+        std::vector<ElemType> rowMajorA(rows * inner);
+        const ElemType* dataA = A.Data();
+        if (!transposeA)
+            std::copy(dataA, dataA + rows * inner, rowMajorA.begin());
+        else // A is [inner x rows] column-major, op(A)^T as [inner x rows] row-major requires a transposition
+        {
+            for (size_t i = 0; i < inner; i++)
+                for (size_t j = 0; j < rows; j++)
+                    rowMajorA[i * rows + j] = dataA[j * inner + i];
+        }
+
+        ElemType absMaxA = AbsMax(rowMajorA.data(), rowMajorA.size());
+        if (absMaxA == 0)
+            absMaxA = 1; // all zeros, any range will do
+
+        std::vector<QuantizedType> quantizedA(rowMajorA.size());
+        SymmetricQuantizer<ElemType, QuantizedType> quantizerA(absMaxA, prepared->m_extraBits);
+        ArrayRef<ElemType> rawA(rowMajorA.data(), rowMajorA.size());
+        ArrayRef<QuantizedType> outA(quantizedA.data(), quantizedA.size());
+        quantizerA.Quantize(rawA, outA);
+
+        prepared->m_preparedA = prepared->m_gemm->PrepareB(quantizedA.data(), (int)inner, (int)rows);
+        prepared->m_inverseFactorA = quantizerA.GetInverseQuantizeFactor();
+        return prepared;
+    });
+
+    // B is [inner x cols] column-major, i.e. the row-major [cols x inner] left operand of the block multiplier.
+    const size_t sizeB = inner * cols;
+    const ElemType* dataB = B.Data();
+    ElemType absMaxB = AbsMax(dataB, sizeB);
+    if (absMaxB == 0)
+    {
+        C.SetValue(0);
+        return;
+    }
+
+    if (!m_impl)
+        m_impl.reset(new Impl());
+    m_impl->m_quantizedB.resize(sizeB);
+    SymmetricQuantizer<ElemType, QuantizedType> quantizerB(absMaxB, preparedA->m_extraBits);
+    ArrayRef<ElemType> rawB(const_cast<ElemType*>(dataB), sizeB);
+    ArrayRef<QuantizedType> outB(m_impl->m_quantizedB.data(), sizeB);
+    quantizerB.Quantize(rawB, outB);
+
+    // The block multiplier accumulates into the result, so it must start at zero.
+    m_impl->m_result.assign(rows * cols, 0);
+    m_impl->m_gemm->MultiplyMatrices(m_impl->m_quantizedB.data(), (int)cols, (int)inner, preparedA->m_preparedA, (int)rows, m_impl->m_result.data());
+
+    // The row-major [cols x rows] result is the column-major [rows x cols] C.
+    const ElemType scale = preparedA->m_inverseFactorA * quantizerB.GetInverseQuantizeFactor();
+    ElemType* dataC = C.Data();
+    const int32_t* result = m_impl->m_result.data();
+#pragma omp parallel for
+    for (long i = 0; i < (long)(rows * cols); i++)
+        dataC[i] = result[i] * scale;
+}
+
+template class QuantizedMultiplier<float>;
+template class QuantizedMultiplier<double>;
+
+template <class ElemType>
+struct Int8QuantizedMultiplier<ElemType>::PreparedOperand
+{
+    PreparedOperand()
+        : m_gemm(GetCPUKernels().CreateInt8BlockGemm(omp_get_max_threads())), m_preparedA(nullptr)
+    {
+    }
+
+    ~PreparedOperand()
+    {
+        if (m_preparedA)
+            m_gemm->FreePreparedB(m_preparedA);
+    }
+
+    std::unique_ptr<IBlockGemm<int8_t>> m_gemm;
+
+    // op(A)^T as [inner x rows] row-major matrix in block order, see QuantizedMultiplier::PreparedOperand
+    int8_t* m_preparedA;
+    std::vector<ElemType> m_inverseFactorsA; // one per row of op(A)
+};
+
+template <class ElemType>
+struct Int8QuantizedMultiplier<ElemType>::Impl
+{
+    Impl()
+        : m_gemm(GetCPUKernels().CreateInt8BlockGemm(omp_get_max_threads()))
+    {
+    }
+
+    std::unique_ptr<IBlockGemm<int8_t>> m_gemm;
+
+    // scratch buffers reused across calls
+    std::vector<int8_t> m_quantizedB;
+    std::vector<int32_t> m_result;
+};
+
+template <class ElemType>
+Int8QuantizedMultiplier<ElemType>::Int8QuantizedMultiplier(double inputRange, const std::shared_ptr<Cache>& cache)
+    : m_cache(cache ? cache : std::make_shared<Cache>()), m_inputRange(inputRange)
+{
+    if (inputRange < 0)
+        InvalidArgument("Int8QuantizedMultiplier: The input range must not be negative.");
+}
+
+template <class ElemType>
+Int8QuantizedMultiplier<ElemType>::~Int8QuantizedMultiplier()
+{
+}
+
+template <class ElemType>
+void Int8QuantizedMultiplier<ElemType>::Reset()
+{
+    m_cache->Reset();
+}
+
+template <class ElemType>
+bool Int8QuantizedMultiplier<ElemType>::IsPrepared() const
+{
+    return m_cache->IsPrepared();
+}
+
+template <class ElemType>
+void Int8QuantizedMultiplier<ElemType>::Multiply(const Matrix<ElemType>& A, bool transposeA, const Matrix<ElemType>& B, Matrix<ElemType>& C)
+{
+    const size_t rows  = transposeA ? A.GetNumCols() : A.GetNumRows();
+    const size_t inner = transposeA ? A.GetNumRows() : A.GetNumCols();
+    const size_t cols  = B.GetNumCols();
+
+    if (B.GetNumRows() != inner || C.GetNumRows() != rows || C.GetNumCols() != cols)
+        InvalidArgument("Int8QuantizedMultiplier: Dimensions of op(A) [%d x %d], B [%d x %d] and C [%d x %d] do not match.",
+                        (int)rows, (int)inner, (int)B.GetNumRows(), (int)cols, (int)C.GetNumRows(), (int)C.GetNumCols());
+
+    // The int32 sums of 'inner' products of up to 127 * 127 must not overflow.
+    bool isSupported = A.GetDeviceId() == CPUDEVICE && B.GetDeviceId() == CPUDEVICE && C.GetDeviceId() == CPUDEVICE &&
+                       A.GetMatrixType() == DENSE && B.GetMatrixType() == DENSE && C.GetMatrixType() == DENSE &&
+                       rows * inner <= INT_MAX && inner * cols <= INT_MAX && rows * cols <= INT_MAX && inner * 127 * 127 <= INT_MAX;
+    if (!isSupported)
+    {
+        Matrix<ElemType>::MultiplyAndWeightedAdd(1, A, transposeA, B, false, 0, C);
+        return;
+    }
+
+    if (rows == 0 || cols == 0)
+        return;
+
+    // Quantize A once with one range per row of op(A), i.e. per column of the row-major op(A)^T, and keep it in block order.
+    auto preparedA = m_cache->Get(A.Data(), rows, inner, transposeA, 0, [&]()
+    {
+        std::shared_ptr<PreparedOperand> prepared = std::make_shared<PreparedOperand>();
+        std::vector<ElemType> rowMajorA(rows * inner);
+        const ElemType* dataA = A.Data();
+        if (!transposeA)
+            std::copy(dataA, dataA + rows * inner, rowMajorA.begin());
+        else
+        {
+            for (size_t i = 0; i < inner; i++)
+                for (size_t j = 0; j < rows; j++)
+                    rowMajorA[i * rows + j] = dataA[j * inner + i];
+        }
+
+        std::vector<int8_t> quantizedA(rowMajorA.size());
+        ChannelwiseInt8Quantizer<ElemType> quantizerA(rows, 1);
+        ArrayRef<ElemType> rawA(rowMajorA.data(), rowMajorA.size());
+        ArrayRef<int8_t> outA(quantizedA.data(), quantizedA.size());
+        quantizerA.Quantize(rawA, outA);
+
+        prepared->m_preparedA = prepared->m_gemm->PrepareB(quantizedA.data(), (int)inner, (int)rows);
+        prepared->m_inverseFactorsA = quantizerA.GetInverseQuantizeFactors();
+        return prepared;
+    });
+
+    const size_t sizeB = inner * cols;
+    const ElemType* dataB = B.Data();
+    ElemType rangeB = (ElemType)m_inputRange;
+    if (rangeB == 0)
+        rangeB = AbsMax(dataB, sizeB);
+    if (rangeB == 0)
+    {
+        C.SetValue(0);
+        return;
+    }
+
+    // Values beyond a calibrated range are clipped.
+    const ElemType factorB = 127 / rangeB;
+    if (!m_impl)
+        m_impl.reset(new Impl());
+    m_impl->m_quantizedB.resize(sizeB);
+    int8_t* quantizedB = m_impl->m_quantizedB.data();
+#pragma omp parallel for
+    for (long i = 0; i < (long)sizeB; i++)
+        quantizedB[i] = (int8_t)std::max((ElemType)-127, std::min((ElemType)127, (ElemType)round(dataB[i] * factorB)));
+
+    m_impl->m_result.assign(rows * cols, 0);
+    m_impl->m_gemm->MultiplyMatrices(quantizedB, (int)cols, (int)inner, preparedA->m_preparedA, (int)rows, m_impl->m_result.data());
+
+    // The row-major [cols x rows] result is the column-major [rows x cols] C, row i of C has the range of row i of op(A).
+    const ElemType inverseFactorB = rangeB / 127;
+    const ElemType* inverseFactorsA = preparedA->m_inverseFactorsA.data();
+    ElemType* dataC = C.Data();
+    const int32_t* result = m_impl->m_result.data();
+#pragma omp parallel for
+    for (long i = 0; i < (long)(rows * cols); i++)
+        dataC[i] = result[i] * inverseFactorsA[i % rows] * inverseFactorB;
+}
+
+template class Int8QuantizedMultiplier<float>;
+template class Int8QuantizedMultiplier<double>;
+
+template <class ElemType>
+struct ReducedPrecisionMultiplier<ElemType>::PreparedOperand
+{
+    PreparedOperand(size_t rows, size_t inner)
+    {
+        // Panels of about 256 KB in ElemType stay in the cache between their conversion and their multiplication.
+        m_panelRows = std::max((size_t)16, (256 * 1024 / sizeof(ElemType)) / std::max(inner, (size_t)1));
+        m_panelRows = std::min(m_panelRows, rows);
+    }
+
+    // op(A) in panels of m_panelRows rows (the last one may have fewer), each a column-major [panel rows x inner] matrix
+    std::vector<uint16_t> m_packedA;
+    size_t m_panelRows;
+};
+
+// C(:, j) = sum of B(k, j) * op(A)(:, k) over the nonzero elements of column j of the CSC matrix B, with op(A) in the
+// panels of ReducedPrecisionMultiplier. Column k of a panel is contiguous, so only the columns that B selects are converted.
+template <class ElemType, float (*toFloat)(uint16_t)>
+static void MultiplySparse(const uint16_t* packedA, size_t rows, size_t inner, size_t panelRowsMax, const CPUSparseMatrix<ElemType>& B, ElemType* dataC)
+{
+    const ElemType* values = B.Buffer() + B.SecondaryIndexLocation()[0];
+    const CPUSPARSE_INDEX_TYPE* rowIndices = B.MajorIndexLocation();
+    const CPUSPARSE_INDEX_TYPE* colStarts = B.SecondaryIndexLocation();
+#pragma omp parallel for
+    for (long j = 0; j < (long)B.GetNumCols(); j++)
+    {
+        ElemType* column = dataC + j * rows;
+        std::fill(column, column + rows, (ElemType)0);
+        for (auto p = colStarts[j] - colStarts[0]; p < colStarts[j + 1] - colStarts[0]; p++)
+        {
+            const size_t k = rowIndices[p];
+            const ElemType value = values[p];
+            for (size_t first = 0; first < rows; first += panelRowsMax)
+            {
+                const size_t panelRows = std::min(panelRowsMax, rows - first);
+                const uint16_t* packedColumn = packedA + first * inner + k * panelRows;
+                for (size_t r = 0; r < panelRows; r++)
+                    column[first + r] += value * (ElemType)toFloat(packedColumn[r]);
+            }
+        }
+    }
+}
+
+template <class ElemType>
+struct ReducedPrecisionMultiplier<ElemType>::Impl
+{
+    // scratch buffers reused across calls
+    std::vector<ElemType> m_panel;
+    std::vector<ElemType> m_panelResult;
+};
+
+template <class ElemType>
+ReducedPrecisionMultiplier<ElemType>::ReducedPrecisionMultiplier(ReducedPrecisionFormat format, const std::shared_ptr<Cache>& cache)
+    : m_cache(cache ? cache : std::make_shared<Cache>()), m_format(format)
+{
+    if (format == ReducedPrecisionFormat::none)
+        InvalidArgument("ReducedPrecisionMultiplier: A 16-bit format is required.");
+}
+
+template <class ElemType>
+ReducedPrecisionMultiplier<ElemType>::~ReducedPrecisionMultiplier()
+{
+}
+
+template <class ElemType>
+void ReducedPrecisionMultiplier<ElemType>::Reset()
+{
+    m_cache->Reset();
+}
+
+template <class ElemType>
+bool ReducedPrecisionMultiplier<ElemType>::IsPrepared() const
+{
+    return m_cache->IsPrepared();
+}
+
+template <class ElemType>
+void ReducedPrecisionMultiplier<ElemType>::Multiply(const Matrix<ElemType>& A, bool transposeA, const Matrix<ElemType>& B, Matrix<ElemType>& C)
+{
+    const size_t rows  = transposeA ? A.GetNumCols() : A.GetNumRows();
+    const size_t inner = transposeA ? A.GetNumRows() : A.GetNumCols();
+    const size_t cols  = B.GetNumCols();
+
+    if (B.GetNumRows() != inner || C.GetNumRows() != rows || C.GetNumCols() != cols)
+        InvalidArgument("ReducedPrecisionMultiplier: Dimensions of op(A) [%d x %d], B [%d x %d] and C [%d x %d] do not match.",
+                        (int)rows, (int)inner, (int)B.GetNumRows(), (int)cols, (int)C.GetNumRows(), (int)C.GetNumCols());
+
+    const bool isSparseB = B.GetMatrixType() == SPARSE && B.GetFormat() == matrixFormatSparseCSC;
+    bool isSupported = A.GetDeviceId() == CPUDEVICE && B.GetDeviceId() == CPUDEVICE && C.GetDeviceId() == CPUDEVICE &&
+                       A.GetMatrixType() == DENSE && (B.GetMatrixType() == DENSE || isSparseB) && C.GetMatrixType() == DENSE;
+    if (!isSupported)
+    {
+        Matrix<ElemType>::MultiplyAndWeightedAdd(1, A, transposeA, B, false, 0, C);
+        return;
+    }
+
+    if (rows == 0 || cols == 0)
+        return;
+
+    // Pack op(A) once, panel by panel.
+    auto preparedA = m_cache->Get(A.Data(), rows, inner, transposeA, (size_t)m_format, [&]()
+    {
+        std::shared_ptr<PreparedOperand> prepared = std::make_shared<PreparedOperand>(rows, inner);
+        prepared->m_packedA.resize(rows * inner);
+        const ElemType* dataA = A.Data();
+        std::vector<ElemType> panel(prepared->m_panelRows * inner);
+        for (size_t first = 0; first < rows; first += prepared->m_panelRows)
+        {
+            const size_t panelRows = std::min(prepared->m_panelRows, rows - first);
+            const long panelSize = (long)(panelRows * inner);
+#pragma omp parallel for
+            for (long i = 0; i < panelSize; i++)
+            {
+                // element (r, j) of the panel is op(A)(first + r, j)
+                const size_t r = i % panelRows, j = i / panelRows;
+                panel[i] = transposeA ? dataA[(first + r) * inner + j] : dataA[j * rows + first + r];
+            }
+            ConvertToReducedPrecision(m_format, panel.data(), prepared->m_packedA.data() + first * inner, panelSize);
+        }
+        return prepared;
+    });
+
+    if (isSparseB)
+    {
+        if (m_format == ReducedPrecisionFormat::float16)
+            MultiplySparse<ElemType, Float16ToFloat>(preparedA->m_packedA.data(), rows, inner, preparedA->m_panelRows, *B.m_CPUSparseMatrix, C.Data());
+        else
+            MultiplySparse<ElemType, BFloat16ToFloat>(preparedA->m_packedA.data(), rows, inner, preparedA->m_panelRows, *B.m_CPUSparseMatrix, C.Data());
+        return;
+    }
+
+    if (!m_impl)
+        m_impl.reset(new Impl());
+    const size_t panelRowsMax = preparedA->m_panelRows;
+    m_impl->m_panel.resize(panelRowsMax * inner);
+    m_impl->m_panelResult.resize(panelRowsMax * cols);
+    ElemType* dataC = C.Data();
+    for (size_t first = 0; first < rows; first += panelRowsMax)
+    {
+        const size_t panelRows = std::min(panelRowsMax, rows - first);
+        ConvertFromReducedPrecision(m_format, preparedA->m_packedA.data() + first * inner, m_impl->m_panel.data(), panelRows * inner);
+
+        Matrix<ElemType> panel(panelRows, inner, m_impl->m_panel.data(), CPUDEVICE, matrixFlagDontOwnBuffer);
+        if (panelRows == rows) // a single panel: the product goes straight into C
+        {
+            Matrix<ElemType>::MultiplyAndWeightedAdd(1, panel, false, B, false, 0, C);
+            break;
+        }
+
+        Matrix<ElemType> panelResult(panelRows, cols, m_impl->m_panelResult.data(), CPUDEVICE, matrixFlagDontOwnBuffer);
+        Matrix<ElemType>::MultiplyAndWeightedAdd(1, panel, false, B, false, 0, panelResult);
+        const ElemType* result = m_impl->m_panelResult.data();
+#pragma omp parallel for
+        for (long c = 0; c < (long)cols; c++)
+            std::copy(result + c * panelRows, result + (c + 1) * panelRows, dataC + c * rows + first);
+    }
+}
+
+template class ReducedPrecisionMultiplier<float>;
+template class ReducedPrecisionMultiplier<double>;
+
+}}}
@@ -0,0 +1,193 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include "Matrix.h"
+#include "ReducedPrecision.h"
+#include <memory>
+#include <mutex>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+#pragma warning(push)
+#pragma warning(disable : 4251)
+
+// PreparedOperandCache holds the copy of the constant operand A that one of the multipliers below prepares on its
+// first call, keyed on the location and shape of op(A) and on the variant of the preparation (e.g. its format).
+// Multipliers constructed with the same cache, e.g. those of the copies of a network that share its parameters
+// (see ComputationNetwork::CloneWithSharedParameters()), prepare such an A only once and keep a single copy of it.
+// Thread-safe: the copy is built under a lock and is read-only afterwards, each multiplier has its own scratch buffers.
+template <class PreparedOperand>
+class PreparedOperandCache
+{
+public:
+    PreparedOperandCache()
+        : m_data(nullptr), m_rows(0), m_inner(0), m_transposeA(false), m_variant(0)
+    {
+    }
+
+    // Returns the copy for this key, calling prepare() to build it if the cached one is for another key (or there is none).
+    template <class PrepareFunction>
+    std::shared_ptr<const PreparedOperand> Get(const void* data, size_t rows, size_t inner, bool transposeA, size_t variant, const PrepareFunction& prepare)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_prepared || m_data != data || m_rows != rows || m_inner != inner || m_transposeA != transposeA || m_variant != variant)
+        {
+            m_prepared.reset(); // release the old copy before building the new one
+            m_prepared = prepare();
+            m_data = data;
+            m_rows = rows;
+            m_inner = inner;
+            m_transposeA = transposeA;
+            m_variant = variant;
+        }
+        return m_prepared;
+    }
+
+    // Drops the prepared copy, e.g. because the value of A is about to change. Calls in progress keep using it.
+    void Reset()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_prepared.reset();
+    }
+
+    bool IsPrepared() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_prepared != nullptr;
+    }
+
+private:
+    mutable std::mutex m_mutex;
+    std::shared_ptr<const PreparedOperand> m_prepared;
+    const void* m_data;
+    size_t m_rows;
+    size_t m_inner;
+    bool m_transposeA;
+    size_t m_variant;
+
+    DISABLE_COPY_AND_MOVE(PreparedOperandCache);
+};
+
+// QuantizedMultiplier computes C = op(A) * B on the CPU using the 16-bit integer
+// BlockMultiplier GEMM for the instruction set of the processor (see CPUKernels.h), where A is a constant (e.g. a frozen weight matrix during inference).
+// The first call quantizes A with a SymmetricQuantizer and keeps the block-ordered copy
+// produced by BlockMultiplier::PrepareB in its cache, so later calls only quantize the right operand B.
+// Matrices that do not reside on the CPU or are not dense are multiplied in full precision.
+// Not thread-safe: use one multiplier per evaluation thread, multipliers of the same A may share the cache.
+template <class ElemType>
+class MATH_API QuantizedMultiplier
+{
+public:
+    struct PreparedOperand; // op(A) quantized and in block order
+    typedef PreparedOperandCache<PreparedOperand> Cache;
+
+    // extraBits - minimum headroom passed to SymmetricQuantizer to protect the int32 accumulators
+    //     from overflowing, see Quantizers.h. It is increased as needed for large inner dimensions.
+    // cache - cache of the quantized copy of A to share with other multipliers, or null for one of its own.
+    QuantizedMultiplier(size_t extraBits = 2, const std::shared_ptr<Cache>& cache = nullptr);
+    ~QuantizedMultiplier();
+
+    // C = op(A) * B. A must stay unchanged between calls (see Reset()).
+    void Multiply(const Matrix<ElemType>& A, bool transposeA, const Matrix<ElemType>& B, Matrix<ElemType>& C);
+
+    // Drops the quantized copy of A, it is rebuilt on the next call to Multiply().
+    void Reset();
+
+    bool IsPrepared() const;
+
+    const std::shared_ptr<Cache>& GetCache() const { return m_cache; }
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+    std::shared_ptr<Cache> m_cache;
+    size_t m_extraBits;
+
+    DISABLE_COPY_AND_MOVE(QuantizedMultiplier);
+};
+
+// Int8QuantizedMultiplier computes C = op(A) * B like QuantizedMultiplier, but with 8-bit integers: A is quantized
+// with one range per row of op(A) (i.e. per output channel, see ChannelwiseInt8Quantizer), B with a single range
+// that is either calibrated beforehand (inputRange) or the absolute max of each B. The products are computed by
+// the 8-bit BlockMultiplier for the instruction set of the processor; operands that do not fit its exact int32 accumulation are multiplied in full precision.
+// Not thread-safe, see QuantizedMultiplier.
+template <class ElemType>
+class MATH_API Int8QuantizedMultiplier
+{
+public:
+    struct PreparedOperand; // op(A) quantized per row and in block order
+    typedef PreparedOperandCache<PreparedOperand> Cache;
+
+    // inputRange - absolute value that is mapped to the largest int8 value when quantizing B, larger values
+    //     are clipped. 0 uses the absolute max of each B.
+    // cache - see QuantizedMultiplier
+    Int8QuantizedMultiplier(double inputRange = 0, const std::shared_ptr<Cache>& cache = nullptr);
+    ~Int8QuantizedMultiplier();
+
+    // C = op(A) * B. A must stay unchanged between calls (see Reset()).
+    void Multiply(const Matrix<ElemType>& A, bool transposeA, const Matrix<ElemType>& B, Matrix<ElemType>& C);
+
+    // Drops the quantized copy of A, it is rebuilt on the next call to Multiply().
+    void Reset();
+
+    bool IsPrepared() const;
+
+    double InputRange() const { return m_inputRange; }
+
+    const std::shared_ptr<Cache>& GetCache() const { return m_cache; }
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+    std::shared_ptr<Cache> m_cache;
+    double m_inputRange;
+
+    DISABLE_COPY_AND_MOVE(Int8QuantizedMultiplier);
+};
+
+// ReducedPrecisionMultiplier computes C = op(A) * B on the CPU with A held in a 16-bit format (see ReducedPrecision.h),
+// e.g. a weight matrix whose LearnableParameter stores float16 or bfloat16 values. The first call packs op(A) into
+// panels of rows in the 16-bit format. Each call converts one panel at a time back to ElemType right before multiplying
+// it in full precision, so A is read from memory at half the width. The result is the product with A rounded to the format.
+// A sparse B in CSC format, e.g. the one-hot input of an embedding, sums the columns of op(A) that it selects, converted
+// from the 16-bit copy. Matrices that do not reside on the CPU, and other sparse formats, are multiplied in full precision.
+// Not thread-safe, see QuantizedMultiplier.
+template <class ElemType>
+class MATH_API ReducedPrecisionMultiplier
+{
+public:
+    struct PreparedOperand; // op(A) in 16-bit panels
+    typedef PreparedOperandCache<PreparedOperand> Cache;
+
+    // cache - see QuantizedMultiplier
+    ReducedPrecisionMultiplier(ReducedPrecisionFormat format, const std::shared_ptr<Cache>& cache = nullptr);
+    ~ReducedPrecisionMultiplier();
+
+    // C = op(A) * B. A must stay unchanged between calls (see Reset()).
+    void Multiply(const Matrix<ElemType>& A, bool transposeA, const Matrix<ElemType>& B, Matrix<ElemType>& C);
+
+    // Drops the packed copy of A, it is rebuilt on the next call to Multiply().
+    void Reset();
+
+    bool IsPrepared() const;
+
+    ReducedPrecisionFormat Format() const { return m_format; }
+
+    const std::shared_ptr<Cache>& GetCache() const { return m_cache; }
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+    std::shared_ptr<Cache> m_cache;
+    ReducedPrecisionFormat m_format;
+
+    DISABLE_COPY_AND_MOVE(ReducedPrecisionMultiplier);
+};
+
+#pragma warning(pop)
+
+}}}
@@ -80,6 +80,13 @@ public:
         }
     }
 
+    // Factor that maps a quantized value back to the raw range. The product of two quantized values
+    // is mapped back by the product of the two factors.
+    RawType GetInverseQuantizeFactor() const
+    {
+        return m_inverseQuantizerFactor;
+    }
+
 private: 
     // Find absolute maximum value
     RawType FindAbsMax(const ArrayRef<RawType>& arrayRef)
@@ -103,4 +110,67 @@ private:
     }
 };
 
+// Symmetric 8-bit quantizer with one range per channel, e.g. per output channel of a weight matrix.
+// Element i of a collection belongs to channel (i / channelStride) % numChannels. Each channel is scaled so that
+// its absolute max maps to 127; -128 is never produced, so products of two quantized values stay below 2^14.
+// Quantize() determines the ranges, Dequantize() maps quantized values back with the ranges of the last Quantize()
+// or the ones passed to SetInverseQuantizeFactors(). Quantizing dequantized values again yields the same int8 values.
+template <class RawType>
+class ChannelwiseInt8Quantizer
+{
+    size_t m_numChannels;
+    size_t m_channelStride;
+    std::vector<RawType> m_inverseQuantizeFactors; // one per channel
+public:
+    ChannelwiseInt8Quantizer(size_t numChannels, size_t channelStride)
+        : m_numChannels(numChannels), m_channelStride(channelStride), m_inverseQuantizeFactors(numChannels, 1)
+    {
+        if (numChannels == 0 || channelStride == 0)
+            InvalidArgument("ChannelwiseInt8Quantizer: The number of channels and the channel stride must be positive.");
+    }
+
+    size_t GetChannel(size_t index) const
+    {
+        return (index / m_channelStride) % m_numChannels;
+    }
+
+    void Quantize(const ArrayRef<RawType>& input, ArrayRef<int8_t>& output)
+    {
+        assert(input.size() == output.size());
+
+        std::vector<RawType> absMax(m_numChannels, 0);
+        for (size_t i = 0; i < input.size(); i++)
+            absMax[GetChannel(i)] = std::max(absMax[GetChannel(i)], (RawType)std::abs(input[i]));
+        for (size_t c = 0; c < m_numChannels; c++)
+            m_inverseQuantizeFactors[c] = absMax[c] > 0 ? absMax[c] / 127 : 1; // an all-zero channel quantizes to 0 with any factor
+
+        for (size_t i = 0; i < input.size(); i++)
+        {
+            RawType quantized = round(input[i] / m_inverseQuantizeFactors[GetChannel(i)]);
+            output[i] = (int8_t)std::max((RawType)-127, std::min((RawType)127, quantized));
+        }
+    }
+
+    void Dequantize(const ArrayRef<int8_t>& input, ArrayRef<RawType>& output) const
+    {
+        assert(input.size() == output.size());
+
+        for (size_t i = 0; i < input.size(); i++)
+            output[i] = input[i] * m_inverseQuantizeFactors[GetChannel(i)];
+    }
+
+    // Factors that map the quantized values of each channel back to the raw range.
+    const std::vector<RawType>& GetInverseQuantizeFactors() const
+    {
+        return m_inverseQuantizeFactors;
+    }
+
+    void SetInverseQuantizeFactors(const std::vector<RawType>& factors)
+    {
+        if (factors.size() != m_numChannels)
+            InvalidArgument("ChannelwiseInt8Quantizer: Expected %d factors, got %d.", (int)m_numChannels, (int)factors.size());
+        m_inverseQuantizeFactors = factors;
+    }
+};
+
 }}}
\ No newline at end of file
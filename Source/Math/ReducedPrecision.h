@@ -0,0 +1,174 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// ReducedPrecision.h -- 16-bit floating-point storage formats (IEEE half precision and bfloat16) for values that are
+// computed with in float or double
+//
+
+#pragma once
+
+#include "Basics.h"
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+enum class ReducedPrecisionFormat : int
+{
+    none     = 0, // full precision
+    float16  = 1, // IEEE 754 half precision: 5 exponent bits, 10 mantissa bits, largest value 65504
+    bfloat16 = 2  // upper half of a float: 8 exponent bits, 7 mantissa bits, the range of float
+};
+
+inline const char* ReducedPrecisionFormatName(ReducedPrecisionFormat format)
+{
+    switch (format)
+    {
+    case ReducedPrecisionFormat::none:     return "full";
+    case ReducedPrecisionFormat::float16:  return "float16";
+    case ReducedPrecisionFormat::bfloat16: return "bfloat16";
+    default: LogicError("ReducedPrecisionFormatName: Unknown format %d.", (int)format);
+    }
+}
+
+// Accepts the names returned by ReducedPrecisionFormatName(), case-insensitive.
+inline ReducedPrecisionFormat ReducedPrecisionFormatFromName(const std::wstring& name)
+{
+    for (auto format : { ReducedPrecisionFormat::none, ReducedPrecisionFormat::float16, ReducedPrecisionFormat::bfloat16 })
+    {
+        std::string candidate = ReducedPrecisionFormatName(format);
+        if (EqualCI(name, std::wstring(candidate.begin(), candidate.end())))
+            return format;
+    }
+    InvalidArgument("'%ls' is not a storage format, use full, float16 or bfloat16.", name.c_str());
+}
+
+// Conversions round to nearest even. Values beyond the range of float16 become infinite, NaNs stay NaNs.
+inline uint16_t FloatToFloat16(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+    uint32_t absBits = bits & 0x7fffffff;
+
+    if (absBits >= 0x7f800000) // infinity or NaN
+        return (uint16_t)(sign | 0x7c00 | (absBits > 0x7f800000 ? 0x200 : 0));
+    if (absBits >= 0x477ff000) // 65520 and above round to infinity
+        return (uint16_t)(sign | 0x7c00);
+    if (absBits < 0x38800000) // below 2^-14, the smallest normal float16: subnormal or zero
+    {
+        // Adding 0.5 leaves a float whose last mantissa bit has the weight 2^-24 of the last float16 subnormal bit,
+        // so the float addition does the rounding.
+        float absValue;
+        memcpy(&absValue, &absBits, sizeof(absValue));
+        absValue += 0.5f;
+        memcpy(&absBits, &absValue, sizeof(absBits));
+        return (uint16_t)(sign | (absBits - 0x3f000000));
+    }
+    // rebias the exponent from 127 to 15 and round off the lower 13 mantissa bits
+    absBits += 0xc8000fff + ((absBits >> 13) & 1);
+    return (uint16_t)(sign | (absBits >> 13));
+}
+
+inline float Float16ToFloat(uint16_t value)
+{
+    const uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+    const uint32_t exponent = (value >> 10) & 0x1f;
+    const uint32_t mantissa = value & 0x3ff;
+    uint32_t bits;
+    if (exponent == 0x1f) // infinity or NaN
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    else if (exponent != 0)
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    else // subnormal or zero: mantissa * 2^-24, which is exact in float
+    {
+        float absValue = mantissa * (1.0f / 16777216);
+        memcpy(&bits, &absValue, sizeof(bits));
+        bits |= sign;
+    }
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+inline uint16_t FloatToBFloat16(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    if ((bits & 0x7fffffff) > 0x7f800000) // NaN: keep it quiet, rounding could turn it into infinity
+        return (uint16_t)((bits >> 16) | 0x40);
+    bits += 0x7fff + ((bits >> 16) & 1);
+    return (uint16_t)(bits >> 16);
+}
+
+inline float BFloat16ToFloat(uint16_t value)
+{
+    const uint32_t bits = (uint32_t)value << 16;
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+// Converts n values to the 16-bit format, double values via float.
+template <class ElemType>
+void ConvertToReducedPrecision(ReducedPrecisionFormat format, const ElemType* in, uint16_t* out, size_t n)
+{
+    const long size = (long)n;
+    if (format == ReducedPrecisionFormat::float16)
+    {
+#pragma omp parallel for
+        for (long i = 0; i < size; i++)
+            out[i] = FloatToFloat16((float)in[i]);
+    }
+    else if (format == ReducedPrecisionFormat::bfloat16)
+    {
+#pragma omp parallel for
+        for (long i = 0; i < size; i++)
+            out[i] = FloatToBFloat16((float)in[i]);
+    }
+    else
+        LogicError("ConvertToReducedPrecision: Not a 16-bit format.");
+}
+
+template <class ElemType>
+void ConvertFromReducedPrecision(ReducedPrecisionFormat format, const uint16_t* in, ElemType* out, size_t n)
+{
+    const long size = (long)n;
+    if (format == ReducedPrecisionFormat::float16)
+    {
+#pragma omp parallel for
+        for (long i = 0; i < size; i++)
+            out[i] = (ElemType)Float16ToFloat(in[i]);
+    }
+    else if (format == ReducedPrecisionFormat::bfloat16)
+    {
+#pragma omp parallel for
+        for (long i = 0; i < size; i++)
+            out[i] = (ElemType)BFloat16ToFloat(in[i]);
+    }
+    else
+        LogicError("ConvertFromReducedPrecision: Not a 16-bit format.");
+}
+
+// Rounds n values in place to the nearest ones the format can represent.
+template <class ElemType>
+void RoundToReducedPrecision(ReducedPrecisionFormat format, ElemType* values, size_t n)
+{
+    const long size = (long)n;
+    if (format == ReducedPrecisionFormat::float16)
+    {
+#pragma omp parallel for
+        for (long i = 0; i < size; i++)
+            values[i] = (ElemType)Float16ToFloat(FloatToFloat16((float)values[i]));
+    }
+    else if (format == ReducedPrecisionFormat::bfloat16)
+    {
+#pragma omp parallel for
+        for (long i = 0; i < size; i++)
+            values[i] = (ElemType)BFloat16ToFloat(FloatToBFloat16((float)values[i]));
+    }
+}
+
+}}}
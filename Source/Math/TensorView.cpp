@@ -22,6 +22,7 @@
 #include "stdafx.h"
 #include "Basics.h"
 #include "TensorView.h"
+#include "QuantizedMultiplier.h"
 #include <array>
 
 #ifndef let
@@ -351,8 +352,10 @@ shared_ptr<Matrix<ElemType>> TensorView<ElemType>::AsMatrix() const
         return make_shared<Matrix<ElemType>>(m_sob->ColumnSlice(firstColumn, numColumns).Reshaped(m_shape[0], m_shape[1]));
 }
 
+// flatten the operands of a matrix product into Matrix objects, validating their dimensions
 template <class ElemType>
-void TensorView<ElemType>::DoMatrixProductOf(ElemType beta, bool transC, const TensorView& a, bool transA, const TensorView& b, bool transB, ElemType alpha)
+void TensorView<ElemType>::FlattenForMatrixProduct(bool transC, const TensorView& a, bool transA, const TensorView& b, bool transB,
+                                                   shared_ptr<Matrix<ElemType>>& A, shared_ptr<Matrix<ElemType>>& B, shared_ptr<Matrix<ElemType>>& C) const
 {
     // determine integration dimension offset
     auto shapeA = a.m_shape;
@@ -378,9 +381,16 @@ void TensorView<ElemType>::DoMatrixProductOf(ElemType beta, bool transC, const T
         InvalidArgument("DoMatrixProductOf: Flattened tensor dimensions %s mismatch.", MatrixProductFormat(shapeA, transA, shapeB, transB, shapeC, transC).c_str());
     }
     // create Matrix objects out of this
-    let  A = a.Reshaped(shapeA).AsMatrix();
-    let  B = b.Reshaped(shapeB).AsMatrix();
-    auto C =   Reshaped(shapeC).AsMatrix();
+    A = a.Reshaped(shapeA).AsMatrix();
+    B = b.Reshaped(shapeB).AsMatrix();
+    C =   Reshaped(shapeC).AsMatrix();
+}
+
+template <class ElemType>
+void TensorView<ElemType>::DoMatrixProductOf(ElemType beta, bool transC, const TensorView& a, bool transA, const TensorView& b, bool transB, ElemType alpha)
+{
+    shared_ptr<Matrix<ElemType>> A, B, C;
+    FlattenForMatrixProduct(transC, a, transA, b, transB, A, B, C);
     // and go
     if (!transC)
         Matrix<ElemType>::MultiplyAndWeightedAdd(alpha, *A, transA, *B, transB, beta, *C);
@@ -388,6 +398,30 @@ void TensorView<ElemType>::DoMatrixProductOf(ElemType beta, bool transC, const T
         Matrix<ElemType>::MultiplyAndWeightedAdd(alpha, *B, !transB, *A, !transA, beta, *C);
 }
 
+template <class ElemType>
+void TensorView<ElemType>::AssignQuantizedMatrixProductOf(const TensorView& a, bool transA, const TensorView& b, QuantizedMultiplier<ElemType>& multiplier)
+{
+    shared_ptr<Matrix<ElemType>> A, B, C;
+    FlattenForMatrixProduct(/*transC=*/false, a, transA, b, /*transB=*/false, A, B, C);
+    multiplier.Multiply(*A, transA, *B, *C);
+}
+
+template <class ElemType>
+void TensorView<ElemType>::AssignQuantizedMatrixProductOf(const TensorView& a, bool transA, const TensorView& b, Int8QuantizedMultiplier<ElemType>& multiplier)
+{
+    shared_ptr<Matrix<ElemType>> A, B, C;
+    FlattenForMatrixProduct(/*transC=*/false, a, transA, b, /*transB=*/false, A, B, C);
+    multiplier.Multiply(*A, transA, *B, *C);
+}
+
+template <class ElemType>
+void TensorView<ElemType>::AssignReducedPrecisionMatrixProductOf(const TensorView& a, bool transA, const TensorView& b, ReducedPrecisionMultiplier<ElemType>& multiplier)
+{
+    shared_ptr<Matrix<ElemType>> A, B, C;
+    FlattenForMatrixProduct(/*transC=*/false, a, transA, b, /*transB=*/false, A, B, C);
+    multiplier.Multiply(*A, transA, *B, *C);
+}
+
 template class TensorView<float>;
 template class TensorView<double>;
 
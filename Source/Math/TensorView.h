@@ -21,6 +21,10 @@ namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
 // This class is exported from the Math.dll.
 namespace Microsoft { namespace MSR { namespace CNTK {
 
+template <class ElemType> class QuantizedMultiplier;
+template <class ElemType> class Int8QuantizedMultiplier;
+template <class ElemType> class ReducedPrecisionMultiplier;
+
 template <class ElemType>
 class MATH_API TensorView
 {
@@ -147,6 +151,14 @@ public:
     void AssignMatrixProductOf(               bool transC, const TensorView& a, bool transA, const TensorView& b, bool transB, ElemType alpha = 1.0f) { DoMatrixProductOf(0,    transC, a, transA, b, transB, alpha); }
     void AddMatrixProductOf   (               bool transC, const TensorView& a, bool transA, const TensorView& b, bool transB, ElemType alpha = 1.0f) { DoMatrixProductOf(1.0f, transC, a, transA, b, transB, alpha); }
 
+    // same as AssignMatrixProductOf(false, a, transA, b, false) for a constant 'a', computed by a 16-bit integer GEMM
+    // on a quantized copy of 'a' that the multiplier caches
+    void AssignQuantizedMatrixProductOf(const TensorView& a, bool transA, const TensorView& b, QuantizedMultiplier<ElemType>& multiplier);
+    // same with an 8-bit integer GEMM, see Int8QuantizedMultiplier
+    void AssignQuantizedMatrixProductOf(const TensorView& a, bool transA, const TensorView& b, Int8QuantizedMultiplier<ElemType>& multiplier);
+    // same in full precision from a 16-bit floating-point copy of 'a', see ReducedPrecisionMultiplier
+    void AssignReducedPrecisionMatrixProductOf(const TensorView& a, bool transA, const TensorView& b, ReducedPrecisionMultiplier<ElemType>& multiplier);
+
     shared_ptr<Matrix<ElemType>> AsMatrix() const;
     const TensorShape& GetShape() const { return m_shape; }
 
@@ -159,6 +171,9 @@ public:
     friend Test::TensorTest<ElemType>;
 
 private:
+    void FlattenForMatrixProduct(bool transC, const TensorView& a, bool transA, const TensorView& b, bool transB,
+                                 shared_ptr<Matrix<ElemType>>& A, shared_ptr<Matrix<ElemType>>& B, shared_ptr<Matrix<ElemType>>& C) const;
+
     // -------------------------------------------------------------------
     // sob members
     // -------------------------------------------------------------------
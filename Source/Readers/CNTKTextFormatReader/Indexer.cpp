@@ -6,13 +6,25 @@
 #include "stdafx.h"
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <future>
+#include <thread>
 #include "Indexer.h"
 #include "TextReaderConstants.h"
+#include "fileutil.h"
 
 using std::string;
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
+// "CTFINDEX" in little endian, followed by the version of the cache format.
+static const uint64_t s_indexCacheMagic = 0x5845444e49465443ull;
+static const uint64_t s_indexCacheVersion = 1;
+
+// Number of bytes at the beginning of the input file that are hashed into the cache header.
+static const size_t s_indexCacheHeadBytes = 64 * 1024;
+
 Indexer::Indexer(FILE* file, bool skipSequenceIds, size_t chunkSize) :
     m_file(file),
     m_fileOffsetStart(0),
@@ -23,7 +35,10 @@ Indexer::Indexer(FILE* file, bool skipSequenceIds, size_t chunkSize) :
     m_pos(nullptr),
     m_done(false),
     m_hasSequenceIds(!skipSequenceIds),
-    m_index(chunkSize)
+    m_index(chunkSize),
+    m_skipSequenceIds(skipSequenceIds),
+    m_numberOfScanThreads(1),
+    m_minScanRangeSize(0)
 {
     if (m_file == nullptr)
     {
@@ -31,6 +46,13 @@ Indexer::Indexer(FILE* file, bool skipSequenceIds, size_t chunkSize) :
     }
 }
 
+void Indexer::SetParallelScan(const std::wstring& filePath, size_t numberOfThreads, size_t minRangeSizeInBytes)
+{
+    m_parallelScanFilePath = filePath;
+    m_numberOfScanThreads = numberOfThreads > 0 ? numberOfThreads : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    m_minScanRangeSize = std::max<size_t>(minRangeSizeInBytes, 1);
+}
+
 void Indexer::RefillBuffer()
 {
     if (!m_done)
@@ -69,7 +91,7 @@ void Indexer::BuildFromLines(CorpusDescriptorPtr corpus)
             sd.m_fileOffsetBytes = offset;
             offset = GetFileOffset() + 1;
             sd.m_byteSize = offset - sd.m_fileOffsetBytes;
-            AddSequenceIfIncluded(corpus, lines, sd);
+            AddScannedSequence(corpus, lines, sd);
             ++m_pos;
             ++lines;
         }
@@ -87,7 +109,7 @@ void Indexer::BuildFromLines(CorpusDescriptorPtr corpus)
         sd.m_numberOfSamples = 1;
         sd.m_fileOffsetBytes = offset;
         sd.m_byteSize = m_fileOffsetEnd - sd.m_fileOffsetBytes;
-        AddSequenceIfIncluded(corpus, lines, sd);
+        AddScannedSequence(corpus, lines, sd);
     }
 }
 
@@ -100,6 +122,21 @@ void Indexer::Build(CorpusDescriptorPtr corpus)
 
     m_index.Reserve(filesize(m_file));
 
+    if (!m_cacheFilePath.empty() && TryLoadCache(corpus))
+    {
+        return;
+    }
+
+    Scan(corpus);
+
+    if (!m_cacheFilePath.empty())
+    {
+        WriteCache();
+    }
+}
+
+void Indexer::Scan(CorpusDescriptorPtr corpus)
+{
     RefillBuffer(); // read the first block of data
     if (m_done)
     {
@@ -116,7 +153,19 @@ void Indexer::Build(CorpusDescriptorPtr corpus)
     }
 
     // check the first byte and decide what to do next
-    if (!m_hasSequenceIds || m_bufferStart[0] == NAME_PREFIX)
+    bool byLines = !m_hasSequenceIds || m_bufferStart[0] == NAME_PREFIX;
+
+    int64_t begin = GetFileOffset();
+    int64_t end = filesize(m_file);
+    size_t numberOfRanges = m_parallelScanFilePath.empty() ? 1 :
+        std::min(m_numberOfScanThreads, (size_t)((end - begin) / m_minScanRangeSize));
+    if (numberOfRanges > 1)
+    {
+        ScanInParallel(corpus, byLines, begin, end, numberOfRanges);
+        return;
+    }
+
+    if (byLines)
     {
         // skip sequence id parsing, treat lines as individual sequences
         BuildFromLines(corpus);
@@ -145,7 +194,7 @@ void Indexer::Build(CorpusDescriptorPtr corpus)
         {
             // found a new sequence, which starts at the [offset] bytes into the file
             sd.m_byteSize = offset - sd.m_fileOffsetBytes;
-            AddSequenceIfIncluded(corpus, currentKey, sd);
+            AddScannedSequence(corpus, currentKey, sd);
 
             sd = {};
             sd.m_fileOffsetBytes = offset;
@@ -155,7 +204,125 @@ void Indexer::Build(CorpusDescriptorPtr corpus)
 
     // calculate the byte size for the last sequence
     sd.m_byteSize = m_fileOffsetEnd - sd.m_fileOffsetBytes;
-    AddSequenceIfIncluded(corpus, currentKey, sd);
+    AddScannedSequence(corpus, currentKey, sd);
+}
+
+void Indexer::ScanInParallel(CorpusDescriptorPtr corpus, bool byLines, int64_t begin, int64_t end, size_t numberOfRanges)
+{
+    if (byLines)
+    {
+        m_hasSequenceIds = false;
+    }
+
+    std::vector<std::future<std::vector<ScannedSegment>>> ranges;
+    for (size_t i = 0; i < numberOfRanges; ++i)
+    {
+        int64_t rangeBegin = begin + (end - begin) * (int64_t)i / (int64_t)numberOfRanges;
+        int64_t rangeEnd = begin + (end - begin) * (int64_t)(i + 1) / (int64_t)numberOfRanges;
+        ranges.push_back(std::async(std::launch::async, [this, rangeBegin, rangeEnd, i, byLines]()
+        {
+            std::unique_ptr<FILE, int(*)(FILE*)> file(fopenOrDie(m_parallelScanFilePath, L"rbS"), fclose);
+            Indexer rangeIndexer(file.get(), m_skipSequenceIds);
+            std::vector<ScannedSegment> segments;
+            rangeIndexer.ScanRange(rangeBegin, rangeEnd, i == 0, byLines, segments);
+            return segments;
+        }));
+    }
+
+    // Merge the segments in the order of the file, making the same decisions as the serial scan:
+    // a sequence ends where a line with a different sequence id (or, in the line mode, any line) starts.
+    SequenceDescriptor sd = {};
+    bool hasSequence = false;
+    size_t currentKey = 0;
+    size_t lines = 0;
+    for (auto& range : ranges)
+    {
+        for (const auto& segment : range.get())
+        {
+            if (!hasSequence && !byLines && !segment.m_hasKey)
+            {
+                RuntimeError("Expected a sequence id at the offset %" PRIi64 ", none was found.", segment.m_fileOffsetBytes);
+            }
+
+            if (!hasSequence || byLines || (segment.m_hasKey && segment.m_key != currentKey))
+            {
+                if (hasSequence)
+                {
+                    sd.m_byteSize = segment.m_fileOffsetBytes - sd.m_fileOffsetBytes;
+                    AddScannedSequence(corpus, currentKey, sd);
+                }
+
+                sd = {};
+                sd.m_fileOffsetBytes = segment.m_fileOffsetBytes;
+                currentKey = byLines ? lines++ : segment.m_key;
+                hasSequence = true;
+            }
+            sd.m_numberOfSamples += segment.m_numberOfSamples;
+        }
+    }
+
+    if (!hasSequence)
+    {
+        RuntimeError("Expected a sequence id at the offset %" PRIi64 ", none was found.", begin);
+    }
+
+    sd.m_byteSize = end - sd.m_fileOffsetBytes;
+    AddScannedSequence(corpus, currentKey, sd);
+
+    // Leave the file in the same state as after a serial scan.
+    if (_fseeki64(m_file, 0, SEEK_END) != 0)
+    {
+        RuntimeError("Could not seek in the input file.");
+    }
+    m_fileOffsetStart = m_fileOffsetEnd = end;
+    m_done = true;
+}
+
+void Indexer::ScanRange(int64_t begin, int64_t end, bool isFirstRange, bool byLines, std::vector<ScannedSegment>& segments)
+{
+    // Start one byte early, so that a range beginning right after a new line keeps its first line.
+    int64_t readFrom = isFirstRange ? begin : begin - 1;
+    if (_fseeki64(m_file, readFrom, SEEK_SET) != 0)
+    {
+        RuntimeError("Could not seek in the input file.");
+    }
+    m_fileOffsetEnd = readFrom;
+
+    RefillBuffer();
+    if (!isFirstRange)
+    {
+        SkipLine();
+    }
+
+    while (!m_done && GetFileOffset() < end)
+    {
+        int64_t offset = GetFileOffset();
+        size_t id = 0;
+        bool hasId = !byLines && TryGetSequenceId(id);
+        if (m_done)
+        {
+            // The last line of the file consists of digits only, the serial scan does not count it.
+            break;
+        }
+
+        if (byLines || segments.empty() ||
+            (hasId && (!segments.back().m_hasKey || segments.back().m_key != id)))
+        {
+            segments.push_back({ hasId, id, offset, 0 });
+        }
+        segments.back().m_numberOfSamples++;
+
+        SkipLine();
+    }
+}
+
+void Indexer::AddScannedSequence(CorpusDescriptorPtr corpus, size_t sequenceKey, SequenceDescriptor& sd)
+{
+    if (!m_cacheFilePath.empty())
+    {
+        m_scannedSequences.push_back({ sequenceKey, sd.m_fileOffsetBytes, sd.m_byteSize, sd.m_numberOfSamples });
+    }
+    AddSequenceIfIncluded(corpus, sequenceKey, sd);
 }
 
 void Indexer::AddSequenceIfIncluded(CorpusDescriptorPtr corpus, size_t sequenceKey, SequenceDescriptor& sd)
@@ -170,6 +337,134 @@ void Indexer::AddSequenceIfIncluded(CorpusDescriptorPtr corpus, size_t sequenceK
     }
 }
 
+Indexer::CacheHeader Indexer::GetCacheHeader()
+{
+    CacheHeader header = {};
+    header.m_magic = s_indexCacheMagic;
+    header.m_version = s_indexCacheVersion;
+    header.m_fileSize = filesize(m_file);
+    header.m_skipSequenceIds = m_skipSequenceIds;
+
+#ifdef _WIN32
+    struct _stat64 fileStat;
+    int rc = _fstat64(_fileno(m_file), &fileStat);
+#else
+    struct stat fileStat;
+    int rc = fstat(fileno(m_file), &fileStat);
+#endif
+    if (rc != 0)
+    {
+        RuntimeError("Could not retrieve the modification time of the input file.");
+    }
+    header.m_modificationTime = fileStat.st_mtime;
+
+    // FNV-1a hash of the head of the file, which catches in-place edits that preserve size and time.
+    int64_t position = _ftelli64(m_file);
+    if (position == -1L || _fseeki64(m_file, 0, SEEK_SET) != 0)
+    {
+        RuntimeError("Could not seek in the input file.");
+    }
+    std::vector<char> head(s_indexCacheHeadBytes);
+    size_t bytesRead = fread(head.data(), 1, head.size(), m_file);
+    if (ferror(m_file) != 0 || _fseeki64(m_file, position, SEEK_SET) != 0)
+    {
+        RuntimeError("Could not read from the input file.");
+    }
+    header.m_headHash = 14695981039346656037ull;
+    for (size_t i = 0; i < bytesRead; i++)
+    {
+        header.m_headHash = (header.m_headHash ^ (unsigned char)head[i]) * 1099511628211ull;
+    }
+
+    return header;
+}
+
+bool Indexer::TryLoadCache(CorpusDescriptorPtr corpus)
+{
+    if (!fexists(m_cacheFilePath))
+    {
+        return false;
+    }
+
+    std::vector<ScannedSequence> sequences;
+    CacheHeader cached = {};
+    try
+    {
+        CacheHeader expected = GetCacheHeader();
+
+        std::unique_ptr<FILE, int(*)(FILE*)> f(fopenOrDie(m_cacheFilePath, L"rb"), fclose);
+        freadOrDie(&cached, sizeof(cached), 1, f.get());
+        if (cached.m_magic != expected.m_magic || cached.m_version != expected.m_version ||
+            cached.m_fileSize != expected.m_fileSize || cached.m_modificationTime != expected.m_modificationTime ||
+            cached.m_headHash != expected.m_headHash || cached.m_skipSequenceIds != expected.m_skipSequenceIds ||
+            filesize(f.get()) != sizeof(cached) + cached.m_numberOfSequences * sizeof(ScannedSequence))
+        {
+            fprintf(stderr, "Index cache (%ls) does not match the input file, rebuilding it.\n", m_cacheFilePath.c_str());
+            return false;
+        }
+
+        sequences.resize(cached.m_numberOfSequences);
+        freadOrDie(sequences, sequences.size(), f.get());
+    }
+    catch (const std::exception& e)
+    {
+        fprintf(stderr, "WARNING: Could not read the index cache (%ls): %s\n", m_cacheFilePath.c_str(), e.what());
+        return false;
+    }
+
+    // Replaying the scanned sequences applies the same corpus filtering and chunking as a scan.
+    m_hasSequenceIds = cached.m_hasSequenceIds != 0;
+    for (const auto& s : sequences)
+    {
+        SequenceDescriptor sd = {};
+        sd.m_numberOfSamples = s.m_numberOfSamples;
+        sd.m_fileOffsetBytes = s.m_fileOffsetBytes;
+        sd.m_byteSize = s.m_byteSize;
+        AddSequenceIfIncluded(corpus, s.m_key, sd);
+    }
+
+    // Leave the file in the same state as after a scan.
+    if (_fseeki64(m_file, 0, SEEK_END) != 0)
+    {
+        RuntimeError("Could not seek in the input file.");
+    }
+    m_done = true;
+    return true;
+}
+
+void Indexer::WriteCache()
+{
+    // Write to a temporary file first, so that other processes (e.g. other ranks
+    // indexing the same input) never see a partially written cache.
+    std::wstring tempFilePath = m_cacheFilePath + L".tmp" + std::to_wstring(GetCurrentProcessId());
+    try
+    {
+        CacheHeader header = GetCacheHeader();
+        header.m_hasSequenceIds = m_hasSequenceIds;
+        header.m_numberOfSequences = m_scannedSequences.size();
+
+        FILE* f = fopenOrDie(tempFilePath, L"wb");
+        std::unique_ptr<FILE, int(*)(FILE*)> guard(f, fclose);
+        fwriteOrDie(&header, sizeof(header), 1, f);
+        fwriteOrDie(m_scannedSequences, f);
+        if (fclose(guard.release()) != 0)
+        {
+            RuntimeError("error closing file '%ls'", tempFilePath.c_str());
+        }
+        renameOrDie(tempFilePath, m_cacheFilePath);
+    }
+    catch (const std::exception& e)
+    {
+        fprintf(stderr, "WARNING: Could not write the index cache (%ls): %s\n", m_cacheFilePath.c_str(), e.what());
+        if (fexists(tempFilePath))
+        {
+            _wunlink(tempFilePath.c_str());
+        }
+    }
+
+    std::vector<ScannedSequence>().swap(m_scannedSequences);
+}
+
 void Indexer::SkipLine()
 {
     while (!m_done)
@@ -6,6 +6,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <string>
 #include <vector>
 #include "Descriptors.h"
 #include "CorpusDescriptor.h"
@@ -23,9 +24,20 @@ public:
     Indexer(FILE* file, bool skipSequenceIds = false, size_t chunkSize = 32 * 1024 * 1024);
 
     // Reads the input file, building and index of chunks and corresponding
-    // sequences.
+    // sequences. If a cache file was specified, the index is restored from it
+    // when it is still valid, otherwise the cache is (re)written after the scan.
     void Build(CorpusDescriptorPtr corpus);
 
+    // Enables the persistent index cache. The sequences found by the scan are stored
+    // in the given file, together with the size, the modification time and a hash of the head
+    // of the input file, and reused by later runs as long as the input file has not changed.
+    void SetCacheFilePath(const std::wstring& cacheFilePath) { m_cacheFilePath = cacheFilePath; }
+
+    // Enables the parallel scan: the input is split into byte ranges (of at least the given size),
+    // which are scanned concurrently, each through its own handle to the file at 'filePath'.
+    // numberOfThreads = 0 uses one thread per hardware thread. The index is identical to a serial scan.
+    void SetParallelScan(const std::wstring& filePath, size_t numberOfThreads, size_t minRangeSizeInBytes = 16 * 1024 * 1024);
+
     // Returns input data index (chunk and sequence metadata)
     const Index& GetIndex() const { return m_index; }
 
@@ -35,6 +47,40 @@ public:
     bool HasSequenceIds() const { return m_hasSequenceIds; }
 
 private:
+    // A sequence as found by the scan, before the corpus filtering is applied.
+    struct ScannedSequence
+    {
+        uint64_t m_key; // numerical sequence id (or line number)
+        int64_t m_fileOffsetBytes;
+        uint64_t m_byteSize;
+        uint64_t m_numberOfSamples;
+    };
+
+    // A run of lines found by the scan of a byte range. In the line mode, every line is a segment.
+    // Otherwise, a new segment starts at each line whose sequence id differs from the one of the current
+    // segment; the lines preceding the first sequence id of a range form a segment without a key, as
+    // whether they continue the last sequence of the previous range is only known when merging.
+    struct ScannedSegment
+    {
+        bool m_hasKey;
+        size_t m_key;
+        int64_t m_fileOffsetBytes;
+        size_t m_numberOfSamples;
+    };
+
+    // Identifies the input file (and the indexing options) the cache was built for.
+    struct CacheHeader
+    {
+        uint64_t m_magic;
+        uint64_t m_version;
+        uint64_t m_fileSize;
+        int64_t m_modificationTime;
+        uint64_t m_headHash;  // hash of the first bytes of the input file
+        uint64_t m_skipSequenceIds;
+        uint64_t m_hasSequenceIds;
+        uint64_t m_numberOfSequences;
+    };
+
     FILE* m_file;
 
     int64_t m_fileOffsetStart;
@@ -53,9 +99,43 @@ private:
     // a collection of chunk descriptors and sequence keys.
     Index m_index;
 
+    bool m_skipSequenceIds;
+
+    std::wstring m_cacheFilePath; // empty, when the index cache is disabled
+
+    // all sequences found by the scan, only kept when the index cache is enabled.
+    std::vector<ScannedSequence> m_scannedSequences;
+
+    std::wstring m_parallelScanFilePath; // empty, when the input is scanned by a single thread
+    size_t m_numberOfScanThreads;
+    size_t m_minScanRangeSize;
+
     // Same function as above but with check that the sequence is included in the corpus descriptor.
     void AddSequenceIfIncluded(CorpusDescriptorPtr corpus, size_t sequenceKey, SequenceDescriptor& sd);
 
+    // Adds a sequence found by the scan, remembering it for the index cache if enabled.
+    void AddScannedSequence(CorpusDescriptorPtr corpus, size_t sequenceKey, SequenceDescriptor& sd);
+
+    // Does a pass over the input file, adding all sequences to the index.
+    void Scan(CorpusDescriptorPtr corpus);
+
+    // Splits [begin, end) of the input into the given number of ranges, scans them concurrently
+    // and merges the results in the order of the file.
+    void ScanInParallel(CorpusDescriptorPtr corpus, bool byLines, int64_t begin, int64_t end, size_t numberOfRanges);
+
+    // Collects the lines starting within [begin, end) into segments. Unless this is the first range,
+    // the scan is resynchronized at the first line starting at or after 'begin'.
+    void ScanRange(int64_t begin, int64_t end, bool isFirstRange, bool byLines, std::vector<ScannedSegment>& segments);
+
+    // Returns a header describing the current state of the input file.
+    CacheHeader GetCacheHeader();
+
+    // Restores the index from the cache file, returns false if the cache is missing or stale.
+    bool TryLoadCache(CorpusDescriptorPtr corpus);
+
+    // Writes the sequences found by the scan to the cache file.
+    void WriteCache();
+
     // fills up the buffer with data from file, all previously buffered data
     // will be overwritten.
     void RefillBuffer();
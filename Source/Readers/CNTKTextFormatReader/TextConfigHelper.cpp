@@ -148,6 +148,9 @@ TextConfigHelper::TextConfigHelper(const ConfigParameters& config)
     m_traceLevel = config(L"traceLevel", 1);
     m_chunkSizeBytes = config(L"chunkSizeInBytes", 32 * 1024 * 1024); // 32 MB by default
     m_keepDataInMemory = config(L"keepDataInMemory", false);
+    m_cacheIndex = config(L"cacheIndex", false);
+    m_numIndexingThreads = config(L"numIndexingThreads", 1u); // the parallel scan is opt-in, 0 = one per hardware thread
+    m_maxCacheSizeBytes = config(L"maxCacheSizeInBytes", (size_t)0); // unbounded by default
     m_frameMode = config(L"frameMode", false);
 }
 
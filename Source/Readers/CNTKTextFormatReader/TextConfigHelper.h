@@ -37,6 +37,12 @@ public:
 
     bool ShouldKeepDataInMemory() const { return m_keepDataInMemory; }
 
+    size_t GetMaxCacheSize() const { return m_maxCacheSizeBytes; }
+
+    bool ShouldCacheIndex() const { return m_cacheIndex; }
+
+    unsigned int GetNumIndexingThreads() const { return m_numIndexingThreads; }
+
     bool IsInFrameMode() const { return m_frameMode; }
 
     ElementType GetElementType() const { return m_elementType; }
@@ -52,7 +58,10 @@ private:
     unsigned int m_maxErrors;
     unsigned int m_traceLevel;
     size_t m_chunkSizeBytes; // chunks size in bytes
-    bool m_keepDataInMemory; // if true the whole dataset is kept in memory
+    bool m_keepDataInMemory; // if true the dataset is kept in memory
+    size_t m_maxCacheSizeBytes; // memory budget of the in-memory cache in bytes (0 = unbounded)
+    bool m_cacheIndex; // if true the index is persisted next to the input file and reused by later runs
+    unsigned int m_numIndexingThreads; // number of threads scanning the input file (1 by default, 0 = one per hardware thread)
     bool m_frameMode; // if true, the maximum expected sequence length in the dataset is one sample.
 };
 
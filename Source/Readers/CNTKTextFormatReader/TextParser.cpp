@@ -42,12 +42,18 @@ public:
     // Gets sequences by id.
     void GetSequence(size_t sequenceId, std::vector<SequenceDataPtr>& result) override;
 
+    // Gets the number of bytes occupied by the loaded sequence buffers.
+    size_t SizeInBytes() const override { return m_sizeInBytes; }
+
     // A map from sequence ids to the sequence data.
     std::vector<SequenceBuffer> m_sequenceMap;
 
     // chunk id (copied from the descriptor)
     ChunkIdType m_id;
 
+    // memory footprint of the chunk data (computed once the chunk is loaded)
+    size_t m_sizeInBytes;
+
     // a non-owned pointer to the parser that created this chunk
     TextParser* m_parser;
 };
@@ -72,6 +78,8 @@ TextParser(corpus, helper.GetFilePath(), helper.GetStreams())
     SetMaxAllowedErrors(helper.GetMaxAllowedErrors());
     SetChunkSize(helper.GetChunkSize());
     SetSkipSequenceIds(helper.ShouldSkipSequenceIds());
+    SetCacheIndex(helper.ShouldCacheIndex());
+    SetNumIndexingThreads(helper.GetNumIndexingThreads());
 
     Initialize();
 }
@@ -94,6 +102,8 @@ TextParser<ElemType>::TextParser(CorpusDescriptorPtr corpus, const std::wstring&
     m_hadWarnings(false),
     m_numAllowedErrors(0),
     m_skipSequenceIds(false),
+    m_cacheIndex(false),
+    m_numIndexingThreads(1),
     m_numRetries(5),
     m_corpus(corpus)
 {
@@ -172,6 +182,14 @@ void TextParser<ElemType>::Initialize()
         }
 
         m_indexer = make_unique<Indexer>(m_file, m_skipSequenceIds, m_chunkSizeBytes);
+        if (m_cacheIndex)
+        {
+            m_indexer->SetCacheFilePath(m_filename + L".index");
+        }
+        if (m_numIndexingThreads != 1)
+        {
+            m_indexer->SetParallelScan(m_filename, m_numIndexingThreads);
+        }
 
         m_indexer->Build(m_corpus);
     });
@@ -231,7 +249,8 @@ void TextParser<ElemType>::GetSequencesForChunk(ChunkIdType chunkId, std::vector
 
 template <class ElemType>
 TextParser<ElemType>::TextDataChunk::TextDataChunk(const ChunkDescriptor& descriptor, TextParser* parser) :
-    m_parser(parser)
+    m_parser(parser),
+    m_sizeInBytes(0)
 {
     m_id = descriptor.m_id;
 }
@@ -273,6 +292,28 @@ void TextParser<ElemType>::LoadChunk(TextChunkPtr& chunk, const ChunkDescriptor&
     {
         chunk->m_sequenceMap[sequenceDescriptor.m_id] = LoadSequence(sequenceDescriptor);
     }
+
+    size_t sizeInBytes = 0;
+    for (const auto& sequence : chunk->m_sequenceMap)
+    {
+        for (size_t i = 0; i < sequence.size(); ++i)
+        {
+            if (m_streamInfos[i].m_type == StorageType::dense)
+            {
+                const auto& data = static_cast<const DenseInputStreamBuffer&>(*sequence[i]);
+                sizeInBytes += sizeof(DenseInputStreamBuffer) + data.m_buffer.capacity() * sizeof(ElemType);
+            }
+            else
+            {
+                const auto& data = static_cast<const SparseInputStreamBuffer&>(*sequence[i]);
+                sizeInBytes += sizeof(SparseInputStreamBuffer) +
+                    data.m_buffer.capacity() * sizeof(ElemType) +
+                    data.m_indicesBuffer.capacity() * sizeof(IndexType) +
+                    data.m_nnzCounts.capacity() * sizeof(IndexType);
+            }
+        }
+    }
+    chunk->m_sizeInBytes = sizeInBytes;
 }
 
 template <class ElemType>
@@ -1171,6 +1212,18 @@ void TextParser<ElemType>::SetSkipSequenceIds(bool skip)
     m_skipSequenceIds = skip;
 }
 
+template <class ElemType>
+void TextParser<ElemType>::SetCacheIndex(bool cacheIndex)
+{
+    m_cacheIndex = cacheIndex;
+}
+
+template <class ElemType>
+void TextParser<ElemType>::SetNumIndexingThreads(unsigned int numThreads)
+{
+    m_numIndexingThreads = numThreads;
+}
+
 template <class ElemType>
 void TextParser<ElemType>::SetChunkSize(size_t size)
 {
@@ -121,6 +121,8 @@ private:
     bool m_hadWarnings;
     unsigned int m_numAllowedErrors;
     bool m_skipSequenceIds;
+    bool m_cacheIndex; // if true, the index is persisted in '<input file>.index'
+    unsigned int m_numIndexingThreads; // 1 = sequential scan (default), 0 = one per hardware thread
     unsigned int m_numRetries; // specifies the number of times an unsuccessful
     // file operation should be repeated (default value is 5).
 
@@ -191,6 +193,10 @@ private:
 
     void SetSkipSequenceIds(bool skip);
 
+    void SetCacheIndex(bool cacheIndex);
+
+    void SetNumIndexingThreads(unsigned int numThreads);
+
     void SetChunkSize(size_t size);
 
     void SetNumRetries(unsigned int numRetries);
@@ -14,13 +14,43 @@ ChunkPtr ChunkCache::GetChunk(ChunkIdType chunkId)
     auto it = m_chunkMap.find(chunkId);
     if (it != m_chunkMap.end())
     {
-        return it->second;
+        m_numHits++;
+
+        // Move the chunk to the front of the LRU list.
+        m_lruList.splice(m_lruList.begin(), m_lruList, it->second.m_lruPosition);
+        return it->second.m_chunk;
     }
- 
+
+    m_numMisses++;
     ChunkPtr chunk = m_deserializer->GetChunk(chunkId);
-    m_chunkMap[chunkId] = chunk;
- 
+
+    m_lruList.push_front(chunkId);
+    CacheEntry entry = { chunk, chunk->SizeInBytes(), m_lruList.begin() };
+    m_chunkMap[chunkId] = entry;
+    m_sizeInBytes += entry.m_sizeInBytes;
+
+    EvictIfNeeded();
     return chunk;
 }
 
+void ChunkCache::EvictIfNeeded()
+{
+    if (m_maxSizeInBytes == 0)
+    {
+        return;
+    }
+
+    while (m_sizeInBytes > m_maxSizeInBytes && m_lruList.size() > 1)
+    {
+        ChunkIdType victim = m_lruList.back();
+        m_lruList.pop_back();
+
+        auto it = m_chunkMap.find(victim);
+        assert(it != m_chunkMap.end());
+        m_sizeInBytes -= it->second.m_sizeInBytes;
+        m_chunkMap.erase(it);
+        m_numEvictions++;
+    }
+}
+
 } } }
@@ -5,22 +5,33 @@
 
 #pragma once
 
-#include <map>
+#include <list>
+#include <unordered_map>
 #include "DataDeserializer.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
-// A cache to store the complete dataset (all chunks) in memory. The caching can
-// be switched on/off by a boolean flag in the reader config section, independent 
-// of the randomization and chunking parameters. The caching should only be enabled 
-// when the whole dataset fits in memory.
+// A cache to store chunks in memory. The caching can be switched on/off by a boolean
+// flag in the reader config section, independent of the randomization and chunking parameters.
 // Implemented as a wrapping proxy around a deserializer that stores pointers to
-// all chunks it sees in an internal map.
+// the chunks it sees in an internal map.
+// The cache can optionally be bounded by a memory budget (in bytes). In this case the least
+// recently used chunks are evicted once the total size reported by Chunk::SizeInBytes()
+// exceeds the budget. A budget of 0 means unbounded, i.e. the whole dataset is kept in memory.
+// Evicting a chunk only drops the reference held by the cache, the memory is freed once
+// all its sequences are released by the consumers.
 class ChunkCache : public IDataDeserializer
 {
 public:
 
-    ChunkCache(IDataDeserializerPtr deserializer) : m_deserializer(deserializer) { }
+    ChunkCache(IDataDeserializerPtr deserializer, size_t maxSizeInBytes = 0)
+        : m_deserializer(deserializer),
+          m_maxSizeInBytes(maxSizeInBytes),
+          m_sizeInBytes(0),
+          m_numHits(0),
+          m_numMisses(0),
+          m_numEvictions(0)
+    { }
 
     virtual std::vector<StreamDescriptionPtr> GetStreamDescriptions() const override
     {
@@ -45,11 +56,41 @@ public:
     // Gets chunk data given its id.
     virtual ChunkPtr GetChunk(ChunkIdType chunkId);
 
+    // Cache statistics.
+    size_t GetMaxSizeInBytes() const { return m_maxSizeInBytes; }
+    size_t GetSizeInBytes() const { return m_sizeInBytes; }
+    size_t GetNumberOfCachedChunks() const { return m_chunkMap.size(); }
+    size_t GetNumberOfHits() const { return m_numHits; }
+    size_t GetNumberOfMisses() const { return m_numMisses; }
+    size_t GetNumberOfEvictions() const { return m_numEvictions; }
+
 private:
+    // Evicts the least recently used chunks till the cache fits into the budget.
+    // The most recently used chunk is never evicted.
+    void EvictIfNeeded();
+
+    struct CacheEntry
+    {
+        ChunkPtr m_chunk;
+        size_t m_sizeInBytes;
+        std::list<ChunkIdType>::iterator m_lruPosition;
+    };
+
     // A map of currently loaded chunks
-    std::map<size_t, ChunkPtr> m_chunkMap;
+    std::unordered_map<ChunkIdType, CacheEntry> m_chunkMap;
+
+    // Chunk ids ordered by their last access, the most recently used first.
+    std::list<ChunkIdType> m_lruList;
+
     IDataDeserializerPtr m_deserializer;
 
+    size_t m_maxSizeInBytes; // 0 means the cache is not bounded
+    size_t m_sizeInBytes;    // total size of the currently cached chunks
+
+    size_t m_numHits;
+    size_t m_numMisses;
+    size_t m_numEvictions;
+
     DISABLE_COPY_AND_MOVE(ChunkCache);
 };
 
@@ -120,6 +120,13 @@ public:
     // deallocated till all its sequences are released.
     virtual void GetSequence(size_t sequenceId, std::vector<SequenceDataPtr>& result) = 0;
 
+    // Returns the approximate number of bytes the chunk occupies in memory.
+    // Used by caching proxies to budget memory; 0 means the size is unknown.
+    virtual size_t SizeInBytes() const
+    {
+        return 0;
+    }
+
     virtual ~Chunk() {};
 
 protected:
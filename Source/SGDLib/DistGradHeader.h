@@ -52,6 +52,37 @@ public:
         return DistGradHeaderSize(numEvalNode);
     }
 
+    // The header as an array of doubles, so that the headers of all workers can be summed with a single allreduce.
+    // The counts are exact as long as they stay below 2^53.
+    static size_t PackedSize(int numEvalNode)
+    {
+        return 3 + 2 * (size_t) numEvalNode;
+    }
+
+    void Pack(double* packed) const
+    {
+        packed[0] = (double) numSamples;
+        packed[1] = (double) numSamplesWithLabel;
+        packed[2] = criterion;
+        for (int i = 0; i < numEvalNode; i++)
+        {
+            packed[3 + 2 * i] = evalErrors[i].first;
+            packed[4 + 2 * i] = (double) evalErrors[i].second;
+        }
+    }
+
+    void Unpack(const double* packed)
+    {
+        numSamples = (size_t) packed[0];
+        numSamplesWithLabel = (size_t) packed[1];
+        criterion = packed[2];
+        for (int i = 0; i < numEvalNode; i++)
+        {
+            evalErrors[i].first  = packed[3 + 2 * i];
+            evalErrors[i].second = (size_t) packed[4 + 2 * i];
+        }
+    }
+
     void Clear()
     {
         numSamples = 0;
@@ -17,6 +17,10 @@
 #include <stdexcept>
 #include <chrono> 
 #include <random>
+#include <map>
+
+// the size of the buffers the parameters are packed into for pipelined model averaging
+#define DEFAULT_MODEL_AVERAGING_BUCKET_SIZE_IN_BYTES (16 * 1024 * 1024)
 
 
 namespace Microsoft { namespace MSR { namespace CNTK {
@@ -324,18 +328,69 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 
 
     // Implementation of standard model averaging 
+    //
+    // With useAsyncModelAveraging the averaging is pipelined, so that the workers do not stall at the sync points:
+    // each worker packs how far its model moved during the block into a few large buffers, starts non-blocking
+    // allreduces on them, and continues training right away. The average of these updates is applied at the next
+    // sync point (stale by one block), to a consensus model that is the same on all workers:
+    //     consensus(t) = consensus(t-1) + average update of block t-1
+    //     W_i(t)       = consensus(t) + update of worker i in block t
+    // i.e. a worker keeps its own latest update until the average that includes it arrives. At the end of an epoch
+    // the last average is waited for, which leaves all workers with the model synchronous averaging would compute
+    // from the same updates.
     template<typename ElemType>
     class BasicModelAveragingSGD : public IMASGD<ElemType>
     {
         typedef IMASGD<ElemType> Base; 
         using Base::m_pMPI;
+        using Base::m_deviceId;
         using Base::DownCast;
 
     public:
-        BasicModelAveragingSGD(const MPIWrapperPtr& pMPI, size_t reportFreq, DEVICEID_TYPE devID)
-            : Base(pMPI, reportFreq, devID)
+        BasicModelAveragingSGD(const MPIWrapperPtr& pMPI, size_t reportFreq, DEVICEID_TYPE devID, bool useAsyncModelAveraging = false,
+                               size_t bucketSizeInBytes = DEFAULT_MODEL_AVERAGING_BUCKET_SIZE_IN_BYTES)
+            : Base(pMPI, reportFreq, devID),
+              m_useAsyncModelAveraging(useAsyncModelAveraging),
+              m_bucketSizeInBytes(bucketSizeInBytes),
+              m_epochEnding(false),
+              m_numSamples(0)
+        {
+            fprintf(stderr, "Parallel training (%d workers) using ModelAveraging%s\n", (int)m_pMPI->NumNodesInUse(),
+                    m_useAsyncModelAveraging ? " with pipelined (stale-by-one) averaging" : "");
+        }
+
+        void OnEpochStart(const std::list<ComputationNodeBasePtr>& learnableNodes) override
         {
-            fprintf(stderr, "Parallel training (%d workers) using ModelAveraging\n",(int)m_pMPI->NumNodesInUse());
+            Base::OnEpochStart(learnableNodes);
+            if (!m_useAsyncModelAveraging)
+                return;
+
+            if (!m_pendingRequests.empty())
+                LogicError("BasicModelAveragingSGD: Unexpected pending model averaging at the start of an epoch.");
+            if (m_parameters.empty())
+                CreateBuckets(learnableNodes);
+
+            // the epoch starts from the same model on all workers
+            for (auto& pBaseNode : learnableNodes)
+            {
+                if (!pBaseNode->IsParameterUpdateRequired())
+                    continue;
+
+                const Matrix<ElemType>& value = DownCast(pBaseNode)->Value();
+                ParameterState& state = m_parameters.at(pBaseNode->NodeName());
+                state.m_consensus->SetValue(value);
+                state.m_blockStart->SetValue(value);
+            }
+        }
+
+        void OnEpochEnd(const std::list<ComputationNodeBasePtr>& learnableNodes,
+                        std::list<Matrix<ElemType>>& smoothedGradient,
+                        size_t samplesSinceLastSync) override
+        {
+            // the last sync point of the epoch waits for its averaging, see PipelinedModelAggregationProcessing()
+            m_epochEnding = true;
+            Base::OnEpochEnd(learnableNodes, smoothedGradient, samplesSinceLastSync);
+            m_epochEnding = false;
         }
 
         void ModelAggregationProcessing(
@@ -347,7 +402,12 @@ namespace Microsoft { namespace MSR { namespace CNTK {
             // NOTE: the variable type is determined by the interface in SGD::TrainOneEpoch
             // even for const std::list<ComputationNodeBasePtr>, the object being pointed to can still be modified 
         {
-            //----------------------------------------
+            if (m_useAsyncModelAveraging)
+            {
+                PipelinedModelAggregationProcessing(samplesSinceLastSync, learnableNodes, totalSamplesProcessed, secondsOnCommunication);
+                return;
+            }
+
             // 1. communicate with other nodes to negotiate  contribution weights
             //----------------------------------------
             float factor = 0;
@@ -402,6 +462,367 @@ namespace Microsoft { namespace MSR { namespace CNTK {
                 //delete[]px;
             }
         }
+
+    private:
+        // where a parameter is packed for the pipelined averaging, and the models it is applied to
+        struct ParameterState
+        {
+            size_t m_bucket;
+            size_t m_offset;
+            shared_ptr<Matrix<ElemType>> m_consensus;  // the model all workers agree on, which lags one block behind
+            shared_ptr<Matrix<ElemType>> m_blockStart; // the local model at the last sync point
+        };
+
+        // Packs the parameters, in the order of learnableNodes, into buffers of up to m_bucketSizeInBytes, which are
+        // reduced by a single MPI_Iallreduce each.
+        void CreateBuckets(const std::list<ComputationNodeBasePtr>& learnableNodes)
+        {
+            const size_t bucketSize = max(m_bucketSizeInBytes / sizeof(ElemType), (size_t)1);
+            std::vector<size_t> bucketSizes(1, 0);
+            for (auto& pBaseNode : learnableNodes)
+            {
+                if (!pBaseNode->IsParameterUpdateRequired())
+                    continue;
+
+                size_t numElements = DownCast(pBaseNode)->Value().GetNumElements();
+                if (bucketSizes.back() > 0 && bucketSizes.back() + numElements > bucketSize)
+                    bucketSizes.push_back(0);
+
+                ParameterState& state = m_parameters[pBaseNode->NodeName()];
+                state.m_bucket = bucketSizes.size() - 1;
+                state.m_offset = bucketSizes.back();
+                state.m_consensus = make_shared<Matrix<ElemType>>(m_deviceId);
+                state.m_blockStart = make_shared<Matrix<ElemType>>(m_deviceId);
+                bucketSizes.back() += numElements;
+            }
+
+            m_buckets.resize(bucketSizes.size());
+            for (size_t i = 0; i < m_buckets.size(); i++)
+                m_buckets[i].resize(bucketSizes[i]);
+        }
+
+        void StartAveraging(size_t bucket)
+        {
+            m_pendingRequests.push_back(MPI_REQUEST_NULL);
+            if (m_pMPI->NumNodesInUse() > 1)
+            {
+                std::vector<ElemType>& buffer = m_buckets[bucket];
+                MPI_Iallreduce(MPI_IN_PLACE, buffer.data(), (int)buffer.size(), MPIWrapper::GetDataType(buffer.data()), MPI_SUM, m_pMPI->Communicator(), &m_pendingRequests.back()) || MpiFail("MPI_Iallreduce");
+            }
+        }
+
+        // Waits for the averaging started at the previous sync point and adds the average update to the consensus.
+        // Returns the number of samples of all workers in that block, 0 if nothing was pending.
+        size_t CompletePendingAveraging(const std::list<ComputationNodeBasePtr>& learnableNodes)
+        {
+            if (m_pendingRequests.empty())
+                return 0;
+
+            MPI_Waitall((int)m_pendingRequests.size(), m_pendingRequests.data(), MPI_STATUSES_IGNORE) || MpiFail("MPI_Waitall");
+            m_pendingRequests.clear();
+
+            size_t totalSamples = m_numSamples;
+            ElemType factor = totalSamples > 0 ? (ElemType)(1.0 / totalSamples) : 0;
+            for (auto& pBaseNode : learnableNodes)
+            {
+                if (!pBaseNode->IsParameterUpdateRequired())
+                    continue;
+
+                ParameterState& state = m_parameters.at(pBaseNode->NodeName());
+                Matrix<ElemType>& consensus = *state.m_consensus;
+                Matrix<ElemType> averageUpdate(consensus.GetNumRows(), consensus.GetNumCols(), consensus.GetDeviceId());
+                averageUpdate.SetValue(consensus.GetNumRows(), consensus.GetNumCols(), consensus.GetDeviceId(), &m_buckets[state.m_bucket][state.m_offset]);
+                Matrix<ElemType>::ScaleAndAdd(factor, averageUpdate, consensus);
+            }
+            return totalSamples;
+        }
+
+        void PipelinedModelAggregationProcessing(
+            size_t samplesSinceLastSync,                                       /* in */
+            const std::list<ComputationNodeBasePtr>&  learnableNodes,          /* in/out */
+            size_t&                                   totalSamplesProcessed,   /* out */
+            float&                                    secondsOnCommunication   /* out */)
+        {
+            //----------------------------------------
+            // 1. apply the average of the previous block, which was communicated while this block was trained
+            //----------------------------------------
+            Timer commTimer;
+            commTimer.Start();
+            size_t samplesOfPreviousBlock = CompletePendingAveraging(learnableNodes);
+            commTimer.Stop();
+            secondsOnCommunication = (float)commTimer.ElapsedSeconds();
+
+            //----------------------------------------
+            // 2. start averaging the updates of this block, and a buffer as soon as it is packed
+            //----------------------------------------
+            // the samples are summed exactly in a separate reduction, an ElemType would round them above 2^24 for float
+            m_numSamples = samplesSinceLastSync;
+            m_pendingRequests.push_back(MPI_REQUEST_NULL);
+            if (m_pMPI->NumNodesInUse() > 1)
+                MPI_Iallreduce(MPI_IN_PLACE, &m_numSamples, 1, MPIWrapper::GetDataType(&m_numSamples), MPI_SUM, m_pMPI->Communicator(), &m_pendingRequests.back()) || MpiFail("MPI_Iallreduce");
+
+            size_t numStartedBuckets = 0;
+            for (auto& pBaseNode : learnableNodes)
+            {
+                if (!pBaseNode->IsParameterUpdateRequired())
+                    continue;
+
+                auto pNode = DownCast(pBaseNode);
+                Matrix<ElemType>& value = pNode->Value();
+                ParameterState& state = m_parameters.at(pBaseNode->NodeName());
+                while (numStartedBuckets < state.m_bucket)
+                    StartAveraging(numStartedBuckets++);
+
+                // 2.1. the update of this worker, weighted by its samples
+                Matrix<ElemType> localUpdate(value.DeepClone());
+                localUpdate -= *state.m_blockStart;
+                ElemType* packed = &m_buckets[state.m_bucket][state.m_offset];
+                localUpdate.CopySection(localUpdate.GetNumRows(), localUpdate.GetNumCols(), packed, localUpdate.GetNumRows());
+                for (size_t i = 0; i < localUpdate.GetNumElements(); i++)
+                    packed[i] *= (ElemType)samplesSinceLastSync;
+
+                // 2.2. continue from the consensus, plus the own update until its average arrives
+                value.AssignSumOf(*state.m_consensus, localUpdate);
+                state.m_blockStart->SetValue(value);
+            }
+            while (numStartedBuckets < m_buckets.size())
+                StartAveraging(numStartedBuckets++);
+
+            //----------------------------------------
+            // 3. at the end of an epoch all workers continue with the same model
+            //----------------------------------------
+            size_t samplesOfThisBlock = 0;
+            if (m_epochEnding)
+            {
+                commTimer.Restart();
+                samplesOfThisBlock = CompletePendingAveraging(learnableNodes);
+                commTimer.Stop();
+                secondsOnCommunication += (float)commTimer.ElapsedSeconds();
+
+                for (auto& pBaseNode : learnableNodes)
+                {
+                    if (!pBaseNode->IsParameterUpdateRequired())
+                        continue;
+
+                    ParameterState& state = m_parameters.at(pBaseNode->NodeName());
+                    DownCast(pBaseNode)->Value().SetValue(*state.m_consensus);
+                    state.m_blockStart->SetValue(*state.m_consensus);
+                }
+            }
+
+            // the samples of the other workers are only known when their averaging completes
+            totalSamplesProcessed = samplesOfPreviousBlock + samplesOfThisBlock;
+            if (totalSamplesProcessed == 0)
+                totalSamplesProcessed = samplesSinceLastSync * m_pMPI->NumNodesInUse(); // give an estimated one
+        }
+
+        bool m_useAsyncModelAveraging;
+        size_t m_bucketSizeInBytes;
+        bool m_epochEnding;
+        std::map<std::wstring, ParameterState> m_parameters;
+        std::vector<std::vector<ElemType>> m_buckets;
+        size_t m_numSamples; // the samples of this worker, of all workers once the averaging completes
+        std::vector<MPI_Request> m_pendingRequests;
+    };
+
+    // Implementation of blockwise model-update filtering (BMUF) with block momentum
+    // (K. Chen and Q. Huo, "Scalable training of deep learning machines by incremental block training with intra-block
+    // parallel optimization and blockwise model-update filtering", ICASSP 2016)
+    //
+    // At every sync point the workers average how far their models moved during the block, G(t) = W_start(t) - avg W_i(t),
+    // and filter it with a block-level momentum:
+    //     Delta(t) = blockMomentum * Delta(t-1) + blockLearningRate * G(t)
+    //     W(t)     = W(t-1) - Delta(t)
+    // The workers start the next block from W(t), or with Nesterov-style block momentum from the lookahead
+    // W(t) - blockMomentum * Delta(t). As W(t-1) = W_start(t) + blockMomentum * Delta(t-1) in that case, the start
+    // of the next block is W_start(t) - blockLearningRate * G(t) - blockMomentum * Delta(t).
+    template<typename ElemType>
+    class BlockMomentumSGD : public IMASGD<ElemType>
+    {
+        typedef IMASGD<ElemType> Base;
+        using Base::m_pMPI;
+        using Base::m_deviceId;
+        using Base::DownCast;
+
+    public:
+        BlockMomentumSGD(const MPIWrapperPtr& pMPI, size_t reportFreq, DEVICEID_TYPE devID,
+                         bool useNesterovMomentum, bool resetSGDMomentumAfterAggregation,
+                         double blockLearningRate, double blockMomentumAsTimeConstant, size_t syncPeriod)
+            : Base(pMPI, reportFreq, devID),
+              m_useNesterovMomentum(useNesterovMomentum),
+              m_resetSGDMomentumAfterAggregation(resetSGDMomentumAfterAggregation),
+              m_blockLearningRate(blockLearningRate),
+              m_blockMomentumAsTimeConstant(blockMomentumAsTimeConstant),
+              m_syncPeriod(syncPeriod)
+        {
+            fprintf(stderr, "Parallel training (%d workers) using BlockMomentumSGD with block momentum = %6.4f, block momentum time constant = %6.4f, block learning rate = %6.4f, block size = %d samples, %s Nesterov-style block momentum, %s SGD momentum after sync\n",
+                    (int)m_pMPI->NumNodesInUse(), TimeConstant2Momentum(m_blockMomentumAsTimeConstant, m_syncPeriod), m_blockMomentumAsTimeConstant,
+                    m_blockLearningRate, (int)m_syncPeriod, m_useNesterovMomentum ? "with" : "without", m_resetSGDMomentumAfterAggregation ? "resetting" : "keeping");
+        }
+
+        void OnEpochStart(const std::list<ComputationNodeBasePtr>& learnableNodes) override
+        {
+            Base::OnEpochStart(learnableNodes);
+            for (auto& pBaseNode : learnableNodes)
+            {
+                if (!pBaseNode->IsParameterUpdateRequired())
+                    continue;
+
+                // the block-level momentum carries over between epochs, and may have been loaded from a checkpoint
+                auto pNode = DownCast(pBaseNode);
+                const Matrix<ElemType>& value = pNode->Value();
+                auto& blockDelta = m_blockLevelSmoothedGradient[pBaseNode->NodeName()];
+                if (!blockDelta)
+                {
+                    blockDelta = make_shared<Matrix<ElemType>>(value.GetNumRows(), value.GetNumCols(), m_deviceId);
+                    blockDelta->SetValue(0);
+                }
+
+                auto& startValue = m_prevParameters[pBaseNode->NodeName()];
+                if (!startValue)
+                    startValue = make_shared<Matrix<ElemType>>(m_deviceId);
+                startValue->SetValue(value);
+            }
+        }
+
+        void ModelAggregationProcessing(
+            size_t samplesSinceLastSync,                                       /* in */
+            const std::list<ComputationNodeBasePtr>&  learnableNodes,          /* in/out */
+            std::list<Matrix<ElemType>>&              smoothedGradient,        /* in/out */
+            size_t&                                   totalSamplesProcessed,   /* out */
+            float&                                    secondsOnCommunication   /* out */) override
+        {
+            //----------------------------------------
+            // 1. communicate with other nodes to negotiate contribution weights, as BasicModelAveragingSGD
+            //----------------------------------------
+            ElemType factor = 0;
+            int nTotalSamples = (int)samplesSinceLastSync;
+            Timer commTimer;
+            secondsOnCommunication = 0.0f;
+            commTimer.Start();
+            m_pMPI->AllReduce(&nTotalSamples, 1);
+            commTimer.Stop();
+            secondsOnCommunication += (float)commTimer.ElapsedSeconds();
+
+            if (nTotalSamples <= 0)
+            {
+                factor = (ElemType)1.0 / m_pMPI->NumNodesInUse();
+                totalSamplesProcessed = samplesSinceLastSync * m_pMPI->NumNodesInUse();
+            }
+            else
+            {
+                factor = (ElemType)samplesSinceLastSync / nTotalSamples;
+                totalSamplesProcessed = nTotalSamples;
+            }
+
+            ElemType blockMomentum = (ElemType)TimeConstant2Momentum(m_blockMomentumAsTimeConstant, m_syncPeriod);
+            ElemType blockLearningRate = (ElemType)m_blockLearningRate;
+
+            //----------------------------------------
+            // 2. filter the averaged model update of each node
+            //----------------------------------------
+            for (auto& pBaseNode : learnableNodes)
+            {
+                if (!pBaseNode->IsParameterUpdateRequired())
+                    continue;
+
+                auto pNode = DownCast(pBaseNode);
+                Matrix<ElemType>& value = pNode->Value();
+                Matrix<ElemType>& startValue = *m_prevParameters.at(pBaseNode->NodeName());
+                Matrix<ElemType>& blockDelta = *m_blockLevelSmoothedGradient.at(pBaseNode->NodeName());
+
+                // 2.1. G(t), weighted by the samples of each worker
+                Matrix<ElemType> blockGradient(startValue.DeepClone());
+                blockGradient -= value;
+                Matrix<ElemType>::Scale(factor, blockGradient);
+                unique_ptr<ElemType[]> px(blockGradient.CopyToArray());
+                size_t nx = blockGradient.GetNumElements();
+                commTimer.Restart();
+                m_pMPI->AllReduce(px.get(), nx);
+                commTimer.Stop();
+                secondsOnCommunication += (float)commTimer.ElapsedSeconds();
+                blockGradient.SetValue(blockGradient.GetNumRows(), blockGradient.GetNumCols(), blockGradient.GetDeviceId(), px.get());
+
+                // 2.2. Delta(t) = blockMomentum * Delta(t-1) + blockLearningRate * G(t)
+                Matrix<ElemType>::ScaleAndAdd(blockLearningRate, blockGradient, blockMomentum, blockDelta);
+
+                // 2.3. the start of the next block
+                if (m_useNesterovMomentum)
+                {
+                    Matrix<ElemType>::ScaleAndAdd(-blockLearningRate, blockGradient, startValue);
+                    Matrix<ElemType>::ScaleAndAdd(-blockMomentum, blockDelta, startValue);
+                }
+                else
+                    startValue -= blockDelta;
+                value.SetValue(startValue);
+            }
+
+            //----------------------------------------
+            // 3. the local momentum belongs to the models of the previous block
+            //----------------------------------------
+            if (m_resetSGDMomentumAfterAggregation)
+            {
+                for (Matrix<ElemType>& x : smoothedGradient)
+                    x.SetValue(0);
+            }
+        }
+
+        void SaveToCheckPoint(File& fstream) override
+        {
+            fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BBlockMomentumSGD");
+            fstream << m_blockLevelSmoothedGradient.size();
+            for (const auto& iter : m_blockLevelSmoothedGradient)
+                fstream << iter.first << *iter.second;
+            fstream.PutMarker(FileMarker::fileMarkerEndSection, L"EBlockMomentumSGD");
+        }
+
+        void LoadFromCheckPoint(File& fstream) override
+        {
+            // checkpoints of other parallelization methods have no block momentum, which then starts at zero
+            if (!fstream.TryGetMarker(FileMarker::fileMarkerBeginSection, L"BBlockMomentumSGD"))
+                return;
+
+            size_t numMatrices;
+            fstream >> numMatrices;
+            m_blockLevelSmoothedGradient.clear();
+            for (size_t i = 0; i < numMatrices; i++)
+            {
+                wstring name;
+                fstream >> name;
+                auto blockDelta = make_shared<Matrix<ElemType>>(m_deviceId);
+                fstream >> *blockDelta;
+                m_blockLevelSmoothedGradient[name] = blockDelta;
+            }
+            fstream.GetMarker(FileMarker::fileMarkerEndSection, L"EBlockMomentumSGD");
+        }
+
+        // the block momentum per sync of syncPeriod samples, for a time constant given in samples
+        static double TimeConstant2Momentum(double timeConstant, size_t syncPeriod)
+        {
+            if (timeConstant == 0)
+                return 0;
+            return exp(-((double)syncPeriod) / timeConstant);
+        }
+
+        static double Momentum2TimeConstant(double blockMomentum, size_t syncPeriod)
+        {
+            if (blockMomentum < 0 || blockMomentum >= 1)
+                InvalidArgument("Block momentum must be in the range [0, 1), but is %.4f.", blockMomentum);
+            if (blockMomentum == 0)
+                return 0;
+            return -((double)syncPeriod) / log(blockMomentum);
+        }
+
+    private:
+        bool   m_useNesterovMomentum;
+        bool   m_resetSGDMomentumAfterAggregation;
+        double m_blockLearningRate;
+        double m_blockMomentumAsTimeConstant;
+        size_t m_syncPeriod;
+
+        // Delta(t) and W_start(t) of each learnable node, by node name
+        std::map<std::wstring, shared_ptr<Matrix<ElemType>>> m_blockLevelSmoothedGradient;
+        std::map<std::wstring, shared_ptr<Matrix<ElemType>>> m_prevParameters;
     };
 
 } } }
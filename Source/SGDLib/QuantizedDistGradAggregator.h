@@ -0,0 +1,298 @@
+#pragma once
+
+#include "IDistGradAggregator.h"
+#include "CUDAPageLockedMemAllocator.h"
+#include "TimerUtility.h"
+#include "MatrixQuantizerImpl.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// Aggregates gradients quantized to 1, 2, 4, 8 (or, for double, 16) bits per value, with error feedback: the
+// quantization error of each worker is kept as a residual and added to its gradient of the next minibatch.
+//
+// The columns of each quantized gradient are divided into one stripe per worker. Every worker sends its quantized
+// stripe s to worker s (a reduce-scatter), which sums the stripes it received, quantizes the sum again, with a
+// residual of its own, and sends the result to all workers (an allgather). Columns are quantized independently
+// (see ColumnQuantizer), so the stripes of a quantized matrix are contiguous and each exchange is a single
+// MPI_Ialltoallv or MPI_Iallgatherv per gradient.
+//
+// Gradients smaller than the given size, or with so few rows that quantizing their columns would not halve them,
+// are packed into one buffer and summed in full precision with a single allreduce.
+template <class ElemType>
+class QuantizedDistGradAggregator : public IDistGradAggregator<ElemType>
+{
+    UsingIDistGradAggregatorMembers;
+
+public:
+    QuantizedDistGradAggregator(const MPIWrapperPtr& mpi, int numGradientBits, bool zeroThresholdFor1Bit, int syncStatsTrace, size_t minQuantizedSizeInBytes)
+        : IDistGradAggregator<ElemType>(mpi), m_numGradientBits(numGradientBits), m_zeroThresholdFor1Bit(zeroThresholdFor1Bit), m_syncStatsTrace(syncStatsTrace),
+          m_minQuantizedSizeInBytes(minQuantizedSizeInBytes), m_iterationCount(0), m_initialized(false)
+    {
+        if ((numGradientBits < 1) || (numGradientBits >= 8 * sizeof(ElemType)) || ((numGradientBits & (numGradientBits - 1)) != 0))
+            InvalidArgument("QuantizedDistGradAggregator: gradientBits must be a power of two less than %d, but is %d.", (int)(8 * sizeof(ElemType)), numGradientBits);
+    }
+
+    bool AggregateGradients(const std::vector<Matrix<ElemType>*>& gradients, DistGradHeader* headerCPU, bool resetState) override
+    {
+        ResetState(gradients, headerCPU->numEvalNode, resetState);
+        bool showSyncPerfStats = (m_syncStatsTrace > 0) && ((m_iterationCount % m_syncStatsTrace) == 0);
+        m_iterationCount++;
+
+        AggregateGradientsImpl(gradients, headerCPU, showSyncPerfStats);
+        return (headerCPU->numSamples != 0);
+    }
+
+private:
+    // The buffers of a gradient that is exchanged in quantized form. All but the residual of the gradient are on the CPU.
+    struct QuantizedGradient
+    {
+        size_t m_gradientIndex;
+        std::unique_ptr<MatrixQuantizerImpl<ElemType>> m_quantizer;
+        std::unique_ptr<Matrix<ElemType>> m_residual;               // quantization error of this worker's gradient
+        std::unique_ptr<QuantizedMatrix<ElemType>> m_quantized;     // the gradient, later the aggregate; stripe by stripe
+        std::unique_ptr<QuantizedMatrix<ElemType>> m_stripes;       // this worker's stripe of the gradient of every worker
+        std::unique_ptr<Matrix<ElemType>> m_stripeSum;
+        std::unique_ptr<Matrix<ElemType>> m_stripeResidual;         // quantization error of this worker's stripe of the aggregate
+        size_t m_stripeStartCol;
+        size_t m_stripeNumCols;
+        std::vector<int> m_stripeBytes, m_stripeOffsets;            // of each worker's stripe in m_quantized
+        std::vector<int> m_receivedBytes, m_receivedOffsets;        // of each worker's contribution in m_stripes
+    };
+
+    // Divides the columns into numStripes stripes as evenly as possible.
+    static void GetStripe(size_t numCols, size_t numStripes, size_t stripe, size_t& startCol, size_t& numStripeCols)
+    {
+        size_t stripeCols = numCols / numStripes;
+        size_t remainder = numCols % numStripes;
+        startCol = (stripe * stripeCols) + std::min(stripe, remainder);
+        numStripeCols = stripeCols + ((stripe < remainder) ? 1 : 0);
+    }
+
+    bool ShouldQuantize(const Matrix<ElemType>& gradient) const
+    {
+        size_t numRows = gradient.GetNumRows();
+        size_t quantizedColSize = QuantizedColumn<ElemType>::QuantizedColumnSize(m_numGradientBits, numRows);
+        return (gradient.GetNumElements() * sizeof(ElemType) >= m_minQuantizedSizeInBytes) && (2 * quantizedColSize <= numRows * sizeof(ElemType));
+    }
+
+    void ResetState(const std::vector<Matrix<ElemType>*>& gradients, int numEvalNodes, bool resetState)
+    {
+        if (!m_initialized)
+        {
+            m_initialized = true;
+            int deviceId = gradients[0]->GetDeviceId();
+            if (deviceId != CPUDEVICE)
+                m_allocator.reset(new CUDAPageLockedMemAllocator(deviceId));
+
+            m_cpuQuantizer.reset(MatrixQuantizerImpl<ElemType>::Create(CPUDEVICE, /*useAsync=*/false));
+
+            size_t numSmallElements = 0;
+            for (size_t i = 0; i < gradients.size(); i++)
+            {
+                // Make sure none of the gradient matrixes are sparse - we currently do not support aggregation of sparse gradient matrices
+                if (gradients[i]->GetMatrixType() != DENSE)
+                    RuntimeError("Gradient aggregation for sparse gradient matrices is currently unsupported!");
+
+                if (ShouldQuantize(*gradients[i]))
+                    InitQuantizedGradient(i, *gradients[i]);
+                else
+                {
+                    m_smallGradientIndices.push_back(i);
+                    numSmallElements += gradients[i]->GetNumElements();
+                }
+            }
+            m_smallGradientBuffer.resize(numSmallElements);
+
+            m_packedHeader.resize(DistGradHeader::PackedSize(numEvalNodes));
+        }
+        else if (resetState)
+        {
+            for (auto& q : m_quantizedGradients)
+            {
+                q.m_residual->SetValue(0);
+                if (q.m_stripeResidual)
+                    q.m_stripeResidual->SetValue(0);
+            }
+        }
+    }
+
+    void InitQuantizedGradient(size_t gradientIndex, const Matrix<ElemType>& gradient)
+    {
+        int deviceId = gradient.GetDeviceId();
+        size_t numRows = gradient.GetNumRows();
+        size_t numCols = gradient.GetNumCols();
+        size_t quantizedColSize = QuantizedColumn<ElemType>::QuantizedColumnSize(m_numGradientBits, numRows);
+
+        m_quantizedGradients.push_back(QuantizedGradient());
+        QuantizedGradient& q = m_quantizedGradients.back();
+        q.m_gradientIndex = gradientIndex;
+        q.m_quantizer.reset(MatrixQuantizerImpl<ElemType>::Create(deviceId, /*useAsync=*/false));
+        q.m_residual.reset(new Matrix<ElemType>(numRows, numCols, deviceId));
+        q.m_residual->SetValue(0);
+        q.m_quantized.reset(new QuantizedMatrix<ElemType>(numRows, numCols, m_numGradientBits, CPUDEVICE, m_allocator.get()));
+
+        for (size_t s = 0; s < NumProc(); s++)
+        {
+            size_t startCol, numStripeCols;
+            GetStripe(numCols, NumProc(), s, startCol, numStripeCols);
+            q.m_stripeBytes.push_back((int)(numStripeCols * quantizedColSize));
+            q.m_stripeOffsets.push_back((int)(startCol * quantizedColSize));
+        }
+
+        GetStripe(numCols, NumProc(), MyRank(), q.m_stripeStartCol, q.m_stripeNumCols);
+        for (size_t s = 0; s < NumProc(); s++)
+        {
+            q.m_receivedBytes.push_back((int)(q.m_stripeNumCols * quantizedColSize));
+            q.m_receivedOffsets.push_back((int)(s * q.m_stripeNumCols * quantizedColSize));
+        }
+
+        // with more workers than columns some workers have no stripe
+        if (q.m_stripeNumCols > 0)
+        {
+            q.m_stripes.reset(new QuantizedMatrix<ElemType>(numRows, q.m_stripeNumCols * NumProc(), m_numGradientBits, CPUDEVICE));
+            q.m_stripeSum.reset(new Matrix<ElemType>(numRows, q.m_stripeNumCols, CPUDEVICE));
+            q.m_stripeResidual.reset(new Matrix<ElemType>(numRows, q.m_stripeNumCols, CPUDEVICE));
+            q.m_stripeResidual->SetValue(0);
+        }
+    }
+
+    // Sums the stripes of this worker received from all workers and quantizes the sum into its stripe of m_quantized.
+    void AggregateStripe(QuantizedGradient& q)
+    {
+        if (q.m_stripeNumCols == 0)
+            return;
+
+        for (size_t s = 0; s < NumProc(); s++)
+        {
+            QuantizedMatrix<ElemType> received = q.m_stripes->ColumnSlice(s * q.m_stripeNumCols, q.m_stripeNumCols);
+            m_cpuQuantizer->UnquantizeAsync(received, *q.m_stripeSum, /*add=*/s > 0);
+            m_cpuQuantizer->WaitUnquantizeAsyncDone();
+        }
+
+        QuantizedMatrix<ElemType> stripe = q.m_quantized->ColumnSlice(q.m_stripeStartCol, q.m_stripeNumCols);
+        m_cpuQuantizer->QuantizeAsync(*q.m_stripeSum, *q.m_stripeResidual, stripe, *q.m_stripeResidual, m_zeroThresholdFor1Bit);
+        m_cpuQuantizer->WaitQuantizeAsyncDone();
+    }
+
+    void AggregateGradientsImpl(const std::vector<Matrix<ElemType>*>& gradients, DistGradHeader* headerCPU, bool showSyncPerfStats)
+    {
+        Timer aggregationTimer;
+        int deviceId = gradients[0]->GetDeviceId();
+        if (showSyncPerfStats)
+        {
+            std::unique_ptr<MatrixComputeStreamEvent> mainStreamSyncEvent(MatrixComputeStreamEvent::Create(deviceId));
+            mainStreamSyncEvent->SynchronizeEvent();
+            aggregationTimer.Start();
+        }
+
+        if (headerCPU->numSamples == 0)
+        {
+            assert(headerCPU->criterion == 0.0);
+            assert(headerCPU->numSamplesWithLabel == 0);
+
+            // If the current node did not process any samples, the gradients should be zero'd
+            for (size_t i = 0; i < gradients.size(); ++i)
+                gradients[i]->SetValue(0);
+        }
+
+        // Quantize the gradients, adding the residuals of the previous minibatch, and start sending the stripes to their workers
+        size_t numQuantized = m_quantizedGradients.size();
+        std::vector<MPI_Request> requests(numQuantized);
+        for (size_t i = 0; i < numQuantized; ++i)
+        {
+            QuantizedGradient& q = m_quantizedGradients[i];
+            q.m_quantizer->QuantizeAsync(*gradients[q.m_gradientIndex], *q.m_residual, *q.m_quantized, *q.m_residual, m_zeroThresholdFor1Bit);
+            q.m_quantizer->WaitQuantizeAsyncDone();
+
+            char* stripes = q.m_stripes ? q.m_stripes->Buffer() : nullptr;
+            MPI_Ialltoallv(q.m_quantized->Buffer(), q.m_stripeBytes.data(), q.m_stripeOffsets.data(), MPI_CHAR,
+                           stripes, q.m_receivedBytes.data(), q.m_receivedOffsets.data(), MPI_CHAR, m_mpi->Communicator(), &requests[i]) || MpiFail("MPI_Ialltoallv");
+        }
+
+        // Sum the small gradients in full precision
+        MPI_Request smallGradientsRequest = MPI_REQUEST_NULL;
+        if (!m_smallGradientBuffer.empty())
+        {
+            size_t offset = 0;
+            for (size_t i : m_smallGradientIndices)
+            {
+                gradients[i]->CopySection(gradients[i]->GetNumRows(), gradients[i]->GetNumCols(), &m_smallGradientBuffer[offset], gradients[i]->GetNumRows());
+                offset += gradients[i]->GetNumElements();
+            }
+            MPI_Iallreduce(MPI_IN_PLACE, m_smallGradientBuffer.data(), (int)m_smallGradientBuffer.size(), MPIWrapper::GetDataType(m_smallGradientBuffer.data()), MPI_SUM, m_mpi->Communicator(), &smallGradientsRequest) || MpiFail("MPI_Iallreduce");
+        }
+
+        // Sum the headers with a single small allreduce
+        MPI_Request headerRequest;
+        headerCPU->Pack(m_packedHeader.data());
+        MPI_Iallreduce(MPI_IN_PLACE, m_packedHeader.data(), (int)m_packedHeader.size(), MPIWrapper::GetDataType(m_packedHeader.data()), MPI_SUM, m_mpi->Communicator(), &headerRequest) || MpiFail("MPI_Iallreduce");
+
+        // As the stripes arrive, aggregate them and start sending the aggregates to all workers
+        for (size_t i = 0; i < numQuantized; ++i)
+        {
+            QuantizedGradient& q = m_quantizedGradients[i];
+            MPI_Wait(&requests[i], MPI_STATUS_IGNORE) || MpiFail("MPI_Wait");
+            AggregateStripe(q);
+            MPI_Iallgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, q.m_quantized->Buffer(), q.m_stripeBytes.data(), q.m_stripeOffsets.data(), MPI_CHAR, m_mpi->Communicator(), &requests[i]) || MpiFail("MPI_Iallgatherv");
+        }
+
+        MPI_Wait(&headerRequest, MPI_STATUS_IGNORE) || MpiFail("MPI_Wait");
+        headerCPU->Unpack(m_packedHeader.data());
+
+        if (!m_smallGradientBuffer.empty())
+        {
+            MPI_Wait(&smallGradientsRequest, MPI_STATUS_IGNORE) || MpiFail("MPI_Wait");
+            size_t offset = 0;
+            for (size_t i : m_smallGradientIndices)
+            {
+                gradients[i]->SetValue(gradients[i]->GetNumRows(), gradients[i]->GetNumCols(), deviceId, &m_smallGradientBuffer[offset]);
+                offset += gradients[i]->GetNumElements();
+            }
+        }
+
+        for (size_t i = 0; i < numQuantized; ++i)
+        {
+            QuantizedGradient& q = m_quantizedGradients[i];
+            MPI_Wait(&requests[i], MPI_STATUS_IGNORE) || MpiFail("MPI_Wait");
+            q.m_quantizer->UnquantizeAsync(*q.m_quantized, *gradients[q.m_gradientIndex], /*add=*/false);
+        }
+        for (auto& q : m_quantizedGradients)
+            q.m_quantizer->WaitUnquantizeAsyncDone();
+
+        if (showSyncPerfStats)
+        {
+            aggregationTimer.Stop();
+            size_t quantizedBytes = 0, fullBytes = 0;
+            for (const auto& q : m_quantizedGradients)
+            {
+                quantizedBytes += q.m_quantized->GetSize();
+                fullBytes += gradients[q.m_gradientIndex]->GetNumElements() * sizeof(ElemType);
+            }
+            fprintf(stderr, "Actual gradient aggregation time: %.6g\n", aggregationTimer.ElapsedSeconds());
+            fprintf(stderr, "Gradient aggregation quantized %d matrices to %d bits (%d bytes instead of %d), %d small matrices in full precision.\n",
+                    (int)numQuantized, m_numGradientBits, (int)quantizedBytes, (int)fullBytes, (int)m_smallGradientIndices.size());
+        }
+    }
+
+private:
+    int m_numGradientBits;
+    bool m_zeroThresholdFor1Bit;
+    int m_syncStatsTrace;
+    size_t m_minQuantizedSizeInBytes;
+
+    // Only used for controlling frequency of measuring/showing gradient aggregation perf stats
+    size_t m_iterationCount;
+
+    bool m_initialized;
+
+    std::unique_ptr<CUDAPageLockedMemAllocator> m_allocator;
+    std::unique_ptr<MatrixQuantizerImpl<ElemType>> m_cpuQuantizer;
+    std::vector<QuantizedGradient> m_quantizedGradients;
+
+    std::vector<size_t> m_smallGradientIndices;
+    std::vector<ElemType> m_smallGradientBuffer;
+
+    // the header as summed by the allreduce, see DistGradHeader::Pack()
+    std::vector<double> m_packedHeader;
+};
+} } }
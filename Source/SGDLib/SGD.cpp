@@ -13,10 +13,10 @@
 //static inline bool operator==(const std::pair<double,size_t>& a, double b) { assert(b==0); return a.first == b; }
 // ^^ workaround until this line in AggregateGradientsImpl() gets updated: assert(headerCPU->evalErrors[i] == 0);
 #include "AllReduceDistGradAggregator.h"
-#include "BlockMomentumSGD.h"
 #endif
 
 #include "SimpleDistGradAggregator.h"
+#include "QuantizedDistGradAggregator.h"
 #include "ProgressTracing.h"
 
 #include <map>
@@ -1943,10 +1943,20 @@ void SGD<ElemType>::InitDistGradAgg(int numEvalNodes, int numGradientBits, int t
 #else
     if (numGradientBits != (8 * sizeof(ElemType)))
     {
-        RuntimeError("Gradient quantization is unsupported in CNTK binaries built without quantized gradient aggregation support!");
+        if (m_bufferedAsyncGradientAggregation)
+            fprintf(stderr, "WARNING: useBufferedAsyncGradientAggregation is ignored with gradient quantization, gradients are aggregated synchronously.\n");
+        if (m_useHierarchicalAllReduce)
+            fprintf(stderr, "WARNING: useHierarchicalAllReduce is ignored with gradient quantization.\n");
+
+        m_distGradAgg = std::make_shared<QuantizedDistGradAggregator<ElemType>>(m_mpi, numGradientBits, m_zeroThresholdFor1Bit, m_syncStatsTrace, m_gradientBucketSizeInBytes);
     }
+    else
+    {
+        if (m_useHierarchicalAllReduce && !m_mpi->IsSplitByHost())
+            m_mpi->SplitByHost(m_ranksPerHost);
 
-    m_distGradAgg = std::make_shared<SimpleDistGradAggregator<ElemType>>(m_mpi, m_bufferedAsyncGradientAggregation, m_syncStatsTrace);
+        m_distGradAgg = std::make_shared<SimpleDistGradAggregator<ElemType>>(m_mpi, m_bufferedAsyncGradientAggregation, m_syncStatsTrace, m_gradientBucketSizeInBytes, m_useHierarchicalAllReduce);
+    }
 #endif // !CNTK_PARALLEL_TRAINING_SUPPORT
 
     m_gradHeader.reset(DistGradHeader::Create(numEvalNodes), [](DistGradHeader* ptr) { DistGradHeader::Destroy(ptr); });
@@ -1961,18 +1971,14 @@ void SGD<ElemType>::InitModelAggregationHandler(int traceLevel, DEVICEID_TYPE de
     }
     if (GetParallelizationMethod() == ParallelizationMethod::modelAveragingSGD)
     {
-        m_pMASGDHelper = make_shared<BasicModelAveragingSGD<ElemType>>(m_mpi, traceLevel, devID);
+        m_pMASGDHelper = make_shared<BasicModelAveragingSGD<ElemType>>(m_mpi, traceLevel, devID, m_useAsyncModelAveraging);
     }
     else if (GetParallelizationMethod() == ParallelizationMethod::blockMomentumSGD)
     {
-#ifndef CNTK_PARALLEL_TRAINING_SUPPORT
-        RuntimeError("Block Momentum is not supported in the main CNTK repo. You need to enable 1bit submodule.");
-#else
         m_pMASGDHelper = make_shared<BlockMomentumSGD<ElemType>>(m_mpi, traceLevel, devID, 
                                                                  m_useNesterovBlockMomentum, m_resetSGDMomentum, 
                                                                  m_blockLearningRate, m_blockMomentumAsTimeConstant, 
                                                                  m_modelAggregationBlockSize);
-#endif 
     }
 }
 
@@ -2693,9 +2699,13 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
     m_numGradientBits = vector<int>{8 * (int)sizeofElemType}; // means no quantization
     m_zeroThresholdFor1Bit = true;
     m_bufferedAsyncGradientAggregation = false;
+    m_gradientBucketSizeInBytes = DEFAULT_GRADIENT_BUCKET_SIZE_IN_BYTES;
+    m_useHierarchicalAllReduce = false;
+    m_ranksPerHost = 0;
     m_enableDistributedMBReading = false;
     m_parallelizationStartEpochNum = 0;
     m_modelAggregationBlockSize = 0; 
+    m_useAsyncModelAveraging = false;
 
     if (configSGD.Exists(L"ParallelTrain"))
     {
@@ -2726,15 +2736,21 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
             m_numGradientBits = configDataParallelSGD(L"gradientBits", ConfigRecordType::Array(intargvector(vector<int>{defaultGradientBits})));
             m_zeroThresholdFor1Bit = configDataParallelSGD(L"useZeroThresholdFor1BitQuantization", true);
             m_bufferedAsyncGradientAggregation = configDataParallelSGD(L"useBufferedAsyncGradientAggregation", false);
+            m_gradientBucketSizeInBytes = configDataParallelSGD(L"gradientBucketSizeInKB", (size_t)(DEFAULT_GRADIENT_BUCKET_SIZE_IN_BYTES / 1024)) * 1024;
+            m_useHierarchicalAllReduce = configDataParallelSGD(L"useHierarchicalAllReduce", false);
+            m_ranksPerHost = configDataParallelSGD(L"ranksPerHost", (size_t)0);
             for (size_t i = 0; i < m_numGradientBits.size(); i++)
             {
                 if (m_numGradientBits[i] < 1 || m_numGradientBits[i] > defaultGradientBits)
                     InvalidArgument("gradientBits values must be in the range [1, 32] when using precision=float and in range [1, 64] when using precision=double.");
+                if ((m_numGradientBits[i] & (m_numGradientBits[i] - 1)) != 0)
+                    InvalidArgument("gradientBits values must be powers of two.");
             }
         }
         if (configParallelTrain.Exists(L"ModelAveragingSGD"))
         {
             const ConfigRecordType& configMASGD(configParallelTrain(L"ModelAveragingSGD", ConfigRecordType::Record()));
+                m_useAsyncModelAveraging = configMASGD(L"useAsyncModelAveraging", false);
                 if (configMASGD.Exists(L"blockSizePerWorker") && configMASGD.Exists(L"blockSize"))
                     InvalidArgument("It is only allowed to set blockSizePerWorker or blockSize, not both of them");
                 else if (configMASGD.Exists(L"blockSize"))
@@ -2767,9 +2783,6 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
         }
         if (configParallelTrain.Exists(L"BlockMomentumSGD"))
         {
-#ifndef CNTK_PARALLEL_TRAINING_SUPPORT
-            InvalidArgument("BlockMomentumSGD is not enabled in this version.\n"); 
-#else
             const ConfigRecordType& configBMSGD(configParallelTrain(L"BlockMomentumSGD", ConfigRecordType::Record()));
                 if (configBMSGD.Exists(L"blockSize") && configBMSGD.Exists(L"blockSizePerWorker"))
                     InvalidArgument("It is only allowed to set blockSizePerWorker or blockSize, not both of them");
@@ -2816,7 +2829,6 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
                     double blockMomentum = 1.0 - 1.0 / (double)numMPIWorkers;   // this is a default value which ensures each block update contributes equally
                     m_blockMomentumAsTimeConstant = BlockMomentumSGD<double>::Momentum2TimeConstant(blockMomentum, m_modelAggregationBlockSize);
             }
-#endif 
                 InitializeAndCheckBlockMomentumSGDParameters();
         }
         } // if (!pMPI)
@@ -2841,7 +2853,6 @@ SGDParams::SGDParams(const ScriptableObjects::IConfigRecordPtr configp)
 
 void SGDParams::InitializeAndCheckBlockMomentumSGDParameters()
 {
-#ifdef CNTK_PARALLEL_TRAINING_SUPPORT 
     // final argument checking in case of user specifying a bad parameter
     size_t numMPIWorker = MPIWrapper::GetInstance()->NumNodesInUse();
     double blockMomentum = BlockMomentumSGD<double>::TimeConstant2Momentum(m_blockMomentumAsTimeConstant, m_modelAggregationBlockSize);
@@ -2853,11 +2864,6 @@ void SGDParams::InitializeAndCheckBlockMomentumSGDParameters()
     {
         fprintf(stderr, "WARNING: blockMomentum equals to zero. \n");
     }
-#else
-    // don't need do anything here 
-    m_blockMomentumAsTimeConstant = 0.0;
-    m_blockLearningRate = 1.0;
-#endif 
 }
 
 // register SGD<> with the ScriptableObject system
@@ -274,9 +274,17 @@ protected:
     intargvector m_numGradientBits;
     bool m_bufferedAsyncGradientAggregation;
     bool m_zeroThresholdFor1Bit;
+    // gradients smaller than this are packed into fusion buffers of about this size, each reduced with a single allreduce (0: no packing);
+    // with gradient quantization they are not quantized but reduced in full precision
+    size_t m_gradientBucketSizeInBytes;
+    // reduce the gradients within each host before reducing them across hosts; ranksPerHost > 0 groups consecutive ranks
+    // instead of those on the same host
+    bool m_useHierarchicalAllReduce;
+    size_t m_ranksPerHost;
 
     // Parallel training related with MA / BM
     size_t m_modelAggregationBlockSize;
+    bool   m_useAsyncModelAveraging;
     bool   m_resetSGDMomentum; 
     bool   m_useNesterovBlockMomentum;
     double m_blockLearningRate; 
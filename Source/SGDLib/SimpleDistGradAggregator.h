@@ -3,10 +3,14 @@
 #include "IDistGradAggregator.h"
 #include "CUDAPageLockedMemAllocator.h"
 #include <future>
+#include <unordered_map>
 #include "GPUDataTransferer.h"
 #include "TimerUtility.h"
 #include "MatrixQuantizerImpl.h"
 
+// Gradients smaller than this are packed into contiguous buffers of about this size, reduced by a single allreduce each
+#define DEFAULT_GRADIENT_BUCKET_SIZE_IN_BYTES (32 * 1024)
+
 namespace Microsoft { namespace MSR { namespace CNTK {
 
 template <class ElemType>
@@ -15,15 +19,16 @@ class SimpleDistGradAggregator : public IDistGradAggregator<ElemType>
     UsingIDistGradAggregatorMembers;
 
 public:
-    SimpleDistGradAggregator(const MPIWrapperPtr& mpi, bool useAsyncAggregation, int syncStatsTrace)
-        : IDistGradAggregator<ElemType>(mpi), m_useAsyncAggregation(useAsyncAggregation), m_initialized(false), m_bufferedGradHeader(nullptr), m_syncStatsTrace(syncStatsTrace), m_iterationCount(0)
-    {}
+    SimpleDistGradAggregator(const MPIWrapperPtr& mpi, bool useAsyncAggregation, int syncStatsTrace, size_t bucketSizeInBytes = DEFAULT_GRADIENT_BUCKET_SIZE_IN_BYTES, bool useHierarchicalAllReduce = false)
+        : IDistGradAggregator<ElemType>(mpi), m_useAsyncAggregation(useAsyncAggregation), m_initialized(false), m_bufferedGradHeader(nullptr), m_syncStatsTrace(syncStatsTrace), m_iterationCount(0), m_bucketSizeInBytes(bucketSizeInBytes), m_useHierarchicalAllReduce(useHierarchicalAllReduce)
+    {
+        // the ranks are grouped by their actual hosts unless the caller has split them already
+        if (m_useHierarchicalAllReduce && !m_mpi->IsSplitByHost())
+            m_mpi->SplitByHost();
+    }
 
     ~SimpleDistGradAggregator()
     {
-        for (size_t i = 0; i < m_recvHeaders.size(); ++i)
-            DistGradHeader::Destroy(m_recvHeaders[i]);
-
         if (m_bufferedGradHeader != nullptr)
             DistGradHeader::Destroy(m_bufferedGradHeader);
     }
@@ -117,6 +122,19 @@ public:
     }
 
 private:
+    // A group of gradients that is reduced with a single MPI_Iallreduce call, see CreateBuckets()
+    struct GradientBucket
+    {
+        GradientBucket()
+            : m_numElements(0), m_packed(false)
+        {}
+
+        std::vector<size_t> m_gradientIndices;
+        size_t m_numElements;
+        bool m_packed; // the gradients are copied into m_fusionBuffer for the reduction
+        std::shared_ptr<Matrix<ElemType>> m_fusionBuffer;
+    };
+
     std::shared_ptr<ElemType> AllocateIntermediateBuffer(int deviceID, size_t numElements)
     {
         assert(deviceID >= 0);
@@ -145,14 +163,18 @@ private:
                 if (gradients[i]->GetMatrixType() != DENSE)
                     RuntimeError("Gradient aggregation for sparse gradient matrices is currently unsupported!");
 
+                if (m_useAsyncAggregation)
+                    m_bufferedGradients[gradients[i]].reset(new Matrix<ElemType>(gradients[i]->GetNumRows(), gradients[i]->GetNumCols(), deviceId));
+            }
+
+            CreateBuckets(gradients);
+            for (const auto& bucket : m_buckets)
+            {
                 if (deviceId != CPUDEVICE)
                 {
                     m_gpuDataTransferers.push_back(std::unique_ptr<GPUDataTransferer<ElemType>>(new GPUDataTransferer<ElemType>(deviceId, m_useAsyncAggregation)));
-                    m_intermediateCPUBuffers.push_back(AllocateIntermediateBuffer(deviceId, gradients[i]->GetNumElements()));
+                    m_intermediateCPUBuffers.push_back(AllocateIntermediateBuffer(deviceId, bucket.m_numElements));
                 }
-
-                if (m_useAsyncAggregation)
-                    m_bufferedGradients[gradients[i]].reset(new Matrix<ElemType>(gradients[i]->GetNumRows(), gradients[i]->GetNumCols(), deviceId));
             }
 
             if (m_useAsyncAggregation)
@@ -161,11 +183,7 @@ private:
                 m_bufferedGradHeader->Clear();
             }
 
-            if (m_mpi->IsMainNode())
-            {
-                for (size_t i = 0; i < NumProc() - 1; ++i)
-                    m_recvHeaders.push_back(DistGradHeader::Create(numEvalNodes));
-            }
+            m_packedHeader.resize(DistGradHeader::PackedSize(numEvalNodes));
         }
         else if (resetState)
         {
@@ -184,6 +202,63 @@ private:
         }
     }
 
+    // Groups the gradients into buckets that are reduced by a single MPI_Iallreduce call each. Consecutive gradients
+    // smaller than the bucket size are packed into a contiguous fusion buffer of up to that size, since for
+    // small messages the per-call latency dominates. Larger gradients are reduced in place, one per bucket.
+    // Only the sizes and the order of the gradients matter, so the buckets also apply to the buffered gradients
+    // used for async aggregation.
+    void CreateBuckets(const std::vector<Matrix<ElemType>*>& gradients)
+    {
+        const size_t bucketSize = m_bucketSizeInBytes / sizeof(ElemType);
+        m_buckets.clear();
+        for (size_t i = 0; i < gradients.size(); i++)
+        {
+            size_t numElements = gradients[i]->GetNumElements();
+            bool pack = numElements < bucketSize;
+            if (m_buckets.empty() || !pack || !m_buckets.back().m_packed || (m_buckets.back().m_numElements + numElements > bucketSize))
+            {
+                m_buckets.push_back(GradientBucket());
+                m_buckets.back().m_packed = pack;
+            }
+
+            GradientBucket& bucket = m_buckets.back();
+            bucket.m_gradientIndices.push_back(i);
+            bucket.m_numElements += numElements;
+        }
+
+        int deviceId = gradients[0]->GetDeviceId();
+        for (auto& bucket : m_buckets)
+        {
+            // a single small gradient does not need to be copied around
+            bucket.m_packed = bucket.m_packed && (bucket.m_gradientIndices.size() > 1);
+            if (bucket.m_packed)
+                bucket.m_fusionBuffer.reset(new Matrix<ElemType>(1, bucket.m_numElements, deviceId));
+        }
+    }
+
+    // The device memory that is reduced for the bucket.
+    ElemType* GetBucketData(const GradientBucket& bucket, const std::vector<Matrix<ElemType>*>& gradients) const
+    {
+        return bucket.m_packed ? bucket.m_fusionBuffer->Data() : gradients[bucket.m_gradientIndices[0]]->Data();
+    }
+
+    // Copies the gradients of a packed bucket into its fusion buffer (pack) or back (!pack).
+    void CopyFusionBuffer(const GradientBucket& bucket, const std::vector<Matrix<ElemType>*>& gradients, bool pack)
+    {
+        size_t offset = 0;
+        for (size_t i : bucket.m_gradientIndices)
+        {
+            Matrix<ElemType>& gradient = *gradients[i];
+            size_t numElements = gradient.GetNumElements();
+            Matrix<ElemType> slice = bucket.m_fusionBuffer->ColumnSlice(offset, numElements);
+            if (pack)
+                slice.AssignValuesOf(gradient.Reshaped(1, numElements));
+            else
+                gradient.AssignValuesOf(slice.Reshaped(gradient.GetNumRows(), gradient.GetNumCols()));
+            offset += numElements;
+        }
+    }
+
     void AggregateGradientsImpl(const std::vector<Matrix<ElemType>*>& gradients, DistGradHeader* headerCPU, bool showSyncPerfStats)
     {
         Timer aggregationTimer;
@@ -215,123 +290,171 @@ private:
             }
         }
 
-        // Initiate transfer of the gradient matrices to the CPU if needed
-        if (deviceId >= 0)
+        // Pack the small gradients into the fusion buffers
+        size_t numBuckets = m_buckets.size();
+        bool anyPacked = false;
+        Timer packingTimer;
+        if (showSyncPerfStats)
+            packingTimer.Start();
+        for (size_t i = 0; i < numBuckets; ++i)
         {
-            for (size_t i = 0; i < numGradMatrices; ++i)
-                m_gpuDataTransferers[i]->CopyGPUToCPUAsync(gradients[i]->Data(), gradients[i]->GetNumElements(), m_intermediateCPUBuffers[i].get());
+            if (m_buckets[i].m_packed)
+            {
+                CopyFusionBuffer(m_buckets[i], gradients, /*pack=*/true);
+                anyPacked = true;
+            }
         }
+        if (showSyncPerfStats)
+            StopPackingTimer(packingTimer, deviceId);
 
-        // Initiate receive of the header on the main node
-        std::vector<MPI_Request> recvHeaderRequests(NumProc() - 1);
-        if (m_mpi->IsMainNode())
+        // The copies to the CPU must not start before the packing on the compute stream is done
+        if (anyPacked && m_useAsyncAggregation && (deviceId >= 0))
         {
-            for (size_t j = 0; j < NumProc() - 1; ++j)
-            {
-                int source = (j >= MyRank()) ? (j + 1) : j;
-                // We use a tag of 'numGradMatrices' for the pre-aggregation header
-                MPI_Irecv(m_recvHeaders[j], m_recvHeaders[j]->Size(), MPI_CHAR, source, numGradMatrices, m_mpi->Communicator(), &(recvHeaderRequests[j])) || MpiFail("MPI_Irecv");
-            }
+            std::unique_ptr<MatrixComputeStreamEvent> mainStreamSyncEvent(MatrixComputeStreamEvent::Create(deviceId));
+            mainStreamSyncEvent->SynchronizeDataTransferFetchStreamWithEvent<ElemType>();
+        }
+
+        // Initiate transfer of the gradient buckets to the CPU if needed
+        if (deviceId >= 0)
+        {
+            for (size_t i = 0; i < numBuckets; ++i)
+                m_gpuDataTransferers[i]->CopyGPUToCPUAsync(GetBucketData(m_buckets[i], gradients), m_buckets[i].m_numElements, m_intermediateCPUBuffers[i].get());
         }
 
-        // Send the headers from all nodes but the main node
-        MPI_Request sendHeaderRequest;
-        if (!m_mpi->IsMainNode())
-            MPI_Isend(headerCPU, headerCPU->Size(), MPI_CHAR, m_mpi->MainNodeRank(), numGradMatrices, m_mpi->Communicator(), &sendHeaderRequest) || MpiFail("MPI_Isend");
+        // Sum the headers of all nodes with a single small allreduce, alongside those of the gradients
+        MPI_Request headerRequest;
+        headerCPU->Pack(m_packedHeader.data());
+        MPI_Iallreduce(MPI_IN_PLACE, m_packedHeader.data(), (int)m_packedHeader.size(), MPIWrapper::GetDataType(m_packedHeader.data()), MPI_SUM, m_mpi->Communicator(), &headerRequest) || MpiFail("MPI_Iallreduce");
 
-        // Perform MPI async allreduce on the gradient data
-        std::vector<MPI_Request> allReduceRequests(numGradMatrices);
-        for (size_t i = 0; i < numGradMatrices; ++i)
+        // Perform MPI async allreduce on the gradient data, one call per bucket
+        std::vector<MPI_Request> allReduceRequests(numBuckets);
+        std::vector<ElemType*> reductionBuffers(numBuckets);
+        std::vector<Timer> bucketTimers(showSyncPerfStats ? numBuckets : 0);
+        for (size_t i = 0; i < numBuckets; ++i)
         {
-            ElemType* reductionBuffer = gradients[i]->Data();
+            ElemType* reductionBuffer = GetBucketData(m_buckets[i], gradients);
             if (deviceId >= 0)
             {
                 m_gpuDataTransferers[i]->WaitForCopyGPUToCPUAsync();
                 reductionBuffer = m_intermediateCPUBuffers[i].get();
             }
 
-            // On Windows this async MPI_Iallreduce call requires MS MPI v7 or higher to be installed
-            MPI_Iallreduce(MPI_IN_PLACE, reductionBuffer, gradients[i]->GetNumElements(), MPIWrapper::GetDataType(reductionBuffer), MPI_SUM, m_mpi->Communicator(), &allReduceRequests[i]) || MpiFail("MPI_Iallreduce");
-        }
-
-        // On the main node wait for the headers to arrive and aggregate
-        if (m_mpi->IsMainNode())
-        {
-            size_t numNodesHeadersReceivedFrom = 0;
-            while (numNodesHeadersReceivedFrom < (NumProc() - 1))
-            {
-                int idx = MPI_UNDEFINED;
-                MPI_Waitany(recvHeaderRequests.size(), recvHeaderRequests.data(), &idx, MPI_STATUS_IGNORE) || MpiFail("MPI_Waitany");
-                if (idx == MPI_UNDEFINED)
-                {
-                    break;
-                }
+            if (showSyncPerfStats)
+                bucketTimers[i].Start();
 
-                numNodesHeadersReceivedFrom++;
-
-                headerCPU->Aggregate(m_recvHeaders[idx], true);
-            }
-
-            assert(numNodesHeadersReceivedFrom == (NumProc() - 1));
+            reductionBuffers[i] = reductionBuffer;
+            StartBucketReduction(reductionBuffer, m_buckets[i].m_numElements, &allReduceRequests[i]);
         }
 
-        // Initiate receive of the aggregate header
-        MPI_Request recvAggHeaderRequest;
-        if (!m_mpi->IsMainNode())
-            MPI_Irecv(headerCPU, headerCPU->Size(), MPI_CHAR, m_mpi->MainNodeRank(), numGradMatrices + 1 + numGradMatrices, m_mpi->Communicator(), &recvAggHeaderRequest) || MpiFail("MPI_Irecv");
-
-        // Intiate send of the aggregate header from main node
-        std::vector<MPI_Request> sendAggHeaderRequests(NumProc() - 1);
-        if (m_mpi->IsMainNode())
-        {
-            for (size_t j = 0; j < NumProc() - 1; ++j)
-            {
-                int dest = (j >= MyRank()) ? (j + 1) : j;
-                // TODO: Should we use MPI_Bcast instead for better performance
-                MPI_Isend(headerCPU, headerCPU->Size(), MPI_CHAR, dest, numGradMatrices + 1 + numGradMatrices, m_mpi->Communicator(), &(sendAggHeaderRequests[j])) || MpiFail("MPI_Isend");
-            }
-        }
+        if (m_useHierarchicalAllReduce)
+            ContinueHierarchicalReductions(reductionBuffers, allReduceRequests);
 
         // Wait for the allreduce operations to finish and initiate transfer back to the GPU if needed
-        for (size_t i = 0; i < numGradMatrices; ++i)
+        for (size_t i = 0; i < numBuckets; ++i)
         {
             MPI_Wait(&allReduceRequests[i], MPI_STATUSES_IGNORE) || MpiFail("MPI_Wait");
+            if (showSyncPerfStats)
+                bucketTimers[i].Stop();
             if (deviceId >= 0)
-                m_gpuDataTransferers[i]->CopyCPUToGPUAsync(m_intermediateCPUBuffers[i].get(), gradients[i]->GetNumElements(), gradients[i]->Data());
+                m_gpuDataTransferers[i]->CopyCPUToGPUAsync(m_intermediateCPUBuffers[i].get(), m_buckets[i].m_numElements, GetBucketData(m_buckets[i], gradients));
         }
 
-        // Wait to receive aggregate header
-        if (!m_mpi->IsMainNode())
-            MPI_Wait(&recvAggHeaderRequest, MPI_STATUSES_IGNORE) || MpiFail("MPI_Wait");
+        // Wait for the aggregate header
+        MPI_Wait(&headerRequest, MPI_STATUS_IGNORE) || MpiFail("MPI_Wait");
+        headerCPU->Unpack(m_packedHeader.data());
 
         // Wait for all the transfers to finish
         if (deviceId >= 0)
         {
-            for (size_t i = 0; i < numGradMatrices; ++i)
+            for (size_t i = 0; i < numBuckets; ++i)
                 m_gpuDataTransferers[i]->WaitForCopyCPUToGPUAsync();
         }
 
-        // Wait for completion of the async send requests
-        if (!m_mpi->IsMainNode())
-            MPI_Wait(&sendHeaderRequest, MPI_STATUSES_IGNORE) || MpiFail("MPI_Wait");
-        else
-            MPI_Waitall(sendAggHeaderRequests.size(), sendAggHeaderRequests.data(), MPI_STATUSES_IGNORE) || MpiFail("MPI_Waitall");
+        // Scatter the aggregated fusion buffers back into the gradients
+        Timer unpackingTimer;
+        if (showSyncPerfStats)
+            unpackingTimer.Start();
+        for (size_t i = 0; i < numBuckets; ++i)
+        {
+            if (m_buckets[i].m_packed)
+                CopyFusionBuffer(m_buckets[i], gradients, /*pack=*/false);
+        }
+        if (showSyncPerfStats)
+            StopPackingTimer(unpackingTimer, deviceId);
 
         if (showSyncPerfStats)
         {
             aggregationTimer.Stop();
             double gradientAggregationTime = aggregationTimer.ElapsedSeconds();
             fprintf(stderr, "Actual gradient aggregation time: %.6g\n", gradientAggregationTime);
+            fprintf(stderr, "Gradient aggregation used %d allreduce calls for %d matrices.\n", (int)numBuckets, (int)numGradMatrices);
+            if (m_useHierarchicalAllReduce)
+                fprintf(stderr, "\tEach allreduce is a reduce within the host, an allreduce across %d hosts and a broadcast within the host.\n", (int)m_mpi->NumHosts());
+            if (anyPacked)
+                fprintf(stderr, "\tPacking the fusion buffers: %.6g, scattering them back: %.6g\n", packingTimer.ElapsedSeconds(), unpackingTimer.ElapsedSeconds());
+            // the allreduces of all buckets are in flight at the same time, so their times overlap
+            for (size_t i = 0; i < numBuckets; ++i)
+            {
+                fprintf(stderr, "\tBucket %d: %d matrices, %d bytes%s, allreduce completed after: %.6g\n", (int)i, (int)m_buckets[i].m_gradientIndices.size(),
+                        (int)(m_buckets[i].m_numElements * sizeof(ElemType)), m_buckets[i].m_packed ? " (packed)" : "", bucketTimers[i].ElapsedSeconds());
+            }
+        }
+    }
+
+    // The copies into and out of the fusion buffers run on the GPU compute stream, so wait for them before reading the timer.
+    void StopPackingTimer(Timer& timer, int deviceId)
+    {
+        if (deviceId >= 0)
+        {
+            std::unique_ptr<MatrixComputeStreamEvent> mainStreamSyncEvent(MatrixComputeStreamEvent::Create(deviceId));
+            mainStreamSyncEvent->SynchronizeEvent();
+        }
+        timer.Stop();
+    }
+
+    // The first stage of the reduction of a bucket: the allreduce, or with hierarchical reduction the reduce onto the
+    // leader of the host, see ContinueHierarchicalReductions().
+    void StartBucketReduction(ElemType* buffer, size_t numElements, MPI_Request* request)
+    {
+        if (!m_useHierarchicalAllReduce)
+        {
+            // On Windows this async MPI_Iallreduce call requires MS MPI v7 or higher to be installed
+            MPI_Iallreduce(MPI_IN_PLACE, buffer, (int)numElements, MPIWrapper::GetDataType(buffer), MPI_SUM, m_mpi->Communicator(), request) || MpiFail("MPI_Iallreduce");
+        }
+        else if (m_mpi->IsHostLeader())
+            MPI_Ireduce(MPI_IN_PLACE, buffer, (int)numElements, MPIWrapper::GetDataType(buffer), MPI_SUM, 0, m_mpi->IntraHostCommunicator(), request) || MpiFail("MPI_Ireduce");
+        else
+            MPI_Ireduce(buffer, nullptr, (int)numElements, MPIWrapper::GetDataType(buffer), MPI_SUM, 0, m_mpi->IntraHostCommunicator(), request) || MpiFail("MPI_Ireduce");
+    }
+
+    // As the reductions within the hosts complete, allreduces their results among the host leaders, which is the only
+    // traffic between hosts, and broadcasts the sums back within the hosts. Goes bucket by bucket, so that the stages
+    // of different buckets overlap. Returns with the requests of the broadcasts.
+    void ContinueHierarchicalReductions(const std::vector<ElemType*>& buffers, std::vector<MPI_Request>& requests)
+    {
+        bool reduceAcrossHosts = m_mpi->IsHostLeader() && (m_mpi->NumHosts() > 1);
+        for (size_t i = 0; i < m_buckets.size(); ++i)
+        {
+            MPI_Wait(&requests[i], MPI_STATUS_IGNORE) || MpiFail("MPI_Wait");
+            if (reduceAcrossHosts)
+                MPI_Iallreduce(MPI_IN_PLACE, buffers[i], (int)m_buckets[i].m_numElements, MPIWrapper::GetDataType(buffers[i]), MPI_SUM, m_mpi->InterHostCommunicator(), &requests[i]) || MpiFail("MPI_Iallreduce");
+        }
+
+        for (size_t i = 0; i < m_buckets.size(); ++i)
+        {
+            MPI_Wait(&requests[i], MPI_STATUS_IGNORE) || MpiFail("MPI_Wait");
+            MPI_Ibcast(buffers[i], (int)m_buckets[i].m_numElements, MPIWrapper::GetDataType(buffers[i]), 0, m_mpi->IntraHostCommunicator(), &requests[i]) || MpiFail("MPI_Ibcast");
         }
     }
 
 private:
     std::unique_ptr<CUDAPageLockedMemAllocator> m_allocator;
+    // one per bucket
     std::vector<std::shared_ptr<ElemType>> m_intermediateCPUBuffers;
-
     std::vector<std::unique_ptr<GPUDataTransferer<ElemType>>> m_gpuDataTransferers;
 
-    std::vector<DistGradHeader*> m_recvHeaders;
+    // the header as summed by the allreduce, see DistGradHeader::Pack()
+    std::vector<double> m_packedHeader;
 
     // Perform aysnchronous gradient aggregation using double buffering of the gradient matrices
     bool m_useAsyncAggregation;
@@ -349,5 +472,11 @@ private:
     size_t m_iterationCount;
 
     bool m_initialized;
+
+    std::vector<GradientBucket> m_buckets;
+    size_t m_bucketSizeInBytes;
+
+    // reduce within each host before reducing across hosts, see MPIWrapper::SplitByHost()
+    bool m_useHierarchicalAllReduce;
 };
 } } }
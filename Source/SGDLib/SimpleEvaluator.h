@@ -405,6 +405,91 @@ public:
         return;
     }
 
+    // Calibrates int8 quantization: returns, for each node that ComputationNetwork::QuantizeInt8() can quantize,
+    // the largest absolute value of its data input over the first 'numMinibatches' minibatches.
+    std::map<ComputationNodeBasePtr, double> CalibrateInt8(IDataReader* dataReader, const vector<wstring>& evalNodeNames, const size_t mbSize, const size_t numMinibatches, const size_t testSize = requestDataSize)
+    {
+        ScopedNetworkOperationMode modeGuard(m_net, NetworkOperationMode::inferring);
+
+        // determine nodes to evaluate
+        std::vector<ComputationNodeBasePtr> evalNodes;
+        set<ComputationNodeBasePtr> nodesSeen;
+        if (evalNodeNames.size() == 0)
+        {
+            for (const auto& group : { m_net->OutputNodes(), m_net->EvaluationNodes(), m_net->FinalCriterionNodes() })
+                for (const auto& node : group)
+                    if (nodesSeen.insert(node).second)
+                        evalNodes.push_back(node);
+            if (evalNodes.empty())
+                InvalidArgument("There is no default output, evaluation node or training criterion specified in the network.");
+        }
+        else
+        {
+            for (const auto& name : evalNodeNames)
+            {
+                const auto& node = m_net->GetNodeFromName(name);
+                if (nodesSeen.insert(node).second)
+                    evalNodes.push_back(node);
+            }
+        }
+
+        // the data inputs of the quantizable nodes are requested as outputs, so that their memory is not reused before they are inspected
+        auto quantizableNodes = m_net->GetInt8QuantizableNodes(evalNodes);
+        std::vector<ComputationNodeBasePtr> dataInputs;
+        std::map<ComputationNodeBasePtr, double> inputRanges;
+        for (const auto& node : quantizableNodes)
+        {
+            dataInputs.push_back(node->Input(1));
+            inputRanges[node] = 0;
+        }
+        if (quantizableNodes.empty())
+            return inputRanges;
+
+        // allocate memory for forward computation
+        m_net->AllocateAllMatrices(evalNodes, dataInputs, nullptr);
+
+        // prepare features and labels
+        auto& featureNodes = m_net->FeatureNodes();
+        auto& labelNodes = m_net->LabelNodes();
+
+        StreamMinibatchInputs inputMatrices;
+        for (auto& node : featureNodes)
+            inputMatrices.AddInput(node->NodeName(), node->ValuePtr(), node->GetMBLayout(), node->GetSampleLayout());
+        for (auto& node : labelNodes)
+            inputMatrices.AddInput(node->NodeName(), node->ValuePtr(), node->GetMBLayout(), node->GetSampleLayout());
+
+        dataReader->StartMinibatchLoop(mbSize, 0, inputMatrices.GetStreamDescriptions(), testSize);
+        m_net->StartEvaluateMinibatchLoop(evalNodes);
+
+        size_t numMBsRun = 0;
+        size_t actualMBSize = 0;
+        while (numMBsRun < numMinibatches &&
+               DataReaderHelpers::GetMinibatchIntoNetwork<ElemType>(*dataReader, m_net, nullptr, false, false, inputMatrices, actualMBSize, nullptr))
+        {
+            ComputationNetwork::BumpEvalTimeStamp(featureNodes);
+            ComputationNetwork::BumpEvalTimeStamp(labelNodes);
+            for (const auto& node : evalNodes)
+                m_net->ForwardProp(node);
+
+            for (const auto& node : quantizableNodes)
+            {
+                auto input = dynamic_pointer_cast<ComputationNode<ElemType>>(node->Input(1));
+                if (input->Value().GetMatrixType() != MatrixType::DENSE)
+                    continue;
+                input->MaskMissingValueColumnsToZero(FrameRange(input->GetMBLayout())); // gaps must not widen the range
+                inputRanges[node] = max(inputRanges[node], (double)input->Value().MatrixNormInf());
+            }
+            dataReader->DataEnd();
+            numMBsRun++;
+        }
+
+        if (m_traceLevel > 0)
+            for (const auto& node : quantizableNodes)
+                LOGPRINTF(stderr, "CalibrateInt8: %ls %ls operation: input range %.8g over %d minibatches.\n",
+                          node->NodeName().c_str(), node->OperationName().c_str(), inputRanges[node], (int)numMBsRun);
+        return inputRanges;
+    }
+
 protected:
     void DisplayEvalStatistics(const size_t startMBNum, const size_t endMBNum, const size_t numSamplesLastLogged,
                                const vector<ComputationNodeBasePtr>& evalNodes,
@@ -7,6 +7,7 @@
 #include "EvalTestHelper.h"
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
+#include <thread>
 
 using namespace Microsoft::MSR::CNTK;
 
@@ -219,6 +220,41 @@ BOOST_AUTO_TEST_CASE(EvalDenseTimesTest)
     eval->Destroy();
 }
 
+BOOST_AUTO_TEST_CASE(EvalQuantizedDenseTimesTest)
+{
+    std::string modelDefinition =
+        "deviceId = -1 \n"
+        "precision = \"float\" \n"
+        "traceLevel = 1 \n"
+        "quantizedInference = true \n"
+        "run=NDLNetworkBuilder \n"
+        "NDLNetworkBuilder=[ \n"
+        "i1 = Input(4) \n"
+        "o1 = Times(Constant(2, rows=2, cols=4), i1, tag=\"output\") \n"
+        "FeatureNodes = (i1) \n"
+        "] \n";
+
+    VariableSchema inputLayouts;
+    VariableSchema outputLayouts;
+    IEvaluateModelExtended<float> *eval;
+    eval = SetupNetworkAndGetLayouts(modelDefinition, inputLayouts, outputLayouts);
+
+    Values<float> outputBuffer = outputLayouts.CreateBuffers<float>({ 2 });
+
+    // Two samples.
+    Values<float> inputBuffer(1);
+    inputBuffer[0].m_buffer = { 1, 2, 3, 4, 4, 3, 2, -1 };
+    eval->ForwardPass(inputBuffer, outputBuffer);
+
+    std::vector<float> expected{ 20, 20, 16, 16 };
+    auto buf = outputBuffer[0].m_buffer;
+    BOOST_REQUIRE_EQUAL(buf.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); i++)
+        BOOST_CHECK_CLOSE(buf[i], expected[i], 0.1f); // tolerance in percent
+
+    eval->Destroy();
+}
+
 BOOST_AUTO_TEST_CASE(EvalSparseTimesTest)
 {
     std::string modelDefinition =
@@ -420,5 +456,152 @@ BOOST_AUTO_TEST_CASE(EvalRNNTest)
     eval->Destroy();
 }
 
+BOOST_AUTO_TEST_CASE(EvalConcurrentSessionsTest)
+{
+    std::string modelDefinition =
+        "deviceId = -1 \n"
+        "precision = \"float\" \n"
+        "traceLevel = 1 \n"
+        "run=NDLNetworkBuilder \n"
+        "NDLNetworkBuilder=[ \n"
+        "i1 = Input(2) \n"
+        "W = Parameter(2, 2, init = \"uniform\", initValueScale = 1) \n"
+        "R = Parameter(2, 2, init = \"uniform\", initValueScale = 1) \n"
+        "dh = PastValue(2, o1, timeStep = 1) \n"
+        "o1 = Tanh(Plus(Times(W, i1), Times(R, dh)), tag=\"output\") \n"
+        "FeatureNodes = (i1) \n"
+        "] \n";
+
+    VariableSchema inputLayouts;
+    VariableSchema outputLayouts;
+    IEvaluateModelExtended<float> *eval;
+    eval = SetupNetworkAndGetLayouts(modelDefinition, inputLayouts, outputLayouts);
+
+    // one input sequence of a different length per session
+    const size_t numSessions = 4;
+    std::vector<Values<float>> inputBuffers;
+    std::vector<std::vector<float>> expected;
+    for (size_t s = 0; s < numSessions; s++)
+    {
+        Values<float> inputBuffer(1);
+        for (size_t i = 0; i < 2 * (s + 2); i++)
+            inputBuffer[0].m_buffer.push_back((float)(i + s) / 4);
+        Values<float> outputBuffer = outputLayouts.CreateBuffers<float>({ s + 2 });
+        eval->ForwardPass(inputBuffer, outputBuffer);
+        inputBuffers.push_back(inputBuffer);
+        expected.push_back(outputBuffer[0].m_buffer);
+    }
+
+    std::vector<IEvaluateModelExtended<float>*> sessions;
+    for (size_t s = 0; s < numSessions; s++)
+        sessions.push_back(eval->CreateSession());
+    // sessions keep the shared parameters alive
+    eval->Destroy();
+
+    std::vector<int> numMismatches(numSessions, 0);
+    std::vector<std::thread> threads;
+    for (size_t s = 0; s < numSessions; s++)
+    {
+        threads.push_back(std::thread([&, s]()
+        {
+            Values<float> outputBuffer = outputLayouts.CreateBuffers<float>({ s + 2 });
+            for (size_t iter = 0; iter < 50; iter++)
+            {
+                sessions[s]->ForwardPass(inputBuffers[s], outputBuffer);
+                if (outputBuffer[0].m_buffer != expected[s])
+                    numMismatches[s]++;
+            }
+        }));
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    for (size_t s = 0; s < numSessions; s++)
+    {
+        BOOST_CHECK_EQUAL(numMismatches[s], 0);
+        sessions[s]->Destroy();
+    }
+}
+
+BOOST_AUTO_TEST_CASE(EvalBatchedForwardPassTest)
+{
+    std::string modelDefinition =
+        "deviceId = -1 \n"
+        "precision = \"float\" \n"
+        "traceLevel = 1 \n"
+        "maxBatchSize = 3 \n"
+        "maxBatchWaitMs = 20 \n"
+        "run=NDLNetworkBuilder \n"
+        "NDLNetworkBuilder=[ \n"
+        "i1 = Input(2) \n"
+        "W = Parameter(2, 2, init = \"uniform\", initValueScale = 1) \n"
+        "R = Parameter(2, 2, init = \"uniform\", initValueScale = 1) \n"
+        "dh = PastValue(2, o1, timeStep = 1) \n"
+        "o1 = Tanh(Plus(Times(W, i1), Times(R, dh)), tag=\"output\") \n"
+        "FeatureNodes = (i1) \n"
+        "] \n";
+
+    VariableSchema inputLayouts;
+    VariableSchema outputLayouts;
+    IEvaluateModelExtended<float> *eval;
+    eval = SetupNetworkAndGetLayouts(modelDefinition, inputLayouts, outputLayouts);
+
+    // sequences of different lengths, evaluated one by one for reference
+    const size_t numRequests = 7;
+    std::vector<Values<float>> inputBuffers;
+    std::vector<std::vector<float>> expected;
+    for (size_t r = 0; r < numRequests; r++)
+    {
+        Values<float> inputBuffer(1);
+        for (size_t i = 0; i < 2 * (1 + r % 4); i++)
+            inputBuffer[0].m_buffer.push_back((float)(i + r) / 8);
+        Values<float> outputBuffer = outputLayouts.CreateBuffers<float>({ 1 + r % 4 });
+        eval->ForwardPass(inputBuffer, outputBuffer);
+        inputBuffers.push_back(inputBuffer);
+        expected.push_back(outputBuffer[0].m_buffer);
+    }
+
+    // a malformed request fails alone
+    Values<float> badInputBuffer(1);
+    badInputBuffer[0].m_buffer = { 1, 2, 3 };
+
+    std::vector<std::vector<float>> results(numRequests);
+    bool badRequestFailed = false;
+    std::vector<std::thread> threads;
+    for (size_t r = 0; r < numRequests; r++)
+    {
+        threads.push_back(std::thread([&, r]()
+        {
+            Values<float> outputBuffer = outputLayouts.CreateBuffers<float>({ 1 + r % 4 });
+            eval->ForwardPassBatched(inputBuffers[r], outputBuffer);
+            results[r] = outputBuffer[0].m_buffer;
+        }));
+    }
+    threads.push_back(std::thread([&]()
+    {
+        Values<float> outputBuffer = outputLayouts.CreateBuffers<float>({ 1 });
+        try
+        {
+            eval->ForwardPassBatched(badInputBuffer, outputBuffer);
+        }
+        catch (const std::exception&)
+        {
+            badRequestFailed = true;
+        }
+    }));
+    for (auto& thread : threads)
+        thread.join();
+
+    BOOST_CHECK(badRequestFailed);
+    for (size_t r = 0; r < numRequests; r++)
+    {
+        BOOST_REQUIRE_EQUAL(results[r].size(), expected[r].size());
+        for (size_t i = 0; i < expected[r].size(); i++)
+            BOOST_CHECK_CLOSE(results[r][i], expected[r][i], 1e-3f); // tolerance in percent
+    }
+
+    eval->Destroy();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 }}}}
\ No newline at end of file
@@ -12,6 +12,7 @@
 #include "../../../Source/Math/CPUMatrix.h"
 #include "../../../Source/Math/GPUMatrix.h"
 #include "../../../Source/Math/BatchNormalizationEngine.h"
+#include "../../../Source/Math/ConvolutionEngine.h"
 #include "../../../Source/Math/CuDnnFactories.h"
 #include "common.h"
 
@@ -327,6 +328,54 @@ BOOST_AUTO_TEST_CASE(BatchNormalizationBackward)
     }
 }
 
+BOOST_AUTO_TEST_CASE(BatchNormalizationChannelBlockedCpu)
+{
+    // Inference on the channel-blocked layout against the cudnn layout, both on the CPU.
+    std::mt19937 rng(0);
+    boost::random::normal_distribution<float> nd;
+
+    auto initMat = [&](size_t r, size_t c) -> SingleMatrix
+    {
+        vec buf(r * c);
+        std::generate(begin(buf), end(buf), [&] { return nd(rng); });
+        return SingleMatrix(r, c, buf.data(), CPUDEVICE, matrixFlagNormal);
+    };
+
+    for (const auto& inOutT : {TensorShape(5, 4, 8), TensorShape(3, 7, 32)})
+    {
+        BOOST_REQUIRE(BNEng::IsChannelBlockedLayoutSupported(CPUDEVICE, inOutT, true));
+        auto engBase = BNEng::Create(CPUDEVICE, inOutT, true, ImageLayoutKind::CHW, BatchNormEngineKind::Cntk);
+        auto engBlocked = BNEng::Create(CPUDEVICE, inOutT, true, ImageLayoutKind::CHWc, BatchNormEngineKind::Cntk);
+
+        size_t crow = inOutT.GetNumElements();
+        size_t ccol = 3;
+        size_t numChannels = inOutT[2];
+        SingleMatrix in = initMat(crow, ccol);
+        SingleMatrix scale = initMat(numChannels, 1);
+        SingleMatrix bias = initMat(numChannels, 1);
+        SingleMatrix runMean = initMat(numChannels, 1);
+        SingleMatrix runVariance = initMat(numChannels, 1);
+        runVariance.InplaceAbs();
+        SingleMatrix savedMean(CPUDEVICE);
+        SingleMatrix savedInvStdDev(CPUDEVICE);
+        double eps = 1e-5;
+
+        SingleMatrix outB(crow, ccol, CPUDEVICE);
+        engBase->Forward(in, scale, bias, true, 0, 1, runMean, runVariance, outB, eps, savedMean, savedInvStdDev);
+
+        SingleMatrix blockedIn(crow, ccol, CPUDEVICE);
+        ConvolutionEngine<float>::ReorderChannelBlocks(in, blockedIn, inOutT, /*toChannelBlocks=*/true);
+        SingleMatrix blockedOut(crow, ccol, CPUDEVICE);
+        engBlocked->Forward(blockedIn, scale, bias, true, 0, 1, runMean, runVariance, blockedOut, eps, savedMean, savedInvStdDev);
+        SingleMatrix out(crow, ccol, CPUDEVICE);
+        ConvolutionEngine<float>::ReorderChannelBlocks(blockedOut, out, inOutT, /*toChannelBlocks=*/false);
+
+        std::string emsg;
+        BOOST_REQUIRE_MESSAGE(CheckEqual(out, outB, emsg, Err<float>::Rel, Err<float>::Abs * 20),
+                              "out are not equal, inOut tensor: " << (std::string)inOutT << ". " << emsg);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } } } }
@@ -4,6 +4,8 @@
 //
 #include "stdafx.h"
 #include "../../../Source/Math/BlockMultiplier.h"
+#include "../../../Source/Math/QuantizedMultiplier.h"
+#include "../../../Source/Math/CPUKernels.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK { namespace TEST {
 
@@ -137,6 +139,32 @@ template<typename ScalarAT, typename ScalarBT, typename ScalarCT, typename Multi
     TestMultiplierSub<ScalarAT, ScalarBT, ScalarCT, MultiplierT>(m, k, n, testMult, numThreads, epsilon);
 }
 
+// Presents the IBlockGemm of the current instruction set to TestMultiplierSub() like a BlockMultiplier.
+template<typename ScalarT> class BlockGemmUnderTest
+{
+    public:
+        void SetNumThreads(int numThreads) { m_gemm.reset(CreateGemm(numThreads, (ScalarT*)nullptr)); }
+        static ScalarT* CreateMatrixA(int m, int n) { return new ScalarT[m * n](); }
+        static ScalarT* CreateMatrixB(int m, int n) { return new ScalarT[m * n](); }
+        static int32_t* CreateMatrixC(int m, int n) { return new int32_t[m * n](); }
+        template<typename ScalarXT> void FreeMatrix(ScalarXT* destroyMe)
+        {
+            if (destroyMe == (ScalarXT*)m_preparedB)
+                m_gemm->FreePreparedB(m_preparedB);
+            else
+                delete[] destroyMe;
+        }
+        ScalarT* PrepareB(ScalarT* oldB, int k, int n) { return m_preparedB = m_gemm->PrepareB(oldB, k, n); }
+        void MultiplyMatrices(ScalarT* A, int m, int k, ScalarT* B, int n, int32_t* C) { m_gemm->MultiplyMatrices(A, m, k, B, n, C); }
+
+    private:
+        static IBlockGemm<int16_t>* CreateGemm(int numThreads, int16_t*) { return GetCPUKernels().CreateInt16BlockGemm(numThreads); }
+        static IBlockGemm<int8_t>* CreateGemm(int numThreads, int8_t*) { return GetCPUKernels().CreateInt8BlockGemm(numThreads); }
+
+        std::unique_ptr<IBlockGemm<ScalarT>> m_gemm;
+        ScalarT* m_preparedB = nullptr;
+};
+
 BOOST_AUTO_TEST_SUITE(BlockMultiplierSuite)
 
 BOOST_AUTO_TEST_CASE(BlockMultiplyTest8x128x8SingleThread)
@@ -185,5 +213,265 @@ BOOST_AUTO_TEST_CASE(BlockMultiplyTestAllKFourRowsMultiThread)
     TestMultiplierSub<int16_t, int16_t, int32_t, BlockMultiplier<BlockHandlerSSE>>(4, 128 + 64 + 32 + 16 + 8 + 1, 1, 2);
 }
 
+// The 8-bit handler must compute exact products for all kernel sizes, four rows and single rows at a time
+BOOST_AUTO_TEST_CASE(BlockMultiplyInt8TestAllK)
+{
+    const int k = 2 * 128 + 64 + 32 + 16 + 8 + 3;
+    TestMultiplierSub<int8_t, int8_t, int32_t, BlockMultiplier<BlockHandlerSSEInt8>>(8, k, 5, 1);
+    TestMultiplierSub<int8_t, int8_t, int32_t, BlockMultiplier<BlockHandlerSSEInt8>>(7, k, 5, 1);
+    TestMultiplierSub<int8_t, int8_t, int32_t, BlockMultiplier<BlockHandlerSSEInt8>>(8, k, 5, 2);
+    TestMultiplierSub<int8_t, int8_t, int32_t, BlockMultiplier<BlockHandlerSSEInt8>>(1, 3 * 128 + 8, 1, 2);
+}
+
+// The block multipliers of every instruction set this processor supports must compute exact products for all kernel sizes
+BOOST_AUTO_TEST_CASE(BlockGemmTestAllInstructionSets)
+{
+    const int k = 2 * 128 + 64 + 32 + 16 + 8 + 3;
+    const CPUInstructionSet supported = GetSupportedCPUInstructionSet();
+    for (int instructionSet = (int)CPUInstructionSet::SSE41; instructionSet <= (int)supported; instructionSet++)
+    {
+        BOOST_REQUIRE(SetCPUInstructionSet((CPUInstructionSet)instructionSet) == (CPUInstructionSet)instructionSet);
+        BOOST_TEST_MESSAGE("Instruction set " << CPUInstructionSetName(GetCPUInstructionSet()));
+        TestMultiplierSub<int16_t, int16_t, int32_t, BlockGemmUnderTest<int16_t>>(8, k, 5, 1);
+        TestMultiplierSub<int16_t, int16_t, int32_t, BlockGemmUnderTest<int16_t>>(7, k, 5, 2);
+        TestMultiplierSub<int16_t, int16_t, int32_t, BlockGemmUnderTest<int16_t>>(1, 3 * 128 + 8, 1, 2);
+        TestMultiplierSub<int8_t, int8_t, int32_t, BlockGemmUnderTest<int8_t>>(8, k, 5, 1);
+        TestMultiplierSub<int8_t, int8_t, int32_t, BlockGemmUnderTest<int8_t>>(7, k, 5, 2);
+        TestMultiplierSub<int8_t, int8_t, int32_t, BlockGemmUnderTest<int8_t>>(1, 3 * 128 + 8, 1, 2);
+    }
+    SetCPUInstructionSet(supported);
+}
+
+// Quantized product of float matrices must be close to the full precision one, for both layouts of the constant operand
+BOOST_AUTO_TEST_CASE(QuantizedMultiplierMatchesFullPrecision)
+{
+    const size_t m = 13, k = 128 + 64 + 3, n = 7;
+    for (bool transposeA : { false, true })
+    {
+        Matrix<float> A = Matrix<float>::RandomUniform(transposeA ? k : m, transposeA ? m : k, CPUDEVICE, -1.0f, 1.0f, 1);
+        Matrix<float> B = Matrix<float>::RandomUniform(k, n, CPUDEVICE, -1.0f, 1.0f, 2);
+        Matrix<float> expected(m, n, CPUDEVICE);
+        Matrix<float>::MultiplyAndWeightedAdd(1.0f, A, transposeA, B, false, 0.0f, expected);
+
+        QuantizedMultiplier<float> multiplier;
+        Matrix<float> actual(m, n, CPUDEVICE);
+        // Multiply twice to exercise the cached quantized copy of A.
+        for (int i = 0; i < 2; ++i)
+        {
+            multiplier.Multiply(A, transposeA, B, actual);
+            BOOST_CHECK(multiplier.IsPrepared());
+            BOOST_CHECK(actual.IsEqualTo(expected, 0.01f));
+        }
+    }
+}
+
+// Multipliers with a shared cache quantize their constant operand once, and again when the operand is another matrix
+BOOST_AUTO_TEST_CASE(QuantizedMultipliersShareThePreparedOperand)
+{
+    const size_t m = 13, k = 64 + 3, n = 7;
+    Matrix<float> A = Matrix<float>::RandomUniform(m, k, CPUDEVICE, -1.0f, 1.0f, 1);
+    Matrix<float> otherA = Matrix<float>::RandomUniform(m, k, CPUDEVICE, -1.0f, 1.0f, 2);
+    Matrix<float> B = Matrix<float>::RandomUniform(k, n, CPUDEVICE, -1.0f, 1.0f, 3);
+
+    QuantizedMultiplier<float> first;
+    QuantizedMultiplier<float> second(2, first.GetCache());
+    Matrix<float> expected(m, n, CPUDEVICE);
+    Matrix<float> actual(m, n, CPUDEVICE);
+    first.Multiply(A, false, B, expected);
+    BOOST_CHECK(second.IsPrepared());
+    second.Multiply(A, false, B, actual);
+    BOOST_CHECK(actual.IsEqualTo(expected, 0.0f));
+
+    Matrix<float>::MultiplyAndWeightedAdd(1.0f, otherA, false, B, false, 0.0f, expected);
+    second.Multiply(otherA, false, B, actual);
+    BOOST_CHECK(actual.IsEqualTo(expected, 0.01f));
+
+    first.Reset();
+    BOOST_CHECK(!second.IsPrepared());
+}
+
+// Same for 8-bit quantization, where the multipliers may differ in the range of B
+BOOST_AUTO_TEST_CASE(Int8QuantizedMultipliersShareThePreparedOperand)
+{
+    const size_t m = 13, k = 64 + 3, n = 7;
+    Matrix<float> A = Matrix<float>::RandomUniform(m, k, CPUDEVICE, -1.0f, 1.0f, 1);
+    Matrix<float> B = Matrix<float>::RandomUniform(k, n, CPUDEVICE, -1.0f, 1.0f, 3);
+
+    Int8QuantizedMultiplier<float> first;
+    Int8QuantizedMultiplier<float> second(0, first.GetCache());
+    Int8QuantizedMultiplier<float> calibrated(2.0, first.GetCache());
+    Matrix<float> expected(m, n, CPUDEVICE);
+    Matrix<float> actual(m, n, CPUDEVICE);
+    first.Multiply(A, false, B, expected);
+    BOOST_CHECK(second.IsPrepared() && calibrated.IsPrepared());
+    second.Multiply(A, false, B, actual);
+    BOOST_CHECK(actual.IsEqualTo(expected, 0.0f));
+    calibrated.Multiply(A, false, B, actual);
+    BOOST_CHECK(actual.IsEqualTo(expected, 0.1f));
+}
+
+// Same for 8-bit quantization, with per-row ranges of op(A) and dynamic or calibrated ranges of B
+BOOST_AUTO_TEST_CASE(Int8QuantizedMultiplierMatchesFullPrecision)
+{
+    const size_t m = 13, k = 128 + 64 + 3, n = 7;
+    for (bool transposeA : { false, true })
+    {
+        Matrix<float> A = Matrix<float>::RandomUniform(transposeA ? k : m, transposeA ? m : k, CPUDEVICE, -1.0f, 1.0f, 1);
+        // rows of op(A) with very different ranges are the case per-row quantization is for
+        for (size_t i = 0; i < A.GetNumElements(); i++)
+            A.Data()[i] *= (transposeA ? i / k : i % m) % 2 ? 0.01f : 1.0f;
+        Matrix<float> B = Matrix<float>::RandomUniform(k, n, CPUDEVICE, -1.0f, 1.0f, 2);
+        Matrix<float> expected(m, n, CPUDEVICE);
+        Matrix<float>::MultiplyAndWeightedAdd(1.0f, A, transposeA, B, false, 0.0f, expected);
+
+        for (double inputRange : { 0.0, 1.0 })
+        {
+            Int8QuantizedMultiplier<float> multiplier(inputRange);
+            Matrix<float> actual(m, n, CPUDEVICE);
+            for (int i = 0; i < 2; ++i)
+            {
+                multiplier.Multiply(A, transposeA, B, actual);
+                BOOST_CHECK(multiplier.IsPrepared());
+                for (size_t j = 0; j < actual.GetNumElements(); j++)
+                {
+                    float tolerance = (j % m) % 2 ? 0.002f : 0.2f;
+                    BOOST_CHECK_SMALL(actual.Data()[j] - expected.Data()[j], tolerance);
+                }
+            }
+        }
+    }
+}
+
+// Conversions to 16-bit floating-point formats round to nearest even and handle the special values
+BOOST_AUTO_TEST_CASE(ReducedPrecisionConversions)
+{
+    BOOST_CHECK_EQUAL(FloatToFloat16(1.0f), 0x3c00);
+    BOOST_CHECK_EQUAL(FloatToFloat16(-2.0f), 0xc000);
+    BOOST_CHECK_EQUAL(FloatToFloat16(65504.0f), 0x7bff);
+    BOOST_CHECK_EQUAL(FloatToFloat16(65519.0f), 0x7bff);
+    BOOST_CHECK_EQUAL(FloatToFloat16(65520.0f), 0x7c00);         // ties to even: infinity
+    BOOST_CHECK_EQUAL(FloatToFloat16(1.0f + 1.0f / 2048), 0x3c00); // tie between 1 and 1 + 2^-10 rounds to even
+    BOOST_CHECK_EQUAL(FloatToFloat16(1.0f + 3.0f / 2048), 0x3c02);
+    BOOST_CHECK_EQUAL(FloatToFloat16(ldexp(1.0f, -24)), 0x0001);   // smallest subnormal
+    BOOST_CHECK_EQUAL(FloatToFloat16(ldexp(1.0f, -25)), 0x0000);   // tie rounds to even zero
+    BOOST_CHECK_EQUAL(FloatToFloat16(ldexp(3.0f, -25)), 0x0002);
+    BOOST_CHECK_EQUAL(FloatToFloat16(ldexp(1023.5f, -24)), 0x0400); // rounds up to the smallest normal
+    BOOST_CHECK_EQUAL(FloatToFloat16(-std::numeric_limits<float>::infinity()), 0xfc00);
+    BOOST_CHECK(std::isnan(Float16ToFloat(FloatToFloat16(std::numeric_limits<float>::quiet_NaN()))));
+    BOOST_CHECK_EQUAL(FloatToBFloat16(1.0f), 0x3f80);
+    BOOST_CHECK_EQUAL(FloatToBFloat16(1.0f + 1.0f / 256), 0x3f80);   // tie rounds to even
+    BOOST_CHECK_EQUAL(FloatToBFloat16(1.0f + 3.0f / 256), 0x3f82);
+    BOOST_CHECK_EQUAL(FloatToBFloat16(std::numeric_limits<float>::max()), 0x7f80);
+    BOOST_CHECK(std::isnan(BFloat16ToFloat(FloatToBFloat16(std::numeric_limits<float>::quiet_NaN()))));
+
+    // every 16-bit value but NaNs converts to float and back unchanged
+    for (uint32_t i = 0; i < 0x10000; i++)
+    {
+        uint16_t value = (uint16_t)i;
+        if ((value & 0x7c00) != 0x7c00 || (value & 0x3ff) == 0)
+            BOOST_CHECK_EQUAL(FloatToFloat16(Float16ToFloat(value)), value);
+        if ((value & 0x7f80) != 0x7f80 || (value & 0x7f) == 0)
+            BOOST_CHECK_EQUAL(FloatToBFloat16(BFloat16ToFloat(value)), value);
+    }
+}
+
+// The product with A packed in 16 bits must equal the full precision product with A rounded to the format
+BOOST_AUTO_TEST_CASE(ReducedPrecisionMultiplierMatchesRoundedA)
+{
+    // the inner dimension makes op(A) span several panels
+    const size_t m = 150, k = 1000, n = 7;
+    for (auto format : { ReducedPrecisionFormat::float16, ReducedPrecisionFormat::bfloat16 })
+    {
+        for (bool transposeA : { false, true })
+        {
+            Matrix<float> A = Matrix<float>::RandomUniform(transposeA ? k : m, transposeA ? m : k, CPUDEVICE, -1.0f, 1.0f, 1);
+            Matrix<float> B = Matrix<float>::RandomUniform(k, n, CPUDEVICE, -1.0f, 1.0f, 2);
+            Matrix<float> roundedA = A.DeepClone();
+            RoundToReducedPrecision(format, roundedA.Data(), roundedA.GetNumElements());
+            Matrix<float> expected(m, n, CPUDEVICE);
+            Matrix<float>::MultiplyAndWeightedAdd(1.0f, roundedA, transposeA, B, false, 0.0f, expected);
+
+            ReducedPrecisionMultiplier<float> multiplier(format);
+            Matrix<float> actual(m, n, CPUDEVICE);
+            for (int i = 0; i < 2; ++i)
+            {
+                multiplier.Multiply(A, transposeA, B, actual);
+                BOOST_CHECK(multiplier.IsPrepared());
+                BOOST_CHECK(actual.IsEqualTo(expected, 1e-4f));
+            }
+        }
+    }
+}
+
+// A sparse B, like the one-hot input of an embedding, selects columns of the 16-bit copy of op(A)
+BOOST_AUTO_TEST_CASE(ReducedPrecisionMultiplierWithSparseB)
+{
+    const size_t m = 150, k = 1000, n = 9;
+    for (auto format : { ReducedPrecisionFormat::float16, ReducedPrecisionFormat::bfloat16 })
+    {
+        for (bool transposeA : { false, true })
+        {
+            Matrix<float> A = Matrix<float>::RandomUniform(transposeA ? k : m, transposeA ? m : k, CPUDEVICE, -1.0f, 1.0f, 1);
+            Matrix<float> roundedA = A.DeepClone();
+            RoundToReducedPrecision(format, roundedA.Data(), roundedA.GetNumElements());
+
+            // one-hot columns, a column with two weighted words and an empty one
+            Matrix<float> denseB(k, n, CPUDEVICE);
+            denseB.SetValue(0);
+            for (size_t j = 0; j < n; j++)
+                denseB(j * 111 % k, j) = 1;
+            denseB(k - 1, 3) = -0.5f;
+            denseB(0, 5) = 0;
+            Matrix<float> sparseB = denseB.DeepClone();
+            sparseB.SwitchToMatrixType(SPARSE, matrixFormatSparseCSC, true);
+
+            // all columns, and a view that starts with a later column
+            for (size_t first : { 0, 2 })
+            {
+                const size_t cols = n - first;
+                Matrix<float> expected(m, cols, CPUDEVICE);
+                Matrix<float>::MultiplyAndWeightedAdd(1.0f, roundedA, transposeA, denseB.ColumnSlice(first, cols), false, 0.0f, expected);
+
+                ReducedPrecisionMultiplier<float> multiplier(format);
+                Matrix<float> actual(m, cols, CPUDEVICE);
+                multiplier.Multiply(A, transposeA, sparseB.ColumnSlice(first, cols), actual);
+                BOOST_CHECK(actual.IsEqualTo(expected, 1e-5f));
+
+                // later products read only the packed copy, not A
+                Matrix<float> unchangedA = A.DeepClone();
+                A.SetValue(0);
+                multiplier.Multiply(A, transposeA, sparseB.ColumnSlice(first, cols), actual);
+                BOOST_CHECK(actual.IsEqualTo(expected, 1e-5f));
+                A.SetValue(unchangedA);
+            }
+        }
+    }
+}
+
+// Multipliers with a shared cache pack A once per format
+BOOST_AUTO_TEST_CASE(ReducedPrecisionMultipliersShareThePreparedOperand)
+{
+    const size_t m = 150, k = 1000, n = 7;
+    Matrix<float> A = Matrix<float>::RandomUniform(m, k, CPUDEVICE, -1.0f, 1.0f, 1);
+    Matrix<float> B = Matrix<float>::RandomUniform(k, n, CPUDEVICE, -1.0f, 1.0f, 2);
+
+    ReducedPrecisionMultiplier<float> first(ReducedPrecisionFormat::float16);
+    ReducedPrecisionMultiplier<float> second(ReducedPrecisionFormat::float16, first.GetCache());
+    ReducedPrecisionMultiplier<float> other(ReducedPrecisionFormat::bfloat16, first.GetCache());
+    Matrix<float> expected(m, n, CPUDEVICE);
+    Matrix<float> actual(m, n, CPUDEVICE);
+    first.Multiply(A, false, B, expected);
+    BOOST_CHECK(second.IsPrepared());
+    second.Multiply(A, false, B, actual);
+    BOOST_CHECK(actual.IsEqualTo(expected, 0.0f));
+
+    // bfloat16 keeps fewer significant bits, so its product must not come from the float16 copy
+    Matrix<float> roundedA = A.DeepClone();
+    RoundToReducedPrecision(ReducedPrecisionFormat::bfloat16, roundedA.Data(), roundedA.GetNumElements());
+    Matrix<float>::MultiplyAndWeightedAdd(1.0f, roundedA, false, B, false, 0.0f, expected);
+    other.Multiply(A, false, B, actual);
+    BOOST_CHECK(actual.IsEqualTo(expected, 1e-4f));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 }}}} //end namespaces
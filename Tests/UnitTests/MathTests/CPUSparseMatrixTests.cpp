@@ -61,6 +61,56 @@ BOOST_FIXTURE_TEST_CASE(CPUSparseMatrixCopyColumnSliceToDense, RandomSeedFixture
     BOOST_CHECK(dm1.IsEqualTo(dm2, c_epsilonFloatE4));
 }
 
+BOOST_FIXTURE_TEST_CASE(CPUSparseMatrixMultiplyAndAdd, RandomSeedFixture)
+{
+    // a sparse input with repeated rows (words) across its columns (samples), some empty columns
+    const size_t numWords = 40;
+    const size_t numSamples = 30;
+    const size_t hidden = 7;
+    DenseMatrix dense(numWords, numSamples);
+    SparseMatrix sparse(MatrixFormat::matrixFormatSparseCSC, numWords, numSamples, 0);
+    dense.SetValue(0);
+    for (size_t j = 0; j < numSamples; j++)
+    {
+        for (size_t i = (j * 7) % 5; i < numWords && j % 4 != 3; i += 3 + j % 5)
+        {
+            dense(i, j) = (double) (i + 1) / (j + 2);
+            sparse.SetValue(i, j, dense(i, j));
+        }
+    }
+
+    for (bool transposeA : { false, true })
+    {
+        for (bool transposeB : { false, true })
+        {
+            for (size_t start : { 0, 5 }) // full matrix and column slice of the sparse input
+            {
+                const size_t numCols = numSamples - start;
+                SparseMatrix sparseSlice = sparse.ColumnSlice(start, numCols);
+                DenseMatrix denseSlice = dense.ColumnSlice(start, numCols);
+
+                const size_t inner = transposeB ? numCols : numWords;
+                DenseMatrix lhs = transposeA ? DenseMatrix(inner, hidden) : DenseMatrix(hidden, inner);
+                lhs.SetUniformRandomValue(-1, 1, IncrementCounter());
+
+                SparseMatrix result(MatrixFormat::matrixFormatSparseBlockCol);
+                SparseMatrix::MultiplyAndAdd(0.5, lhs, transposeA, sparseSlice, transposeB, result);
+
+                DenseMatrix expected;
+                DenseMatrix::MultiplyAndWeightedAdd(0.5, lhs, transposeA, denseSlice, transposeB, 0, expected);
+                DenseMatrix actual(expected.GetNumRows(), expected.GetNumCols());
+                actual.SetValue(0);
+                SparseMatrix::ScaleAndAdd(1, result, actual);
+
+                BOOST_CHECK(actual.IsEqualTo(expected, c_epsilonFloatE4));
+                const size_t numBlocks = result.NzCount() / result.GetNumRows();
+                for (size_t b = 1; b < numBlocks; b++)
+                    BOOST_CHECK_LT(result.BlockIdsLocation()[b - 1], result.BlockIdsLocation()[b]);
+            }
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 }
 } } }
@@ -7,8 +7,11 @@
 #include <array>
 #include <random>
 #include <numeric>
+#include <fstream>
+#include <iterator>
 #include <boost/random/normal_distribution.hpp>
 #include <boost/random/uniform_int_distribution.hpp>
+#include <boost/filesystem.hpp>
 #include "../../../Source/Math/Matrix.h"
 #include "../../../Source/Math/CPUMatrix.h"
 #include "../../../Source/Math/GPUMatrix.h"
@@ -61,6 +64,10 @@ std::vector<std::tuple<ConvolutionEngineKind, DEVICEID_TYPE, size_t>> GetTestEng
     res.push_back(std::make_tuple(ConvolutionEngineKind::Gemm, -1, 0));
     res.push_back(std::make_tuple(ConvolutionEngineKind::Gemm, -1, 1));
     res.push_back(std::make_tuple(ConvolutionEngineKind::Gemm, -1, 3));
+
+    // Direct and Winograd engines. CPU only, plain 2D convolutions only, so fall back to the reference engine otherwise.
+    res.push_back(std::make_tuple((ConvolutionEngineKind)((int)ConvolutionEngineKind::Direct | (int)ConvolutionEngineKind::Reference), -1, 0));
+    res.push_back(std::make_tuple((ConvolutionEngineKind)((int)ConvolutionEngineKind::Winograd | (int)ConvolutionEngineKind::Reference), -1, 0));
     return res;
 }
 
@@ -370,6 +377,302 @@ BOOST_AUTO_TEST_CASE(ConvolutionBackwardKernel)
     }
 }
 
+BOOST_AUTO_TEST_CASE(DirectAndWinogradConvolutionCpu)
+{
+    // Direct and Winograd engines against the reference engine, on the CPU only.
+    std::mt19937 rng(0);
+    boost::random::uniform_int_distribution<> batchSizeG(1, 8);
+    boost::random::normal_distribution<float> nd;
+
+    auto initMat = [&](size_t r, size_t c, vec& data) -> SingleMatrix
+    {
+        data.resize(r * c);
+        std::generate(begin(data), end(data), [&] { return nd(rng); });
+        return SingleMatrix(r, c, data.data(), CPUDEVICE, matrixFlagNormal);
+    };
+
+    auto geometries = GenerateConvTestConfigs();
+    // Winograd tiles overlapping the right and bottom borders, and 1x1 convolutions computed as a matrix product.
+    geometries.push_back(std::make_shared<ConvolveGeometry>(TensorShape(7, 5, 4),
+        TensorShape(3, 3, 4), TensorShape(6), TensorShape(1, 1, 4),
+        ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{true, true, false},
+        TensorShape(0), TensorShape(0)));
+    geometries.push_back(std::make_shared<ConvolveGeometry>(TensorShape(6, 4, 8),
+        TensorShape(1, 1, 8), TensorShape(3), TensorShape(1, 1, 8),
+        ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{false},
+        TensorShape(0), TensorShape(0)));
+
+    for (auto engKind : {ConvolutionEngineKind::Direct, ConvolutionEngineKind::Winograd})
+    {
+        for (const auto& g : geometries)
+        {
+            auto baseEng = ConvEng::Create(g, CPUDEVICE, ImageLayoutKind::CHW, 0, PoolKind::None, ConvolutionEngineKind::Reference);
+            // Geometries that the engine does not support fall back to the reference engine.
+            auto testEng = ConvEng::Create(g, CPUDEVICE, ImageLayoutKind::CHW, 0, PoolKind::None, (ConvolutionEngineKind)((int)engKind | (int)ConvolutionEngineKind::Reference));
+
+            size_t n = batchSizeG(rng);
+            size_t mapCount = g->GetMapCount(g->InputShape().GetRank() - 1);
+            vec buf;
+            SingleMatrix in = initMat(g->InputShape().GetNumElements(), n, buf);
+            SingleMatrix kernel = initMat(mapCount, g->KernelShape().GetNumElements(), buf);
+            SingleMatrix srcGrad = initMat(g->OutputShape().GetNumElements(), n, buf);
+            SingleMatrix grad = initMat(g->InputShape().GetNumElements(), n, buf);
+            SingleMatrix gradB(grad.DeepClone(), CPUDEVICE);
+            SingleMatrix kernelGrad = initMat(mapCount, g->KernelShape().GetNumElements(), buf);
+            SingleMatrix kernelGradB(kernelGrad.DeepClone(), CPUDEVICE);
+            SingleMatrix out(g->OutputShape().GetNumElements(), n, CPUDEVICE);
+            SingleMatrix outB(g->OutputShape().GetNumElements(), n, CPUDEVICE);
+            SingleMatrix workspace(CPUDEVICE);
+            SingleMatrix workspaceB(CPUDEVICE);
+
+            testEng->Forward(in, kernel, out, workspace);
+            baseEng->Forward(in, kernel, outB, workspaceB);
+            testEng->BackwardData(srcGrad, kernel, grad, workspace);
+            baseEng->BackwardData(srcGrad, kernel, gradB, workspaceB);
+            testEng->BackwardKernel(srcGrad, in, kernelGrad, false, workspace);
+            baseEng->BackwardKernel(srcGrad, in, kernelGradB, false, workspaceB);
+
+            std::stringstream tmsg;
+            tmsg << "Geometry: " << (std::string)(*g) << ", Batch: " << n << ", Engine: " << (int)engKind;
+            std::string msg = " are not equal, " + tmsg.str();
+
+            float relErr = Err<float>::Rel;
+            float absErr = Err<float>::Abs;
+            std::string emsg;
+
+            BOOST_REQUIRE_MESSAGE(CheckEqual(out, outB, emsg, relErr * 4, absErr * 14), "out" << msg << ". " << emsg);
+            BOOST_REQUIRE_MESSAGE(CheckEqual(grad, gradB, emsg, relErr * 16, absErr * 16), "grad" << msg << ". " << emsg);
+            BOOST_REQUIRE_MESSAGE(CheckEqual(kernelGrad, kernelGradB, emsg, relErr * 192, absErr * 32), "kernel" << msg << ". " << emsg);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(QuantizedConvolutionForwardCpu)
+{
+    // 8-bit quantized forward pass of the GEMM engine against the full precision reference engine, with and without sub-batches.
+    std::mt19937 rng(0);
+    boost::random::normal_distribution<float> nd;
+
+    auto initMat = [&](size_t r, size_t c, vec& data) -> SingleMatrix
+    {
+        data.resize(r * c);
+        std::generate(begin(data), end(data), [&] { return nd(rng); });
+        return SingleMatrix(r, c, data.data(), CPUDEVICE, matrixFlagNormal);
+    };
+
+    std::vector<ConvolveGeometryPtr> geometries;
+    geometries.push_back(std::make_shared<ConvolveGeometry>(TensorShape(7, 5, 4),
+        TensorShape(3, 3, 4), TensorShape(6), TensorShape(1, 1, 4),
+        ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{true, true, false},
+        TensorShape(0), TensorShape(0)));
+    geometries.push_back(std::make_shared<ConvolveGeometry>(TensorShape(9, 8, 3),
+        TensorShape(5, 5, 3), TensorShape(8), TensorShape(2, 2, 3),
+        ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{false},
+        TensorShape(0), TensorShape(0)));
+    geometries.push_back(std::make_shared<ConvolveGeometry>(TensorShape(6, 4, 8),
+        TensorShape(1, 1, 8), TensorShape(3), TensorShape(1, 1, 8),
+        ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{false},
+        TensorShape(0), TensorShape(0)));
+
+    for (const auto& g : geometries)
+    {
+        for (size_t maxTempMem : { 0, 2 })
+        {
+            auto baseEng = ConvEng::Create(g, CPUDEVICE, ImageLayoutKind::CHW, 0, PoolKind::None, ConvolutionEngineKind::Reference);
+            auto testEng = ConvEng::Create(g, CPUDEVICE, ImageLayoutKind::CHW, maxTempMem, PoolKind::None, ConvolutionEngineKind::Gemm);
+
+            size_t n = 5;
+            size_t mapCount = g->GetMapCount(g->InputShape().GetRank() - 1);
+            vec buf;
+            SingleMatrix in = initMat(g->InputShape().GetNumElements(), n, buf);
+            SingleMatrix kernel = initMat(mapCount, g->KernelShape().GetNumElements(), buf);
+            SingleMatrix out(g->OutputShape().GetNumElements(), n, CPUDEVICE);
+            SingleMatrix outB(g->OutputShape().GetNumElements(), n, CPUDEVICE);
+            SingleMatrix workspace(CPUDEVICE);
+            SingleMatrix workspaceB(CPUDEVICE);
+
+            Int8QuantizedMultiplier<float> multiplier;
+            testEng->ForwardQuantized(in, kernel, out, workspace, multiplier);
+            baseEng->Forward(in, kernel, outB, workspaceB);
+
+            // The quantization error grows with the number of products that are summed up.
+            float tolerance = 0.05f * sqrt((float)g->KernelShape().GetNumElements());
+            for (size_t i = 0; i < out.GetNumElements(); i++)
+                BOOST_REQUIRE_MESSAGE(fabs(out.Data()[i] - outB.Data()[i]) < tolerance,
+                                      "out are not equal at " << i << ", geometry: " << (std::string)(*g) << ", maxTempMem: " << maxTempMem);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(DirectAndWinogradAreOptInCpu)
+{
+    // By default, Create() picks the GEMM engine for a 3x3 stride-1 convolution, once enabled the Winograd engine.
+    std::mt19937 rng(0);
+    boost::random::normal_distribution<float> nd;
+
+    auto initMat = [&](size_t r, size_t c, vec& data) -> SingleMatrix
+    {
+        data.resize(r * c);
+        std::generate(begin(data), end(data), [&] { return nd(rng); });
+        return SingleMatrix(r, c, data.data(), CPUDEVICE, matrixFlagNormal);
+    };
+
+    auto g = std::make_shared<ConvolveGeometry>(TensorShape(7, 5, 4),
+        TensorShape(3, 3, 4), TensorShape(6), TensorShape(1, 1, 4),
+        ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{true, true, false},
+        TensorShape(0), TensorShape(0));
+    size_t n = 3;
+    vec buf;
+    SingleMatrix in = initMat(g->InputShape().GetNumElements(), n, buf);
+    SingleMatrix kernel = initMat(6, g->KernelShape().GetNumElements(), buf);
+    SingleMatrix workspace(CPUDEVICE);
+
+    auto forward = [&](ConvolutionEngineKind enabledEngines)
+    {
+        SingleMatrix out(g->OutputShape().GetNumElements(), n, CPUDEVICE);
+        ConvEng::Create(g, CPUDEVICE, ImageLayoutKind::CHW, 0, PoolKind::None, enabledEngines)->Forward(in, kernel, out, workspace);
+        return out;
+    };
+    auto gemmOut = forward(ConvolutionEngineKind::Gemm);
+    auto winogradOut = forward(ConvolutionEngineKind::Winograd);
+
+    std::string emsg;
+    BOOST_REQUIRE(!CheckEqual(winogradOut, gemmOut, emsg, 0.0f, 0.0f)); // the engines round differently
+    BOOST_REQUIRE(!IsDirectAndWinogradConvolutionEnabled());
+    BOOST_CHECK_MESSAGE(CheckEqual(forward(ConvolutionEngineKind::All), gemmOut, emsg, 0.0f, 0.0f), "default engine is not GEMM. " << emsg);
+
+    SetDirectAndWinogradConvolution(true);
+    BOOST_CHECK_MESSAGE(CheckEqual(forward(ConvolutionEngineKind::All), winogradOut, emsg, 0.0f, 0.0f), "enabled engine is not Winograd. " << emsg);
+    SetDirectAndWinogradConvolution(false);
+}
+
+BOOST_AUTO_TEST_CASE(ConvolutionAutotuningCpu)
+{
+    std::mt19937 rng(0);
+    boost::random::normal_distribution<float> nd;
+
+    auto initMat = [&](size_t r, size_t c, vec& data) -> SingleMatrix
+    {
+        data.resize(r * c);
+        std::generate(begin(data), end(data), [&] { return nd(rng); });
+        return SingleMatrix(r, c, data.data(), CPUDEVICE, matrixFlagNormal);
+    };
+    auto readFile = [](const std::wstring& path)
+    {
+        std::ifstream file(boost::filesystem::path(path).string());
+        return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    };
+
+    const std::wstring cachePath = boost::filesystem::unique_path(boost::filesystem::temp_directory_path() / "ConvolutionAutotuningCpu-%%%%-%%%%.cache").wstring();
+
+    auto g = std::make_shared<ConvolveGeometry>(TensorShape(12, 10, 3),
+        TensorShape(3, 3, 3), TensorShape(4), TensorShape(1, 1, 3),
+        ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{true, true, false},
+        TensorShape(0), TensorShape(0));
+    size_t n = 5;
+    vec buf;
+    SingleMatrix in = initMat(g->InputShape().GetNumElements(), n, buf);
+    SingleMatrix kernel = initMat(4, g->KernelShape().GetNumElements(), buf);
+    SingleMatrix outB(g->OutputShape().GetNumElements(), n, CPUDEVICE);
+    SingleMatrix workspace(CPUDEVICE);
+    ConvEng::Create(g, CPUDEVICE, ImageLayoutKind::CHW, 0, PoolKind::None, ConvolutionEngineKind::Reference)->Forward(in, kernel, outB, workspace);
+
+    // The first engine tunes and records its decision, the second one restores it instead of tuning again, which
+    // would append another line. Both compute the same result. Which engine is fastest is up to the machine.
+    std::string decision;
+    for (size_t run = 0; run < 2; run++)
+    {
+        SetConvolutionAutotuning(true, cachePath);
+        auto eng = ConvEng::Create(g, CPUDEVICE, ImageLayoutKind::CHW, 0, PoolKind::None);
+        SingleMatrix out(g->OutputShape().GetNumElements(), n, CPUDEVICE);
+        eng->Forward(in, kernel, out, workspace);
+
+        std::string emsg;
+        BOOST_REQUIRE_MESSAGE(CheckEqual(out, outB, emsg, Err<float>::Rel * 16, Err<float>::Abs * 32), "out are not equal, run " << run << ". " << emsg);
+        if (run == 0)
+            decision = readFile(cachePath);
+        BOOST_CHECK_EQUAL(std::count(decision.begin(), decision.end(), '\n'), 1);
+        BOOST_CHECK_EQUAL(readFile(cachePath), decision);
+    }
+
+    SetConvolutionAutotuning(false);
+    BOOST_CHECK(!IsConvolutionAutotuningEnabled());
+    boost::filesystem::remove(cachePath);
+}
+
+BOOST_AUTO_TEST_CASE(ChannelBlockedLayoutCpu)
+{
+    // Convolutions and poolings on the channel-blocked layout against the reference engine on the cudnn layout.
+    std::mt19937 rng(0);
+    boost::random::normal_distribution<float> nd;
+
+    auto initMat = [&](size_t r, size_t c, vec& data) -> SingleMatrix
+    {
+        data.resize(r * c);
+        std::generate(begin(data), end(data), [&] { return nd(rng); });
+        return SingleMatrix(r, c, data.data(), CPUDEVICE, matrixFlagNormal);
+    };
+
+    using ConvConfig = std::pair<PoolKind, ConvolveGeometryPtr>;
+    std::vector<ConvConfig> configs;
+    configs.push_back(ConvConfig(PoolKind::None, std::make_shared<ConvolveGeometry>(TensorShape(9, 7, 8),
+        TensorShape(3, 3, 8), TensorShape(16), TensorShape(1, 1, 8),
+        ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{true, true, false}, TensorShape(0), TensorShape(0))));
+    configs.push_back(ConvConfig(PoolKind::None, std::make_shared<ConvolveGeometry>(TensorShape(10, 6, 16),
+        TensorShape(3, 2, 16), TensorShape(8), TensorShape(2, 2, 16),
+        ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{false}, TensorShape(0), TensorShape(0))));
+    configs.push_back(ConvConfig(PoolKind::Max, std::make_shared<ConvolveGeometry>(TensorShape(9, 6, 8),
+        TensorShape(2, 2, 1), TensorShape(1), TensorShape(2, 2, 1),
+        ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{false}, TensorShape(0), TensorShape(0))));
+    configs.push_back(ConvConfig(PoolKind::Average, std::make_shared<ConvolveGeometry>(TensorShape(5, 7, 16),
+        TensorShape(3, 3, 1), TensorShape(1), TensorShape(1, 1, 1),
+        ConvolveGeometry::BoolVec{true}, ConvolveGeometry::BoolVec{true, true, false}, TensorShape(0), TensorShape(0))));
+
+    for (const auto& config : configs)
+    {
+        PoolKind poolKind = config.first;
+        const auto& g = config.second;
+        BOOST_REQUIRE(ConvEng::IsChannelBlockedLayoutSupported(*g, CPUDEVICE, poolKind));
+        auto baseEng = ConvEng::Create(g, CPUDEVICE, ImageLayoutKind::CHW, 0, poolKind, ConvolutionEngineKind::Reference);
+        auto testEng = ConvEng::Create(g, CPUDEVICE, ImageLayoutKind::CHWc, 0, poolKind);
+
+        size_t n = 3;
+        size_t mapCount = g->GetMapCount(g->InputShape().GetRank() - 1);
+        vec buf;
+        SingleMatrix in = initMat(g->InputShape().GetNumElements(), n, buf);
+        SingleMatrix kernel = initMat(mapCount, g->KernelShape().GetNumElements(), buf);
+        SingleMatrix outB(g->OutputShape().GetNumElements(), n, CPUDEVICE);
+        SingleMatrix workspace(CPUDEVICE);
+        if (poolKind == PoolKind::None)
+            baseEng->Forward(in, kernel, outB, workspace);
+        else
+            baseEng->ForwardPooling(in, outB);
+
+        SingleMatrix blockedIn(in.GetNumRows(), n, CPUDEVICE);
+        ConvEng::ReorderChannelBlocks(in, blockedIn, g->InputShape(), /*toChannelBlocks=*/true);
+        SingleMatrix blockedOut(outB.GetNumRows(), n, CPUDEVICE);
+        if (poolKind == PoolKind::None)
+            testEng->Forward(blockedIn, kernel, blockedOut, workspace);
+        else
+            testEng->ForwardPooling(blockedIn, blockedOut);
+        SingleMatrix out(outB.GetNumRows(), n, CPUDEVICE);
+        ConvEng::ReorderChannelBlocks(blockedOut, out, g->OutputShape(), /*toChannelBlocks=*/false);
+
+        std::string emsg;
+        BOOST_REQUIRE_MESSAGE(CheckEqual(out, outB, emsg, Err<float>::Rel * 4, Err<float>::Abs * 14),
+                              "out are not equal, Geometry: " << (std::string)(*g) << ". " << emsg);
+
+        // reordering back and forth, and accumulating the gradient
+        SingleMatrix roundTrip(in.GetNumRows(), n, CPUDEVICE);
+        ConvEng::ReorderChannelBlocks(blockedIn, roundTrip, g->InputShape(), /*toChannelBlocks=*/false);
+        BOOST_REQUIRE(roundTrip.IsEqualTo(in));
+        ConvEng::ReorderChannelBlocks(blockedIn, roundTrip, g->InputShape(), /*toChannelBlocks=*/false, /*accumulate=*/true);
+        SingleMatrix twice(in.DeepClone(), CPUDEVICE);
+        twice.AssignSumOf(in, in);
+        BOOST_REQUIRE(roundTrip.IsEqualTo(twice));
+    }
+}
+
 BOOST_AUTO_TEST_CASE(PoolingForward)
 {
     std::mt19937 rng(0);
@@ -0,0 +1,174 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include <random>
+#include "../../../Source/Math/Matrix.h"
+#include "../../../Source/Math/CPURNN.h"
+
+using namespace Microsoft::MSR::CNTK;
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+namespace
+{
+float Sigmoid(float x)
+{
+    return 1 / (1 + exp(-x));
+}
+
+// Straightforward evaluation of one sequence (one vector per frame) against the cuDNN parameter layout.
+std::vector<std::vector<float>> ReferenceRNN(const std::vector<float>& params, std::vector<std::vector<float>> input, const RnnAttributes& attributes)
+{
+    const size_t H = attributes.m_hiddenSize;
+    const size_t numDirections = attributes.m_bidirectional ? 2 : 1;
+    const size_t G = attributes.m_recurrentOp == L"lstm" ? 4 : attributes.m_recurrentOp == L"gru" ? 3 : 1;
+    const size_t T = input.size();
+
+    size_t biasOffset = 0;
+    for (size_t l = 0, inputDim = input[0].size(); l < attributes.m_numLayers; l++, inputDim = numDirections * H)
+        biasOffset += numDirections * G * H * (inputDim + H);
+
+    size_t weightOffset = 0;
+    for (size_t l = 0; l < attributes.m_numLayers; l++)
+    {
+        const size_t inputDim = input[0].size();
+        std::vector<std::vector<float>> output(T, std::vector<float>(numDirections * H));
+        for (size_t d = 0; d < numDirections; d++)
+        {
+            const float* W = params.data() + weightOffset;
+            const float* R = W + G * H * inputDim;
+            const float* bW = params.data() + biasOffset;
+            const float* bR = bW + G * H;
+            weightOffset += G * H * (inputDim + H);
+            biasOffset += 2 * G * H;
+
+            std::vector<float> h(H, 0), c(H, 0);
+            for (size_t step = 0; step < T; step++)
+            {
+                size_t t = d == 0 ? step : T - 1 - step;
+                std::vector<float> wx(G * H), rh(G * H);
+                for (size_t i = 0; i < G * H; i++)
+                {
+                    wx[i] = bW[i];
+                    rh[i] = bR[i];
+                    for (size_t j = 0; j < inputDim; j++)
+                        wx[i] += W[i * inputDim + j] * input[t][j];
+                    for (size_t j = 0; j < H; j++)
+                        rh[i] += R[i * H + j] * h[j];
+                }
+                std::vector<float> hNew(H);
+                for (size_t k = 0; k < H; k++)
+                {
+                    if (attributes.m_recurrentOp == L"lstm")
+                    {
+                        c[k] = Sigmoid(wx[H + k] + rh[H + k]) * c[k] + Sigmoid(wx[k] + rh[k]) * tanh(wx[2 * H + k] + rh[2 * H + k]);
+                        hNew[k] = Sigmoid(wx[3 * H + k] + rh[3 * H + k]) * tanh(c[k]);
+                    }
+                    else if (attributes.m_recurrentOp == L"gru")
+                    {
+                        float r = Sigmoid(wx[k] + rh[k]);
+                        float u = Sigmoid(wx[H + k] + rh[H + k]);
+                        hNew[k] = (1 - u) * tanh(wx[2 * H + k] + r * rh[2 * H + k]) + u * h[k];
+                    }
+                    else if (attributes.m_recurrentOp == L"rnnReLU")
+                        hNew[k] = std::max(wx[k] + rh[k], 0.0f);
+                    else
+                        hNew[k] = tanh(wx[k] + rh[k]);
+                }
+                h = hNew;
+                std::copy(h.begin(), h.end(), output[t].begin() + d * H);
+            }
+        }
+        input = output;
+    }
+    return input;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(CPURNNSuite)
+
+BOOST_FIXTURE_TEST_CASE(CPURNNTanhSingleSequence, RandomSeedFixture)
+{
+    // W, R, bW, bR of a single unit
+    const float params[] = { 0.5f, 0.25f, 0.1f, -0.1f };
+    const float x[] = { 1, 2, 3 };
+    Matrix<float> paramW(1, 4, (float*) params, CPUDEVICE);
+    Matrix<float> inputX(1, 3, (float*) x, CPUDEVICE);
+    Matrix<float> outputY(CPUDEVICE), workspace(CPUDEVICE);
+    RnnAttributes attributes(false, 1, 1, L"rnnTanh", -1);
+
+    CPURNN<float>::Forward(paramW, inputX, outputY, 1, 1, std::vector<size_t>(3, 1), attributes, workspace);
+
+    float h1 = tanh(0.5f);
+    float h2 = tanh(1.0f + 0.25f * h1);
+    float h3 = tanh(1.5f + 0.25f * h2);
+    BOOST_REQUIRE_EQUAL(outputY.GetNumElements(), 3);
+    BOOST_CHECK_CLOSE(outputY(0, 0), h1, 1e-4);
+    BOOST_CHECK_CLOSE(outputY(0, 1), h2, 1e-4);
+    BOOST_CHECK_CLOSE(outputY(0, 2), h3, 1e-4);
+}
+
+BOOST_FIXTURE_TEST_CASE(CPURNNPackedSequencesMatchReference, RandomSeedFixture)
+{
+    const size_t xDim = 3, hidden = 4;
+    const std::vector<size_t> sequenceLengths = { 5, 3, 3, 1 }; // packed by decreasing length
+    const size_t numFrames = sequenceLengths[0];
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> dist(-0.5f, 0.5f);
+
+    std::vector<size_t> numSequencesForFrame(numFrames, 0), frameOffsets(numFrames + 1, 0);
+    for (size_t t = 0; t < numFrames; t++)
+    {
+        for (auto length : sequenceLengths)
+            numSequencesForFrame[t] += length > t;
+        frameOffsets[t + 1] = frameOffsets[t] + numSequencesForFrame[t];
+    }
+    const size_t numCols = frameOffsets[numFrames];
+
+    std::vector<std::vector<std::vector<float>>> sequences(sequenceLengths.size());
+    std::vector<float> packed(xDim * numCols);
+    for (size_t s = 0; s < sequenceLengths.size(); s++)
+    {
+        for (size_t t = 0; t < sequenceLengths[s]; t++)
+        {
+            std::vector<float> frame(xDim);
+            for (auto& v : frame)
+                v = dist(rng);
+            std::copy(frame.begin(), frame.end(), packed.begin() + (frameOffsets[t] + s) * xDim);
+            sequences[s].push_back(frame);
+        }
+    }
+    Matrix<float> inputX(xDim, numCols, packed.data(), CPUDEVICE);
+
+    for (auto op : { L"lstm", L"gru", L"rnnReLU", L"rnnTanh" })
+    {
+        for (bool bidirectional : { false, true })
+        {
+            RnnAttributes attributes(bidirectional, 2, hidden, op, -1);
+            auto numParameters = attributes.GetNumParameters(xDim);
+            std::vector<float> params(numParameters.first * numParameters.second);
+            for (auto& v : params)
+                v = dist(rng);
+            Matrix<float> paramW(numParameters.first, numParameters.second, params.data(), CPUDEVICE);
+            Matrix<float> outputY(CPUDEVICE), workspace(CPUDEVICE);
+
+            const size_t yDim = (bidirectional ? 2 : 1) * hidden;
+            CPURNN<float>::Forward(paramW, inputX, outputY, xDim, yDim, numSequencesForFrame, attributes, workspace);
+            BOOST_REQUIRE_EQUAL(outputY.GetNumElements(), yDim * numCols);
+
+            for (size_t s = 0; s < sequenceLengths.size(); s++)
+            {
+                auto expected = ReferenceRNN(params, sequences[s], attributes);
+                for (size_t t = 0; t < sequenceLengths[s]; t++)
+                    for (size_t k = 0; k < yDim; k++)
+                        BOOST_CHECK_SMALL(outputY(k, frameOffsets[t] + s) - expected[t][k], 1e-5f);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} } } }
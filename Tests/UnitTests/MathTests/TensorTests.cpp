@@ -4,9 +4,12 @@
 //
 //
 #include "stdafx.h"
+#include <omp.h>
+#include <random>
 #include "TensorView.h"
 #include "Sequences.h"
 #include "TensorTestsHelper.h"
+#include "CPUKernels.h"
 
 using namespace Microsoft::MSR::CNTK;
 
@@ -85,6 +88,107 @@ BOOST_AUTO_TEST_CASE(BiasGradient2)
     });
 }
 
+BOOST_AUTO_TEST_CASE(CPUReductions)
+{
+    // 4 threads, so that the parallel code paths are taken on any machine
+    int numThreads = omp_get_max_threads();
+    omp_set_num_threads(4);
+    struct Case { TensorShape input, output; };
+    const Case cases[] = {
+        { TensorShape{ 300000 }, TensorShape{ 1 } },             // reduction to a scalar: split into chunks
+        { TensorShape{ 64, 5000 }, TensorShape{ 64 } },          // bias gradient: parallel over the output elements
+        { TensorShape{ 3, 40000 }, TensorShape{ 3 } },           // few long reductions: each split into chunks
+        { TensorShape{ 5000, 64 }, TensorShape{ 1, 64 } },       // contiguous reduction
+        { TensorShape{ 8, 100, 300 }, TensorShape{ 1, 100, 1 } } // two reduction dimensions
+    };
+    for (const auto& c : cases)
+    {
+        SmallVector<size_t> inDims(c.input.GetDims()), outDims(c.output.GetDims());
+        inDims.resize(3, 1);
+        outDims.resize(3, 1);
+
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<float> dist(-1, 1);
+        vector<float> init(c.input.GetNumElements());
+        generate(init.begin(), init.end(), [&] { return dist(rng); });
+        TensorView<float> input(make_shared<Matrix<float>>(init.size(), 1, init.data(), CPUDEVICE), c.input);
+
+        for (auto reductionOp : { ElementWiseOperator::opSum, ElementWiseOperator::opMax, ElementWiseOperator::opLogSum })
+        {
+            // LogAdd() drops terms that are more than -MINLOGEXP below the aggregate, so long log-sums depend on the order of summation
+            if (reductionOp == ElementWiseOperator::opLogSum && c.input.GetNumElements() / c.output.GetNumElements() > 5000)
+                continue;
+
+            // reference: strictly sequential reduction in double precision
+            vector<double> expected(c.output.GetNumElements(), reductionOp == ElementWiseOperator::opSum ? 0 : -std::numeric_limits<double>::infinity());
+            for (size_t k = 0, n = 0; k < inDims[2]; k++)
+                for (size_t j = 0; j < inDims[1]; j++)
+                    for (size_t i = 0; i < inDims[0]; i++, n++)
+                    {
+                        double& e = expected[(outDims[0] == 1 ? 0 : i) + outDims[0] * ((outDims[1] == 1 ? 0 : j) + outDims[1] * (outDims[2] == 1 ? 0 : k))];
+                        if (reductionOp == ElementWiseOperator::opSum)
+                            e += init[n];
+                        else if (reductionOp == ElementWiseOperator::opMax)
+                            e = max(e, (double) init[n]);
+                        else
+                            e = max(e, (double) init[n]) + log(exp(e - max(e, (double) init[n])) + exp(init[n] - max(e, (double) init[n])));
+                    }
+
+            TensorView<float> output(make_shared<Matrix<float>>(c.output.GetNumElements(), 1, CPUDEVICE), c.output);
+            output.DoUnaryOpOf(0, input, 1, ElementWiseOperator::opCopy, reductionOp);
+            Matrix<float> result = output.GetSOB().DeepClone();
+            for (size_t i = 0; i < expected.size(); i++)
+                BOOST_CHECK_CLOSE(result(i, 0), expected[i], 1e-3);
+        }
+    }
+    omp_set_num_threads(numThreads);
+}
+
+BOOST_AUTO_TEST_CASE(CPUElementwiseAllInstructionSets)
+{
+    // large enough for the parallel loops
+    const size_t n = 100003;
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> dist(-3, 3);
+    vector<float> initA(n), initB(n), initC(n);
+    generate(initA.begin(), initA.end(), [&] { return dist(rng); });
+    generate(initB.begin(), initB.end(), [&] { return dist(rng); });
+    generate(initC.begin(), initC.end(), [&] { return dist(rng); });
+    TensorView<float> a(make_shared<Matrix<float>>(n, 1, initA.data(), CPUDEVICE), TensorShape{ n });
+    TensorView<float> b(make_shared<Matrix<float>>(n, 1, initB.data(), CPUDEVICE), TensorShape{ n });
+
+    // The loops of all instruction sets must give bit-identical results.
+    const CPUInstructionSet supported = GetSupportedCPUInstructionSet();
+    vector<vector<float>> results;
+    for (int instructionSet = (int)CPUInstructionSet::SSE41; instructionSet <= (int)supported; instructionSet++)
+    {
+        SetCPUInstructionSet((CPUInstructionSet)instructionSet);
+        vector<float> result;
+        for (float beta : { 0.0f, 0.5f })
+        {
+            TensorView<float> c(make_shared<Matrix<float>>(n, 1, initC.data(), CPUDEVICE), TensorShape{ n });
+            c.DoBinaryOpOf(beta, a, b, 2.0f, ElementWiseOperator::opElementwiseProduct, ElementWiseOperator::opSum);
+            c.DoBinaryOpOf(beta, c, a, 1.0f, ElementWiseOperator::opSum, ElementWiseOperator::opSum);
+            c.DoUnaryOpOf(beta, c, 1.0f, ElementWiseOperator::opSigmoid, ElementWiseOperator::opSum);
+            Matrix<float> m = c.GetSOB().DeepClone();
+            result.insert(result.end(), m.Data(), m.Data() + n);
+        }
+        results.push_back(result);
+    }
+    SetCPUInstructionSet(supported);
+
+    for (size_t i = 0; i < 2 * n; i++)
+    {
+        float beta = i < n ? 0.0f : 0.5f, c = initC[i % n], x = initA[i % n], y = initB[i % n];
+        c = x * y * 2.0f + beta * c;
+        c = (c + x) + beta * c;
+        c = 1.0f / (1.0f + exp(-c)) + beta * c;
+        BOOST_CHECK_CLOSE(results[0][i], c, 1e-3);
+    }
+    for (size_t k = 1; k < results.size(); k++)
+        BOOST_CHECK(results[k] == results[0]);
+}
+
 BOOST_AUTO_TEST_CASE(ColumnSliceMultAndAdd)
 {
     ColumnSliceMultAndAddTest<float>(2048, 2048, 256, 0);
@@ -0,0 +1,114 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "ComputationNetwork.h"
+#include "ComputationNetworkBuilder.h"
+#include "TrainingNodes.h"
+#include "Common/ValueTestHelper.h"
+
+using namespace Microsoft::MSR::CNTK;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+namespace
+{
+const float epsilon = 1e-5f;
+
+// builds bnC = BatchNormalization(Convolution(W, x)) with spatial normalization of 16 channels, and
+// bnT = BatchNormalization(Plus(Times(V, y), b)) with normalization of 10 elements, and evaluates bnC and bnT in inference mode
+// nearZeroVariance - set the variance of a third of the channels to 0 and of another third to 1e-7, so that epsilon dominates
+ComputationNetworkPtr EvaluateNormalizedNetwork(bool foldBatchNormalization, bool nearZeroVariance)
+{
+    auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+    ComputationNetworkBuilder<float> builder(*net);
+    auto x = builder.CreateInputNode(L"x", TensorShape(6, 5, 4));
+    auto y = builder.CreateInputNode(L"y", 12);
+    auto w = builder.CreateLearnableParameter(L"W", 16, 3 * 3 * 4);
+    auto v = builder.CreateLearnableParameter(L"V", 10, 12);
+    auto b = builder.CreateLearnableParameter(L"b", 10, 1);
+    SetValues(w, 0.02f, -0.1f);
+    SetValues(v, 0.05f, -0.2f);
+    SetValues(b, 0.1f, -0.3f);
+
+    auto normalize = [&](const shared_ptr<ComputationNode<float>>& input, size_t dim, bool spatial, const wstring& name)
+    {
+        auto scale = builder.CreateLearnableParameter(name + L".scale", dim, 1);
+        auto bias = builder.CreateLearnableParameter(name + L".bias", dim, 1);
+        auto mean = builder.CreateLearnableParameter(name + L".mean", dim, 1);
+        auto variance = builder.CreateLearnableParameter(name + L".variance", dim, 1);
+        SetValues(scale, 0.1f, 0.5f);
+        SetValues(bias, 0.2f, -1.0f);
+        SetValues(mean, 0.05f, -0.2f);
+        SetValues(variance, 0.3f, 0.1f);
+        if (nearZeroVariance)
+        {
+            float* pvariance = variance->Value().Data();
+            for (size_t j = 0; j < dim; j++)
+                pvariance[j] = j % 3 == 0 ? 0 : j % 3 == 1 ? 1e-7f : pvariance[j];
+        }
+        auto bn = builder.BatchNormalization(input, scale, bias, mean, variance, spatial, 0, 0, epsilon, true, ImageLayoutKind::CHW, name);
+        bn->As<BatchNormalizationNode<float>>()->SetSamplesSeen(1000); // the running statistics count as trained
+        return bn;
+    };
+    auto c = builder.Convolution(w, x, TensorShape(3, 3, 4), TensorShape(16), TensorShape(1, 1, 4),
+                                 vector<bool>{true}, vector<bool>{true, true, false}, TensorShape(0), TensorShape(0),
+                                 false, ImageLayoutKind::CHW, 0, L"c");
+    auto p = builder.Plus(builder.Times(v, y, 1, L"h"), b, L"p");
+    net->AddToNodeGroup(L"output", normalize(c, 16, true, L"bnC"));
+    net->AddToNodeGroup(L"output", normalize(p, 10, false, L"bnT"));
+    net->SetBatchNormalizationFolding(foldBatchNormalization);
+    net->CompileNetwork();
+
+    InitSingleFrameSamples(net, 2);
+    x->Value().Resize(6 * 5 * 4, 2);
+    y->Value().Resize(12, 2);
+    SetValues(x, 0.2f, -1.0f);
+    SetValues(y, 0.15f, -0.7f);
+
+    EvaluateInference(net, { net->GetNodeFromName(L"bnC"), net->GetNodeFromName(L"bnT") });
+    return net;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(BatchNormalizationFoldingSuite)
+
+BOOST_AUTO_TEST_CASE(FoldedNetworkMatchesNormalization)
+{
+    auto net = EvaluateNormalizedNetwork(false, false);
+    auto foldedNet = EvaluateNormalizedNetwork(true, false);
+
+    // the reference computes the normalizations with the BatchNormalization nodes and their engine
+    BOOST_CHECK(net->GetNodeFromName(L"bnC")->OperationName() == L"BatchNormalization");
+    BOOST_CHECK(net->GetNodeFromName(L"bnT")->OperationName() == L"BatchNormalization");
+
+    // bnC is replaced by a new bias addition, bnT by the existing one; the normalization parameters are gone
+    BOOST_CHECK(foldedNet->GetNodeFromName(L"bnC")->OperationName() == L"Plus");
+    BOOST_CHECK(foldedNet->GetNodeFromName(L"bnC")->GetInputs()[0] == foldedNet->GetNodeFromName(L"c"));
+    BOOST_CHECK(foldedNet->GetNodeFromName(L"bnT")->OperationName() == L"Plus");
+    BOOST_CHECK(foldedNet->GetNodeFromName(L"bnT")->GetInputs()[1] == foldedNet->GetNodeFromName(L"b"));
+    BOOST_CHECK(!foldedNet->NodeNameExists(L"p"));
+    for (const wstring& name : { L"bnC.scale", L"bnC.variance", L"bnT.mean", L"bnT.bias" })
+        BOOST_CHECK(!foldedNet->NodeNameExists(name));
+
+    for (const wstring& name : { L"bnC", L"bnT" })
+        CheckCloseValues(NodeValue(foldedNet, name), NodeValue(net, name), 1e-5f);
+}
+
+BOOST_AUTO_TEST_CASE(NearZeroVarianceIsFoldedWithEpsilon)
+{
+    auto net = EvaluateNormalizedNetwork(false, true);
+    auto foldedNet = EvaluateNormalizedNetwork(true, true);
+
+    BOOST_CHECK(foldedNet->GetNodeFromName(L"bnC")->OperationName() == L"Plus");
+    BOOST_CHECK(foldedNet->GetNodeFromName(L"bnT")->OperationName() == L"Plus");
+
+    // scaled by up to 1/sqrt(epsilon), the outputs reach several hundred, and differ in the last bits
+    for (const wstring& name : { L"bnC", L"bnT" })
+        CheckCloseValues(NodeValue(foldedNet, name), NodeValue(net, name), 1e-3f);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
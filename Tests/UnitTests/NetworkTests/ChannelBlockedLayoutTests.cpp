@@ -0,0 +1,159 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "ComputationNetwork.h"
+#include "ComputationNetworkBuilder.h"
+#include "Common/ValueTestHelper.h"
+#include <boost/filesystem.hpp>
+
+using namespace Microsoft::MSR::CNTK;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+namespace
+{
+typedef shared_ptr<ComputationNode<float>> NodePtr;
+
+// 3x3 convolution with the given padding
+NodePtr Convolve(ComputationNetworkBuilder<float>& builder, const NodePtr& w, const NodePtr& input, size_t inChannels, size_t outChannels,
+                 bool autoPadding, const TensorShape& lowerPad, const TensorShape& upperPad, const wstring& name)
+{
+    return builder.Convolution(w, input, TensorShape(3, 3, inChannels), TensorShape(outChannels), TensorShape(1, 1, inChannels),
+                               vector<bool>{true}, vector<bool>{autoPadding, autoPadding, false}, lowerPad, upperPad,
+                               false, ImageLayoutKind::CHW, 0, name);
+}
+
+size_t CountReorderings(const ComputationNetworkPtr& net)
+{
+    size_t numReorderings = 0;
+    for (const auto& node : net->GetAllNodes())
+        if (node->OperationName() == L"ReorderChannelBlocks")
+            numReorderings++;
+    return numReorderings;
+}
+
+// evaluates the output z of a compiled network on two images [W x H x C]
+ComputationNetworkPtr EvaluateCompiled(const ComputationNetworkPtr& net, const TensorShape& imageShape)
+{
+    InitSingleFrameSamples(net, 2);
+    auto x = net->GetNodeFromName(L"x");
+    x->As<ComputationNode<float>>()->Value().Resize(imageShape.GetNumElements(), 2);
+    SetValues(x, 0.2f, -1.0f);
+    EvaluateInference(net, { net->GetNodeFromName(L"z") });
+    return net;
+}
+
+ComputationNetworkPtr Evaluate(const ComputationNetworkPtr& net, bool channelBlockedLayout, const TensorShape& imageShape)
+{
+    net->SetChannelBlockedLayout(channelBlockedLayout);
+    net->CompileNetwork();
+    return EvaluateCompiled(net, imageShape);
+}
+
+// builds z = Convolution(W2, MaxPooling(ReLU(Convolution(W1, x)))) with 8 and 16 channels,
+// and evaluates it on two images
+ComputationNetworkPtr EvaluateConvolutionStack(bool channelBlockedLayout)
+{
+    auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+    ComputationNetworkBuilder<float> builder(*net);
+    auto features = builder.CreateInputNode(L"x", TensorShape(8, 6, 8));
+    auto w1 = builder.CreateLearnableParameter(L"W1", 16, 3 * 3 * 8);
+    auto w2 = builder.CreateLearnableParameter(L"W2", 8, 3 * 3 * 16);
+    SetValues(w1, 0.02f, -0.1f);
+    SetValues(w2, 0.03f, -0.15f);
+
+    auto c1 = Convolve(builder, w1, features, 8, 16, true, TensorShape(0), TensorShape(0), L"c1");
+    auto r = builder.RectifiedLinear(c1, L"r");
+    auto p = builder.Pooling(r, PoolKind::Max, TensorShape(2, 2, 1), TensorShape(2, 2, 1), vector<bool>{false},
+                             TensorShape(0), TensorShape(0), ImageLayoutKind::CHW, L"p");
+    ComputationNodeBasePtr z = Convolve(builder, w2, p, 16, 8, true, TensorShape(0), TensorShape(0), L"z");
+    net->AddToNodeGroup(L"output", z);
+    return Evaluate(net, channelBlockedLayout, TensorShape(8, 6, 8));
+}
+
+// builds z = Convolution(W2, AveragePooling(ReLU(Convolution(W1, ReLU(Convolution(W0, x)))))) on odd-sized images:
+// c0 reads 3 channels and z writes 12, which are no multiples of the block size, c1 is padded asymmetrically,
+// and the pooling window overhangs the image, so that it is padded as well
+ComputationNetworkPtr EvaluatePaddedStack(bool channelBlockedLayout)
+{
+    auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+    ComputationNetworkBuilder<float> builder(*net);
+    auto features = builder.CreateInputNode(L"x", TensorShape(9, 7, 3));
+    auto w0 = builder.CreateLearnableParameter(L"W0", 16, 3 * 3 * 3);
+    auto w1 = builder.CreateLearnableParameter(L"W1", 16, 3 * 3 * 16);
+    auto w2 = builder.CreateLearnableParameter(L"W2", 12, 3 * 3 * 16);
+    SetValues(w0, 0.04f, -0.2f);
+    SetValues(w1, 0.02f, -0.1f);
+    SetValues(w2, 0.03f, -0.15f);
+
+    auto c0 = Convolve(builder, w0, features, 3, 16, true, TensorShape(0), TensorShape(0), L"c0");
+    auto c1 = Convolve(builder, w1, builder.RectifiedLinear(c0, L"r0"), 16, 16, false, TensorShape(0, 1, 0), TensorShape(1, 0, 0), L"c1");
+    auto p = builder.Pooling(builder.RectifiedLinear(c1, L"r1"), PoolKind::Average, TensorShape(3, 3, 1), TensorShape(2, 2, 1), vector<bool>{true, true, false},
+                             TensorShape(0), TensorShape(0), ImageLayoutKind::CHW, L"p");
+    ComputationNodeBasePtr z = Convolve(builder, w2, p, 16, 12, true, TensorShape(0), TensorShape(0), L"z");
+    net->AddToNodeGroup(L"output", z);
+    return Evaluate(net, channelBlockedLayout, TensorShape(9, 7, 3));
+}
+}
+
+BOOST_AUTO_TEST_SUITE(ChannelBlockedLayoutSuite)
+
+BOOST_AUTO_TEST_CASE(BlockedRegionMatchesCudnnLayout)
+{
+    auto net = EvaluateConvolutionStack(false);
+    auto blockedNet = EvaluateConvolutionStack(true);
+
+    // c1, r and p compute on the blocked layout; x is reordered into it, p back out of it. z is an output and stays as it is.
+    BOOST_CHECK_EQUAL(CountReorderings(blockedNet), 2);
+    BOOST_CHECK(blockedNet->GetNodeFromName(L"c1")->GetInputs()[1]->OperationName() == L"ReorderChannelBlocks");
+    BOOST_CHECK(blockedNet->GetNodeFromName(L"z")->GetInputs()[1]->OperationName() == L"ReorderChannelBlocks");
+    BOOST_CHECK(blockedNet->GetNodeFromName(L"r")->GetInputs()[0] == blockedNet->GetNodeFromName(L"c1"));
+
+    CheckCloseValues(NodeValue(blockedNet, L"z"), NodeValue(net, L"z"), 1e-4f);
+}
+
+BOOST_AUTO_TEST_CASE(PaddingAndPartialChannelBlocks)
+{
+    auto net = EvaluatePaddedStack(false);
+    auto blockedNet = EvaluatePaddedStack(true);
+
+    // c0 reads x as it is, since 3 channels do not fill a block; c1, r1 and p form the blocked region
+    BOOST_CHECK(blockedNet->GetNodeFromName(L"c0")->GetInputs()[1] == blockedNet->GetNodeFromName(L"x"));
+    BOOST_CHECK(blockedNet->GetNodeFromName(L"c1")->GetInputs()[1]->OperationName() == L"ReorderChannelBlocks");
+    BOOST_CHECK(blockedNet->GetNodeFromName(L"z")->GetInputs()[1]->OperationName() == L"ReorderChannelBlocks");
+    BOOST_CHECK_EQUAL(CountReorderings(blockedNet), 2);
+
+    CheckCloseValues(NodeValue(blockedNet, L"z"), NodeValue(net, L"z"), 1e-4f);
+}
+
+BOOST_AUTO_TEST_CASE(CloneKeepsBlockedLayout)
+{
+    auto net = EvaluateConvolutionStack(false);
+    auto clonedNet = EvaluateConvolutionStack(true)->CloneWithSharedParameters();
+
+    BOOST_CHECK_EQUAL(CountReorderings(clonedNet), 2);
+    EvaluateCompiled(clonedNet, TensorShape(8, 6, 8));
+    CheckCloseValues(NodeValue(clonedNet, L"z"), NodeValue(net, L"z"), 1e-4f);
+}
+
+BOOST_AUTO_TEST_CASE(SavedModelKeepsBlockedLayout)
+{
+    const wstring modelPath = boost::filesystem::unique_path(boost::filesystem::temp_directory_path() / "ChannelBlockedLayoutTests-%%%%-%%%%.dnn").wstring();
+    auto net = EvaluateConvolutionStack(false);
+    EvaluateConvolutionStack(true)->Save(modelPath);
+    {
+        auto loadedNet = make_shared<ComputationNetwork>(CPUDEVICE);
+        loadedNet->Load<float>(modelPath);
+
+        BOOST_CHECK_EQUAL(CountReorderings(loadedNet), 2);
+        EvaluateCompiled(loadedNet, TensorShape(8, 6, 8));
+        CheckCloseValues(NodeValue(loadedNet, L"z"), NodeValue(net, L"z"), 1e-4f);
+    }
+    _wunlink(modelPath.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
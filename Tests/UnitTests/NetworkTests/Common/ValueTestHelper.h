@@ -0,0 +1,66 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// Helpers for the tests that set up and compare the values of network nodes.
+//
+#pragma once
+
+#include "ComputationNetwork.h"
+#include <boost/test/unit_test.hpp>
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+// Fills the value of a float node with the pattern scale * ((i * 7) % 11) + offset, i.e. 11 distinct values
+// whose period is prime to the dimensions of the test networks.
+inline void SetValues(const ComputationNodeBasePtr& node, float scale, float offset = 0)
+{
+    auto& value = node->As<ComputationNode<float>>()->Value();
+    for (size_t i = 0; i < value.GetNumElements(); i++)
+        value.Data()[i] = scale * (float)((i * 7) % 11) + offset;
+}
+
+// Checks that the elements of two matrices differ by at most 'tolerance'. Equal elements match too, including infinities.
+inline void CheckCloseValues(const Matrix<float>& value, const Matrix<float>& expected, float tolerance)
+{
+    BOOST_REQUIRE_EQUAL(value.GetNumRows(), expected.GetNumRows());
+    BOOST_REQUIRE_EQUAL(value.GetNumCols(), expected.GetNumCols());
+    for (size_t i = 0; i < value.GetNumElements(); i++)
+    {
+        if (value.Data()[i] != expected.Data()[i])
+            BOOST_CHECK_SMALL(value.Data()[i] - expected.Data()[i], tolerance);
+    }
+}
+
+inline const Matrix<float>& NodeValue(const ComputationNetworkPtr& net, const std::wstring& name)
+{
+    return net->GetNodeFromName(name)->As<ComputationNode<float>>()->Value();
+}
+
+inline const Matrix<float>& NodeGradient(const ComputationNetworkPtr& net, const std::wstring& name)
+{
+    return net->GetNodeFromName(name)->As<ComputationNode<float>>()->Gradient();
+}
+
+// Sets up the minibatch layout of a compiled network for 'numSamples' sequences of a single frame.
+inline void InitSingleFrameSamples(const ComputationNetworkPtr& net, size_t numSamples)
+{
+    auto pMBLayout = net->GetMBLayoutPtrOfNetwork();
+    pMBLayout->Init(numSamples, 1);
+    for (size_t s = 0; s < numSamples; s++)
+        pMBLayout->AddSequence(s, s, 0, 1);
+}
+
+// Computes the values of 'nodes' in inference mode, after the inputs have been set.
+inline void EvaluateInference(const ComputationNetworkPtr& net, const std::vector<ComputationNodeBasePtr>& nodes)
+{
+    net->AllocateAllMatrices(nodes, {}, nullptr);
+    ScopedNetworkOperationMode modeGuard(net, NetworkOperationMode::inferring);
+    for (const auto& node : nodes)
+    {
+        net->StartEvaluateMinibatchLoop(node);
+        net->ForwardProp(node);
+    }
+}
+
+}}}}
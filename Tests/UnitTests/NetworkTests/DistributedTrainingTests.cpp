@@ -0,0 +1,444 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// These tests run in a single process as well as under mpiexec with any number of workers.
+//
+#include "stdafx.h"
+#include "Matrix.h"
+#include "MPIWrapper.h"
+#include <boost/filesystem.hpp>
+
+using namespace std;
+using namespace Microsoft::MSR::CNTK;
+
+#include "QuantizedDistGradAggregator.h"
+#include "SimpleDistGradAggregator.h"
+#include "InputAndParamNodes.h"
+#include "SGD.h" // for MASGD.h
+#include "Common/ValueTestHelper.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+namespace
+{
+MPIWrapperPtr GetMPIWrapper()
+{
+    static MPIWrapperPtr mpi = MPIWrapper::GetInstance(/*create=*/true);
+    return mpi;
+}
+
+// the gradient value i of the given worker in the given minibatch, between -1 and 1
+float GradientValue(size_t worker, size_t minibatch, size_t i)
+{
+    return sinf(0.37f * (float)i + 1.3f * (float)worker + 0.71f * (float)minibatch) * (float)((i * 7 + worker) % 5 + 1) / 5;
+}
+
+void SetGradient(Matrix<float>& gradient, size_t worker, size_t minibatch)
+{
+    for (size_t i = 0; i < gradient.GetNumElements(); i++)
+        gradient.Data()[i] = GradientValue(worker, minibatch, i);
+}
+
+// the sum of the gradients of all workers
+void AddGradientSum(Matrix<float>& sum, size_t numWorkers, size_t minibatch)
+{
+    for (size_t i = 0; i < sum.GetNumElements(); i++)
+        for (size_t worker = 0; worker < numWorkers; worker++)
+            sum.Data()[i] += GradientValue(worker, minibatch, i);
+}
+
+float MeanAbsDifference(const Matrix<float>& a, const Matrix<float>& b)
+{
+    float sum = 0;
+    for (size_t i = 0; i < a.GetNumElements(); i++)
+        sum += fabs(a.Data()[i] - b.Data()[i]);
+    return sum / a.GetNumElements();
+}
+
+// Moves the model of this worker by its local update of the given block and syncs with blockMomentumSGD.
+void RunBlock(BlockMomentumSGD<float>& blockMomentumSGD, const std::list<ComputationNodeBasePtr>& nodes, std::list<Matrix<float>>& smoothedGradients,
+              size_t rank, size_t block)
+{
+    auto& value = nodes.front()->As<ComputationNode<float>>()->Value();
+    Matrix<float> localUpdate(value.GetNumRows(), value.GetNumCols(), CPUDEVICE);
+    SetGradient(localUpdate, rank, block);
+    value -= localUpdate;
+
+    size_t totalSamples;
+    float secondsOnCommunication;
+    blockMomentumSGD.ModelAggregationProcessing(/*samplesSinceLastSync=*/rank + 1, nodes, smoothedGradients, totalSamples, secondsOnCommunication);
+}
+
+// Runs the given number of blocks through the sync points of modelAveragingSGD, the last one ending the epoch.
+// Returns the model of this worker after each block.
+std::vector<Matrix<float>> RunModelAveragingEpoch(BasicModelAveragingSGD<float>& modelAveragingSGD, const std::list<ComputationNodeBasePtr>& nodes,
+                                                  size_t rank, size_t numBlocks)
+{
+    auto& value = nodes.front()->As<ComputationNode<float>>()->Value();
+    std::list<Matrix<float>> smoothedGradients;
+    smoothedGradients.emplace_back(value.GetNumRows(), value.GetNumCols(), CPUDEVICE);
+    std::vector<Matrix<float>> models;
+    modelAveragingSGD.OnEpochStart(nodes);
+    for (size_t block = 0; block < numBlocks; block++)
+    {
+        Matrix<float> localUpdate(value.GetNumRows(), value.GetNumCols(), CPUDEVICE);
+        SetGradient(localUpdate, rank, block);
+        value -= localUpdate;
+        if (block + 1 < numBlocks)
+            BOOST_CHECK(modelAveragingSGD.OnArrivingAtSyncPoint(nodes, smoothedGradients, /*samplesSinceLastSync=*/rank + 1));
+        else
+            modelAveragingSGD.OnEpochEnd(nodes, smoothedGradients, rank + 1);
+        models.push_back(value.DeepClone());
+    }
+    return models;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(QuantizedGradientAggregationSuite)
+
+BOOST_AUTO_TEST_CASE(QuantizedAggregationWithErrorFeedback)
+{
+    auto mpi = GetMPIWrapper();
+    const size_t numWorkers = mpi->NumNodesInUse();
+    const size_t rank = mpi->CurrentNodeRank();
+    const size_t numMinibatches = 50;
+
+    for (int numBits : { 1, 2, 8 })
+    {
+        // a weight gradient that is quantized, and a bias gradient that is too small to be
+        Matrix<float> weightGradient(300, 40, CPUDEVICE), biasGradient(300, 1, CPUDEVICE);
+        std::vector<Matrix<float>*> gradients = { &weightGradient, &biasGradient };
+        QuantizedDistGradAggregator<float> aggregator(mpi, numBits, /*zeroThresholdFor1Bit=*/true, /*syncStatsTrace=*/0, /*minQuantizedSizeInBytes=*/32 * 1024);
+
+        std::shared_ptr<DistGradHeader> header(DistGradHeader::Create(1), [](DistGradHeader* p) { DistGradHeader::Destroy(p); });
+        Matrix<float> aggregatedSum(300, 40, CPUDEVICE), expectedSum(300, 40, CPUDEVICE);
+        aggregatedSum.SetValue(0);
+        expectedSum.SetValue(0);
+        float firstError = 0;
+        for (size_t minibatch = 0; minibatch < numMinibatches; minibatch++)
+        {
+            SetGradient(weightGradient, rank, minibatch);
+            SetGradient(biasGradient, rank, minibatch);
+            header->numSamples = rank + 1;
+            header->numSamplesWithLabel = rank + 1;
+            header->criterion = 0.5 * (rank + 1);
+            header->evalErrors[0] = std::make_pair(1.0, rank + 1);
+            BOOST_CHECK(aggregator.AggregateGradients(gradients, header.get(), /*resetState=*/minibatch == 0));
+
+            // the header is summed exactly
+            const size_t totalSamples = numWorkers * (numWorkers + 1) / 2;
+            BOOST_CHECK_EQUAL(header->numSamples, totalSamples);
+            BOOST_CHECK_EQUAL(header->numSamplesWithLabel, totalSamples);
+            BOOST_CHECK_CLOSE(header->criterion, 0.5 * totalSamples, 1e-10);
+            BOOST_CHECK_CLOSE(header->evalErrors[0].first, (double)numWorkers, 1e-10);
+            BOOST_CHECK_EQUAL(header->evalErrors[0].second, totalSamples);
+
+            // and so is the small bias gradient
+            Matrix<float> expectedBias(300, 1, CPUDEVICE);
+            expectedBias.SetValue(0);
+            AddGradientSum(expectedBias, numWorkers, minibatch);
+            BOOST_CHECK_SMALL(MeanAbsDifference(biasGradient, expectedBias), 1e-5f);
+
+            aggregatedSum += weightGradient;
+            AddGradientSum(expectedSum, numWorkers, minibatch);
+            if (minibatch == 0)
+                firstError = MeanAbsDifference(aggregatedSum, expectedSum);
+        }
+
+        // The error of a single minibatch stays in the residuals, so that the error of the sum over
+        // all minibatches is about the same, instead of growing with their number.
+        float sumError = MeanAbsDifference(aggregatedSum, expectedSum);
+        BOOST_CHECK_LT(sumError, 3 * firstError);
+        if (numBits == 8)
+            BOOST_CHECK_LT(firstError, 0.02f * numWorkers);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(DistGradHeaderSuite)
+
+BOOST_AUTO_TEST_CASE(HeadersAreSummedByAllReduce)
+{
+    auto mpi = GetMPIWrapper();
+    const size_t numWorkers = mpi->NumNodesInUse();
+    const size_t rank = mpi->CurrentNodeRank();
+
+    std::shared_ptr<DistGradHeader> header(DistGradHeader::Create(2), [](DistGradHeader* p) { DistGradHeader::Destroy(p); });
+    std::vector<double> packed(DistGradHeader::PackedSize(2));
+    BOOST_CHECK_EQUAL(packed.size(), 7);
+
+    // the last worker did not process any samples in this minibatch
+    Matrix<float> gradient(30, 20, CPUDEVICE);
+    std::vector<Matrix<float>*> gradients = { &gradient };
+    SimpleDistGradAggregator<float> aggregator(mpi, /*useAsyncAggregation=*/false, /*syncStatsTrace=*/0);
+    const bool hasSamples = (numWorkers == 1) || (rank + 1 < numWorkers);
+    header->Clear();
+    if (hasSamples)
+    {
+        header->numSamples = 100 * (rank + 1);
+        header->numSamplesWithLabel = 90 * (rank + 1);
+        header->criterion = 0.25 * (rank + 1);
+        header->evalErrors[0] = std::make_pair(1.5, 10 * (rank + 1));
+        header->evalErrors[1] = std::make_pair(0.125 * rank, rank);
+    }
+    SetGradient(gradient, rank, 0);
+
+    // Pack() and Unpack() round-trip
+    header->Pack(packed.data());
+    std::shared_ptr<DistGradHeader> unpacked(DistGradHeader::Create(2), [](DistGradHeader* p) { DistGradHeader::Destroy(p); });
+    unpacked->Unpack(packed.data());
+    BOOST_CHECK_EQUAL(unpacked->numSamples, header->numSamples);
+    BOOST_CHECK_EQUAL(unpacked->evalErrors[1].second, header->evalErrors[1].second);
+
+    BOOST_CHECK(aggregator.AggregateGradients(gradients, header.get(), /*resetState=*/true));
+
+    const size_t numContributing = (numWorkers == 1) ? 1 : numWorkers - 1;
+    const size_t sum = numContributing * (numContributing + 1) / 2; // of rank + 1 over the contributing workers
+    BOOST_CHECK_EQUAL(header->numSamples, 100 * sum);
+    BOOST_CHECK_EQUAL(header->numSamplesWithLabel, 90 * sum);
+    BOOST_CHECK_CLOSE(header->criterion, 0.25 * sum, 1e-10);
+    BOOST_CHECK_CLOSE(header->evalErrors[0].first, 1.5 * numContributing, 1e-10);
+    BOOST_CHECK_EQUAL(header->evalErrors[0].second, 10 * sum);
+    BOOST_CHECK_CLOSE(header->evalErrors[1].first + 1, 0.125 * (sum - numContributing) + 1, 1e-10);
+    BOOST_CHECK_EQUAL(header->evalErrors[1].second, sum - numContributing);
+
+    Matrix<float> expected(30, 20, CPUDEVICE);
+    expected.SetValue(0);
+    AddGradientSum(expected, numContributing, 0);
+    CheckCloseValues(gradient, expected, 1e-5f);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(HierarchicalAllReduceSuite)
+
+// Groups of consecutive ranks simulate hosts, ranksPerHost = 0 groups the ranks by their actual hosts.
+BOOST_AUTO_TEST_CASE(HierarchicalGradientAggregation)
+{
+    auto mpi = GetMPIWrapper();
+    const size_t numWorkers = mpi->NumNodesInUse();
+    const size_t rank = mpi->CurrentNodeRank();
+
+    // the split applies to the MPIWrapper of the whole process, so the later tests get it back unsplit
+    struct HostSplitGuard
+    {
+        MPIWrapperPtr m_mpi;
+        ~HostSplitGuard() { m_mpi->UndoSplitByHost(); }
+    } guard = { mpi };
+
+    for (size_t ranksPerHost : { 0, 1, 2, 3 })
+    {
+        mpi->SplitByHost(ranksPerHost);
+        BOOST_CHECK(mpi->IsSplitByHost());
+        if (ranksPerHost > 0)
+        {
+            BOOST_CHECK_EQUAL(mpi->NumHosts(), (numWorkers + ranksPerHost - 1) / ranksPerHost);
+            BOOST_CHECK_EQUAL(mpi->IsHostLeader(), rank % ranksPerHost == 0);
+        }
+
+        // a gradient reduced in place and two that are packed into one bucket
+        Matrix<float> weightGradient(300, 40, CPUDEVICE), biasGradient(300, 1, CPUDEVICE), scaleGradient(1, 1, CPUDEVICE);
+        std::vector<Matrix<float>*> gradients = { &weightGradient, &biasGradient, &scaleGradient };
+        SimpleDistGradAggregator<float> aggregator(mpi, /*useAsyncAggregation=*/false, /*syncStatsTrace=*/0, /*bucketSizeInBytes=*/32 * 1024, /*useHierarchicalAllReduce=*/true);
+
+        std::shared_ptr<DistGradHeader> header(DistGradHeader::Create(1), [](DistGradHeader* p) { DistGradHeader::Destroy(p); });
+        for (size_t minibatch = 0; minibatch < 3; minibatch++)
+        {
+            for (auto gradient : gradients)
+                SetGradient(*gradient, rank, ranksPerHost * 3 + minibatch);
+            header->numSamples = rank + 1;
+            header->numSamplesWithLabel = rank + 1;
+            header->criterion = 0.5 * (rank + 1);
+            header->evalErrors[0] = std::make_pair(1.0, rank + 1);
+            BOOST_CHECK(aggregator.AggregateGradients(gradients, header.get(), /*resetState=*/minibatch == 0));
+
+            BOOST_CHECK_EQUAL(header->numSamples, numWorkers * (numWorkers + 1) / 2);
+            for (auto gradient : gradients)
+            {
+                Matrix<float> expected(gradient->GetNumRows(), gradient->GetNumCols(), CPUDEVICE);
+                expected.SetValue(0);
+                AddGradientSum(expected, numWorkers, ranksPerHost * 3 + minibatch);
+                CheckCloseValues(*gradient, expected, 1e-5f);
+            }
+        }
+    }
+    mpi->UndoSplitByHost();
+    BOOST_CHECK(!mpi->IsSplitByHost());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(ModelAveragingSGDSuite)
+
+BOOST_AUTO_TEST_CASE(PipelinedModelAveragingIsStaleByOneBlock)
+{
+    auto mpi = GetMPIWrapper();
+    const size_t rank = mpi->CurrentNodeRank();
+    const size_t numBlocks = 4;
+
+    // two parameters, packed into separate buffers
+    auto w = make_shared<LearnableParameter<float>>(CPUDEVICE, L"W", 20, 30);
+    auto b = make_shared<LearnableParameter<float>>(CPUDEVICE, L"b", 20, 1);
+    std::list<ComputationNodeBasePtr> nodes = { w, b };
+    Matrix<float> initialBias(20, 1, CPUDEVICE);
+    SetGradient(initialBias, 0, 100);
+
+    SetGradient(w->Value(), 0, 100);
+    b->Value().SetValue(initialBias);
+    BasicModelAveragingSGD<float> synchronous(mpi, 0, CPUDEVICE);
+    auto expected = RunModelAveragingEpoch(synchronous, nodes, rank, numBlocks);
+
+    SetGradient(w->Value(), 0, 100);
+    b->Value().SetValue(initialBias);
+    BasicModelAveragingSGD<float> pipelined(mpi, 0, CPUDEVICE, /*useAsyncModelAveraging=*/true, /*bucketSizeInBytes=*/20 * 30 * sizeof(float));
+    auto models = RunModelAveragingEpoch(pipelined, nodes, rank, numBlocks);
+
+    // In the middle of the epoch a worker is at the synchronous model of the previous block plus its own update.
+    for (size_t block = 1; block + 1 < numBlocks; block++)
+    {
+        Matrix<float> localUpdate(20, 30, CPUDEVICE);
+        SetGradient(localUpdate, rank, block);
+        Matrix<float> stale(expected[block - 1].DeepClone());
+        stale -= localUpdate;
+        CheckCloseValues(models[block], stale, 1e-5f);
+    }
+
+    // and at its end the models of the workers agree with synchronous averaging
+    CheckCloseValues(models.back(), expected.back(), 1e-5f);
+    CheckCloseValues(b->Value(), initialBias, 1e-6f);
+    auto expectedSum = expected.back().DeepClone();
+    auto sum = models.back().DeepClone();
+    mpi->AllReduce(sum.Data(), sum.GetNumElements());
+    Matrix<float>::Scale((float)mpi->NumNodesInUse(), expectedSum);
+    CheckCloseValues(sum, expectedSum, 1e-4f);
+}
+
+BOOST_AUTO_TEST_CASE(PipelinedModelAveragingCountsSamplesExactly)
+{
+    auto mpi = GetMPIWrapper();
+    const size_t rank = mpi->CurrentNodeRank();
+    const size_t numWorkers = mpi->NumNodesInUse();
+
+    auto w = make_shared<LearnableParameter<float>>(CPUDEVICE, L"W", 4, 3);
+    SetGradient(w->Value(), 0, 100);
+    std::list<ComputationNodeBasePtr> nodes = { w };
+    std::list<Matrix<float>> smoothedGradients;
+    smoothedGradients.emplace_back(4, 3, CPUDEVICE);
+    BasicModelAveragingSGD<float> pipelined(mpi, 0, CPUDEVICE, /*useAsyncModelAveraging=*/true);
+    pipelined.OnEpochStart(nodes);
+
+    // odd counts above 2^24, which a float cannot represent
+    auto samplesOf = [](size_t worker, size_t block) { return ((size_t)1 << 24) + 2 * worker + 4 * block + 1; };
+    size_t totalSamples;
+    float secondsOnCommunication;
+    pipelined.ModelAggregationProcessing(samplesOf(rank, 0), nodes, smoothedGradients, totalSamples, secondsOnCommunication);
+    BOOST_CHECK_EQUAL(totalSamples, samplesOf(rank, 0) * numWorkers); // estimated, nothing was averaged yet
+
+    // the samples of a block are reported when its averaging completes at the next sync point
+    pipelined.ModelAggregationProcessing(samplesOf(rank, 1), nodes, smoothedGradients, totalSamples, secondsOnCommunication);
+    size_t expectedSamples = 0;
+    for (size_t worker = 0; worker < numWorkers; worker++)
+        expectedSamples += samplesOf(worker, 0);
+    BOOST_CHECK_EQUAL(totalSamples, expectedSamples);
+
+    pipelined.OnEpochEnd(nodes, smoothedGradients, samplesOf(rank, 2));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(BlockMomentumSGDSuite)
+
+BOOST_AUTO_TEST_CASE(BlockMomentumFiltersAveragedModelUpdates)
+{
+    auto mpi = GetMPIWrapper();
+    const size_t numWorkers = mpi->NumNodesInUse();
+    const size_t rank = mpi->CurrentNodeRank();
+    const size_t totalSamples = numWorkers * (numWorkers + 1) / 2;
+    const size_t syncPeriod = 1000;
+    const float blockMomentum = 0.5f, blockLearningRate = 0.8f;
+    const double timeConstant = BlockMomentumSGD<float>::Momentum2TimeConstant(blockMomentum, syncPeriod);
+    BOOST_CHECK_CLOSE(BlockMomentumSGD<float>::TimeConstant2Momentum(timeConstant, syncPeriod), blockMomentum, 1e-8);
+
+    for (bool useNesterovMomentum : { false, true })
+    {
+        auto w = make_shared<LearnableParameter<float>>(CPUDEVICE, L"W", 20, 30);
+        SetGradient(w->Value(), /*worker=*/0, /*minibatch=*/100); // the same on all workers
+        std::list<ComputationNodeBasePtr> nodes = { w };
+        std::list<Matrix<float>> smoothedGradients;
+        smoothedGradients.emplace_back(20, 30, CPUDEVICE);
+
+        BlockMomentumSGD<float> blockMomentumSGD(mpi, 0, CPUDEVICE, useNesterovMomentum, /*resetSGDMomentumAfterAggregation=*/true,
+                                                 blockLearningRate, timeConstant, syncPeriod);
+        blockMomentumSGD.OnEpochStart(nodes);
+
+        Matrix<float> expected(w->Value().DeepClone()), blockDelta(20, 30, CPUDEVICE);
+        blockDelta.SetValue(0);
+        for (size_t block = 0; block < 3; block++)
+        {
+            smoothedGradients.front().SetValue(1);
+            RunBlock(blockMomentumSGD, nodes, smoothedGradients, rank, block);
+
+            // G(t) is the update of all workers, weighted by their samples
+            for (size_t i = 0; i < expected.GetNumElements(); i++)
+            {
+                float blockGradient = 0;
+                for (size_t worker = 0; worker < numWorkers; worker++)
+                    blockGradient += GradientValue(worker, block, i) * (worker + 1) / totalSamples;
+                blockDelta.Data()[i] = blockMomentum * blockDelta.Data()[i] + blockLearningRate * blockGradient;
+                if (useNesterovMomentum)
+                    expected.Data()[i] -= blockLearningRate * blockGradient + blockMomentum * blockDelta.Data()[i];
+                else
+                    expected.Data()[i] -= blockDelta.Data()[i];
+            }
+            CheckCloseValues(w->Value(), expected, 1e-5f);
+            BOOST_CHECK_EQUAL(smoothedGradients.front().FrobeniusNorm(), 0);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(BlockMomentumSurvivesCheckpoints)
+{
+    auto mpi = GetMPIWrapper();
+    const size_t rank = mpi->CurrentNodeRank();
+    const size_t syncPeriod = 1000;
+    const double timeConstant = BlockMomentumSGD<float>::Momentum2TimeConstant(0.7, syncPeriod);
+
+    auto w = make_shared<LearnableParameter<float>>(CPUDEVICE, L"W", 20, 30);
+    SetGradient(w->Value(), 0, 100);
+    std::list<ComputationNodeBasePtr> nodes = { w };
+    std::list<Matrix<float>> smoothedGradients;
+    smoothedGradients.emplace_back(20, 30, CPUDEVICE);
+
+    BlockMomentumSGD<float> blockMomentumSGD(mpi, 0, CPUDEVICE, true, true, 1.0, timeConstant, syncPeriod);
+    blockMomentumSGD.OnEpochStart(nodes);
+    RunBlock(blockMomentumSGD, nodes, smoothedGradients, rank, 0);
+
+    const wstring checkpointPath = boost::filesystem::unique_path(boost::filesystem::temp_directory_path() / "BlockMomentumSGDTests-%%%%-%%%%.ckp").wstring();
+    {
+        File file(checkpointPath, fileOptionsBinary | fileOptionsWrite);
+        blockMomentumSGD.SaveToCheckPoint(file);
+    }
+    BlockMomentumSGD<float> restored(mpi, 0, CPUDEVICE, true, true, 1.0, timeConstant, syncPeriod);
+    {
+        File file(checkpointPath, fileOptionsBinary | fileOptionsRead);
+        restored.LoadFromCheckPoint(file);
+    }
+
+    // the next epoch continues with the same block momentum
+    Matrix<float> startValue(w->Value().DeepClone());
+    blockMomentumSGD.OnEpochStart(nodes);
+    RunBlock(blockMomentumSGD, nodes, smoothedGradients, rank, 1);
+    Matrix<float> expected(w->Value().DeepClone());
+
+    w->Value().SetValue(startValue);
+    restored.OnEpochStart(nodes);
+    RunBlock(restored, nodes, smoothedGradients, rank, 1);
+    CheckCloseValues(w->Value(), expected, 0);
+    _wunlink(checkpointPath.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
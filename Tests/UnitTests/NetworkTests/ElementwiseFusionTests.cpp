@@ -0,0 +1,146 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "ComputationNetwork.h"
+#include "ComputationNetworkBuilder.h"
+#include "Common/ValueTestHelper.h"
+
+using namespace Microsoft::MSR::CNTK;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+namespace
+{
+// sets up two sequences of the given lengths, the second one followed by a gap, and the input values
+void InitSequences(const ComputationNetworkPtr& net, const ComputationNodeBasePtr& features, size_t length0, size_t length1, float scale, float offset)
+{
+    auto pMBLayout = net->GetMBLayoutPtrOfNetwork();
+    pMBLayout->Init(2, length0);
+    pMBLayout->AddSequence(0, 0, 0, length0);
+    pMBLayout->AddSequence(1, 1, 0, length1);
+    pMBLayout->AddGap(1, length1, length0);
+    features->As<ComputationNode<float>>()->Value().Resize(features->GetSampleLayout().GetNumElements(), 2 * length0);
+    SetValues(features, scale, offset);
+}
+
+// computes the value of 'criterion' and the gradients of the parameters
+void Train(const ComputationNetworkPtr& net, const ComputationNodeBasePtr& criterion)
+{
+    net->AllocateAllMatrices({}, {}, criterion);
+    ScopedNetworkOperationMode modeGuard(net, NetworkOperationMode::training);
+    net->StartEvaluateMinibatchLoop(criterion);
+    net->ForwardProp(criterion);
+    net->Backprop(criterion);
+}
+
+// builds criterion = Sum(ElementTimes(Sigmoid(Plus(Times(W, x), b)), Minus(c, Tanh(Times(W, x))))) on two sequences of
+// the given lengths, evaluates it and computes the gradients of the parameters
+// b and c are broadcast to all columns by the fused node, which sums their gradients in blocks of columns.
+ComputationNetworkPtr EvaluateLSTMLikeCell(bool fuseElementwiseOperations, size_t length0, size_t length1)
+{
+    auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+    ComputationNetworkBuilder<float> builder(*net);
+    auto features = builder.CreateInputNode(L"x", 3);
+    auto weights = builder.CreateLearnableParameter(L"W", 4, 3);
+    auto bias = builder.CreateLearnableParameter(L"b", 4, 1);
+    auto c = builder.CreateLearnableParameter(L"c", 4, 1);
+    SetValues(weights, 0.25f, -0.5f);
+    SetValues(bias, 0.1f, -0.5f);
+    SetValues(c, 0.3f, -0.5f);
+
+    auto h = builder.Times(weights, features, 1, L"h");
+    auto gate = builder.Sigmoid(builder.Plus(h, bias, L"p"), L"s");
+    auto hr = builder.Times(weights, features, 1, L"hr");
+    auto z = builder.ElementTimes(gate, builder.Minus(c, builder.Tanh(hr, L"t"), L"m"), L"z");
+    ComputationNodeBasePtr criterion = builder.Sum(z, L"ce");
+    net->AddToNodeGroup(L"criterion", criterion);
+    net->SetElementwiseFusion(fuseElementwiseOperations);
+    net->CompileNetwork();
+
+    InitSequences(net, features, length0, length1, 0.2f, -0.5f);
+    Train(net, criterion);
+    return net;
+}
+
+// builds criterion = Sum(Minus(ElementTimes(Sigmoid(a), a), Tanh(Negate(a)))) with a = Plus(Times(W, x), b), where a is used
+// three times, on a minibatch that is large enough for the parallel loops
+// Large inputs drive the sigmoid and tanh into saturation, where their derivatives vanish.
+ComputationNetworkPtr EvaluateSharedIntermediate(bool fuseElementwiseOperations)
+{
+    auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+    ComputationNetworkBuilder<float> builder(*net);
+    auto features = builder.CreateInputNode(L"x", 16);
+    auto weights = builder.CreateLearnableParameter(L"W", 64, 16);
+    auto bias = builder.CreateLearnableParameter(L"b", 64, 1);
+    SetValues(weights, 0.5f, -2.5f);
+    SetValues(bias, 1.0f, -5.0f);
+
+    auto a = builder.Plus(builder.Times(weights, features, 1, L"h"), bias, L"a");
+    auto e = builder.ElementTimes(builder.Sigmoid(a, L"s"), a, L"e");
+    auto z = builder.Minus(e, builder.Tanh(builder.Negate(a, L"n"), L"t"), L"z");
+    ComputationNodeBasePtr criterion = builder.Sum(z, L"ce");
+    net->AddToNodeGroup(L"criterion", criterion);
+    net->SetElementwiseFusion(fuseElementwiseOperations);
+    net->CompileNetwork();
+
+    InitSequences(net, features, 200, 137, 0.4f, -2.0f);
+    Train(net, criterion);
+    return net;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(ElementwiseFusionSuite)
+
+BOOST_AUTO_TEST_CASE(FusedChainMatchesSeparateNodes)
+{
+    auto net = EvaluateLSTMLikeCell(false, 5, 3);
+    auto fusedNet = EvaluateLSTMLikeCell(true, 5, 3);
+
+    // Plus, Sigmoid, Tanh, Minus and ElementTimes are computed by a single node named like the last one
+    BOOST_CHECK(fusedNet->GetNodeFromName(L"z")->OperationName() == L"FusedElementwise");
+    for (const wstring& name : { L"p", L"s", L"t", L"m" })
+        BOOST_CHECK(!fusedNet->NodeNameExists(name));
+    BOOST_CHECK_EQUAL(fusedNet->GetTotalNumberOfNodes(), net->GetTotalNumberOfNodes() - 4);
+
+    CheckCloseValues(NodeValue(fusedNet, L"ce"), NodeValue(net, L"ce"), 1e-5f);
+    for (const wstring& name : { L"W", L"b", L"c" })
+        CheckCloseValues(NodeGradient(fusedNet, name), NodeGradient(net, name), 1e-5f);
+}
+
+BOOST_AUTO_TEST_CASE(BroadcastGradientsOverSeveralColumnBlocks)
+{
+    // 2 x 100 columns make one partial block of 8 columns after three full blocks of 64, and the gap after the
+    // second sequence of 67 frames reaches from the third block into the last
+    auto net = EvaluateLSTMLikeCell(false, 100, 67);
+    auto fusedNet = EvaluateLSTMLikeCell(true, 100, 67);
+    BOOST_CHECK(fusedNet->GetNodeFromName(L"z")->OperationName() == L"FusedElementwise");
+
+    // the gradients of b and c are sums over 167 columns, of magnitude 100, which the blocks add in another order
+    CheckCloseValues(NodeValue(fusedNet, L"ce"), NodeValue(net, L"ce"), 1e-4f);
+    for (const wstring& name : { L"W", L"b", L"c" })
+        CheckCloseValues(NodeGradient(fusedNet, name), NodeGradient(net, name), 1e-4f);
+}
+
+BOOST_AUTO_TEST_CASE(SharedIntermediateIsNotFused)
+{
+    auto net = EvaluateSharedIntermediate(false);
+    auto fusedNet = EvaluateSharedIntermediate(true);
+
+    // a has three consumers, so it is computed once by a node of its own, which the fused chain reads
+    BOOST_CHECK(fusedNet->GetNodeFromName(L"a")->OperationName() == L"Plus");
+    BOOST_CHECK(fusedNet->GetNodeFromName(L"z")->OperationName() == L"FusedElementwise");
+    for (const wstring& name : { L"s", L"e", L"n", L"t" })
+        BOOST_CHECK(!fusedNet->NodeNameExists(name));
+
+    CheckCloseValues(NodeValue(fusedNet, L"a"), NodeValue(net, L"a"), 0);
+    // ce is of magnitude 1e5, where 1e-2 is about one unit in the last place; the gradients are of magnitude 300
+    CheckCloseValues(NodeValue(fusedNet, L"ce"), NodeValue(net, L"ce"), 1e-2f);
+    for (const wstring& name : { L"W", L"b" })
+        CheckCloseValues(NodeGradient(fusedNet, name), NodeGradient(net, name), 1e-3f);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
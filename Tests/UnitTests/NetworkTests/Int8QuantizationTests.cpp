@@ -0,0 +1,120 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "ComputationNetwork.h"
+#include "ComputationNetworkBuilder.h"
+#include "InputAndParamNodes.h"
+#include "Common/ValueTestHelper.h"
+#include <boost/filesystem.hpp>
+
+using namespace Microsoft::MSR::CNTK;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+namespace
+{
+// builds z = Times(V, ReLU(Convolution(W, x))) with 16 channels and 10 outputs
+ComputationNetworkPtr BuildConvolutionClassifier()
+{
+    auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+    ComputationNetworkBuilder<float> builder(*net);
+    auto x = builder.CreateInputNode(L"x", TensorShape(6, 5, 4));
+    auto w = builder.CreateLearnableParameter(L"W", 16, 3 * 3 * 4);
+    auto v = builder.CreateLearnableParameter(L"V", TensorShape(10, 6, 5, 16));
+    SetValues(w, 0.02f, -0.1f);
+    SetValues(v, 0.01f, -0.05f);
+
+    auto c = builder.Convolution(w, x, TensorShape(3, 3, 4), TensorShape(16), TensorShape(1, 1, 4),
+                                 vector<bool>{true}, vector<bool>{true, true, false}, TensorShape(0), TensorShape(0),
+                                 false, ImageLayoutKind::CHW, 0, L"c");
+    auto z = builder.Times(v, builder.RectifiedLinear(c, L"r"), 1, L"z");
+    net->AddToNodeGroup(L"output", z);
+    net->CompileNetwork();
+    return net;
+}
+
+// sets x to two samples in [-1, 1], clipped to [-inputClip, inputClip], and evaluates z
+const Matrix<float>& Evaluate(const ComputationNetworkPtr& net, float inputClip = 1)
+{
+    InitSingleFrameSamples(net, 2);
+    auto x = net->GetNodeFromName(L"x");
+    auto& input = x->As<ComputationNode<float>>()->Value();
+    input.Resize(6 * 5 * 4, 2);
+    SetValues(x, 0.2f, -1.0f);
+    for (size_t i = 0; i < input.GetNumElements(); i++)
+        input.Data()[i] = max(-inputClip, min(inputClip, input.Data()[i]));
+
+    auto z = net->GetNodeFromName(L"z");
+    EvaluateInference(net, { z });
+    return z->As<ComputationNode<float>>()->Value();
+}
+
+// quantizes the classifier with the calibrated range 'inputRange' of x and 1.2 of ReLU(c)
+void Quantize(const ComputationNetworkPtr& net, double inputRange)
+{
+    auto quantizableNodes = net->GetInt8QuantizableNodes(net->OutputNodes());
+    BOOST_REQUIRE_EQUAL(quantizableNodes.size(), 2);
+
+    std::map<ComputationNodeBasePtr, double> inputRanges;
+    inputRanges[net->GetNodeFromName(L"c")] = inputRange;
+    inputRanges[net->GetNodeFromName(L"z")] = 1.2;
+    BOOST_CHECK_EQUAL(net->QuantizeInt8(inputRanges), 2);
+    for (const wstring& name : { L"W", L"V" })
+        BOOST_CHECK(net->GetNodeFromName(name)->As<LearnableParameter<float>>()->HasInt8Storage());
+}
+}
+
+BOOST_AUTO_TEST_SUITE(Int8QuantizationSuite)
+
+BOOST_AUTO_TEST_CASE(QuantizedNetworkMatchesFullPrecision)
+{
+    auto net = BuildConvolutionClassifier();
+    const auto& expected = Evaluate(net);
+
+    // calibrated ranges: x lies in [-1, 1], ReLU(c) below 1.2
+    auto quantizedNet = BuildConvolutionClassifier();
+    Quantize(quantizedNet, 1.0);
+    CheckCloseValues(Evaluate(quantizedNet), expected, 0.02f);
+
+    // the int8 weights and the input ranges survive a save and load
+    const wstring modelPath = boost::filesystem::unique_path(boost::filesystem::temp_directory_path() / "Int8QuantizationTests-%%%%-%%%%.dnn").wstring();
+    quantizedNet->Save(modelPath);
+    {
+        auto loadedNet = make_shared<ComputationNetwork>(CPUDEVICE);
+        loadedNet->Load<float>(modelPath);
+        for (const wstring& name : { L"W", L"V" })
+        {
+            auto weights = loadedNet->GetNodeFromName(name)->As<LearnableParameter<float>>();
+            BOOST_CHECK(weights->HasInt8Storage());
+            CheckCloseValues(weights->Value(), NodeValue(quantizedNet, name), 1e-6f);
+        }
+        CheckCloseValues(Evaluate(loadedNet), NodeValue(quantizedNet, L"z"), 1e-5f);
+    }
+    _wunlink(modelPath.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(InputsBeyondTheCalibratedRangeSaturate)
+{
+    // x exceeds its calibrated range of 0.5, so the quantized inputs saturate at +-0.5 instead of wrapping around,
+    // and the result is that of full precision on x clipped to the range
+    auto clippedNet = BuildConvolutionClassifier();
+    const auto& expected = Evaluate(clippedNet, 0.5f);
+    auto quantizedNet = BuildConvolutionClassifier();
+    Quantize(quantizedNet, 0.5);
+    const auto& z = Evaluate(quantizedNet);
+    CheckCloseValues(z, expected, 0.02f);
+
+    // the clipping matters: the result differs from that of the unclipped inputs
+    auto unclippedNet = BuildConvolutionClassifier();
+    const auto& unclipped = Evaluate(unclippedNet);
+    float maxDifference = 0;
+    for (size_t i = 0; i < z.GetNumElements(); i++)
+        maxDifference = max(maxDifference, fabs(z.Data()[i] - unclipped.Data()[i]));
+    BOOST_CHECK_GT(maxDifference, 0.1f);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
@@ -0,0 +1,58 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "MatrixPool.h"
+
+using namespace Microsoft::MSR::CNTK;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+BOOST_AUTO_TEST_SUITE(MatrixPoolSuite)
+
+BOOST_AUTO_TEST_CASE(MatrixPoolBestFit)
+{
+    MatrixPool pool;
+    auto large = pool.Request<float>(CPUDEVICE, 1000);
+    auto small = pool.Request<float>(CPUDEVICE, 10);
+    pool.Release<float>(large);
+    pool.Release<float>(small);
+
+    // a small request must not take the large matrix, even though it was not released last
+    BOOST_CHECK(pool.Request<float>(CPUDEVICE, 8) == small);
+    BOOST_CHECK(pool.Request<float>(CPUDEVICE, 900) == large);
+
+    BOOST_CHECK_EQUAL(pool.GetNumberOfRequests(), 4);
+    BOOST_CHECK_EQUAL(pool.GetNumberOfMatrices(), 2);
+    BOOST_CHECK_EQUAL(pool.GetPlannedSizeInBytes(), 1010 * sizeof(float));
+    BOOST_CHECK_EQUAL(pool.GetRequestedSizeInBytes(), 1918 * sizeof(float));
+}
+
+BOOST_AUTO_TEST_CASE(MatrixPoolGrowsLargestReleased)
+{
+    MatrixPool pool;
+    auto first = pool.Request<double>(CPUDEVICE, 10);
+    auto second = pool.Request<double>(CPUDEVICE, 20);
+    pool.Release<double>(first);
+    pool.Release<double>(second);
+
+    // no released matrix is large enough, the largest one grows the least
+    BOOST_CHECK(pool.Request<double>(CPUDEVICE, 30) == second);
+    BOOST_CHECK_EQUAL(pool.GetPlannedSizeInBytes(), 40 * sizeof(double));
+}
+
+BOOST_AUTO_TEST_CASE(MatrixPoolWithoutSharing)
+{
+    MatrixPool pool;
+    pool.SetMemorySharing(false);
+    auto first = pool.Request<float>(CPUDEVICE, 10);
+    pool.Release<float>(first);
+
+    BOOST_CHECK(pool.Request<float>(CPUDEVICE, 10) != first);
+    BOOST_CHECK_EQUAL(pool.GetPlannedSizeInBytes(), pool.GetRequestedSizeInBytes());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
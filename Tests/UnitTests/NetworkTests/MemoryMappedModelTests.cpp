@@ -0,0 +1,74 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "ComputationNetwork.h"
+#include "ComputationNetworkBuilder.h"
+#include <boost/filesystem.hpp>
+
+using namespace Microsoft::MSR::CNTK;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+namespace
+{
+const Matrix<float>& ParameterValue(const ComputationNetwork& net, const wstring& name)
+{
+    return net.GetNodeFromName(name)->As<ComputationNode<float>>()->Value();
+}
+
+void CheckEqualValues(const Matrix<float>& a, const Matrix<float>& b)
+{
+    BOOST_REQUIRE_EQUAL(a.GetNumRows(), b.GetNumRows());
+    BOOST_REQUIRE_EQUAL(a.GetNumCols(), b.GetNumCols());
+    BOOST_CHECK(std::equal(a.Data(), a.Data() + a.GetNumElements(), b.Data()));
+}
+}
+
+BOOST_AUTO_TEST_SUITE(MemoryMappedModelSuite)
+
+BOOST_AUTO_TEST_CASE(MemoryMappedParametersMatchReadParameters)
+{
+    const wstring modelPath = boost::filesystem::unique_path(boost::filesystem::temp_directory_path() / "MemoryMappedModelTests-%%%%-%%%%.dnn").wstring();
+    {
+        auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+        ComputationNetworkBuilder<float> builder(*net);
+        auto weights = builder.CreateLearnableParameter(L"W", 300, 7); // larger than a page
+        auto bias = builder.CreateLearnableParameter(L"b", 3, 1);
+        auto input = builder.CreateLearnableParameter(L"x", 7, 1);
+        for (size_t i = 0; i < weights->Value().GetNumElements(); i++)
+            weights->Value().Data()[i] = (float)i / 7;
+        bias->Value().SetValue(-1.5f);
+        input->Value().SetValue(0.25f);
+        net->AddToNodeGroup(L"output", builder.Plus(builder.Times(weights, input), weights, L"z"));
+        net->AddToNodeGroup(L"output", builder.Plus(bias, bias, L"y"));
+        net->CompileNetwork();
+        net->Save(modelPath);
+    }
+
+    // the networks release the mapping before the file is deleted
+    {
+        ComputationNetwork readNet(CPUDEVICE);
+        readNet.Read<float>(modelPath);
+
+        ComputationNetwork mappedNet(CPUDEVICE);
+        mappedNet.SetMemoryMappedParameters(true);
+        mappedNet.Read<float>(modelPath);
+
+        for (const wstring& name : { L"W", L"b", L"x" })
+        {
+            CheckEqualValues(ParameterValue(mappedNet, name), ParameterValue(readNet, name));
+            BOOST_CHECK(ParameterValue(readNet, name).OwnBuffer());
+        }
+        // the values of the weights are used in place from the mapped file
+        BOOST_CHECK(!ParameterValue(mappedNet, L"W").OwnBuffer());
+        BOOST_CHECK_EQUAL((uintptr_t)ParameterValue(mappedNet, L"W").Data() % 4096, 0);
+        BOOST_CHECK_EQUAL(ParameterValue(mappedNet, L"b")(1, 0), -1.5f);
+    }
+    _wunlink(modelPath.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
@@ -0,0 +1,192 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "ComputationNetwork.h"
+#include "ComputationNetworkBuilder.h"
+#include "InputAndParamNodes.h"
+#include "Common/ValueTestHelper.h"
+#include <boost/filesystem.hpp>
+
+using namespace Microsoft::MSR::CNTK;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+namespace
+{
+// builds z = Times(W, x) with a weight of several panels of ReducedPrecisionMultiplier
+// The weights are perturbed, so that 16 bits cannot represent them. With 'edgeCases', W[0,0] and W[1,1] exceed the
+// range of float16, and row 2 is in its subnormal range, below 2^-14.
+ComputationNetworkPtr BuildProjection(bool edgeCases)
+{
+    auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+    ComputationNetworkBuilder<float> builder(*net);
+    auto x = builder.CreateInputNode(L"x", TensorShape(400));
+    auto w = builder.CreateLearnableParameter(L"W", 300, 400);
+    SetValues(w, 0.01f, -0.05f);
+    auto& weight = w->Value();
+    for (size_t i = 0; i < weight.GetNumElements(); i++)
+        weight.Data()[i] += 1e-5f * (float)(i % 13);
+    if (edgeCases)
+    {
+        weight(0, 0) = 1e5f;
+        weight(1, 1) = -7e4f;
+        for (size_t j = 0; j < weight.GetNumCols(); j++)
+            weight(2, j) = 1e-6f * (1 + (float)(j % 5)) + 1e-9f * (float)(j % 7);
+    }
+    auto z = builder.Times(w, x, 1, L"z");
+    net->AddToNodeGroup(L"output", z);
+    net->CompileNetwork();
+    return net;
+}
+
+// evaluates z on three samples of x, none of whose first two elements is 0, so that z[0] and z[1] are infinite and not NaN
+// if W[0,0] and W[1,1] are
+const Matrix<float>& Evaluate(const ComputationNetworkPtr& net)
+{
+    InitSingleFrameSamples(net, 3);
+    auto x = net->GetNodeFromName(L"x");
+    x->As<ComputationNode<float>>()->Value().Resize(400, 3);
+    SetValues(x, 0.2f, -1.0f);
+
+    auto z = net->GetNodeFromName(L"z");
+    EvaluateInference(net, { z });
+    return z->As<ComputationNode<float>>()->Value();
+}
+
+// builds z = Times(W, x) on a sparse input x of 400 words, an embedding of dimension 300, and evaluates it on three words
+Matrix<float> EvaluateEmbedding(bool reducedPrecisionStorage)
+{
+    auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+    ComputationNetworkBuilder<float> builder(*net);
+    auto x = builder.CreateSparseInputNode(L"x", 400);
+    auto w = builder.CreateLearnableParameter(L"W", 300, 400);
+    SetValues(w, 0.01f, -0.05f);
+    RoundToReducedPrecision(ReducedPrecisionFormat::float16, w->Value().Data(), w->Value().GetNumElements());
+    if (reducedPrecisionStorage)
+        w->As<LearnableParameter<float>>()->SetReducedPrecisionStorage(ReducedPrecisionFormat::float16);
+    auto z = builder.Times(w, x, 1, L"z");
+    net->AddToNodeGroup(L"output", z);
+    net->CompileNetwork();
+
+    InitSingleFrameSamples(net, 3);
+    const CPUSPARSE_INDEX_TYPE colStarts[] = { 0, 1, 2, 3 }, words[] = { 7, 123, 399 };
+    const float values[] = { 1, 1, 1 };
+    x->Value().SetMatrixFromCSCFormat(colStarts, words, values, 3, 400, 3);
+    EvaluateInference(net, { z });
+
+    // the product reads the 16-bit copy, which stays as it is while inferring, and not the weight itself
+    if (reducedPrecisionStorage)
+    {
+        Matrix<float> expected = z->Value().DeepClone();
+        w->Value().SetValue(0);
+        EvaluateInference(net, { z });
+        CheckCloseValues(z->Value(), expected, 0);
+    }
+    return z->Value().DeepClone();
+}
+
+// rounds the weight of the projection to the values that 'format' can represent, keeping it in full precision
+void RoundWeight(const ComputationNetworkPtr& net, ReducedPrecisionFormat format)
+{
+    auto& weight = net->GetNodeFromName(L"W")->As<ComputationNode<float>>()->Value();
+    RoundToReducedPrecision(format, weight.Data(), weight.GetNumElements());
+}
+
+void SetReducedPrecisionStorage(const ComputationNetworkPtr& net, ReducedPrecisionFormat format)
+{
+    auto weight = net->GetNodeFromName(L"W")->As<LearnableParameter<float>>();
+    weight->SetReducedPrecisionStorage(format);
+    BOOST_CHECK(weight->GetReducedPrecisionStorage() == format);
+}
+
+wstring TempModelPath(const char* name)
+{
+    return boost::filesystem::unique_path(boost::filesystem::temp_directory_path() / (string(name) + "-%%%%-%%%%.dnn")).wstring();
+}
+
+long GetFileSize(const wstring& path)
+{
+    File file(path, fileOptionsBinary | fileOptionsRead);
+    return (long)file.Size();
+}
+}
+
+BOOST_AUTO_TEST_SUITE(ReducedPrecisionStorageSuite)
+
+BOOST_AUTO_TEST_CASE(ReducedPrecisionWeightsMatchRoundedWeights)
+{
+    const wstring fullModelPath = TempModelPath("ReducedPrecisionStorageTests.full");
+    const wstring modelPath = TempModelPath("ReducedPrecisionStorageTests");
+    BuildProjection(false)->Save(fullModelPath);
+
+    for (auto format : { ReducedPrecisionFormat::float16, ReducedPrecisionFormat::bfloat16 })
+    {
+        // reference: the full-precision product with the rounded weight
+        auto roundedNet = BuildProjection(false);
+        RoundWeight(roundedNet, format);
+        const auto& expected = Evaluate(roundedNet);
+
+        auto reducedNet = BuildProjection(false);
+        SetReducedPrecisionStorage(reducedNet, format);
+        CheckCloseValues(NodeValue(reducedNet, L"W"), NodeValue(roundedNet, L"W"), 0);
+        CheckCloseValues(Evaluate(reducedNet), expected, 1e-4f);
+
+        // the model file stores the weight in 16 bits, and loading restores the rounded values exactly
+        reducedNet->Save(modelPath);
+        BOOST_CHECK_LT(GetFileSize(modelPath), GetFileSize(fullModelPath) * 6 / 10);
+        auto loadedNet = make_shared<ComputationNetwork>(CPUDEVICE);
+        loadedNet->Load<float>(modelPath);
+        auto loadedWeight = loadedNet->GetNodeFromName(L"W")->As<LearnableParameter<float>>();
+        BOOST_CHECK(loadedWeight->GetReducedPrecisionStorage() == format);
+        CheckCloseValues(loadedWeight->Value(), NodeValue(roundedNet, L"W"), 0);
+        CheckCloseValues(Evaluate(loadedNet), expected, 1e-4f);
+    }
+    _wunlink(modelPath.c_str());
+    _wunlink(fullModelPath.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(SparseInputUsesReducedPrecisionWeight)
+{
+    CheckCloseValues(EvaluateEmbedding(true), EvaluateEmbedding(false), 1e-6f);
+}
+
+BOOST_AUTO_TEST_CASE(Float16OverflowAndSubnormals)
+{
+    auto roundedNet = BuildProjection(true);
+    RoundWeight(roundedNet, ReducedPrecisionFormat::float16);
+    const auto& expected = Evaluate(roundedNet);
+    auto reducedNet = BuildProjection(true);
+    SetReducedPrecisionStorage(reducedNet, ReducedPrecisionFormat::float16);
+    const auto& z = Evaluate(reducedNet);
+    const auto& weight = NodeValue(reducedNet, L"W");
+
+    // the weights beyond 65504 overflow to infinity, and so do the outputs they contribute to
+    BOOST_CHECK_EQUAL(weight(0, 0), numeric_limits<float>::infinity());
+    BOOST_CHECK_EQUAL(weight(1, 1), -numeric_limits<float>::infinity());
+    for (size_t s = 0; s < z.GetNumCols(); s++)
+    {
+        BOOST_CHECK(isinf(z(0, s)) && isinf(z(1, s)));
+        BOOST_CHECK(isfinite(z(3, s)));
+    }
+    CheckCloseValues(weight, NodeValue(roundedNet, L"W"), 0);
+    CheckCloseValues(z, expected, 1e-4f);
+
+    // the subnormal weights keep their 2^-24 resolution instead of being flushed to zero
+    for (size_t j = 0; j < weight.GetNumCols(); j++)
+    {
+        BOOST_CHECK_GT(weight(2, j), 0);
+        BOOST_CHECK_LT(weight(2, j), 6.1e-5f);
+        BOOST_CHECK_SMALL(weight(2, j) - 1e-6f * (1 + (float)(j % 5)), 4e-8f);
+    }
+    for (size_t s = 0; s < z.GetNumCols(); s++)
+    {
+        BOOST_CHECK(expected(2, s) != 0);
+        BOOST_CHECK_SMALL(z(2, s) - expected(2, s), 1e-9f);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
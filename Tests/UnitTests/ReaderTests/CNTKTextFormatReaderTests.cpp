@@ -16,6 +16,7 @@
 #include <boost/scope_exit.hpp>
 #include "Common/ReaderTestHelper.h"
 #include "TextParser.h"
+#include "Indexer.h"
 
 using namespace Microsoft::MSR::CNTK;
 
@@ -73,6 +74,60 @@ void SortLinesInFile(string filename, size_t expectedNumLines = 1)
     ofstream.close();
 }
 
+// Indexes a file, keeping the file open for the lifetime of the indexer.
+struct IndexedFile
+{
+    FILE* m_file;
+    unique_ptr<Indexer> m_indexer;
+
+    IndexedFile(const string& filename, bool cacheIndex, bool skipSequenceIds = false, size_t numberOfThreads = 1)
+    {
+        wstring path(filename.begin(), filename.end());
+        m_file = fopenOrDie(path, L"rbS");
+        m_indexer = make_unique<Indexer>(m_file, skipSequenceIds, 1024);
+        if (cacheIndex)
+        {
+            m_indexer->SetCacheFilePath(path + L".index");
+        }
+        if (numberOfThreads > 1)
+        {
+            // tiny ranges, so that the range boundaries fall on all kinds of positions
+            m_indexer->SetParallelScan(path, numberOfThreads, 64);
+        }
+        m_indexer->Build(std::make_shared<CorpusDescriptor>());
+    }
+
+    ~IndexedFile()
+    {
+        m_indexer.reset();
+        fclose(m_file);
+    }
+};
+
+void CheckIndexesEqual(const IndexedFile& expected, const IndexedFile& actual)
+{
+    BOOST_CHECK_EQUAL(expected.m_indexer->HasSequenceIds(), actual.m_indexer->HasSequenceIds());
+    const auto& a = expected.m_indexer->GetIndex();
+    const auto& b = actual.m_indexer->GetIndex();
+    BOOST_REQUIRE_EQUAL(a.m_chunks.size(), b.m_chunks.size());
+    for (size_t i = 0; i < a.m_chunks.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(a.m_chunks[i].m_id, b.m_chunks[i].m_id);
+        BOOST_CHECK_EQUAL(a.m_chunks[i].m_byteSize, b.m_chunks[i].m_byteSize);
+        BOOST_CHECK_EQUAL(a.m_chunks[i].m_numberOfSamples, b.m_chunks[i].m_numberOfSamples);
+        BOOST_REQUIRE_EQUAL(a.m_chunks[i].m_sequences.size(), b.m_chunks[i].m_sequences.size());
+        for (size_t j = 0; j < a.m_chunks[i].m_sequences.size(); ++j)
+        {
+            const auto& x = a.m_chunks[i].m_sequences[j];
+            const auto& y = b.m_chunks[i].m_sequences[j];
+            BOOST_CHECK_EQUAL(x.m_key.m_sequence, y.m_key.m_sequence);
+            BOOST_CHECK_EQUAL(x.m_fileOffsetBytes, y.m_fileOffsetBytes);
+            BOOST_CHECK_EQUAL(x.m_byteSize, y.m_byteSize);
+            BOOST_CHECK_EQUAL(x.m_numberOfSamples, y.m_numberOfSamples);
+        }
+    }
+    BOOST_CHECK(a.m_keyToSequenceInChunk == b.m_keyToSequenceInChunk);
+}
 
 struct CNTKTextFormatReaderFixture : ReaderFixture
 {
@@ -807,6 +862,78 @@ BOOST_AUTO_TEST_CASE(CompositeCNTKTextFormatReader_5x5_and_5x10_jagged_minibatch
         false);
 };
 
+BOOST_AUTO_TEST_CASE(CNTKTextFormatReader_IndexCache)
+{
+    auto input = boost::filesystem::unique_path(boost::filesystem::temp_directory_path() / "IndexCache_Input-%%%%-%%%%.txt").string();
+    auto cache = input + ".index";
+    boost::filesystem::remove(cache);
+    boost::filesystem::copy_file("50x20_jagged_sequences_dense.txt", input, boost::filesystem::copy_option::overwrite_if_exists);
+
+    {
+        IndexedFile reference(input, false);
+        IndexedFile scanned(input, true);
+        BOOST_REQUIRE(boost::filesystem::exists(cache));
+        IndexedFile cached(input, true);
+        CheckIndexesEqual(reference, scanned);
+        CheckIndexesEqual(reference, cached);
+    }
+
+    // a stale cache is detected and rebuilt
+    {
+        ofstream out(input, ios::app);
+        out << "12345|F0 1 2 3\n";
+    }
+    {
+        IndexedFile reference(input, false);
+        IndexedFile rebuilt(input, true);
+        CheckIndexesEqual(reference, rebuilt);
+        IndexedFile cached(input, true);
+        CheckIndexesEqual(reference, cached);
+
+        // the cache is specific to the indexing options
+        IndexedFile referenceLines(input, false, true);
+        IndexedFile cachedLines(input, true, true);
+        CheckIndexesEqual(referenceLines, cachedLines);
+    }
+    boost::filesystem::remove(cache);
+    boost::filesystem::remove(input);
+};
+
+BOOST_AUTO_TEST_CASE(CNTKTextFormatReader_ParallelIndexing)
+{
+    // sequences spanning several lines, lines without ids, repeated ids,
+    // blank lines and a trailing line consisting of digits only
+    auto input = boost::filesystem::unique_path(boost::filesystem::temp_directory_path() / "ParallelIndexing_Input-%%%%-%%%%.txt").string();
+    {
+        ofstream out(input, ios::binary);
+        for (size_t i = 0; i < 300; ++i)
+        {
+            out << i / 3 << "|F0 " << i << "\n";
+            if (i % 7 == 0)
+                out << "|F0 " << i << "\n";
+            if (i % 11 == 0)
+                out << "\n";
+        }
+        out << "12345";
+    }
+
+    for (const string& filename : { input, string("50x20_jagged_sequences_dense.txt"),
+        string("100x100_jagged_sequences_sparse.txt"), string("Simple_dense.txt"),
+        string("contains_blank_lines.txt"), string("missing_trailing_newline.txt") })
+    {
+        for (bool skipSequenceIds : { false, true })
+        {
+            IndexedFile reference(filename, false, skipSequenceIds);
+            for (size_t numberOfThreads : { 2, 3, 7, 64 })
+            {
+                IndexedFile parallel(filename, false, skipSequenceIds, numberOfThreads);
+                CheckIndexesEqual(reference, parallel);
+            }
+        }
+    }
+    boost::filesystem::remove(input);
+};
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } } } }
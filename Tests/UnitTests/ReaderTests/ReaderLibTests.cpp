@@ -11,6 +11,7 @@
 #include "DataDeserializer.h"
 #include "BlockRandomizer.h"
 #include "CorpusDescriptor.h"
+#include "ChunkCache.h"
 #include "SequentialDeserializer.h"
 
 using namespace Microsoft::MSR::CNTK;
@@ -53,6 +54,11 @@ public:
         result.push_back(data);
     }
 
+    size_t SizeInBytes() const override
+    {
+        return (m_chunkEnd - m_chunkBegin) * m_sequenceLength * sizeof(float);
+    }
+
     ~MockChunk() override {};
 };
 
@@ -614,6 +620,57 @@ BOOST_AUTO_TEST_CASE(NoRandomizerOneEpoch)
                                   actual.begin(), actual.end());
 }
 
+BOOST_AUTO_TEST_CASE(ChunkCacheUnbounded)
+{
+    vector<float> data(10);
+    iota(data.begin(), data.end(), 0.0f);
+    auto mockDeserializer = make_shared<MockDeserializer>(5, 2, data);
+
+    ChunkCache cache(mockDeserializer);
+    for (int sweep = 0; sweep < 2; sweep++)
+    {
+        for (ChunkIdType i = 0; i < 5; i++)
+        {
+            cache.GetChunk(i);
+        }
+    }
+
+    BOOST_CHECK_EQUAL(cache.GetNumberOfMisses(), 5u);
+    BOOST_CHECK_EQUAL(cache.GetNumberOfHits(), 5u);
+    BOOST_CHECK_EQUAL(cache.GetNumberOfEvictions(), 0u);
+    BOOST_CHECK_EQUAL(cache.GetNumberOfCachedChunks(), 5u);
+    BOOST_CHECK_EQUAL(cache.GetSizeInBytes(), data.size() * sizeof(float));
+}
+
+BOOST_AUTO_TEST_CASE(ChunkCacheEvictsLeastRecentlyUsed)
+{
+    vector<float> data(10);
+    iota(data.begin(), data.end(), 0.0f);
+    auto mockDeserializer = make_shared<MockDeserializer>(5, 2, data);
+
+    // Each chunk has 2 sequences of a single float, so the budget fits two chunks.
+    const size_t chunkSize = 2 * sizeof(float);
+    ChunkCache cache(mockDeserializer, 2 * chunkSize);
+
+    ChunkPtr chunk0 = cache.GetChunk(0);
+    cache.GetChunk(1);
+    BOOST_CHECK(cache.GetChunk(0) == chunk0); // chunk 0 becomes the most recently used
+    cache.GetChunk(2);                         // evicts chunk 1
+
+    BOOST_CHECK_EQUAL(cache.GetNumberOfEvictions(), 1u);
+    BOOST_CHECK_EQUAL(cache.GetNumberOfCachedChunks(), 2u);
+    BOOST_CHECK_EQUAL(cache.GetSizeInBytes(), 2 * chunkSize);
+
+    BOOST_CHECK(cache.GetChunk(0) == chunk0);
+    BOOST_CHECK_EQUAL(cache.GetNumberOfHits(), 2u);
+
+    cache.GetChunk(1); // was evicted, evicts chunk 2
+    BOOST_CHECK_EQUAL(cache.GetNumberOfMisses(), 4u);
+    BOOST_CHECK_EQUAL(cache.GetNumberOfEvictions(), 2u);
+    BOOST_CHECK(cache.GetChunk(0) == chunk0);
+    BOOST_CHECK_EQUAL(cache.GetNumberOfHits(), 3u);
+}
+
 BOOST_AUTO_TEST_CASE(DefaultCorpusDescriptor)
 {
     const int seed = 13;